@@ -90,7 +90,87 @@ extern "C"
 #define SDI_TL_BUF_SIZE         270
 #define SDI_SPI_PAYLOAD_SIZE    255
 #define SDI_SPI_HDR_LEN         4
-  
+
+// TX frame pool. Outbound messages live in one of these fixed-size frames
+// from reserve until the transport reports TX done. The default holds one BLE
+// data message at the largest ATT MTU (247 - 3).
+#if !defined(SDI_TX_FRAME_SIZE)
+#define SDI_TX_FRAME_SIZE       244
+#endif
+
+#if !defined(SDI_TX_FRAME_CNT)
+#define SDI_TX_FRAME_CNT        6
+#endif
+
+// TX batching defaults, see SDITask_setTxConfig. When enabled, queued frames
+// are packed into a single transfer of up to SDI_TL_BUF_SIZE bytes and a
+// partial batch is held for at most SDI_TX_BATCH_MAX_DELAY ms.
+#if !defined(SDI_TX_BATCH_ENABLE)
+#define SDI_TX_BATCH_ENABLE     0
+#endif
+
+#if !defined(SDI_TX_BATCH_MAX_DELAY)
+#define SDI_TX_BATCH_MAX_DELAY  2
+#endif
+
+// Logical channels, see SDITask_setChannelConfig. Each channel has its own TX
+// queue and, with SDI_USE_FRAMING, its own RX callback. Channels start out
+// with SDI_CHANNEL_WEIGHT frames per round-robin turn. While any channel has
+// strict priority, SDI_TX_FRAME_STRICT_RESERVE pool frames are kept for
+// strict priority channels only.
+#if !defined(SDI_CHANNEL_CNT)
+#define SDI_CHANNEL_CNT         2
+#endif
+
+#if !defined(SDI_CHANNEL_WEIGHT)
+#define SDI_CHANNEL_WEIGHT      1
+#endif
+
+#if !defined(SDI_TX_FRAME_STRICT_RESERVE)
+#define SDI_TX_FRAME_STRICT_RESERVE 1
+#endif
+
+// RX delivery to the app, see SDITask_setRxDeliverySize. Received bytes are
+// handed over when the line goes idle or once the high-water mark is reached,
+// in chunks of at most that size. SDI_RX_IDLE_TIMEOUT (ms) is the backstop
+// for a host write that ends exactly on a UART read boundary.
+#if !defined(SDI_RX_DELIVERY_MAX)
+#define SDI_RX_DELIVERY_MAX     244
+#endif
+
+#if !defined(SDI_RX_DELIVERY_SIZE)
+#define SDI_RX_DELIVERY_SIZE    128
+#endif
+
+#if !defined(SDI_RX_IDLE_TIMEOUT)
+#define SDI_RX_IDLE_TIMEOUT     5
+#endif
+
+// RX backpressure, see SDITask_setRxWatermarks. The UART is throttled once the
+// RX ring holds SDI_RXBUF_HIGH_WATER bytes and reopened when it drains to
+// SDI_RXBUF_LOW_WATER. High water must leave room for a read already under
+// way, ie. one UART ISR buffer.
+#if !defined(SDI_RXBUF_HIGH_WATER)
+#define SDI_RXBUF_HIGH_WATER    (SDI_RXBUF_SIZE - 128)
+#endif
+
+#if !defined(SDI_RXBUF_LOW_WATER)
+#define SDI_RXBUF_LOW_WATER     (SDI_RXBUF_SIZE / 4)
+#endif
+
+// Optional wire framing, see sdi_frame.h. Define SDI_USE_FRAMING to carry
+// each message in a COBS frame with a type, sequence number and CRC-16.
+// SDI_FRAME_MAX_PAYLOAD bounds the frames accepted from the host.
+#if !defined(SDI_FRAME_MAX_PAYLOAD)
+#define SDI_FRAME_MAX_PAYLOAD   SDI_RX_DELIVERY_MAX
+#endif
+
+// RX ring between the transport layer and the SDI task. Must be a power of
+// two and hold at least one transport read.
+#if !defined(SDI_RXBUF_SIZE)
+#define SDI_RXBUF_SIZE          512
+#endif
+
 #ifdef NPI_USE_SPI
 #  if (NPI_TL_BUF_SIZE - NPI_SPI_HDR_LEN) < NPI_SPI_PAYLOAD_SIZE
 #    define NPI_MAX_FRAG_SIZE       (NPI_TL_BUF_SIZE - NPI_SPI_HDR_LEN)
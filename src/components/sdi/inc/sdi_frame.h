@@ -0,0 +1,197 @@
+/******************************************************************************
+
+ @file  sdi_frame.h
+
+  SDI wire framing. Each message is sent as one COBS encoded frame:
+  [type][seq][payload][CRC-16], followed by a 0x00 delimiter.
+  Portable C, no RTOS or driver dependencies.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//******************************************************************************
+#ifndef SDIFRAME_H
+#define SDIFRAME_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// ****************************************************************************
+// includes
+// ****************************************************************************
+#include <stdint.h>
+
+// ****************************************************************************
+// defines
+// ****************************************************************************
+
+//! \brief Marks the end of every encoded frame on the wire
+#define SDI_FRAME_DELIM             0x00
+
+//! \brief Type and sequence bytes ahead of the payload
+#define SDI_FRAME_HDR_LEN           2
+
+//! \brief CRC-16/CCITT-FALSE, sent LSB first after the payload
+#define SDI_FRAME_CRC_LEN           2
+#define SDI_FRAME_CRC_INIT          0xFFFF
+
+//! \brief Unencoded size of a frame carrying n payload bytes
+#define SDI_FRAME_RAW_LEN(n)        ((n) + SDI_FRAME_HDR_LEN + SDI_FRAME_CRC_LEN)
+
+//! \brief Worst case size on the wire of a frame carrying n payload bytes,
+//!        including COBS overhead and the delimiter
+#define SDI_FRAME_ENCODED_MAX(n)    (SDI_FRAME_RAW_LEN(n) + \
+                                     (SDI_FRAME_RAW_LEN(n) / 254) + 2)
+
+//! \brief Frame types, in the low nibble of the type byte
+#define SDI_FRAME_TYPE_DATA         0x01
+#define SDI_FRAME_TYPE_MASK         0x0F
+
+//! \brief The high nibble of the type byte carries the logical channel, so
+//!        channel 0 frames keep the plain type values
+#define SDI_FRAME_CHANNEL_SHIFT     4
+#define SDI_FRAME_MAX_CHANNELS      16
+
+#define SDI_FRAME_MAKE_TYPE(type, ch) \
+    ((uint8_t)(((ch) << SDI_FRAME_CHANNEL_SHIFT) | (type)))
+#define SDI_FRAME_GET_TYPE(t)       ((t) & SDI_FRAME_TYPE_MASK)
+#define SDI_FRAME_GET_CHANNEL(t)    ((uint8_t)(t) >> SDI_FRAME_CHANNEL_SHIFT)
+
+//! \brief SDIFrame_decode status
+#define SDI_FRAME_OK                0   //!< A valid frame was decoded
+#define SDI_FRAME_INCOMPLETE        1   //!< All input used, no delimiter yet
+#define SDI_FRAME_ERR_CRC           2   //!< Frame failed the CRC check
+#define SDI_FRAME_ERR_FORMAT        3   //!< Truncated or malformed frame
+#define SDI_FRAME_ERR_OVERFLOW      4   //!< Frame larger than decode buffer
+
+// ****************************************************************************
+// typedefs
+// ****************************************************************************
+
+//! \brief A decoded frame. pPayload points into the decoder's buffer and is
+//!        only valid until the next call to SDIFrame_decode.
+typedef struct
+{
+    uint8_t  type;
+    uint8_t  seq;
+    uint8_t  *pPayload;
+    uint16_t len;
+} SDIFrame_t;
+
+//! \brief Streaming decoder state, see SDIFrame_initDecoder
+typedef struct
+{
+    uint8_t  *pBuf;         //!< Holds the frame being decoded
+    uint16_t size;          //!< Size of pBuf
+    uint16_t len;           //!< Bytes decoded so far
+    uint8_t  remaining;     //!< Data bytes left in the current COBS block
+    uint8_t  zeroPending;   //!< Current block ends in an implicit zero
+    uint8_t  overflow;      //!< Frame outgrew pBuf, discard until delimiter
+} SDIFrame_Decoder_t;
+
+//*****************************************************************************
+// globals
+//*****************************************************************************
+
+//*****************************************************************************
+// function prototypes
+//*****************************************************************************
+
+// -----------------------------------------------------------------------------
+//! \brief      Update a CRC-16/CCITT-FALSE with more bytes
+//!
+//! \param[in]  crc  - CRC so far, SDI_FRAME_CRC_INIT to start
+//! \param[in]  pBuf - bytes to add
+//! \param[in]  len  - number of bytes
+//!
+//! \return     uint16_t - updated CRC
+// -----------------------------------------------------------------------------
+uint16_t SDIFrame_crc16(uint16_t crc, const uint8_t *pBuf, uint16_t len);
+
+// -----------------------------------------------------------------------------
+//! \brief      Encode a message as one frame, delimiter included
+//!
+//! \param[in]  type     - frame type
+//! \param[in]  seq      - sequence number
+//! \param[in]  pPayload - message bytes
+//! \param[in]  len      - message length
+//! \param[out] pOut     - where to write the encoded frame
+//! \param[in]  outSize  - size of pOut
+//!
+//! \return     uint16_t - bytes written, 0 if pOut is smaller than
+//!             SDI_FRAME_ENCODED_MAX(len)
+// -----------------------------------------------------------------------------
+uint16_t SDIFrame_encode(uint8_t type, uint8_t seq, const uint8_t *pPayload,
+                         uint16_t len, uint8_t *pOut, uint16_t outSize);
+
+// -----------------------------------------------------------------------------
+//! \brief      Prepare a decoder. pBuf must hold SDI_FRAME_RAW_LEN of the
+//!             largest payload expected.
+//!
+//! \param[in]  pDec - decoder state
+//! \param[in]  pBuf - decode buffer
+//! \param[in]  size - size of pBuf
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDIFrame_initDecoder(SDIFrame_Decoder_t *pDec, uint8_t *pBuf,
+                          uint16_t size);
+
+// -----------------------------------------------------------------------------
+//! \brief      Feed received bytes to a decoder. Stops right after the first
+//!             delimiter that ends a frame, so the caller can act on it and
+//!             call again with the rest of the input.
+//!
+//! \param[in]  pDec    - decoder state
+//! \param[in]  pIn     - received bytes
+//! \param[in]  len     - number of received bytes
+//! \param[out] pFrame  - filled in when *pStatus is SDI_FRAME_OK
+//! \param[out] pStatus - SDI_FRAME_OK, SDI_FRAME_INCOMPLETE or an error
+//!
+//! \return     uint16_t - number of bytes of pIn consumed
+// -----------------------------------------------------------------------------
+uint16_t SDIFrame_decode(SDIFrame_Decoder_t *pDec, const uint8_t *pIn,
+                         uint16_t len, SDIFrame_t *pFrame, uint8_t *pStatus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SDIFRAME_H */
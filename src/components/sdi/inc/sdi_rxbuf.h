@@ -75,28 +75,74 @@ extern "C"
 //*****************************************************************************
 
 // -----------------------------------------------------------------------------
-//! \brief      SDIRxBuf_Read
+//! \brief      Move up to len bytes from the transport layer into RxBuf.
+//!             Called from the transport RX call back (producer side).
 //!
-//! \param[in]  len -
+//! \param[in]  len - number of bytes the transport layer has received
 //!
-//! \return     uint16 -
+//! \return     uint16 - number of bytes stored, less than len if RxBuf is full
 // -----------------------------------------------------------------------------
 uint16 SDIRxBuf_Read(uint16);
 
 // -----------------------------------------------------------------------------
 //! \brief      Returns number of bytes that are unparsed in RxBuf
 //!
-//! \return     uint16 -
+//! \return     uint16 - number of bytes, SDI_RXBUF_SIZE when full
 // -----------------------------------------------------------------------------
-uint16 SDIRxBuf_GetRxBufLen();
+uint16 SDIRxBuf_GetRxBufLen(void);
 
 // -----------------------------------------------------------------------------
-//! \brief      SDIRxBuf_ReadFromRxBuf
+//! \brief      Copy up to len bytes out of RxBuf and consume them
 //!
-//! \return     uint16 -
+//! \param[out] buf - destination buffer
+//! \param[in]  len - maximum number of bytes to copy
+//!
+//! \return     uint16 - number of bytes copied
 // -----------------------------------------------------------------------------
 uint16 SDIRxBuf_ReadFromRxBuf(uint8_t *buf, uint16 len);
 
+// -----------------------------------------------------------------------------
+//! \brief      Get the contiguous span of unread bytes at the front of RxBuf
+//!             without consuming it.
+//!
+//! \param[out] ppBuf - set to the first unread byte
+//!
+//! \return     uint16 - length of the span, may be less than
+//!             SDIRxBuf_GetRxBufLen() when the data wraps
+// -----------------------------------------------------------------------------
+uint16 SDIRxBuf_Peek(uint8_t **ppBuf);
+
+// -----------------------------------------------------------------------------
+//! \brief      Consume bytes previously obtained through SDIRxBuf_Peek
+//!
+//! \param[in]  len - number of bytes to release back to the producer
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDIRxBuf_Consume(uint16 len);
+
+// -----------------------------------------------------------------------------
+//! \brief      Get the contiguous span of free space at the back of RxBuf, for
+//!             a producer that writes into RxBuf in place (eg. a UART_read
+//!             issued straight into it). Publish the bytes with
+//!             SDIRxBuf_Commit once they have arrived.
+//!
+//! \param[out] ppBuf - set to the first free byte
+//!
+//! \return     uint16 - length of the span, 0 when RxBuf is full
+// -----------------------------------------------------------------------------
+uint16 SDIRxBuf_GetWriteSpan(uint8_t **ppBuf);
+
+// -----------------------------------------------------------------------------
+//! \brief      Publish bytes written into the span from SDIRxBuf_GetWriteSpan
+//!             to the consumer.
+//!
+//! \param[in]  len - number of bytes written, at most the span length
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDIRxBuf_Commit(uint16 len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -61,6 +61,19 @@ extern "C"
 // ****************************************************************************
 #define DEBUG(x) SDITask_sendToUART(x, strlen(x));
 #define DEBUG_NEWLINE() DEBUG("\n\r")
+
+//! \brief Number of TX latency buckets in SDI_Stats_t. Bucket 0 counts frames
+//!        sent within 1 ms of their commit, bucket n those that took
+//!        [2^(n-1), 2^n) ms, and the last bucket everything slower.
+#define SDI_STATS_LAT_BUCKETS   8
+
+//! \brief Channel used by the channel-less API, ie. SDITask_sendToUART
+#define SDI_CHANNEL_DEFAULT     0
+
+//! \brief Channel weight that gives a channel strict priority over all
+//!        weighted channels, see SDI_ChannelConfig_t
+#define SDI_CHANNEL_WEIGHT_STRICT 0
+
 // ****************************************************************************
 // typedefs
 // ****************************************************************************
@@ -72,11 +85,56 @@ extern "C"
 //!             free this memory.
 //!             NOTE: The contained message buffer does NOT include any "framing"
 //!             bytes, ie. SOF, FCS etc.
+//! \param[in]  event  Event type, ie. UART_DATA_EVT
 //! \param[in]  pMsg   Pointer to "unframed" message buffer.
+//! \param[in]  len    Length of the message, at most the RX delivery size
 //!
 //! \return     void
 // -----------------------------------------------------------------------------
-typedef void (*sdiIncomingEventCBack_t)(uint8_t event, uint8_t *pMsg, uint8_t len);
+typedef void (*sdiIncomingEventCBack_t)(uint8_t event, uint8_t *pMsg, uint16_t len);
+
+//! \brief TX scheduling configuration, see SDITask_setTxConfig
+typedef struct
+{
+    uint8_t  batchEnable;     //!< Pack queued frames into a single transfer
+    uint16_t batchMaxDelay;   //!< ms a partial batch may wait, 0 = no wait
+} SDI_TxConfig_t;
+
+//! \brief Logical channel configuration, see SDITask_setChannelConfig
+typedef struct
+{
+    uint8_t weight;           //!< Frames sent per round-robin turn, or
+                              //!< SDI_CHANNEL_WEIGHT_STRICT to always go first
+} SDI_ChannelConfig_t;
+
+//! \brief SDI runtime counters, see SDITask_getStats. Average batch size is
+//!        txFrames / txTransfers.
+typedef struct
+{
+    // Host to SDI
+    uint32_t rxBytes;          //!< Bytes received from the host into the RX ring
+    uint32_t rxDroppedBytes;   //!< Bytes lost because the RX buffers were full
+    uint32_t uartErrors;       //!< UART error events (overrun, framing, ...)
+    uint16_t rxBufHighWater;   //!< Most bytes the RX ring has held
+
+    // SDI to host
+    uint16_t txQueueHighWater; //!< Most frames the TX queue has held
+    uint32_t txBytes;          //!< Bytes handed to the transport layer
+    uint32_t txFrames;         //!< TX frames carried by those transfers
+    uint32_t txTransfers;      //!< Transfers handed to the transport layer
+    uint32_t txTimerFlushes;   //!< Partial batches sent by the max-delay timer
+    uint32_t txRetries;        //!< Transfers the transport refused, kept and sent again
+    uint32_t txPoolEmpty;      //!< Reserve calls that found no free TX frame
+    uint16_t txPoolHighWater;  //!< Most TX frames reserved at once
+    uint32_t txLatency[SDI_STATS_LAT_BUCKETS]; //!< Commit to TX done per frame
+
+    // Wire framing, only counted with SDI_USE_FRAMING
+    uint32_t rxFrames;         //!< Valid frames received from the host
+    uint32_t crcErrors;        //!< Frames dropped for a bad CRC
+    uint32_t formatErrors;     //!< Truncated or malformed frames dropped
+    uint32_t frameOverflows;   //!< Frames dropped for exceeding SDI_FRAME_MAX_PAYLOAD
+    uint32_t seqGaps;          //!< Breaks in the host's sequence numbers
+} SDI_Stats_t;
 
 //*****************************************************************************
 // globals
@@ -103,17 +161,217 @@ Void SDITask_createTask(void);
 // -----------------------------------------------------------------------------
 extern void SDITask_registerIncomingRXEventAppCB(sdiIncomingEventCBack_t appRxCB);
 
+// -----------------------------------------------------------------------------
+//! \brief      Register the callback for messages the host sends on a logical
+//!             channel. Without SDI_USE_FRAMING the host cannot mark channels
+//!             and everything arrives on SDI_CHANNEL_DEFAULT.
+//!
+//! \param[in]  channel   Channel, below SDI_CHANNEL_CNT
+//! \param[in]  appRxCB   Callback function, NULL to drop the channel's data
+//!
+//! \return     uint8_t - SUCCESS, or FAILURE for an unknown channel
+// -----------------------------------------------------------------------------
+extern uint8_t SDITask_registerChannelRxCB(uint8_t channel,
+                                           sdiIncomingEventCBack_t appRxCB);
+
+// -----------------------------------------------------------------------------
+//! \brief      Channel the data passed to the running RX callback came in on,
+//!             for callbacks registered on several channels. Only meaningful
+//!             from within that callback.
+//!
+//! \return     uint8_t - channel, below SDI_CHANNEL_CNT
+// -----------------------------------------------------------------------------
+extern uint8_t SDITask_getRxChannel(void);
+
+// -----------------------------------------------------------------------------
+//! \brief      Set how a logical channel shares the UART. Channels with strict
+//!             priority are served first, lowest channel first. The others
+//!             take turns, each sending up to its weight in frames per turn.
+//!             A frame that has started out is never interrupted, so a strict
+//!             channel waits for at most one transfer.
+//!
+//! \param[in]  channel   Channel, below SDI_CHANNEL_CNT
+//! \param[in]  pConfig   New configuration
+//!
+//! \return     uint8_t - SUCCESS, or FAILURE for an unknown channel
+// -----------------------------------------------------------------------------
+extern uint8_t SDITask_setChannelConfig(uint8_t channel,
+                                        const SDI_ChannelConfig_t *pConfig);
+
+// -----------------------------------------------------------------------------
+//! \brief      Set the RX high-water mark. Received bytes are passed to the
+//!             incoming RX callback as soon as the host stops sending, or once
+//!             this many are waiting, and never more than this many at a
+//!             time. Typically set to ATT MTU - 3 so that one callback fills
+//!             exactly one GATT operation.
+//!
+//! \param[in]  size    Delivery size, clamped to [1, SDI_RX_DELIVERY_MAX]
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void SDITask_setRxDeliverySize(uint16_t size);
+
+// -----------------------------------------------------------------------------
+//! \brief      Stop or resume RX delivery to the app, eg. while the app's own
+//!             queue towards BLE is full. While held, received bytes stay in
+//!             the SDI RX ring, and once that passes its high watermark the
+//!             host is held off through UART flow control.
+//!
+//! \param[in]  hold    TRUE to stop delivering, FALSE to resume
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void SDITask_holdRx(uint8_t hold);
+
+// -----------------------------------------------------------------------------
+//! \brief      Set the RX ring levels at which the host is held off (high) and
+//!             let go again (low). The high watermark must leave room for one
+//!             transport read that may already be under way.
+//!
+//! \param[in]  highWater  Bytes in the RX ring that throttle the UART
+//! \param[in]  lowWater   Bytes in the RX ring that reopen it, below highWater
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void SDITask_setRxWatermarks(uint16_t highWater, uint16_t lowWater);
+
 // -----------------------------------------------------------------------------
 //! \brief      API for application task to send a message to the Host.
 //!             NOTE: It's assumed all message traffic to the stack will use
 //!             other (ICALL) APIs/Interfaces.
+//!             The message is copied into TX pool frames, messages longer than
+//!             SDI_TX_FRAME_SIZE are split over several frames. Either all of
+//!             a message is queued or none of it.
 //!
 //! \param[in]  pMsg    Pointer to "unframed" message buffer.
 //! \param[in]  length  Length of buffer
 //!
+//! \return     uint8_t - SUCCESS, or FAILURE if the TX pool had too few free
+//!             frames, in which case nothing was queued
+// -----------------------------------------------------------------------------
+extern uint8_t SDITask_sendToUART(uint8_t *pMsg, uint16_t length);
+
+// -----------------------------------------------------------------------------
+//! \brief      Send a message to the Host on a logical channel, see
+//!             SDITask_sendToUART.
+//!
+//! \param[in]  channel Channel, below SDI_CHANNEL_CNT
+//! \param[in]  pMsg    Pointer to "unframed" message buffer.
+//! \param[in]  length  Length of buffer
+//!
+//! \return     uint8_t - SUCCESS, or FAILURE if the TX pool had too few free
+//!             frames or the channel is unknown, in which case nothing was
+//!             queued
+// -----------------------------------------------------------------------------
+extern uint8_t SDITask_sendToChannel(uint8_t channel, uint8_t *pMsg,
+                                     uint16_t length);
+
+// -----------------------------------------------------------------------------
+//! \brief      Reserve a TX pool frame the caller can write a message into
+//!             directly. The frame must be handed back with either
+//!             SDITask_commitTxFrame or SDITask_releaseTxFrame.
+//!
+//! \param[in]  length  Number of bytes the caller intends to write
+//!
+//! \return     uint8_t* - frame payload, NULL if length exceeds
+//!             SDI_TX_FRAME_SIZE or no frame is free
+// -----------------------------------------------------------------------------
+extern uint8_t *SDITask_reserveTxFrame(uint16_t length);
+
+// -----------------------------------------------------------------------------
+//! \brief      Reserve a TX pool frame for a message on a logical channel.
+//!             Strict priority channels may also take the frames held back
+//!             by SDI_TX_FRAME_STRICT_RESERVE.
+//!
+//! \param[in]  channel Channel the frame will be committed to
+//! \param[in]  length  Number of bytes the caller intends to write
+//!
+//! \return     uint8_t* - frame payload, NULL if none is available
+// -----------------------------------------------------------------------------
+extern uint8_t *SDITask_reserveChannelTxFrame(uint8_t channel, uint16_t length);
+
+// -----------------------------------------------------------------------------
+//! \brief      Queue a reserved frame for transmission. The frame is sent from
+//!             where it is, without copying, and returns to the pool once the
+//!             transport reports TX done.
+//!
+//! \param[in]  pFrame  Frame payload returned by SDITask_reserveTxFrame
+//! \param[in]  length  Number of bytes written into the frame
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void SDITask_commitTxFrame(uint8_t *pFrame, uint16_t length);
+
+// -----------------------------------------------------------------------------
+//! \brief      Queue a reserved frame for transmission on a logical channel,
+//!             see SDITask_commitTxFrame.
+//!
+//! \param[in]  channel Channel, below SDI_CHANNEL_CNT
+//! \param[in]  pFrame  Frame payload returned by SDITask_reserveTxFrame
+//! \param[in]  length  Number of bytes written into the frame
+//!
+//! \return     uint8_t - SUCCESS, or FAILURE for an unknown channel, in which
+//!             case the frame goes back to the pool
+// -----------------------------------------------------------------------------
+extern uint8_t SDITask_commitChannelTxFrame(uint8_t channel, uint8_t *pFrame,
+                                            uint16_t length);
+
+// -----------------------------------------------------------------------------
+//! \brief      Return a reserved frame to the pool without sending it.
+//!
+//! \param[in]  pFrame  Frame payload returned by SDITask_reserveTxFrame
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void SDITask_releaseTxFrame(uint8_t *pFrame);
+
+// -----------------------------------------------------------------------------
+//! \brief      Number of TX pool frames a logical channel could reserve right
+//!             now. Lets a producer that cannot wait, like a BLE peer, be told
+//!             up front how many messages it may send.
+//!
+//! \param[in]  channel Channel the frames would be committed to
+//!
+//! \return     uint8_t - free frames, 0 for an unknown channel
+// -----------------------------------------------------------------------------
+extern uint8_t SDITask_getTxFreeFrames(uint8_t channel);
+
+// -----------------------------------------------------------------------------
+//! \brief      Configure how queued TX frames are scheduled onto the
+//!             transport. Takes effect from the next transfer.
+//!
+//! \param[in]  pConfig  New configuration
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void SDITask_setTxConfig(const SDI_TxConfig_t *pConfig);
+
+// -----------------------------------------------------------------------------
+//! \brief      Read the current TX scheduling configuration.
+//!
+//! \param[out] pConfig  Filled with the current configuration
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void SDITask_getTxConfig(SDI_TxConfig_t *pConfig);
+
+// -----------------------------------------------------------------------------
+//! \brief      Read the SDI runtime counters. Counters are only ever written
+//!             from the context that owns them, the snapshot is taken in a
+//!             critical section.
+//!
+//! \param[out] pStats  Filled with a snapshot of the counters
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void SDITask_getStats(SDI_Stats_t *pStats);
+
+// -----------------------------------------------------------------------------
+//! \brief      Zero the SDI runtime counters, including the high-water marks.
+//!
 //! \return     void
 // -----------------------------------------------------------------------------
-extern void SDITask_sendToUART(uint8_t *pMsg, uint16_t length);
+extern void SDITask_resetStats(void);
 
 #ifdef __cplusplus
 {
@@ -67,12 +67,18 @@ extern "C"
 #define transportWrite SDITLUART_writeTransport
 #define transportStopTransfer SDITLUART_stopTransfer
 #define transportMrdyEvent SDITLUART_handleMrdyEvent
+#define transportRxIdle SDITLUART_isRxIdle
+#define transportRxFlow SDITLUART_setRxFlow
+#define transportErrorCounts SDITLUART_getErrorCounts
 #elif defined(NPI_USE_SPI)
 #define transportInit NPITLSPI_initializeTransport
 #define transportRead NPITLSPI_readTransport
 #define transportWrite NPITLSPI_writeTransport
 #define transportStopTransfer NPITLSPI_stopTransfer
 #define transportMrdyEvent NPITLSPI_handleMrdyEvent
+#define transportRxIdle NPITLSPI_isRxIdle
+#define transportRxFlow NPITLSPI_setRxFlow
+#define transportErrorCounts NPITLSPI_getErrorCounts
 #endif
 
 // ****************************************************************************
@@ -130,6 +136,8 @@ uint16 SDITL_readTL(uint8 *buf, uint16 len);
 
 // -----------------------------------------------------------------------------
 //! \brief      This routine writes data from the buffer to the transport layer.
+//!             The buffer is transmitted in place, so it must stay valid until
+//!             the TX complete call back.
 //!
 //! \param[in]  buf - Pointer to buffer to write data from.
 //! \param[in]  len - Number of bytes to write.
@@ -175,6 +183,37 @@ uint16 SDITL_getRxBufLen(void);
 // -----------------------------------------------------------------------------
 bool SDITL_checkSdiBusy(void);
 
+// -----------------------------------------------------------------------------
+//! \brief      This routine returns whether the bytes just reported through the
+//!             RX call back end at an idle line. Only valid from within that
+//!             call back.
+//!
+//! \return     bool - TRUE if the host has stopped sending after those bytes
+// -----------------------------------------------------------------------------
+bool SDITL_isRxIdle(void);
+
+// -----------------------------------------------------------------------------
+//! \brief      This routine throttles (FALSE) or reopens (TRUE) the receive
+//!             path of the transport, holding the host off while SDI catches up.
+//!
+//! \param[in]  enable - TRUE to receive, FALSE to hold the host off
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITL_setRxFlow(bool enable);
+
+// -----------------------------------------------------------------------------
+//! \brief      This routine returns the running counts of transport errors and
+//!             of received bytes the transport had to drop. The counts are
+//!             never reset.
+//!
+//! \param[out] pErrors - transport error events since start up
+//! \param[out] pRxDropped - received bytes dropped since start up
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITL_getErrorCounts(uint32 *pErrors, uint32 *pRxDropped);
+
 /*******************************************************************************
  */
 
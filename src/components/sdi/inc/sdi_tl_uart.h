@@ -103,20 +103,31 @@ extern UART_Params paramsUART;
 // function prototypes
 //*****************************************************************************
 
+// -----------------------------------------------------------------------------
+//! \brief      Reopen the UART with new line settings. SDI keeps its own read
+//!             and write modes and callbacks, everything else (baud rate, data
+//!             format, ...) is taken from initParams.
+//!             Hardware RTS/CTS is used whenever the board's UART hwAttrs
+//!             assign the ctsPin/rtsPin. RTS is then deasserted by the UART
+//!             itself while SDI holds off reading, see SDITLUART_setRxFlow.
+//!
+//! \param[in]  initParams - new settings, NULL to reopen with the current ones
+//!
+//! \return     uint8 - SUCCESS or FAILURE
+// -----------------------------------------------------------------------------
 uint8 SDITLUART_configureUARTParams(UART_Params *initParams);
 
 // -----------------------------------------------------------------------------
 //! \brief      This routine initializes the transport layer and opens the port
 //!             of the device.
 //!
-//! \param[in]  tRxBuf - pointer to SDI TL Tx Buffer
-//! \param[in]  tTxBuf - pointer to SDI TL Rx Buffer
+//! \param[in]  tRxBuf - pointer to SDI TL Rx Buffer
 //! \param[in]  sdiCBack - SDI TL call back function to be invoked at the end of 
 //!             a UART transaction                     
 //!
 //! \return     void
 // -----------------------------------------------------------------------------
-void SDITLUART_initializeTransport(Char *tRxBuf, Char *tTxBuf, sdiCB_t sdiCBack);
+void SDITLUART_initializeTransport(Char *tRxBuf, sdiCB_t sdiCBack);
 
 void SDITLUART_closeUART(void);
 
@@ -132,20 +143,24 @@ extern void SDITLUART_registerIncomingRXErrorStatusAppCB(sdiTLIncomingEventCBack
 
 
 // -----------------------------------------------------------------------------
-//! \brief      This routine reads data from the UART
+//! \brief      This routine reads data from the UART. Without POWER_SAVING the
+//!             read goes straight into free space of the SDI RX ring (see
+//!             SDIRxBuf_GetWriteSpan), otherwise through the TL buffer.
 //!
 //! \return     void
 // -----------------------------------------------------------------------------
 void SDITLUART_readTransport(void);
 
 // -----------------------------------------------------------------------------
-//! \brief      This routine writes copies buffer addr to the transport layer.
+//! \brief      This routine hands a buffer to the UART for transmission. The
+//!             buffer is not copied and must stay valid until write completion.
 //!
+//! \param[in]  tTxBuf - Pointer to buffer to write data from.
 //! \param[in]  len - Number of bytes to write.
 //!
 //! \return     uint16 - number of bytes written to transport
 // -----------------------------------------------------------------------------
-uint16 SDITLUART_writeTransport(uint16);
+uint16 SDITLUART_writeTransport(Char *tTxBuf, uint16 len);
 
 // -----------------------------------------------------------------------------
 //! \brief      This routine stops any pending reads
@@ -162,6 +177,41 @@ void SDITLUART_stopTransfer(void);
 // -----------------------------------------------------------------------------
 void SDITLUART_handleMrdyEvent(void);
 
+// -----------------------------------------------------------------------------
+//! \brief      Whether the bytes most recently passed up by the RX call back
+//!             end at an idle line, ie. the read returned on the UART receive
+//!             timeout (or the MRDY transaction ended) rather than on a full
+//!             ISR buffer. Only meaningful from within that call back.
+//!
+//! \return     bool - TRUE if the line went idle after those bytes
+// -----------------------------------------------------------------------------
+bool SDITLUART_isRxIdle(void);
+
+// -----------------------------------------------------------------------------
+//! \brief      Throttle or reopen the receive path. While RX flow is off no new
+//!             UART_read is issued, incoming bytes back up in the UART FIFO and,
+//!             with hardware flow control, RTS is deasserted towards the host.
+//!             In POWER_SAVING builds the MRDY/SRDY handshake paces the host
+//!             instead and this has no effect.
+//!
+//! \param[in]  enable - TRUE to receive, FALSE to hold the host off
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITLUART_setRxFlow(bool enable);
+
+// -----------------------------------------------------------------------------
+//! \brief      Running counts of UART error events (as reported to the error
+//!             status call back) and of received bytes dropped because the TL
+//!             receive buffer was full. Never reset, callers take deltas.
+//!
+//! \param[out] pErrors - UART error events since start up
+//! \param[out] pRxDropped - bytes dropped since start up
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITLUART_getErrorCounts(uint32 *pErrors, uint32 *pRxDropped);
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,337 @@
+/******************************************************************************
+
+ @file  sdi_frame.c
+
+  SDI wire framing: COBS encoding, CRC-16 and a streaming decoder.
+  Portable C, no RTOS or driver dependencies.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+// ****************************************************************************
+// includes
+// ****************************************************************************
+#include <stdint.h>
+#include <string.h>
+
+#include "inc/sdi_frame.h"
+
+// ****************************************************************************
+// defines
+// ****************************************************************************
+
+//! \brief Largest COBS code, a block of 254 data bytes with no zero after it
+#define SDIFRAME_COBS_MAX_CODE      0xFF
+
+// ****************************************************************************
+// typedefs
+// ****************************************************************************
+
+//! \brief COBS encoder state while a frame is being written
+typedef struct
+{
+    uint8_t  *pOut;
+    uint16_t pos;       //!< Next free byte of pOut
+    uint16_t codeIdx;   //!< Where the current block's code byte goes
+    uint8_t  code;      //!< Current block length + 1
+} SDIFrame_Encoder_t;
+
+//*****************************************************************************
+// globals
+//*****************************************************************************
+
+//! \brief CRC-16/CCITT-FALSE, one nibble at a time
+static const uint16_t crcNibbleTable[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+//*****************************************************************************
+// function prototypes
+//*****************************************************************************
+
+static void SDIFrame_cobsPut(SDIFrame_Encoder_t *pEnc, const uint8_t *pBuf,
+                             uint16_t len);
+
+static void SDIFrame_resetDecoder(SDIFrame_Decoder_t *pDec);
+
+// -----------------------------------------------------------------------------
+//! \brief      Update a CRC-16/CCITT-FALSE with more bytes
+//!
+//! \param[in]  crc  - CRC so far, SDI_FRAME_CRC_INIT to start
+//! \param[in]  pBuf - bytes to add
+//! \param[in]  len  - number of bytes
+//!
+//! \return     uint16_t - updated CRC
+// -----------------------------------------------------------------------------
+uint16_t SDIFrame_crc16(uint16_t crc, const uint8_t *pBuf, uint16_t len)
+{
+    while (len--)
+    {
+        crc = (crc << 4) ^ crcNibbleTable[(crc >> 12) ^ (*pBuf >> 4)];
+        crc = (crc << 4) ^ crcNibbleTable[(crc >> 12) ^ (*pBuf & 0x0F)];
+        pBuf++;
+    }
+
+    return crc;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Encode a message as one frame, delimiter included
+//!
+//! \param[in]  type     - frame type
+//! \param[in]  seq      - sequence number
+//! \param[in]  pPayload - message bytes
+//! \param[in]  len      - message length
+//! \param[out] pOut     - where to write the encoded frame
+//! \param[in]  outSize  - size of pOut
+//!
+//! \return     uint16_t - bytes written, 0 if pOut is too small
+// -----------------------------------------------------------------------------
+uint16_t SDIFrame_encode(uint8_t type, uint8_t seq, const uint8_t *pPayload,
+                         uint16_t len, uint8_t *pOut, uint16_t outSize)
+{
+    SDIFrame_Encoder_t enc;
+    uint8_t hdr[SDI_FRAME_HDR_LEN];
+    uint8_t crcBytes[SDI_FRAME_CRC_LEN];
+    uint16_t crc;
+
+    if (((uint32_t)len + SDI_FRAME_HDR_LEN + SDI_FRAME_CRC_LEN) > 0xFF00 ||
+        outSize < SDI_FRAME_ENCODED_MAX(len))
+    {
+        return 0;
+    }
+
+    hdr[0] = type;
+    hdr[1] = seq;
+
+    crc = SDIFrame_crc16(SDI_FRAME_CRC_INIT, hdr, sizeof(hdr));
+    crc = SDIFrame_crc16(crc, pPayload, len);
+    crcBytes[0] = (uint8_t)crc;
+    crcBytes[1] = (uint8_t)(crc >> 8);
+
+    enc.pOut = pOut;
+    enc.codeIdx = 0;
+    enc.pos = 1;
+    enc.code = 1;
+
+    SDIFrame_cobsPut(&enc, hdr, sizeof(hdr));
+    SDIFrame_cobsPut(&enc, pPayload, len);
+    SDIFrame_cobsPut(&enc, crcBytes, sizeof(crcBytes));
+
+    // Close the last block and terminate the frame
+    pOut[enc.codeIdx] = enc.code;
+    pOut[enc.pos++] = SDI_FRAME_DELIM;
+
+    return enc.pos;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Prepare a decoder.
+//!
+//! \param[in]  pDec - decoder state
+//! \param[in]  pBuf - decode buffer
+//! \param[in]  size - size of pBuf
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDIFrame_initDecoder(SDIFrame_Decoder_t *pDec, uint8_t *pBuf,
+                          uint16_t size)
+{
+    pDec->pBuf = pBuf;
+    pDec->size = size;
+    SDIFrame_resetDecoder(pDec);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Feed received bytes to a decoder, stopping after the first
+//!             delimiter that ends a frame.
+//!
+//! \param[in]  pDec    - decoder state
+//! \param[in]  pIn     - received bytes
+//! \param[in]  len     - number of received bytes
+//! \param[out] pFrame  - filled in when *pStatus is SDI_FRAME_OK
+//! \param[out] pStatus - SDI_FRAME_OK, SDI_FRAME_INCOMPLETE or an error
+//!
+//! \return     uint16_t - number of bytes of pIn consumed
+// -----------------------------------------------------------------------------
+uint16_t SDIFrame_decode(SDIFrame_Decoder_t *pDec, const uint8_t *pIn,
+                         uint16_t len, SDIFrame_t *pFrame, uint8_t *pStatus)
+{
+    uint16_t i;
+    uint16_t rawLen;
+    uint16_t crc;
+    uint8_t b;
+
+    for (i = 0; i < len; i++)
+    {
+        b = pIn[i];
+
+        if (b == SDI_FRAME_DELIM)
+        {
+            // Back to back delimiters are idle fill, not empty frames
+            if ((pDec->len == 0) && !pDec->remaining && !pDec->zeroPending &&
+                !pDec->overflow)
+            {
+                continue;
+            }
+
+            rawLen = pDec->len;
+
+            if (pDec->overflow)
+            {
+                *pStatus = SDI_FRAME_ERR_OVERFLOW;
+            }
+            else if (pDec->remaining ||
+                     (rawLen < (SDI_FRAME_HDR_LEN + SDI_FRAME_CRC_LEN)))
+            {
+                *pStatus = SDI_FRAME_ERR_FORMAT;
+            }
+            else
+            {
+                // The implicit zero closing the last block is not part of
+                // the frame. CRC is sent LSB first.
+                rawLen -= SDI_FRAME_CRC_LEN;
+                crc = SDIFrame_crc16(SDI_FRAME_CRC_INIT, pDec->pBuf, rawLen);
+
+                if ((pDec->pBuf[rawLen] != (uint8_t)crc) ||
+                    (pDec->pBuf[rawLen + 1] != (uint8_t)(crc >> 8)))
+                {
+                    *pStatus = SDI_FRAME_ERR_CRC;
+                }
+                else
+                {
+                    pFrame->type = pDec->pBuf[0];
+                    pFrame->seq = pDec->pBuf[1];
+                    pFrame->pPayload = &pDec->pBuf[SDI_FRAME_HDR_LEN];
+                    pFrame->len = rawLen - SDI_FRAME_HDR_LEN;
+                    *pStatus = SDI_FRAME_OK;
+                }
+            }
+
+            SDIFrame_resetDecoder(pDec);
+            return i + 1;
+        }
+
+        if (pDec->overflow)
+        {
+            continue;
+        }
+
+        if (pDec->remaining == 0)
+        {
+            // Code byte, starts a new block
+            if (pDec->zeroPending)
+            {
+                if (pDec->len == pDec->size)
+                {
+                    pDec->overflow = 1;
+                    continue;
+                }
+                pDec->pBuf[pDec->len++] = 0;
+            }
+
+            pDec->remaining = b - 1;
+            pDec->zeroPending = (b != SDIFRAME_COBS_MAX_CODE);
+        }
+        else
+        {
+            if (pDec->len == pDec->size)
+            {
+                pDec->overflow = 1;
+                continue;
+            }
+            pDec->pBuf[pDec->len++] = b;
+            pDec->remaining--;
+        }
+    }
+
+    *pStatus = SDI_FRAME_INCOMPLETE;
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Append bytes to the frame being COBS encoded
+//!
+//! \param[in]  pEnc - encoder state
+//! \param[in]  pBuf - bytes to append
+//! \param[in]  len  - number of bytes
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDIFrame_cobsPut(SDIFrame_Encoder_t *pEnc, const uint8_t *pBuf,
+                             uint16_t len)
+{
+    while (len--)
+    {
+        if (*pBuf == 0)
+        {
+            pEnc->pOut[pEnc->codeIdx] = pEnc->code;
+            pEnc->codeIdx = pEnc->pos++;
+            pEnc->code = 1;
+        }
+        else
+        {
+            pEnc->pOut[pEnc->pos++] = *pBuf;
+            if (++pEnc->code == SDIFRAME_COBS_MAX_CODE)
+            {
+                pEnc->pOut[pEnc->codeIdx] = pEnc->code;
+                pEnc->codeIdx = pEnc->pos++;
+                pEnc->code = 1;
+            }
+        }
+        pBuf++;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Get a decoder ready for the next frame
+//!
+//! \param[in]  pDec - decoder state
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDIFrame_resetDecoder(SDIFrame_Decoder_t *pDec)
+{
+    pDec->len = 0;
+    pDec->remaining = 0;
+    pDec->zeroPending = 0;
+    pDec->overflow = 0;
+}
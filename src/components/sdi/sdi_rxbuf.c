@@ -57,11 +57,11 @@
 // ****************************************************************************
 // defines
 // ****************************************************************************
-#define SDIRXBUF_RXHEAD_INC(x)   RxBufHead += x;               \
-    RxBufHead %= SDI_TL_BUF_SIZE;
+#if (SDI_RXBUF_SIZE & (SDI_RXBUF_SIZE - 1)) || (SDI_RXBUF_SIZE > 0x8000)
+#error "SDI_RXBUF_SIZE must be a power of two no larger than 32768"
+#endif
 
-#define SDIRXBUF_RXTAIL_INC(x)   RxBufTail += x;               \
-    RxBufTail %= SDI_TL_BUF_SIZE;
+#define SDIRXBUF_MASK            (SDI_RXBUF_SIZE - 1)
 
 // ****************************************************************************
 // typedefs
@@ -72,67 +72,161 @@
 //*****************************************************************************
 
 //Recieve Buffer for all SDI messages
-static uint8 RxBuf[SDI_TL_BUF_SIZE];
-static uint16 RxBufHead = 0;
-static uint16 RxBufTail = 0;
+static uint8 RxBuf[SDI_RXBUF_SIZE];
+
+// Free running indices, masked on access. The transport RX call back is the
+// only writer of RxBufTail and the SDI task the only writer of RxBufHead, so
+// the two sides need no locking.
+static volatile uint16 RxBufHead = 0;
+static volatile uint16 RxBufTail = 0;
 
 //*****************************************************************************
 // function prototypes
 //*****************************************************************************
 
 // -----------------------------------------------------------------------------
-//! \brief      SDIRxBuf_Read
+//! \brief      Move up to len bytes from the transport layer into RxBuf.
+//!             Called from the transport RX call back (producer side).
 //!
-//! \param[in]  len -
+//! \param[in]  len - number of bytes the transport layer has received
 //!
-//! \return     uint16 -
+//! \return     uint16 - number of bytes stored, less than len if RxBuf is full
 // -----------------------------------------------------------------------------
 uint16 SDIRxBuf_Read(uint16 len)
 {
-    uint16 partialLen = 0;
+    uint16 tail = RxBufTail;
+    uint16 space = SDI_RXBUF_SIZE - (uint16)(tail - RxBufHead);
+    uint16 idx = tail & SDIRXBUF_MASK;
+    uint16 partialLen;
+    uint16 readLen;
+
+    if (len > space)
+    {
+        len = space;
+    }
 
     // Need to make two reads due to wrap around of circular buffer
-    if ((len + RxBufTail) > SDI_TL_BUF_SIZE)
+    partialLen = SDI_RXBUF_SIZE - idx;
+    if (partialLen > len)
     {
-        partialLen = SDI_TL_BUF_SIZE - RxBufTail;
-        SDITL_readTL(&RxBuf[RxBufTail],partialLen);
-        len -= partialLen;
-        RxBufTail = 0;
+        partialLen = len;
     }
 
-    // Read remainder of data from Transport Layer
-    SDITL_readTL(&RxBuf[RxBufTail],len);
-    SDIRXBUF_RXTAIL_INC(len);
+    readLen = SDITL_readTL(&RxBuf[idx], partialLen);
+
+    if ((readLen == partialLen) && (len > partialLen))
+    {
+        readLen += SDITL_readTL(&RxBuf[0], len - partialLen);
+    }
 
-    // Return len to original size
-    len += partialLen;
+    // Publish the bytes to the consumer only once they are in place
+    RxBufTail = tail + readLen;
 
-    return len;
+    return readLen;
 }
 
 // -----------------------------------------------------------------------------
 //! \brief      Returns number of bytes that are unparsed in RxBuf
 //!
-//! \return     uint16 -
+//! \return     uint16 - number of bytes, SDI_RXBUF_SIZE when full
 // -----------------------------------------------------------------------------
 uint16 SDIRxBuf_GetRxBufLen(void)
 {
-    return ((RxBufTail - RxBufHead) + SDI_TL_BUF_SIZE) % SDI_TL_BUF_SIZE;
+    return (uint16)(RxBufTail - RxBufHead);
 }
 
 // -----------------------------------------------------------------------------
-//! \brief      SDIRxBuf_ReadFromRxBuf
+//! \brief      Copy up to len bytes out of RxBuf and consume them
+//!
+//! \param[out] buf - destination buffer
+//! \param[in]  len - maximum number of bytes to copy
 //!
-//! \return     uint16 -
+//! \return     uint16 - number of bytes copied
 // -----------------------------------------------------------------------------
 uint16 SDIRxBuf_ReadFromRxBuf(uint8_t *buf, uint16 len)
 {
-	uint16_t idx;
-    for (idx = 0; idx < len; idx++)
+    uint16 head = RxBufHead;
+    uint16 avail = (uint16)(RxBufTail - head);
+    uint16 idx = head & SDIRXBUF_MASK;
+    uint16 partialLen;
+
+    if (len > avail)
+    {
+        len = avail;
+    }
+
+    partialLen = SDI_RXBUF_SIZE - idx;
+    if (partialLen > len)
     {
-        *buf++ = RxBuf[RxBufHead];
-        SDIRXBUF_RXHEAD_INC(1)
+        partialLen = len;
     }
 
+    memcpy(buf, &RxBuf[idx], partialLen);
+    memcpy(buf + partialLen, &RxBuf[0], len - partialLen);
+
+    RxBufHead = head + len;
+
     return len;
 }
+
+// -----------------------------------------------------------------------------
+//! \brief      Get the contiguous span of unread bytes at the front of RxBuf
+//!             without consuming it.
+//!
+//! \param[out] ppBuf - set to the first unread byte
+//!
+//! \return     uint16 - length of the span, may be less than
+//!             SDIRxBuf_GetRxBufLen() when the data wraps
+// -----------------------------------------------------------------------------
+uint16 SDIRxBuf_Peek(uint8_t **ppBuf)
+{
+    uint16 head = RxBufHead;
+    uint16 avail = (uint16)(RxBufTail - head);
+    uint16 idx = head & SDIRXBUF_MASK;
+
+    *ppBuf = &RxBuf[idx];
+
+    return (avail > (SDI_RXBUF_SIZE - idx)) ? (SDI_RXBUF_SIZE - idx) : avail;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Consume bytes previously obtained through SDIRxBuf_Peek
+//!
+//! \param[in]  len - number of bytes to release back to the producer
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDIRxBuf_Consume(uint16 len)
+{
+    RxBufHead += len;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Get the contiguous span of free space at the back of RxBuf
+//!
+//! \param[out] ppBuf - set to the first free byte
+//!
+//! \return     uint16 - length of the span, 0 when RxBuf is full
+// -----------------------------------------------------------------------------
+uint16 SDIRxBuf_GetWriteSpan(uint8_t **ppBuf)
+{
+    uint16 tail = RxBufTail;
+    uint16 space = SDI_RXBUF_SIZE - (uint16)(tail - RxBufHead);
+    uint16 idx = tail & SDIRXBUF_MASK;
+
+    *ppBuf = &RxBuf[idx];
+
+    return (space > (SDI_RXBUF_SIZE - idx)) ? (SDI_RXBUF_SIZE - idx) : space;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Publish bytes written in place to the consumer
+//!
+//! \param[in]  len - number of bytes written, at most the span length
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDIRxBuf_Commit(uint16 len)
+{
+    RxBufTail += len;
+}
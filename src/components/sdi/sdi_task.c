@@ -57,12 +57,18 @@
 #include <ti/sysbios/knl/Event.h>
 
 #include <string.h>
+#include <stddef.h>
 #include <ti/sysbios/family/arm/m3/Hwi.h>
 
+#include "bcomdef.h"
+#include "inc/sdi_config.h"
 #include "inc/sdi_task.h"
 #include "inc/sdi_data.h"
 #include "inc/sdi_rxbuf.h"
 #include "inc/sdi_tl.h"
+#ifdef SDI_USE_FRAMING
+#include "inc/sdi_frame.h"
+#endif //SDI_USE_FRAMING
 
 // ****************************************************************************
 // defines
@@ -80,6 +86,44 @@
 //! \brief MRDY Received Event
 #define SDITASK_MRDY_EVENT              Event_Id_03
 
+//! \brief TX batch max-delay timer expired
+#define SDITASK_TX_FLUSH_EVENT          Event_Id_04
+
+//! \brief No TX channel has anything queued
+#define SDITASK_NO_CHANNEL              0xFF
+
+#if (SDI_CHANNEL_CNT == 0) || \
+    (defined(SDI_USE_FRAMING) && (SDI_CHANNEL_CNT > SDI_FRAME_MAX_CHANNELS))
+#error "SDI_CHANNEL_CNT must be at least 1, and at most 16 with SDI_USE_FRAMING"
+#endif
+
+#if (SDI_TX_FRAME_STRICT_RESERVE >= SDI_TX_FRAME_CNT)
+#error "SDI_TX_FRAME_STRICT_RESERVE must leave frames for weighted channels"
+#endif
+
+#if (SDI_RX_DELIVERY_MAX > SDI_RXBUF_SIZE)
+#error "SDI_RX_DELIVERY_MAX must not exceed SDI_RXBUF_SIZE"
+#endif
+
+#if (SDI_RXBUF_HIGH_WATER > SDI_RXBUF_SIZE) || \
+    (SDI_RXBUF_LOW_WATER >= SDI_RXBUF_HIGH_WATER)
+#error "SDI_RXBUF_LOW_WATER < SDI_RXBUF_HIGH_WATER <= SDI_RXBUF_SIZE required"
+#endif
+
+//! \brief Bytes a queued TX frame takes up on the wire. Framed messages are
+//!        always encoded into the staging buffer, never sent in place.
+#ifdef SDI_USE_FRAMING
+#define SDITASK_TX_WIRE_LEN(len)        SDI_FRAME_ENCODED_MAX(len)
+#define SDITASK_TX_ALWAYS_STAGED        TRUE
+
+#if (SDI_FRAME_ENCODED_MAX(SDI_TX_FRAME_SIZE) > SDI_TL_BUF_SIZE)
+#error "An encoded SDI_TX_FRAME_SIZE frame must fit in SDI_TL_BUF_SIZE"
+#endif
+#else
+#define SDITASK_TX_WIRE_LEN(len)        (len)
+#define SDITASK_TX_ALWAYS_STAGED        FALSE
+#endif //SDI_USE_FRAMING
+
 //! \brief Size of stack created for SDI RTOS task
 #define SDITASK_STACK_SIZE 512
 
@@ -91,24 +135,27 @@
 // typedefs
 // ****************************************************************************
 
-//! \brief Queue record structure
+//! \brief TX pool frame. Sits on the free queue while unused and on the
+//!        ASYNC TX queue between commit and transmission.
 //!
-typedef struct SDI_QueueRec_t 
+typedef struct SDI_TxFrame_t
 {
     Queue_Elem _elem;
-    SDIMSG_msg_t *sdiMsg;
-} SDI_QueueRec;
+    uint16_t len;
+    uint8_t channel;
+    uint32_t commitTicks;
+    uint8_t payload[SDI_TX_FRAME_SIZE];
+} SDI_TxFrame;
+
+//! \brief Get the owning TX pool frame from a payload pointer
+#define SDITASK_FRAME_FROM_PAYLOAD(p) \
+    ((SDI_TxFrame *)((uint8_t *)(p) - offsetof(SDI_TxFrame, payload)))
 
 
 //*****************************************************************************
 // globals
 //*****************************************************************************
 
-uint8 buf[SDI_TL_BUF_SIZE] ={0x00,};
-uint16 length;
-uint8 lengthRead;
-uint8 bufTest[SDI_TL_BUF_SIZE] ={0x00,};
-uint16 lenTest = 0;
 //! \brief ICall ID for stack which will be sending SDI messages
 //!
 //static uint32_t stackServiceID = 0x0000;
@@ -121,15 +168,102 @@ static Task_Struct sdiTaskStruct;
 //!
 Char sdiTaskStack[SDITASK_STACK_SIZE];
 
-//! \brief Handle for the ASYNC TX Queue
+//! \brief Handles for the ASYNC TX Queues, one per logical channel
+//!
+static Queue_Struct sdiTxQueueStruct[SDI_CHANNEL_CNT];
+static Queue_Handle sdiTxQueue[SDI_CHANNEL_CNT];
+
+//! \brief TX channel scheduling. Strict priority channels go first, the
+//!        others take turns sending up to their weight in frames.
+//!
+static uint8_t sdiTxWeight[SDI_CHANNEL_CNT];
+static uint8_t sdiTxRrChannel;
+static uint8_t sdiTxRrCredit;
+
+//! \brief TX frame pool and the queue of frames not currently in use. The
+//!        last sdiTxFrameReserve free frames are for strict priority channels.
 //!
-static Queue_Handle sdiTxQueue;
+static SDI_TxFrame sdiTxFrames[SDI_TX_FRAME_CNT];
+static Queue_Struct sdiTxFreeQueueStruct;
+static Queue_Handle sdiTxFreeQueue;
+static uint8_t sdiTxFreeCnt;
+static uint8_t sdiTxFrameReserve;
 
-//! \brief Pointer to last tx message.  This is free'd once confirmation is
+//! \brief Last tx frame. This is returned to the pool once confirmation is
 //!        is received that the buffer has been transmitted
 //!        (ie. SDITASK_TRANSPORT_TX_DONE_EVENT)
 //!
-static uint8_t *lastQueuedTxMsg;
+static SDI_TxFrame *lastQueuedTxFrame;
+
+//! \brief Bytes and frames committed to the ASYNC TX queue and not yet sent
+//!
+static uint16_t sdiTxQueuedLen;
+static uint16_t sdiTxQueuedFrames;
+
+//! \brief Commit times of the frames in the transfer under way, for the TX
+//!        latency histogram
+//!
+static uint32_t sdiTxInFlightTicks[SDI_TX_FRAME_CNT];
+static uint8_t sdiTxInFlightCnt;
+
+//! \brief TX batching. Frames packed into one transfer are copied here and
+//!        go straight back to the pool.
+//!
+static uint8_t sdiTxBatchBuf[SDI_TL_BUF_SIZE];
+
+//! \brief A transfer staged in sdiTxBatchBuf that the transport refused,
+//!        sent again before anything else. 0 if there is none.
+//!
+static uint16_t sdiTxRetryLen;
+static uint16_t sdiTxRetryFrames;
+static SDI_TxConfig_t sdiTxConfig = { SDI_TX_BATCH_ENABLE,
+                                      SDI_TX_BATCH_MAX_DELAY };
+
+//! \brief Bounds how long a partial batch waits for more frames
+//!
+static Clock_Struct sdiTxFlushClockStruct;
+static Clock_Handle sdiTxFlushClock;
+static uint8_t sdiTxFlushDue;
+
+//! \brief RX delivery. Bytes wrapping around the end of the RX ring are
+//!        gathered here before being handed to the app.
+//!
+static uint8_t sdiRxDeliveryBuf[SDI_RX_DELIVERY_MAX];
+static uint16_t sdiRxDeliverySize = SDI_RX_DELIVERY_SIZE;
+
+//! \brief Bytes at the front of the RX ring that precede the last idle line
+//!
+static uint16_t sdiRxIdleLen;
+
+//! \brief RX backpressure. The transport is throttled while the RX ring is
+//!        above the high watermark, and deliveries stop while the app holds.
+//!
+static uint16_t sdiRxHighWater = SDI_RXBUF_HIGH_WATER;
+static uint16_t sdiRxLowWater = SDI_RXBUF_LOW_WATER;
+static uint8_t sdiRxFlowOff;
+static uint8_t sdiRxHeld;
+
+//! \brief Backstop for an idle line the UART driver does not report
+//!
+static Clock_Struct sdiRxIdleClockStruct;
+static Clock_Handle sdiRxIdleClock;
+
+#ifdef SDI_USE_FRAMING
+//! \brief Wire framing. Each direction numbers its frames independently.
+//!
+static uint8_t sdiTxSeq;
+static uint8_t sdiRxSeq;
+static uint8_t sdiRxSeqValid;
+static uint8_t sdiRxFrameBuf[SDI_FRAME_RAW_LEN(SDI_FRAME_MAX_PAYLOAD)];
+static SDIFrame_Decoder_t sdiRxDecoder;
+#endif //SDI_USE_FRAMING
+
+//! \brief Runtime counters, plus the transport's running error counts at the
+//!        last reset
+//!
+static SDI_Stats_t sdiStats;
+static uint32_t sdiStatsErrorBase;
+static uint32_t sdiStatsRxDropBase;
 
 Event_Struct uartEvent;
 Event_Handle hUartEvent; //!< Event used to control the UART thread
@@ -138,10 +272,14 @@ Event_Handle hUartEvent; //!< Event used to control the UART thread
 //!
 ICall_EntityID sdiAppEntityID = 0;
 
-//! \brief Pointer to Application RX event callback function for optional
-//!        rerouting of messages to application.
+//! \brief Pointers to Application RX event callback functions for optional
+//!        rerouting of messages to application, one per logical channel.
+//!
+static sdiIncomingEventCBack_t incomingRXEventAppCBFunc[SDI_CHANNEL_CNT];
+
+//! \brief Channel of the data currently being passed to an RX callback.
 //!
-static sdiIncomingEventCBack_t incomingRXEventAppCBFunc = NULL;
+static uint8_t sdiRxChannel = SDI_CHANNEL_DEFAULT;
 
 //*****************************************************************************
 // function prototypes
@@ -167,6 +305,64 @@ static void SDITask_MRDYEventCB(int size);
 //!
 static void SDITask_ProcessTXQ(void);
 
+//! \brief Decide whether a partial batch should wait for more frames.
+//!
+static uint8_t SDITask_holdTxBatch(void);
+
+//! \brief Whether any TX channel has frames queued
+//!
+static uint8_t SDITask_txPending(void);
+
+//! \brief Channel the TX scheduler would send from next
+//!
+static uint8_t SDITask_pickTxChannel(void);
+
+//! \brief Dequeue the next frame of a TX channel and charge its turn
+//!
+static SDI_TxFrame *SDITask_takeTxFrame(uint8_t channel);
+
+//! \brief Claim TX pool frames for a channel, all of them or none
+//!
+static uint8_t SDITask_claimTxFrames(uint8_t channel, uint16_t count);
+
+//! \brief Return a TX frame to the pool
+//!
+static void SDITask_freeTxFrame(SDI_TxFrame *pFrame);
+
+//! \brief Clock function for the TX batch max-delay timer
+//!
+static void SDITask_txFlushClockFxn(UArg arg);
+
+#ifdef SDI_USE_FRAMING
+//! \brief Decode received frames and hand their payload to the app
+//!
+static void SDITask_ProcessFramedRX(void);
+#else
+//! \brief Hand received bytes to the app
+//!
+static void SDITask_ProcessRX(void);
+#endif //SDI_USE_FRAMING
+
+//! \brief Reopen the transport once the RX ring has drained
+//!
+static void SDITask_checkRxFlow(void);
+
+//! \brief Copy a TX frame into the staging buffer
+//!
+static uint16_t SDITask_stageTxFrame(SDI_TxFrame *pFrame, uint16_t offset);
+
+//! \brief Hand the staging buffer to the transport, or keep it for a retry
+//!
+static void SDITask_writeTxBatch(uint16_t len, uint16_t frames);
+
+//! \brief Add the frames of a finished transfer to the TX latency histogram
+//!
+static void SDITask_recordTxLatency(void);
+
+//! \brief Clock function for the RX idle backstop timer
+//!
+static void SDITask_rxIdleClockFxn(UArg arg);
+
 
 // -----------------------------------------------------------------------------
 //! \brief      Initialization for the SDI Thread
@@ -175,16 +371,66 @@ static void SDITask_ProcessTXQ(void);
 // -----------------------------------------------------------------------------
 static void SDITask_inititializeTask(void)
 {
-    lastQueuedTxMsg = NULL;
+    uint8_t i;
+
+    lastQueuedTxFrame = NULL;
+    sdiTxQueuedLen = 0;
+    sdiTxQueuedFrames = 0;
+    sdiTxInFlightCnt = 0;
+    sdiTxRetryLen = 0;
+    sdiTxFlushDue = FALSE;
+    sdiRxIdleLen = 0;
+    sdiRxFlowOff = FALSE;
+    sdiRxHeld = FALSE;
+
+#ifdef SDI_USE_FRAMING
+    sdiTxSeq = 0;
+    sdiRxSeqValid = FALSE;
+    SDIFrame_initDecoder(&sdiRxDecoder, sdiRxFrameBuf, sizeof(sdiRxFrameBuf));
+#endif //SDI_USE_FRAMING
+
+    // create a Tx Queue instance per channel
+    for (i = 0; i < SDI_CHANNEL_CNT; i++)
+    {
+        Queue_construct(&sdiTxQueueStruct[i], NULL);
+        sdiTxQueue[i] = Queue_handle(&sdiTxQueueStruct[i]);
+        sdiTxWeight[i] = SDI_CHANNEL_WEIGHT;
+    }
+
+    sdiTxRrChannel = 0;
+    sdiTxRrCredit = 0;
+    sdiTxFrameReserve = (SDI_CHANNEL_WEIGHT == SDI_CHANNEL_WEIGHT_STRICT) ?
+                        SDI_TX_FRAME_STRICT_RESERVE : 0;
 
-    // create a Tx Queue instance
-    sdiTxQueue = Queue_create(NULL, NULL);
+    // Fill the free queue with every frame of the TX pool
+    Queue_construct(&sdiTxFreeQueueStruct, NULL);
+    sdiTxFreeQueue = Queue_handle(&sdiTxFreeQueueStruct);
+
+    for (i = 0; i < SDI_TX_FRAME_CNT; i++)
+    {
+        Queue_put(sdiTxFreeQueue, &sdiTxFrames[i]._elem);
+    }
+    sdiTxFreeCnt = SDI_TX_FRAME_CNT;
 
     Event_Params evParams;
     Event_Params_init(&evParams);
 
     Event_construct(&uartEvent, &evParams);
     hUartEvent = Event_handle(&uartEvent);
+
+    // One-shot, the timeout is set each time a partial batch starts waiting
+    Clock_Params clockParams;
+    Clock_Params_init(&clockParams);
+    clockParams.period = 0;
+    clockParams.startFlag = FALSE;
+    Clock_construct(&sdiTxFlushClockStruct, SDITask_txFlushClockFxn, 1,
+                    &clockParams);
+    sdiTxFlushClock = Clock_handle(&sdiTxFlushClockStruct);
+
+    Clock_construct(&sdiRxIdleClockStruct, SDITask_rxIdleClockFxn,
+                    (SDI_RX_IDLE_TIMEOUT * 1000) / Clock_tickPeriod,
+                    &clockParams);
+    sdiRxIdleClock = Clock_handle(&sdiRxIdleClockStruct);
     
     // Initialize Network Processor Interface (SDI) and Transport Layer
     SDITL_initTL( &SDITask_transportTxDoneCallBack,
@@ -206,7 +452,7 @@ static void SDITask_process(void)
     while (1)
     {
         /* Wait for response message */
-        postedEvents = Event_pend(hUartEvent, Event_Id_NONE, SDITASK_MRDY_EVENT | SDITASK_TX_READY_EVENT | SDITASK_TRANSPORT_RX_EVENT | SDITASK_TRANSPORT_TX_DONE_EVENT, BIOS_WAIT_FOREVER);
+        postedEvents = Event_pend(hUartEvent, Event_Id_NONE, SDITASK_MRDY_EVENT | SDITASK_TX_READY_EVENT | SDITASK_TX_FLUSH_EVENT | SDITASK_TRANSPORT_RX_EVENT | SDITASK_TRANSPORT_TX_DONE_EVENT, BIOS_WAIT_FOREVER);
         
         {
             // Capture the ISR events flags now within this task loop.  
@@ -220,18 +466,34 @@ static void SDITask_process(void)
 
             }
 
+            // A partial batch has waited long enough, send it as it is
+            if (postedEvents & SDITASK_TX_FLUSH_EVENT)
+            {
+                sdiTxFlushDue = TRUE;
+                sdiStats.txTimerFlushes++;
+                postedEvents |= SDITASK_TX_READY_EVENT;
+            }
+
             // An ASYNC message is ready to send to the Host
             if(postedEvents & SDITASK_TX_READY_EVENT)
             {
 
-                if ((!Queue_empty(sdiTxQueue)) && !SDITL_checkSdiBusy())
+                uint8_t txHeld = FALSE;
+
+                if (SDITask_txPending() && !SDITL_checkSdiBusy())
                 {
-                    SDITask_ProcessTXQ();
+                    txHeld = SDITask_holdTxBatch();
+
+                    if (!txHeld)
+                    {
+                        SDITask_ProcessTXQ();
+                    }
                 }
   
-                if (Queue_empty(sdiTxQueue))
+                if (!SDITask_txPending() || txHeld)
                 {
-                    // Q is empty, no action.
+                    // Q is empty, or a partial batch is waiting for the
+                    // flush timer or the next commit, no action.
  
                 }
                 else
@@ -245,36 +507,13 @@ static void SDITask_process(void)
             // The Transport Layer has received some bytes
             if(postedEvents & SDITASK_TRANSPORT_RX_EVENT)
             {
-#define MAX_UART_LENGTH 128
-                length = SDIRxBuf_GetRxBufLen();
+#ifdef SDI_USE_FRAMING
+                SDITask_ProcessFramedRX();
+#else
+                SDITask_ProcessRX();
+#endif //SDI_USE_FRAMING
 
-                if(length > MAX_UART_LENGTH)
-                {
-                  lengthRead = MAX_UART_LENGTH;
-                }else
-                {
-                  lengthRead = (length & 0xFF);
-                }
-                
-                //bufTest[lenTest++] = length;
-                
-                //Do custom app processing
-                SDIRxBuf_ReadFromRxBuf(buf, lengthRead);
-                
-                //Echo back via UART
-                //SDITask_sendToUART(buf, length);
-
-                if (incomingRXEventAppCBFunc != NULL)
-                {
-                  incomingRXEventAppCBFunc( UART_DATA_EVT , buf, lengthRead);
-                }
-                
-                if(length > MAX_UART_LENGTH)
-                {
-                    // Additional bytes to collect, preserve the flag and repost
-                    // to the semaphore
-                    Event_post(hUartEvent, SDITASK_TRANSPORT_RX_EVENT);
-                }
+                SDITask_checkRxFlow();
             }
 
             // The last transmission to the host has completed.
@@ -282,7 +521,7 @@ static void SDITask_process(void)
             {
                 // Current TX is done.
              
-                    if (!Queue_empty(sdiTxQueue))
+                    if (SDITask_txPending())
                     {
                         // There are pending ASYNC messages waiting to be sent
                         // to the host.  Post to event.
@@ -352,124 +591,1102 @@ void SDITask_createTask(void)
 // -----------------------------------------------------------------------------
 void SDITask_registerIncomingRXEventAppCB(sdiIncomingEventCBack_t appRxCB)
 {
-    incomingRXEventAppCBFunc = appRxCB;
+    SDITask_registerChannelRxCB(SDI_CHANNEL_DEFAULT, appRxCB);
 }
 
 // -----------------------------------------------------------------------------
-//! \brief      API for application task to send a message to the Host.
-//!             NOTE: It's assumed all message traffic to the stack will use
-//!             other (ICALL) APIs/Interfaces.
+//! \brief      Register the callback for messages the host sends on a logical
+//!             channel.
 //!
-//! \param[in]  pMsg    Pointer to "unframed" message buffer.
+//! \param[in]  channel   Channel, below SDI_CHANNEL_CNT
+//! \param[in]  appRxCB   Callback function, NULL to drop the channel's data
 //!
-//! \return     void
+//! \return     uint8_t - SUCCESS, or FAILURE for an unknown channel
+// -----------------------------------------------------------------------------
+uint8_t SDITask_registerChannelRxCB(uint8_t channel,
+                                    sdiIncomingEventCBack_t appRxCB)
+{
+    if (channel >= SDI_CHANNEL_CNT)
+    {
+        return FAILURE;
+    }
+
+    incomingRXEventAppCBFunc[channel] = appRxCB;
+
+    return SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Channel the data passed to the running RX callback came in on.
+//!
+//! \return     uint8_t - channel, below SDI_CHANNEL_CNT
+// -----------------------------------------------------------------------------
+uint8_t SDITask_getRxChannel(void)
+{
+    return sdiRxChannel;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Set how a logical channel shares the UART.
+//!
+//! \param[in]  channel   Channel, below SDI_CHANNEL_CNT
+//! \param[in]  pConfig   New configuration
+//!
+//! \return     uint8_t - SUCCESS, or FAILURE for an unknown channel
 // -----------------------------------------------------------------------------
-void SDITask_sendToUART(uint8_t *pMsg, uint16 length)
+uint8_t SDITask_setChannelConfig(uint8_t channel,
+                                 const SDI_ChannelConfig_t *pConfig)
 {
     ICall_CSState key;
-    SDI_QueueRec *recPtr;
+    uint8_t reserve = 0;
+    uint8_t i;
 
-    SDIMSG_msg_t *pSDIMsg =(SDIMSG_msg_t *)ICall_malloc( sizeof(SDIMSG_msg_t));
-    
-    key = ICall_enterCriticalSection();	
-    
-    if(pSDIMsg)
+    if (channel >= SDI_CHANNEL_CNT)
     {
-      pSDIMsg->msgType = SDIMSG_Type_ASYNC;
-      pSDIMsg->pBuf = (uint8 *)ICall_allocMsg(length);
-      pSDIMsg->pBufSize = length;
-        
-      if(pSDIMsg->pBuf)
-      {
-          // Payload
-          memcpy(pSDIMsg->pBuf, pMsg, length);
-      }
-      
-      recPtr = ICall_malloc(sizeof(SDI_QueueRec));
-
-      recPtr->sdiMsg = pSDIMsg;
+        return FAILURE;
     }
-    
-    switch (pSDIMsg->msgType)
+
+    key = ICall_enterCriticalSection();
+    sdiTxWeight[channel] = pConfig->weight;
+
+    // Only hold pool frames back while someone can use them
+    for (i = 0; i < SDI_CHANNEL_CNT; i++)
     {
-        case SDIMSG_Type_ASYNC:
-        {
-            Queue_enqueue(sdiTxQueue, &recPtr->_elem);
-            Event_post(hUartEvent, SDITASK_TX_READY_EVENT);
-            break;
-        }
-        default:
+        if (sdiTxWeight[i] == SDI_CHANNEL_WEIGHT_STRICT)
         {
-            //error
-            break;
+            reserve = SDI_TX_FRAME_STRICT_RESERVE;
         }
     }
+    sdiTxFrameReserve = reserve;
     ICall_leaveCriticalSection(key);
+
+    // A channel that became strict may release a held batch
+    Event_post(hUartEvent, SDITASK_TX_READY_EVENT);
+
+    return SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Set the RX high-water mark, ie. the largest amount of received
+//!             data passed to the incoming RX callback in one go.
+//!
+//! \param[in]  size    Delivery size, clamped to [1, SDI_RX_DELIVERY_MAX]
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITask_setRxDeliverySize(uint16_t size)
+{
+    if (size == 0)
+    {
+        size = 1;
+    }
+    else if (size > SDI_RX_DELIVERY_MAX)
+    {
+        size = SDI_RX_DELIVERY_MAX;
+    }
+
+    sdiRxDeliverySize = size;
+
+    // Bytes already waiting may satisfy the new mark
+    Event_post(hUartEvent, SDITASK_TRANSPORT_RX_EVENT);
 }
 
+// -----------------------------------------------------------------------------
+//! \brief      Stop or resume RX delivery to the app.
+//!
+//! \param[in]  hold    TRUE to stop delivering, FALSE to resume
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITask_holdRx(uint8_t hold)
+{
+    sdiRxHeld = hold;
+
+    if (!hold)
+    {
+        // Deliver whatever piled up meanwhile
+        Event_post(hUartEvent, SDITASK_TRANSPORT_RX_EVENT);
+    }
+}
 
 // -----------------------------------------------------------------------------
-//! \brief      Dequeue next message in the ASYNC TX Queue and send to serial
-//!             interface.
+//! \brief      Set the RX ring levels at which the host is held off and let go.
+//!
+//! \param[in]  highWater  Bytes in the RX ring that throttle the UART
+//! \param[in]  lowWater   Bytes in the RX ring that reopen it
 //!
 //! \return     void
 // -----------------------------------------------------------------------------
-static void SDITask_ProcessTXQ(void)
+void SDITask_setRxWatermarks(uint16_t highWater, uint16_t lowWater)
+{
+    ICall_CSState key;
+
+    if (highWater > SDI_RXBUF_SIZE)
+    {
+        highWater = SDI_RXBUF_SIZE;
+    }
+
+    if (lowWater >= highWater)
+    {
+        lowWater = highWater - 1;
+    }
+
+    key = ICall_enterCriticalSection();
+    sdiRxHighWater = highWater;
+    sdiRxLowWater = lowWater;
+    ICall_leaveCriticalSection(key);
+
+    // The ring may already be past the new levels either way
+    Event_post(hUartEvent, SDITASK_TRANSPORT_RX_EVENT);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Reopen the transport once the RX ring has drained to the low
+//!             watermark.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_checkRxFlow(void)
 {
+    ICall_CSState key;
+    uint8_t reopen = FALSE;
+
+    key = ICall_enterCriticalSection();
+    if (sdiRxFlowOff && (SDIRxBuf_GetRxBufLen() <= sdiRxLowWater))
+    {
+        sdiRxFlowOff = FALSE;
+        reopen = TRUE;
+    }
+    ICall_leaveCriticalSection(key);
+
+    if (reopen)
+    {
+        SDITL_setRxFlow(TRUE);
+    }
+}
 
-    SDI_QueueRec *recPtr = NULL;
+// -----------------------------------------------------------------------------
+//! \brief      API for application task to send a message to the Host.
+//!             NOTE: It's assumed all message traffic to the stack will use
+//!             other (ICALL) APIs/Interfaces.
+//!
+//! \param[in]  pMsg    Pointer to "unframed" message buffer.
+//! \param[in]  length  Length of buffer
+//!
+//! \return     uint8_t - SUCCESS, or FAILURE if the TX pool ran out
+// -----------------------------------------------------------------------------
+uint8_t SDITask_sendToUART(uint8_t *pMsg, uint16 length)
+{
+    return SDITask_sendToChannel(SDI_CHANNEL_DEFAULT, pMsg, length);
+}
 
-    recPtr = Queue_dequeue(sdiTxQueue);
+// -----------------------------------------------------------------------------
+//! \brief      Send a message to the Host on a logical channel.
+//!
+//! \param[in]  channel Channel, below SDI_CHANNEL_CNT
+//! \param[in]  pMsg    Pointer to "unframed" message buffer.
+//! \param[in]  length  Length of buffer
+//!
+//! \return     uint8_t - SUCCESS, or FAILURE if the TX pool ran out or the
+//!             channel is unknown, in which case nothing was queued
+// -----------------------------------------------------------------------------
+uint8_t SDITask_sendToChannel(uint8_t channel, uint8_t *pMsg, uint16_t length)
+{
+    uint8_t *pFrame;
+    uint16_t fragLen;
+
+    // Every fragment's frame is claimed before any is queued, so the host
+    // never sees the head of a message whose tail found no frame
+    if ((channel >= SDI_CHANNEL_CNT) ||
+        !SDITask_claimTxFrames(channel,
+            (length + SDI_TX_FRAME_SIZE - 1) / SDI_TX_FRAME_SIZE))
+    {
+        return FAILURE;
+    }
 
-    if (recPtr != NULL)
+    while (length)
     {
-		lastQueuedTxMsg = recPtr->sdiMsg->pBuf;
+        fragLen = (length > SDI_TX_FRAME_SIZE) ? SDI_TX_FRAME_SIZE : length;
 
-		SDITL_writeTL(recPtr->sdiMsg->pBuf, recPtr->sdiMsg->pBufSize);
+        // Claimed above, so the free queue holds a frame for each fragment
+        pFrame = ((SDI_TxFrame *)Queue_get(sdiTxFreeQueue))->payload;
 
-		//free the Queue record
-		ICall_free(recPtr->sdiMsg);
-		ICall_free(recPtr);
-	}
+        memcpy(pFrame, pMsg, fragLen);
+        SDITask_commitChannelTxFrame(channel, pFrame, fragLen);
+
+        pMsg += fragLen;
+        length -= fragLen;
+    }
 
+    return SUCCESS;
 }
 
 // -----------------------------------------------------------------------------
-// Call Back Functions
+//! \brief      Reserve a TX pool frame the caller can write a message into
+//!             directly.
+//!
+//! \param[in]  length  Number of bytes the caller intends to write
+//!
+//! \return     uint8_t* - frame payload, NULL if none is available
+// -----------------------------------------------------------------------------
+uint8_t *SDITask_reserveTxFrame(uint16_t length)
+{
+    return SDITask_reserveChannelTxFrame(SDI_CHANNEL_DEFAULT, length);
+}
 
 // -----------------------------------------------------------------------------
-//! \brief      Call back function for TX Done event from transport layer.
+//! \brief      Reserve a TX pool frame for a message on a logical channel.
 //!
-//! \param[in]  size    Number of bytes transmitted.
+//! \param[in]  channel Channel the frame will be committed to
+//! \param[in]  length  Number of bytes the caller intends to write
+//!
+//! \return     uint8_t* - frame payload, NULL if none is available
+// -----------------------------------------------------------------------------
+uint8_t *SDITask_reserveChannelTxFrame(uint8_t channel, uint16_t length)
+{
+    if ((length > SDI_TX_FRAME_SIZE) || (channel >= SDI_CHANNEL_CNT) ||
+        !SDITask_claimTxFrames(channel, 1))
+    {
+        return NULL;
+    }
+
+    // sdiTxFreeCnt never runs ahead of the free queue, so this cannot fail
+    return ((SDI_TxFrame *)Queue_get(sdiTxFreeQueue))->payload;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Queue a reserved frame for transmission.
+//!
+//! \param[in]  pFrame  Frame payload returned by SDITask_reserveTxFrame
+//! \param[in]  length  Number of bytes written into the frame
 //!
 //! \return     void
 // -----------------------------------------------------------------------------
-static void SDITask_transportTxDoneCallBack(int size)
+void SDITask_commitTxFrame(uint8_t *pFrame, uint16_t length)
 {
-    
-    if(lastQueuedTxMsg)
+    SDITask_commitChannelTxFrame(SDI_CHANNEL_DEFAULT, pFrame, length);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Queue a reserved frame for transmission on a logical channel.
+//!
+//! \param[in]  channel Channel, below SDI_CHANNEL_CNT
+//! \param[in]  pFrame  Frame payload returned by SDITask_reserveTxFrame
+//! \param[in]  length  Number of bytes written into the frame
+//!
+//! \return     uint8_t - SUCCESS, or FAILURE for an unknown channel
+// -----------------------------------------------------------------------------
+uint8_t SDITask_commitChannelTxFrame(uint8_t channel, uint8_t *pFrame,
+                                     uint16_t length)
+{
+    SDI_TxFrame *pTxFrame = SDITASK_FRAME_FROM_PAYLOAD(pFrame);
+    ICall_CSState key;
+
+    if (channel >= SDI_CHANNEL_CNT)
     {
-        //Deallocate most recent message being transmitted.
-        ICall_freeMsg(lastQueuedTxMsg);
+        SDITask_freeTxFrame(pTxFrame);
+        return FAILURE;
+    }
 
-        lastQueuedTxMsg = NULL;
+    pTxFrame->len = length;
+    pTxFrame->channel = channel;
+    pTxFrame->commitTicks = Clock_getTicks();
+
+    key = ICall_enterCriticalSection();
+    sdiTxQueuedLen += length;
+    if (++sdiTxQueuedFrames > sdiStats.txQueueHighWater)
+    {
+        sdiStats.txQueueHighWater = sdiTxQueuedFrames;
     }
+    ICall_leaveCriticalSection(key);
 
-    // Post the event to the SDI task thread.
-    Event_post(hUartEvent, SDITASK_TRANSPORT_TX_DONE_EVENT);
+    Queue_put(sdiTxQueue[channel], &pTxFrame->_elem);
+    Event_post(hUartEvent, SDITASK_TX_READY_EVENT);
+
+    return SUCCESS;
 }
 
 // -----------------------------------------------------------------------------
-//! \brief      RX Callback provided to Transport Layer for RX Event (ie.Bytes
-//!             received).
+//! \brief      Return a reserved frame to the pool without sending it.
 //!
-//! \param[in]  size    Number of bytes received.
+//! \param[in]  pFrame  Frame payload returned by SDITask_reserveTxFrame
 //!
 //! \return     void
 // -----------------------------------------------------------------------------
-static void SDITask_transportRXCallBack(int size)
+void SDITask_releaseTxFrame(uint8_t *pFrame)
+{
+    SDITask_freeTxFrame(SDITASK_FRAME_FROM_PAYLOAD(pFrame));
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Number of TX pool frames a logical channel could reserve now.
+//!
+//! \param[in]  channel Channel the frames would be committed to
+//!
+//! \return     uint8_t - free frames, 0 for an unknown channel
+// -----------------------------------------------------------------------------
+uint8_t SDITask_getTxFreeFrames(uint8_t channel)
+{
+    uint8_t keep;
+    uint8_t freeCnt;
+
+    if (channel >= SDI_CHANNEL_CNT)
+    {
+        return 0;
+    }
+
+    // Same rule as SDITask_reserveChannelTxFrame
+    keep = (sdiTxWeight[channel] == SDI_CHANNEL_WEIGHT_STRICT) ?
+           0 : sdiTxFrameReserve;
+
+    freeCnt = sdiTxFreeCnt;
+
+    return (freeCnt > keep) ? (freeCnt - keep) : 0;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Claim TX pool frames for a channel. The frames stay on the
+//!             free queue, the caller takes one off it for each frame
+//!             claimed.
+//!
+//! \param[in]  channel Channel, below SDI_CHANNEL_CNT
+//! \param[in]  count   Number of frames
+//!
+//! \return     uint8_t - TRUE if all of them were claimed, FALSE if none was
+// -----------------------------------------------------------------------------
+static uint8_t SDITask_claimTxFrames(uint8_t channel, uint16_t count)
 {
-    SDIRxBuf_Read(size);
+    ICall_CSState key;
+    uint8_t keep;
+
+    if (count == 0)
+    {
+        return TRUE;
+    }
+
+    // Weighted channels leave the reserved frames alone, so that a bulk
+    // transfer cannot starve a strict priority channel of frames
+    keep = (sdiTxWeight[channel] == SDI_CHANNEL_WEIGHT_STRICT) ?
+           0 : sdiTxFrameReserve;
+
+    key = ICall_enterCriticalSection();
+    if ((sdiTxFreeCnt <= keep) || ((sdiTxFreeCnt - keep) < count))
+    {
+        sdiStats.txPoolEmpty++;
+        ICall_leaveCriticalSection(key);
+        return FALSE;
+    }
+    sdiTxFreeCnt -= count;
+    if ((SDI_TX_FRAME_CNT - sdiTxFreeCnt) > sdiStats.txPoolHighWater)
+    {
+        sdiStats.txPoolHighWater = SDI_TX_FRAME_CNT - sdiTxFreeCnt;
+    }
+    ICall_leaveCriticalSection(key);
+
+    return TRUE;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Return a TX frame to the pool.
+//!
+//! \param[in]  pFrame  Frame to free
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_freeTxFrame(SDI_TxFrame *pFrame)
+{
+    ICall_CSState key;
+
+    Queue_put(sdiTxFreeQueue, &pFrame->_elem);
+
+    key = ICall_enterCriticalSection();
+    sdiTxFreeCnt++;
+    ICall_leaveCriticalSection(key);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Whether any TX channel has frames queued.
+//!
+//! \return     uint8_t - TRUE if there is something to send
+// -----------------------------------------------------------------------------
+static uint8_t SDITask_txPending(void)
+{
+    uint8_t i;
+
+    if (sdiTxRetryLen)
+    {
+        return TRUE;
+    }
+
+    for (i = 0; i < SDI_CHANNEL_CNT; i++)
+    {
+        if (!Queue_empty(sdiTxQueue[i]))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Channel the TX scheduler sends from next. Strict priority
+//!             channels come first, lowest channel first. Otherwise the
+//!             current weighted channel keeps its turn while it has credit
+//!             and frames, and then the turn passes to the next weighted
+//!             channel with frames queued.
+//!
+//! \return     uint8_t - channel, SDITASK_NO_CHANNEL if all queues are empty
+// -----------------------------------------------------------------------------
+static uint8_t SDITask_pickTxChannel(void)
+{
+    uint8_t ch;
+    uint8_t i;
+
+    for (ch = 0; ch < SDI_CHANNEL_CNT; ch++)
+    {
+        if ((sdiTxWeight[ch] == SDI_CHANNEL_WEIGHT_STRICT) &&
+            !Queue_empty(sdiTxQueue[ch]))
+        {
+            return ch;
+        }
+    }
+
+    if (sdiTxRrCredit && !Queue_empty(sdiTxQueue[sdiTxRrChannel]))
+    {
+        return sdiTxRrChannel;
+    }
+
+    for (i = 1; i <= SDI_CHANNEL_CNT; i++)
+    {
+        ch = (sdiTxRrChannel + i) % SDI_CHANNEL_CNT;
+
+        if ((sdiTxWeight[ch] != SDI_CHANNEL_WEIGHT_STRICT) &&
+            !Queue_empty(sdiTxQueue[ch]))
+        {
+            return ch;
+        }
+    }
+
+    return SDITASK_NO_CHANNEL;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Dequeue the next frame of a TX channel returned by
+//!             SDITask_pickTxChannel, starting a new turn for that channel if
+//!             it did not have one.
+//!
+//! \param[in]  channel Channel to send from, must have frames queued
+//!
+//! \return     SDI_TxFrame* - the frame
+// -----------------------------------------------------------------------------
+static SDI_TxFrame *SDITask_takeTxFrame(uint8_t channel)
+{
+    if (sdiTxWeight[channel] != SDI_CHANNEL_WEIGHT_STRICT)
+    {
+        if ((channel != sdiTxRrChannel) || !sdiTxRrCredit)
+        {
+            sdiTxRrChannel = channel;
+            sdiTxRrCredit = sdiTxWeight[channel];
+        }
+
+        sdiTxRrCredit--;
+    }
+
+    return (SDI_TxFrame *)Queue_get(sdiTxQueue[channel]);
+}
+
+
+// -----------------------------------------------------------------------------
+//! \brief      Dequeue next message in the ASYNC TX Queue and send to serial
+//!             interface.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_ProcessTXQ(void)
+{
+    SDI_TxFrame *pFrame;
+    SDI_TxFrame *pNext = NULL;
+    ICall_CSState key;
+    uint8_t ch;
+    uint16_t batchLen = 0;
+    uint16_t batchFrames = 0;
+    uint16_t queuedLen = 0;
+
+    // Whatever goes out now satisfies any pending flush
+    Clock_stop(sdiTxFlushClock);
+    sdiTxFlushDue = FALSE;
+
+    // A transfer the transport refused goes out before anything newer
+    if (sdiTxRetryLen)
+    {
+        SDITask_writeTxBatch(sdiTxRetryLen, sdiTxRetryFrames);
+        return;
+    }
+
+    ch = SDITask_pickTxChannel();
+    if (ch == SDITASK_NO_CHANNEL)
+    {
+        return;
+    }
+
+    pFrame = SDITask_takeTxFrame(ch);
+
+    // Only the SDI task dequeues, so a channel picked here stays non-empty
+    ch = SDITask_pickTxChannel();
+    if (ch != SDITASK_NO_CHANNEL)
+    {
+        pNext = (SDI_TxFrame *)Queue_head(sdiTxQueue[ch]);
+    }
+
+    if (SDITASK_TX_ALWAYS_STAGED ||
+        (sdiTxConfig.batchEnable && (pNext != NULL) &&
+         ((SDITASK_TX_WIRE_LEN(pFrame->len) + SDITASK_TX_WIRE_LEN(pNext->len))
+          <= SDI_TL_BUF_SIZE)))
+    {
+        // Pack as many frames as fit into one transfer. Each frame is free
+        // again as soon as it has been copied.
+        while (1)
+        {
+            batchLen += SDITask_stageTxFrame(pFrame, batchLen);
+            queuedLen += pFrame->len;
+            sdiTxInFlightTicks[batchFrames++] = pFrame->commitTicks;
+            SDITask_freeTxFrame(pFrame);
+
+            if (!sdiTxConfig.batchEnable)
+            {
+                break;
+            }
+
+            // The batch is filled in scheduling order
+            ch = SDITask_pickTxChannel();
+            if (ch == SDITASK_NO_CHANNEL)
+            {
+                break;
+            }
+
+            pNext = (SDI_TxFrame *)Queue_head(sdiTxQueue[ch]);
+            if ((batchLen + SDITASK_TX_WIRE_LEN(pNext->len)) > SDI_TL_BUF_SIZE)
+            {
+                break;
+            }
+
+            pFrame = SDITask_takeTxFrame(ch);
+        }
+
+        key = ICall_enterCriticalSection();
+        sdiTxQueuedLen -= queuedLen;
+        sdiTxQueuedFrames -= batchFrames;
+        ICall_leaveCriticalSection(key);
+
+        lastQueuedTxFrame = NULL;
+        SDITask_writeTxBatch(batchLen, batchFrames);
+        return;
+    }
+    else
+    {
+        key = ICall_enterCriticalSection();
+        sdiTxQueuedLen -= pFrame->len;
+        sdiTxQueuedFrames--;
+        ICall_leaveCriticalSection(key);
+
+        // A lone frame is sent straight out of the pool, so keep it until
+        // TX done
+        lastQueuedTxFrame = pFrame;
+        batchLen = pFrame->len;
+        batchFrames = 1;
+        sdiTxInFlightTicks[0] = pFrame->commitTicks;
+        sdiTxInFlightCnt = 1;
+
+        if (SDITL_writeTL(pFrame->payload, pFrame->len) == 0)
+        {
+            // Nothing went out, no TX done will follow. The frame is kept
+            // in the staging buffer until the transport takes it.
+            lastQueuedTxFrame = NULL;
+            sdiTxInFlightCnt = 0;
+            sdiTxRetryLen = SDITask_stageTxFrame(pFrame, 0);
+            sdiTxRetryFrames = 1;
+            sdiStats.txRetries++;
+            SDITask_freeTxFrame(pFrame);
+            return;
+        }
+    }
+
+    sdiStats.txTransfers++;
+    sdiStats.txFrames += batchFrames;
+    sdiStats.txBytes += batchLen;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Copy a TX frame into the staging buffer, encoding it when wire
+//!             framing is in use.
+//!
+//! \param[in]  pFrame  Frame to copy
+//! \param[in]  offset  Where in sdiTxBatchBuf it goes
+//!
+//! \return     uint16_t - bytes written to sdiTxBatchBuf
+// -----------------------------------------------------------------------------
+static uint16_t SDITask_stageTxFrame(SDI_TxFrame *pFrame, uint16_t offset)
+{
+#ifdef SDI_USE_FRAMING
+    return SDIFrame_encode(SDI_FRAME_MAKE_TYPE(SDI_FRAME_TYPE_DATA,
+                                               pFrame->channel),
+                           sdiTxSeq++, pFrame->payload,
+                           pFrame->len, &sdiTxBatchBuf[offset],
+                           SDI_TL_BUF_SIZE - offset);
+#else
+    memcpy(&sdiTxBatchBuf[offset], pFrame->payload, pFrame->len);
+    return pFrame->len;
+#endif //SDI_USE_FRAMING
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Hand the transfer staged in sdiTxBatchBuf to the transport.
+//!             The frames in it are already back in the pool, so if the
+//!             transport refuses it the transfer is kept and sent again on
+//!             the next TX ready event.
+//!
+//! \param[in]  len     Bytes staged
+//! \param[in]  frames  TX frames carried, their commit times are in
+//!                     sdiTxInFlightTicks
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_writeTxBatch(uint16_t len, uint16_t frames)
+{
+    sdiTxInFlightCnt = frames;
+
+    if (SDITL_writeTL(sdiTxBatchBuf, len) == 0)
+    {
+        // Nothing went out, no TX done will follow
+        sdiTxInFlightCnt = 0;
+        sdiTxRetryLen = len;
+        sdiTxRetryFrames = frames;
+        sdiStats.txRetries++;
+        return;
+    }
+
+    sdiTxRetryLen = 0;
+
+    sdiStats.txTransfers++;
+    sdiStats.txFrames += frames;
+    sdiStats.txBytes += len;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Decide whether the ASYNC TX Queue should wait for more frames
+//!             before the next transfer. Arms the max-delay timer the first
+//!             time a partial batch is held.
+//!
+//! \return     uint8_t - TRUE to hold, FALSE to send now
+// -----------------------------------------------------------------------------
+static uint8_t SDITask_holdTxBatch(void)
+{
+    uint8_t ch;
+
+    if (!sdiTxConfig.batchEnable || !sdiTxConfig.batchMaxDelay ||
+        sdiTxRetryLen || sdiTxFlushDue || (sdiTxQueuedLen >= SDI_TL_BUF_SIZE))
+    {
+        return FALSE;
+    }
+
+    // Strict priority frames never wait for a batch to fill
+    ch = SDITask_pickTxChannel();
+    if ((ch == SDITASK_NO_CHANNEL) ||
+        (sdiTxWeight[ch] == SDI_CHANNEL_WEIGHT_STRICT))
+    {
+        return FALSE;
+    }
+
+    if (!Clock_isActive(sdiTxFlushClock))
+    {
+        UInt32 ticks = ((UInt32)sdiTxConfig.batchMaxDelay * 1000) /
+                       Clock_tickPeriod;
+
+        Clock_setTimeout(sdiTxFlushClock, ticks ? ticks : 1);
+        Clock_start(sdiTxFlushClock);
+    }
+
+    return TRUE;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Configure how queued TX frames are scheduled onto the
+//!             transport.
+//!
+//! \param[in]  pConfig  New configuration
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITask_setTxConfig(const SDI_TxConfig_t *pConfig)
+{
+    sdiTxConfig = *pConfig;
+
+    // Let anything held under the old settings go out
+    Event_post(hUartEvent, SDITASK_TX_FLUSH_EVENT);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Read the current TX scheduling configuration.
+//!
+//! \param[out] pConfig  Filled with the current configuration
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITask_getTxConfig(SDI_TxConfig_t *pConfig)
+{
+    *pConfig = sdiTxConfig;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Read the SDI runtime counters.
+//!
+//! \param[out] pStats  Filled with a snapshot of the counters
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITask_getStats(SDI_Stats_t *pStats)
+{
+    ICall_CSState key;
+    uint32 errors;
+    uint32 rxDropped;
+
+    key = ICall_enterCriticalSection();
+    *pStats = sdiStats;
+    SDITL_getErrorCounts(&errors, &rxDropped);
+    pStats->uartErrors = errors - sdiStatsErrorBase;
+    pStats->rxDroppedBytes += rxDropped - sdiStatsRxDropBase;
+    ICall_leaveCriticalSection(key);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Zero the SDI runtime counters.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITask_resetStats(void)
+{
+    ICall_CSState key;
+    uint32 errors;
+    uint32 rxDropped;
+
+    key = ICall_enterCriticalSection();
+    memset(&sdiStats, 0, sizeof(sdiStats));
+    SDITL_getErrorCounts(&errors, &rxDropped);
+    sdiStatsErrorBase = errors;
+    sdiStatsRxDropBase = rxDropped;
+    ICall_leaveCriticalSection(key);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Pass the next chunk of received bytes to the app. A chunk is
+//!             handed over once sdiRxDeliverySize bytes are waiting, or as
+//!             soon as the host stops sending, so that one host write normally
+//!             becomes one callback.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+#ifndef SDI_USE_FRAMING
+static void SDITask_ProcessRX(void)
+{
+    ICall_CSState key;
+    uint8_t *pRxData;
+    uint16_t deliverLen;
+    uint16_t idleLen;
+    uint8_t rxInPlace = FALSE;
+
+    if (sdiRxHeld)
+    {
+        // App is backed up, SDITask_holdRx(FALSE) brings us back
+        return;
+    }
+
+    key = ICall_enterCriticalSection();
+    deliverLen = SDIRxBuf_GetRxBufLen();
+    idleLen = sdiRxIdleLen;
+    ICall_leaveCriticalSection(key);
+
+    if (deliverLen >= sdiRxDeliverySize)
+    {
+        deliverLen = sdiRxDeliverySize;
+    }
+    else if (idleLen)
+    {
+        deliverLen = idleLen;
+    }
+    else
+    {
+        // Host is still sending, wait for more bytes or an idle line
+        return;
+    }
+
+    // Hand the app the bytes straight from RxBuf, only copying out when they
+    // wrap around its end
+    if (SDIRxBuf_Peek(&pRxData) < deliverLen)
+    {
+        SDIRxBuf_ReadFromRxBuf(sdiRxDeliveryBuf, deliverLen);
+        pRxData = sdiRxDeliveryBuf;
+    }
+    else
+    {
+        rxInPlace = TRUE;
+    }
+
+    if (incomingRXEventAppCBFunc[SDI_CHANNEL_DEFAULT] != NULL)
+    {
+        sdiRxChannel = SDI_CHANNEL_DEFAULT;
+        incomingRXEventAppCBFunc[SDI_CHANNEL_DEFAULT](UART_DATA_EVT, pRxData,
+                                                      deliverLen);
+    }
+
+    if (rxInPlace)
+    {
+        SDIRxBuf_Consume(deliverLen);
+    }
+
+    key = ICall_enterCriticalSection();
+    sdiRxIdleLen = (sdiRxIdleLen > deliverLen) ? (sdiRxIdleLen - deliverLen) : 0;
+    idleLen = sdiRxIdleLen;
+    ICall_leaveCriticalSection(key);
+
+    if (idleLen || (SDIRxBuf_GetRxBufLen() >= sdiRxDeliverySize))
+    {
+        // Another chunk is ready, preserve the flag and repost to the event
+        if (!sdiRxHeld)
+        {
+            Event_post(hUartEvent, SDITASK_TRANSPORT_RX_EVENT);
+        }
+    }
+}
+#else
+// -----------------------------------------------------------------------------
+//! \brief      Decode the next frame from RxBuf and hand its payload to the
+//!             app, split into chunks of at most sdiRxDeliverySize. Frame
+//!             delimiters mark message boundaries, so the idle line is not
+//!             needed here.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_ProcessFramedRX(void)
+{
+    SDIFrame_t frame;
+    uint8_t *pRxData;
+    uint8_t ch;
+    uint16_t spanLen;
+    uint16_t offset;
+    uint16_t chunkLen;
+    uint8_t status = SDI_FRAME_INCOMPLETE;
+
+    if (sdiRxHeld)
+    {
+        // App is backed up, SDITask_holdRx(FALSE) brings us back
+        return;
+    }
+
+    // Feed RxBuf to the decoder one contiguous span at a time until a frame
+    // ends or RxBuf runs dry
+    while ((status == SDI_FRAME_INCOMPLETE) &&
+           ((spanLen = SDIRxBuf_Peek(&pRxData)) != 0))
+    {
+        SDIRxBuf_Consume(SDIFrame_decode(&sdiRxDecoder, pRxData, spanLen,
+                                         &frame, &status));
+    }
+
+    switch (status)
+    {
+        case SDI_FRAME_OK:
+            sdiStats.rxFrames++;
+
+            if (sdiRxSeqValid && (frame.seq != (uint8_t)(sdiRxSeq + 1)))
+            {
+                sdiStats.seqGaps++;
+            }
+            sdiRxSeq = frame.seq;
+            sdiRxSeqValid = TRUE;
+
+            ch = SDI_FRAME_GET_CHANNEL(frame.type);
+
+            if ((SDI_FRAME_GET_TYPE(frame.type) == SDI_FRAME_TYPE_DATA) &&
+                (ch < SDI_CHANNEL_CNT) &&
+                (incomingRXEventAppCBFunc[ch] != NULL))
+            {
+                sdiRxChannel = ch;
+
+                for (offset = 0; offset < frame.len; offset += chunkLen)
+                {
+                    chunkLen = frame.len - offset;
+                    if (chunkLen > sdiRxDeliverySize)
+                    {
+                        chunkLen = sdiRxDeliverySize;
+                    }
+
+                    incomingRXEventAppCBFunc[ch](UART_DATA_EVT,
+                                                 &frame.pPayload[offset],
+                                                 chunkLen);
+                }
+            }
+            break;
+
+        case SDI_FRAME_ERR_CRC:
+            sdiStats.crcErrors++;
+            break;
+
+        case SDI_FRAME_ERR_FORMAT:
+            sdiStats.formatErrors++;
+            break;
+
+        case SDI_FRAME_ERR_OVERFLOW:
+            sdiStats.frameOverflows++;
+            break;
+
+        default:
+            // Partial frame, wait for more bytes
+            return;
+    }
+
+    if (SDIRxBuf_GetRxBufLen() && !sdiRxHeld)
+    {
+        // More frames may be waiting, preserve the flag and repost
+        Event_post(hUartEvent, SDITASK_TRANSPORT_RX_EVENT);
+    }
+}
+#endif //SDI_USE_FRAMING
+
+// -----------------------------------------------------------------------------
+// Call Back Functions
+
+// -----------------------------------------------------------------------------
+//! \brief      Call back function for TX Done event from transport layer.
+//!
+//! \param[in]  size    Number of bytes transmitted.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_transportTxDoneCallBack(int size)
+{
+    SDITask_recordTxLatency();
+
+    if(lastQueuedTxFrame)
+    {
+        //Return most recent frame being transmitted to the pool.
+        SDITask_freeTxFrame(lastQueuedTxFrame);
+
+        lastQueuedTxFrame = NULL;
+    }
+
+    // Post the event to the SDI task thread.
+    Event_post(hUartEvent, SDITASK_TRANSPORT_TX_DONE_EVENT);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Count each frame of the transfer that just finished into its
+//!             TX latency bucket, by whole ms since it was committed.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_recordTxLatency(void)
+{
+    uint32_t now = Clock_getTicks();
+    uint32_t ms;
+    uint8_t bucket;
+    uint8_t i;
+
+    for (i = 0; i < sdiTxInFlightCnt; i++)
+    {
+        ms = ((now - sdiTxInFlightTicks[i]) * Clock_tickPeriod) / 1000;
+
+        for (bucket = 0; ms && (bucket < (SDI_STATS_LAT_BUCKETS - 1)); bucket++)
+        {
+            ms >>= 1;
+        }
+
+        sdiStats.txLatency[bucket]++;
+    }
+
+    sdiTxInFlightCnt = 0;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Clock function for the TX batch max-delay timer. Runs in SWI
+//!             context, so only signals the SDI task.
+//!
+//! \param[in]  arg    N/A
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_txFlushClockFxn(UArg arg)
+{
+    Event_post(hUartEvent, SDITASK_TX_FLUSH_EVENT);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      RX Callback provided to Transport Layer for RX Event (ie.Bytes
+//!             received).
+//!
+//! \param[in]  size    Number of bytes received.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_transportRXCallBack(int size)
+{
+#ifdef POWER_SAVING
+    // MRDY transactions are gathered in the TL buffer, whatever does not fit
+    // in RxBuf is lost
+    uint16_t rxLen = SDIRxBuf_Read(size);
+
+    sdiStats.rxDroppedBytes += size - rxLen;
+#else
+    // The UART reads straight into RxBuf, the bytes are already in place
+    uint16_t rxLen = size;
+#endif //POWER_SAVING
+
+    sdiStats.rxBytes += rxLen;
+
+    if (SDIRxBuf_GetRxBufLen() > sdiStats.rxBufHighWater)
+    {
+        sdiStats.rxBufHighWater = SDIRxBuf_GetRxBufLen();
+    }
+
+    // Hold the host off before the transport issues its next read
+    if (!sdiRxFlowOff && (SDIRxBuf_GetRxBufLen() >= sdiRxHighWater))
+    {
+        sdiRxFlowOff = TRUE;
+        SDITL_setRxFlow(FALSE);
+    }
+
+    if (SDITL_isRxIdle())
+    {
+        // Everything in RxBuf so far belongs to a finished host write
+        Clock_stop(sdiRxIdleClock);
+        sdiRxIdleLen = SDIRxBuf_GetRxBufLen();
+    }
+    else
+    {
+        // A read that ends exactly on the UART buffer boundary is not
+        // followed by a receive timeout, so make sure the tail still goes out
+        Clock_stop(sdiRxIdleClock);
+        Clock_start(sdiRxIdleClock);
+    }
+
+    Event_post(hUartEvent, SDITASK_TRANSPORT_RX_EVENT);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Clock function for the RX idle backstop timer. No bytes have
+//!             arrived for SDI_RX_IDLE_TIMEOUT ms, treat the line as idle.
+//!
+//! \param[in]  arg    N/A
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void SDITask_rxIdleClockFxn(UArg arg)
+{
+    ICall_CSState key;
+
+    key = ICall_enterCriticalSection();
+    sdiRxIdleLen = SDIRxBuf_GetRxBufLen();
+    ICall_leaveCriticalSection(key);
+
     Event_post(hUartEvent, SDITASK_TRANSPORT_RX_EVENT);
 }
 
@@ -105,12 +105,6 @@ static uint16_t sdiRxBufTail = 0;
 //! \brief Index to first byte to be read from SDI Transport Layer receive buffer
 static uint16_t sdiRxBufHead = 0;
 
-//! \brief SDI Transport Layer transmit buffer
-static Char sdiTxBuf[SDI_TL_BUF_SIZE];
-
-//! \brief Number of bytes in SDI Transport Layer transmit buffer
-static uint16_t sdiTxBufLen = 0;
-
 //! \brief Call back function in SDI Task for transmit complete
 static sdiRtosCB_t taskTxCB = NULL;
 
@@ -181,7 +175,7 @@ void SDITL_initTL(sdiRtosCB_t sdiCBTx, sdiRtosCB_t sdiCBRx, sdiRtosCB_t sdiCBMrd
     taskMrdyCB = sdiCBMrdy;
 #endif
 
-    transportInit(sdiRxBuf,sdiTxBuf, SDITL_transmissionCallBack);
+    transportInit(sdiRxBuf, SDITL_transmissionCallBack);
 
 #ifdef POWER_SAVING
     SRDY_DISABLE();
@@ -222,6 +216,44 @@ bool SDITL_checkSdiBusy(void)
 #endif
 }
 
+// -----------------------------------------------------------------------------
+//! \brief      This routine returns whether the bytes just reported through the
+//!             RX call back end at an idle line.
+//!
+//! \return     bool - TRUE if the host has stopped sending after those bytes
+// -----------------------------------------------------------------------------
+bool SDITL_isRxIdle(void)
+{
+    return transportRxIdle();
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      This routine throttles (FALSE) or reopens (TRUE) the receive
+//!             path of the transport.
+//!
+//! \param[in]  enable - TRUE to receive, FALSE to hold the host off
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITL_setRxFlow(bool enable)
+{
+    transportRxFlow(enable);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      This routine returns the running counts of transport errors and
+//!             of received bytes the transport had to drop.
+//!
+//! \param[out] pErrors - transport error events since start up
+//! \param[out] pRxDropped - received bytes dropped since start up
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITL_getErrorCounts(uint32 *pErrors, uint32 *pRxDropped)
+{
+    transportErrorCounts(pErrors, pRxDropped);
+}
+
 #ifdef POWER_SAVING
 
 // -----------------------------------------------------------------------------
@@ -395,6 +427,8 @@ uint16 SDITL_readTL(uint8 *buf, uint16 len)
 
 // -----------------------------------------------------------------------------
 //! \brief      This routine writes data from the buffer to the transport layer.
+//!             The buffer is transmitted in place, so it must stay valid until
+//!             the TX complete call back.
 //!
 //! \param[in]  buf - Pointer to buffer to write data from.
 //! \param[in]  len - Number of bytes to write.
@@ -428,12 +462,10 @@ uint16 SDITL_writeTL(uint8 *buf, uint16 len)
       msgFragLen = 0;
     }
 
-    memcpy(sdiTxBuf, buf, len);
-    sdiTxBufLen = len;
     sdiTxActive = TRUE;
     txPktCount++;
 
-    len = transportWrite(sdiTxBufLen);
+    len = transportWrite((Char *)buf, len);
 
 #ifdef POWER_SAVING
     SRDY_ENABLE();
@@ -61,6 +61,7 @@
 #include "inc/sdi_config.h"
 #include "inc/sdi_tl_uart.h"
 #include "inc/sdi_data.h"
+#include "inc/sdi_rxbuf.h"
 
 #include <ti/drivers/uart/UARTCC26XX.h>
 
@@ -78,8 +79,10 @@
 //! \brief UART Handle for UART Driver
 static UART_Handle uartHandle;
 
+#ifdef POWER_SAVING
 //! \brief UART ISR Rx Buffer
 static Char isrRxBuf[UART_ISR_BUF_SIZE];
+#endif //POWER_SAVING
 
 //! \brief SDI TL call back function for the end of a UART transaction
 static sdiCB_t sdiTransmitCB = NULL;
@@ -101,7 +104,26 @@ static Char* TransportRxBuf;
 //! \brief Length of bytes received
 static uint16 TransportRxLen = 0;
 
-//! \brief Pointer to SDI TL RX Buffer
+//! \brief The bytes last passed up end at an idle line
+static bool TransportRxIdle = FALSE;
+
+//! \brief UART error events and received bytes lost to a full TL buffer
+static uint32 TransportErrorCnt = 0;
+static uint32 TransportRxDropCnt = 0;
+
+#ifndef POWER_SAVING
+//! \brief Receive path throttled, do not issue a new UART_read
+static bool RxFlowOff = FALSE;
+
+//! \brief A UART_read is outstanding
+static bool RxReadActive = FALSE;
+
+//! \brief Size of the outstanding UART_read, which lands straight in the SDI
+//!        RX ring
+static size_t RxReadLen = 0;
+#endif //!POWER_SAVING
+
+//! \brief Pointer to the buffer currently being transmitted
 static Char* TransportTxBuf;
 
 //! \brief Length of bytes to send from SDI TL Tx Buffer
@@ -121,8 +143,10 @@ static sdiTLIncomingEventCBack_t incomingRXErrorStatusAppCBFunc = NULL;
 // function prototypes
 //*****************************************************************************
 
+#ifdef POWER_SAVING
 //! \brief UART ISR function. Invoked upon specific threshold of UART RX FIFO size
 static uint16 SDITLUART_readIsrBuf(size_t size);
+#endif //POWER_SAVING
 
 //! \brief UART Callback invoked after UART write completion
 static void SDITLUART_writeCallBack(UART_Handle handle, void *ptr, size_t size);
@@ -161,25 +185,46 @@ uint8 SDITLUART_configureUARTParams(UART_Params *initParams)
   SDITLUART_closeUART();
   
   key = ICall_enterCriticalSection();
+
+#ifndef POWER_SAVING
+  // The cancelled read is gone with the old handle
+  RxReadActive = FALSE;
+#endif //!POWER_SAVING
+
+  if (initParams != NULL)
+  {
+    paramsUART = *initParams;
+
+    // The transport relies on callback mode and its own callbacks
+    paramsUART.readDataMode = UART_DATA_BINARY;
+    paramsUART.writeDataMode = UART_DATA_BINARY;
+    paramsUART.readMode = UART_MODE_CALLBACK;
+    paramsUART.writeMode = UART_MODE_CALLBACK;
+    paramsUART.readEcho = UART_ECHO_OFF;
+    paramsUART.readCallback = SDITLUART_readCallBack;
+    paramsUART.writeCallback = SDITLUART_writeCallBack;
+  }
   
   // Open / power on the UART.
   uartHandle = UART_open(Board_UART, &paramsUART);
   if(uartHandle != NULL)
   {
-    //DEBUG("UART_open successful");
+    //Enable Partial Reads on all subsequent UART_read()
+    UART_control(uartHandle, UARTCC26XX_RETURN_PARTIAL_ENABLE,  NULL);
   }else{
     //DEBUG("ERROR in UART_open");
     status = FAILURE;
   }
- 
-  //Enable Partial Reads on all subsequent UART_read()
-  status = UART_control(uartHandle, UARTCC26XX_RETURN_PARTIAL_ENABLE,  NULL);
   
   ICall_leaveCriticalSection(key);
   
   #ifndef POWER_SAVING
-    //Initiate first read to start polling UART
-    SDITLUART_readTransport();
+    //Initiate first read to start polling UART, unless the host is being
+    //held off
+    if ((status == SUCCESS) && !RxFlowOff)
+    {
+      SDITLUART_readTransport();
+    }
   #endif //POWER_SAVING
   
   return status;
@@ -189,18 +234,16 @@ uint8 SDITLUART_configureUARTParams(UART_Params *initParams)
 //! \brief      This routine initializes the transport layer and opens the port
 //!             of the device.
 //!
-//! \param[in]  tRxBuf - pointer to SDI TL Tx Buffer
-//! \param[in]  tTxBuf - pointer to SDI TL Rx Buffer
+//! \param[in]  tRxBuf - pointer to SDI TL Rx Buffer
 //! \param[in]  sdiCBack - SDI TL call back function to be invoked at the end of 
 //!             a UART transaction                     
 //!
 //! \return     void
 // -----------------------------------------------------------------------------
-void SDITLUART_initializeTransport(Char *tRxBuf, Char *tTxBuf, sdiCB_t sdiCBack)
+void SDITLUART_initializeTransport(Char *tRxBuf, sdiCB_t sdiCBack)
 {
     // Set UART transport callbacks
     TransportRxBuf = tRxBuf;
-    TransportTxBuf = tTxBuf;
     sdiTransmitCB = sdiCBack;
 
     // Configure UART parameters.
@@ -321,6 +364,8 @@ static void SDITLUART_writeCallBack(UART_Handle handle, void *ptr, size_t size)
 
     if (errStatus = ((UARTCC26XX_Handle)handle->object)->status)
     {
+      TransportErrorCnt++;
+
       //report UART error status to application 
       if(incomingRXErrorStatusAppCBFunc != NULL)
         incomingRXErrorStatusAppCBFunc(UART_ERROR_EVT, &errStatus, sizeof(errStatus));
@@ -330,6 +375,7 @@ static void SDITLUART_writeCallBack(UART_Handle handle, void *ptr, size_t size)
     if ( !RxActive )
     {
         UART_readCancel(uartHandle);
+        TransportRxIdle = TRUE;
         if ( sdiTransmitCB )
         {
             sdiTransmitCB(TransportRxLen,TransportTxLen);
@@ -366,20 +412,29 @@ static void SDITLUART_readCallBack(UART_Handle handle, void *ptr, size_t size)
 
     if (errStatus = ((UARTCC26XX_Handle)handle->object)->status)
     {
+      TransportErrorCnt++;
+
       //report UART error status to application 
       if(incomingRXErrorStatusAppCBFunc != NULL)
         incomingRXErrorStatusAppCBFunc(UART_ERROR_EVT, &errStatus, sizeof(errStatus));
     }
 
+#ifdef POWER_SAVING
+    // MRDY transactions are gathered in the TL buffer until MRDY goes high
     if (size)
     {
-        if (size != SDITLUART_readIsrBuf(size))
+        uint16 copied = SDITLUART_readIsrBuf(size);
+
+        if (size != copied)
         {
+            TransportRxDropCnt += size - copied;
+
             // Buffer overflow imminent. Cancel read and pass to higher layers
             // for handling
 #ifdef POWER_SAVING
             RxActive = FALSE;
 #endif //POWER_SAVING
+            TransportRxIdle = FALSE;
             if ( sdiTransmitCB )
             {
                 sdiTransmitCB(SDI_TL_BUF_SIZE,TransportTxLen);
@@ -387,13 +442,13 @@ static void SDITLUART_readCallBack(UART_Handle handle, void *ptr, size_t size)
         }
     }
 
-#ifdef POWER_SAVING
     // Read has been cancelled by transport layer, or bus timeout and no bytes in FIFO
     //    - do not invoke another read
     if ( !UARTCharsAvail(((UARTCC26XX_HWAttrs const *)(uartHandle->hwAttrs))->baseAddr) &&
             mrdy_flag )
     {
         RxActive = FALSE;
+        TransportRxIdle = TRUE;
         
         // If TX has also completed then we are safe to issue call back
         if ( !TxActive && sdiTransmitCB )
@@ -406,17 +461,34 @@ static void SDITLUART_readCallBack(UART_Handle handle, void *ptr, size_t size)
         UART_read(uartHandle, &isrRxBuf[0], UART_ISR_BUF_SIZE);
     }
 #else
-    if ( sdiTransmitCB )
+    // The driver has read straight into the SDI RX ring, publish the bytes
+    // before telling the upper layers about them
+    SDIRxBuf_Commit(size);
+
+    // With partial return enabled a short read means the receive timeout
+    // fired, so the host has stopped sending for now. A read that filled
+    // the span up to the end of the ring says nothing, the SDI task's idle
+    // timer covers that case.
+    TransportRxIdle = (size < RxReadLen);
+    RxReadActive = FALSE;
+
+    if ( size && sdiTransmitCB )
     {
         sdiTransmitCB(size,0);
     }
-    TransportRxLen = 0;
-    UART_read(uartHandle, &isrRxBuf[0], UART_ISR_BUF_SIZE);
+
+    // Unless throttled, leave further bytes in the UART FIFO. With hardware
+    // flow control RTS drops once it fills, until SDITLUART_setRxFlow reopens
+    if (!RxFlowOff)
+    {
+        SDITLUART_readTransport();
+    }
 #endif //POWER_SAVING
 
     ICall_leaveCriticalSection(key);
 }
 
+#ifdef POWER_SAVING
 // -----------------------------------------------------------------------------
 //! \brief      This routine reads data from the transport layer based on len,
 //!             and places it into the buffer.
@@ -440,9 +512,24 @@ static uint16 SDITLUART_readIsrBuf(size_t size)
 
     return i;
 }
+#endif //POWER_SAVING
 
 // -----------------------------------------------------------------------------
-//! \brief      This routine reads data from the UART
+//! \brief      Whether the bytes most recently passed up by the RX call back
+//!             end at an idle line.
+//!
+//! \return     bool - TRUE if the line went idle after those bytes
+// -----------------------------------------------------------------------------
+bool SDITLUART_isRxIdle(void)
+{
+    return TransportRxIdle;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      This routine reads data from the UART. Without POWER_SAVING the
+//!             driver reads straight into free space of the SDI RX ring, so
+//!             received bytes are not copied again before the SDI task sees
+//!             them. Nothing is read while the ring is full.
 //!
 //! \return     void
 // -----------------------------------------------------------------------------
@@ -453,27 +540,71 @@ void SDITLUART_readTransport(void)
     
 #ifdef POWER_SAVING
     RxActive = TRUE;
-#endif //POWER_SAVING
 
     TransportRxLen = 0;
     UART_read(uartHandle, &isrRxBuf[0], UART_ISR_BUF_SIZE);
+#else
+    uint8_t *pSpan;
+
+    RxReadLen = SDIRxBuf_GetWriteSpan(&pSpan);
+    if (RxReadLen > UART_ISR_BUF_SIZE)
+    {
+        RxReadLen = UART_ISR_BUF_SIZE;
+    }
+
+    // A full ring has already thrown the transport's RX flow off, reading
+    // resumes through SDITLUART_setRxFlow
+    RxReadActive = (RxReadLen != 0);
+    if (RxReadActive)
+    {
+        UART_read(uartHandle, pSpan, RxReadLen);
+    }
+#endif //POWER_SAVING
     
     ICall_leaveCriticalSection(key);
 }
 
+// -----------------------------------------------------------------------------
+//! \brief      Throttle or reopen the receive path.
+//!
+//! \param[in]  enable - TRUE to receive, FALSE to hold the host off
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITLUART_setRxFlow(bool enable)
+{
+#ifndef POWER_SAVING
+    ICall_CSState key;
+    key = ICall_enterCriticalSection();
+
+    RxFlowOff = !enable;
+
+    // Restart reading if the read callback left it stopped
+    if (enable && !RxReadActive && (uartHandle != NULL))
+    {
+        SDITLUART_readTransport();
+    }
+
+    ICall_leaveCriticalSection(key);
+#endif //!POWER_SAVING
+}
+
 
 // -----------------------------------------------------------------------------
-//! \brief      This routine writes copies buffer addr to the transport layer.
+//! \brief      This routine hands a buffer to the UART for transmission. The
+//!             buffer is not copied and must stay valid until write completion.
 //!
+//! \param[in]  tTxBuf - Pointer to buffer to write data from.
 //! \param[in]  len - Number of bytes to write.
 //!
 //! \return     uint8 - number of bytes written to transport
 // -----------------------------------------------------------------------------
-uint16 SDITLUART_writeTransport(uint16 len)
+uint16 SDITLUART_writeTransport(Char *tTxBuf, uint16 len)
 {
     ICall_CSState key;
     key = ICall_enterCriticalSection();
     
+    TransportTxBuf = tTxBuf;
     TransportTxLen = len;
 
 #ifdef POWER_SAVING
@@ -495,3 +626,18 @@ uint16 SDITLUART_writeTransport(uint16 len)
     
     return TransportTxLen;
 }
+
+// -----------------------------------------------------------------------------
+//! \brief      Running counts of UART error events and of received bytes
+//!             dropped because the TL receive buffer was full.
+//!
+//! \param[out] pErrors - UART error events since start up
+//! \param[out] pRxDropped - bytes dropped since start up
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+void SDITLUART_getErrorCounts(uint32 *pErrors, uint32 *pRxDropped)
+{
+    *pErrors = TransportErrorCnt;
+    *pRxDropped = TransportRxDropCnt;
+}
@@ -60,6 +60,10 @@
 #include "gapbondmgr.h"
 #include "gatt_uuid.h"
 #include "serial_port_service.h"
+#include "link_tune.h"
+#include "spp_uart_queue.h"
+#include "spp_bench.h"
+#include "spp_session.h"
 
 #include "spp_ble_client.h"
 #include "inc/sdi_task.h"
@@ -93,6 +97,10 @@
 #define SBC_UART_CHANGE_EVT                   0x0040
 #define SBC_PERIODIC_EVT                      0x0080
 #define SBC_AUTO_CONNECT_EVT                  0x0100
+#define SBC_CONN_EVT_END_EVT                  0x0200
+#define SBC_UART_FLUSH_EVT                    0x0400
+#define SBC_BENCH_CMD_EVT                     0x0800
+#define SBC_BENCH_TIMEOUT_EVT                 0x1000
 
 // Maximum number of scan responses
 #define DEFAULT_MAX_SCAN_RES                  8
@@ -169,6 +177,51 @@
 // Length of bd addr as a string
 #define B_ADDR_STR_LEN                        15
 
+// Free UART message blocks below which SDI stops delivering, and the level
+// at which it resumes. One delivery may need a fresh block besides the one
+// being filled, see SPPBLEClient_enqueueUARTMsg.
+#define SBC_UART_POOL_HOLD                    2
+#define SBC_UART_POOL_RESUME                  (SPP_UART_MSG_CNT / 2)
+
+// Longest time (in msec) UART bytes are held back to be merged with later
+// ones into a full write, see SPPBLEClient_enqueueUARTMsg. 0 sends every
+// UART chunk as its own write.
+#ifndef SBC_UART_AGGR_LATENCY
+#define SBC_UART_AGGR_LATENCY                 5
+#endif
+
+// Framed host messages must keep their boundaries, one frame per write
+#ifdef SDI_USE_FRAMING
+#undef SBC_UART_AGGR_LATENCY
+#define SBC_UART_AGGR_LATENCY                 0
+#endif
+
+// Credit based flow control, see SPPBLEClient_grantCredits. Credits are only
+// granted to the server in batches of at least this many notifications,
+// unless it holds none at all.
+#define SBC_CREDITS_GRANT_MIN                 2
+
+// Largest UART chunk that fits in one write command, for the payload size
+// reported by the link tuning module. Reliable sessions send a sequence
+// number in front of the data.
+#ifdef SPP_RELIABLE
+#define SBC_UART_DELIVERY_SIZE(payload)       ((((payload) - SPP_SESSION_HDR_SIZE) < SERIALPORTSERVICE_DATA_LEN) ? \
+                                               ((payload) - SPP_SESSION_HDR_SIZE) : SERIALPORTSERVICE_DATA_LEN)
+#else
+#define SBC_UART_DELIVERY_SIZE(payload)       (((payload) < SERIALPORTSERVICE_DATA_LEN) ? \
+                                               (payload) : SERIALPORTSERVICE_DATA_LEN)
+#endif
+
+#ifdef SPP_BENCH
+// Longest benchmark command line, see SPPBLEClient_benchLine
+#define SBC_BENCH_LINE_LEN                    32
+
+// Time (in msec) an echo probe or the report of a bulk run is waited for
+#ifndef SBC_BENCH_TIMEOUT
+#define SBC_BENCH_TIMEOUT                     1000
+#endif
+#endif
+
 // Task configuration
 #define SBC_TASK_PRIORITY                     1
 
@@ -190,14 +243,10 @@ enum
 enum
 {
   BLE_DISC_STATE_IDLE,                // Idle
-  BLE_DISC_STATE_MTU,                 // Exchange ATT MTU size
   BLE_DISC_STATE_SVC,                 // Service discovery
   BLE_DISC_STATE_CHAR                 // Characteristic discovery
 };
 
-#define APP_SUGGESTED_PDU_SIZE 27
-#define APP_SUGGESTED_TX_TIME 328
-
 /*********************************************************************
  * TYPEDEFS
  */
@@ -216,13 +265,6 @@ typedef struct
   uint8_t *pData; // event data pointer
 } sbcEvt_t;
 
-// App event passed from profiles.
-typedef struct
-{
-  uint8_t data[SERIALPORTSERVICE_DATA_LEN];  // New data
-  uint8_t length; // New status
-} sbcUARTEvt_t;
-
 // RSSI read data structure
 typedef struct
 {
@@ -231,6 +273,20 @@ typedef struct
   Clock_Struct *pClock; // pointer to clock struct
 } readRssi_t;
 
+#ifdef SPP_BENCH
+// Benchmark run, see SPPBLEClient_benchStart
+typedef struct
+{
+  bool active;                // Run in progress
+  bool endSent;               // Bulk run: END probe queued, report awaited
+  uint16_t done;              // Probes answered or given up on
+  uint32_t startUs;           // First probe queued
+  uint32_t bytes;             // Echo run: probe bytes that came back
+  sppBenchResult_t result;    // Filled in as the run goes
+  sppBenchLatency_t latency;  // Echo run: round trip times
+} sbcBench_t;
+#endif
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -268,9 +324,35 @@ static Clock_Struct startNotiEnableClock;
 static Queue_Struct appMsg;
 static Queue_Handle appMsgQueue;
 
-// Queue object used for UART messages
-static Queue_Struct appUARTMsg;
-static Queue_Handle appUARTMsgQueue; 
+// UART messages waiting for BLE live in the spp_uart_queue block pool.
+// TRUE while SDI delivery is held because the pool is running out.
+static bool sbcUARTHeld = FALSE;
+
+// UART message being filled with further UART chunks before it is queued,
+// and the most bytes one write can carry on the current link
+static sppUARTMsg_t *sbcUARTFill = NULL;
+
+// UART blocks waiting to be written to the server
+static sppUARTQueue_t sbcUARTQueue;
+static uint16_t sbcUARTPayload = SBC_UART_DELIVERY_SIZE(ATT_MTU_SIZE - LINKTUNE_ATT_HDR_SIZE);
+
+#if SBC_UART_AGGR_LATENCY
+// Clock object bounding how long sbcUARTFill is held
+static Clock_Struct uartAggrClock;
+#endif
+
+#ifdef SPP_BENCH
+// Benchmark command line coming in from the UART, and the last complete
+// line waiting for the application task
+static char sbcBenchLine[SBC_BENCH_LINE_LEN];
+static uint8_t sbcBenchLineLen = 0;
+static char sbcBenchCmd[SBC_BENCH_LINE_LEN];
+static volatile bool sbcBenchCmdPending = FALSE;
+
+// Current run and the clock bounding the wait for its replies
+static sbcBench_t sbcBench;
+static Clock_Struct benchClock;
+#endif
 
 // Task pending events
 static uint16_t events = 0;
@@ -311,9 +393,39 @@ static uint16_t charDataHdl = 0;
 // Discovered characteristic CCCD handle
 static uint16_t charCCCDHdl = 0;
 
+// Discovered Credits characteristic and CCCD handles, 0 if the server has
+// no Credits characteristic
+static uint16_t charCreditsHdl = 0;
+static uint16_t charCreditsCCCDHdl = 0;
+
+// Discovered Session characteristic and CCCD handles, 0 if the server does
+// not run reliable sessions (SPP_RELIABLE)
+static uint16_t charSessionHdl = 0;
+static uint16_t charSessionCCCDHdl = 0;
+
 //UUID of Serial Port Data Characteristic
 static uint8_t uuidDataChar[ATT_UUID_SIZE] = { TI_BASE_UUID_128(SERIALPORTSERVICE_DATA_UUID) };
 
+//UUID of Serial Port Credits Characteristic
+static uint8_t uuidCreditsChar[ATT_UUID_SIZE] = { TI_BASE_UUID_128(SERIALPORTSERVICE_CREDITS_UUID) };
+
+//UUID of Serial Port Session Characteristic
+static uint8_t uuidSessionChar[ATT_UUID_SIZE] = { TI_BASE_UUID_128(SERIALPORTSERVICE_SESSION_UUID) };
+
+// Credit based flow control, on once credit notifications are enabled on the
+// server. sbcTxCredits is how many more writes the server will take,
+// sbcRxCredits how many more notifications it may send us.
+static bool sbcCreditFlow = FALSE;
+static uint16_t sbcTxCredits = 0;
+static uint16_t sbcRxCredits = 0;
+
+#ifdef SPP_RELIABLE
+// Reliable session with the server, see spp_session.h. Opened on every
+// link, in use once status notifications are enabled on the server.
+static sppSession_t *sbcSession = NULL;
+static bool sbcReliable = FALSE;
+#endif
+
 // Value to write
 static uint8_t charVal = 0x41;
 
@@ -375,9 +487,27 @@ void SPPBLEClient_readRssiHandler(UArg a0);
 static uint8_t SPPBLEClient_enqueueMsg(uint8_t event, uint8_t status,
                                            uint8_t *pData);
 
-void SPPBLEClient_enqueueUARTMsg(uint8_t event, uint8_t *data, uint8_t len);
+void SPPBLEClient_enqueueUARTMsg(uint8_t event, uint8_t *data, uint16_t len);
+static void SPPBLEClient_updateUARTHold(void);
+static void SPPBLEClient_flushUARTFill(void);
+static void SPPBLEClient_grantCredits(void);
+static void SPPBLEClient_linkTuned(linkTuneResult_t *pResult);
 static void SPPBLEClient_genericHandler(UArg arg);
 static void SPPBLEClient_autoConnect(void);
+#ifdef SPP_RELIABLE
+static void SPPBLEClient_sendSessionData(void);
+static void SPPBLEClient_sendSessionRecord(void);
+#endif
+#ifdef SPP_BENCH
+static void SPPBLEClient_benchLine(uint8_t event, uint8_t *data, uint16_t len);
+static void SPPBLEClient_benchStart(void);
+static void SPPBLEClient_benchPump(void);
+static bool SPPBLEClient_benchQueueProbe(uint8_t type, uint16_t seq,
+                                         uint16_t size);
+static bool SPPBLEClient_benchRx(uint8_t *pData, uint16_t len);
+static void SPPBLEClient_benchTimeout(void);
+static void SPPBLEClient_benchFinish(void);
+#endif
 /*********************************************************************
  * PROFILE CALLBACKS
  */
@@ -498,7 +628,11 @@ static void SPPBLEClient_init(void)
   // Create an RTOS queue for message from profile to be sent to app.
   appMsgQueue = Util_constructQueue(&appMsg);
 
-  appUARTMsgQueue = Util_constructQueue(&appUARTMsg);
+  SPPUARTQueue_Init();
+  SPPUARTQueue_InitQueue(&sbcUARTQueue);
+#ifdef SPP_RELIABLE
+  SPPSession_Init();
+#endif
   
   // Setup discovery delay as a one-shot timer
   Util_constructClock(&startDiscClock, SPPBLEClient_genericHandler,
@@ -507,6 +641,16 @@ static void SPPBLEClient_init(void)
   Util_constructClock(&startNotiEnableClock, SPPBLEClient_genericHandler,
                       DEFAULT_NOTI_ENABLE_DELAY, 0, false, SBC_UART_CHANGE_EVT);  
 
+#if SBC_UART_AGGR_LATENCY
+  Util_constructClock(&uartAggrClock, SPPBLEClient_genericHandler,
+                      SBC_UART_AGGR_LATENCY, 0, false, SBC_UART_FLUSH_EVT);
+#endif
+
+#ifdef SPP_BENCH
+  Util_constructClock(&benchClock, SPPBLEClient_genericHandler,
+                      SBC_BENCH_TIMEOUT, 0, false, SBC_BENCH_TIMEOUT_EVT);
+#endif
+
   Board_initKeys(SPPBLEClient_keyChangeHandler);
 
 //  dispHandle = Display_open(Display_Type_LCD, NULL);
@@ -569,7 +713,12 @@ static void SPPBLEClient_init(void)
   GAPBondMgr_Register(&SPPBLEClient_bondCB);
 
   //Register to receive UART messages
+#ifdef SPP_BENCH
+  // The UART carries benchmark commands and results only
+  SDITask_registerIncomingRXEventAppCB(SPPBLEClient_benchLine);
+#else
   SDITask_registerIncomingRXEventAppCB(SPPBLEClient_enqueueUARTMsg);
+#endif
   
   // Register with GAP for HCI/Host messages (for RSSI)
   GAP_RegisterForMsgs(selfEntity);
@@ -577,8 +726,8 @@ static void SPPBLEClient_init(void)
   // Register for GATT local events and ATT Responses pending for transmission
   GATT_RegisterForMsgs(selfEntity);
 
-  //This API is documented in hci.h
-  //HCI_LE_WriteSuggestedDefaultDataLenCmd(APP_SUGGESTED_PDU_SIZE , APP_SUGGESTED_TX_TIME);
+  // Negotiate MTU and data length on every new link
+  LinkTune_Init(selfEntity, SPPBLEClient_linkTuned);
   
   //unsigned char hello[] = "Hello from SPP BLE Client! With Data Length Extension support!\n\r";
   //DEBUG(hello);
@@ -623,8 +772,27 @@ static void SPPBLEClient_taskFxn(UArg a0, UArg a1)
       {
         if ((src == ICALL_SERVICE_CLASS_BLE) && (dest == selfEntity))
         {
-          // Process inter-task message
-          SPPBLEClient_processStackMsg((ICall_Hdr *)pMsg);
+          ICall_Stack_Event *pEvt = (ICall_Stack_Event *)pMsg;
+
+          // Check for BLE stack events first
+          if (pEvt->signature == 0xffff)
+          {
+            if (pEvt->event_flag & SBC_CONN_EVT_END_EVT)
+            {
+              // Hand the server whatever SDI has freed up since
+              SPPBLEClient_grantCredits();
+
+#ifdef SPP_RELIABLE
+              // Acknowledge what the server notified in this event
+              SPPBLEClient_sendSessionRecord();
+#endif
+            }
+          }
+          else
+          {
+            // Process inter-task message
+            SPPBLEClient_processStackMsg((ICall_Hdr *)pMsg);
+          }
         }
 
         if (pMsg)
@@ -634,14 +802,50 @@ static void SPPBLEClient_taskFxn(UArg a0, UArg a1)
       }
     }
     
-      // If RTOS queue is not empty, process app UART message.
-      if (!Queue_empty(appUARTMsgQueue))
+      // UART bytes held for aggregation are due
+      if (events & SBC_UART_FLUSH_EVT)
+      {
+        events &= ~SBC_UART_FLUSH_EVT;
+
+        SPPBLEClient_flushUARTFill();
+      }
+
+#ifdef SPP_BENCH
+      if (events & SBC_BENCH_CMD_EVT)
+      {
+        events &= ~SBC_BENCH_CMD_EVT;
+
+        SPPBLEClient_benchStart();
+      }
+
+      if (events & SBC_BENCH_TIMEOUT_EVT)
+      {
+        events &= ~SBC_BENCH_TIMEOUT_EVT;
+
+        SPPBLEClient_benchTimeout();
+      }
+
+      // Top the UART queue up with the run's next probes
+      SPPBLEClient_benchPump();
+#endif
+
+#ifdef SPP_RELIABLE
+      // In a session UART data is sent, and resent, through it
+      if (sbcReliable)
+      {
+        SPPBLEClient_sendSessionData();
+      }
+      else
+#endif
+      // If the UART queue is not empty, process app UART message.
+      if (SPPUARTQueue_Peek(&sbcUARTQueue) != NULL)
       {
         //Get the message at the front of the queue but still keep it in the queue 
-        queueRec_t *pRec = Queue_head(appUARTMsgQueue);
-        sbcUARTEvt_t *pMsg = (sbcUARTEvt_t *)pRec->pData;
+        sppUARTMsg_t *pMsg = SPPUARTQueue_Peek(&sbcUARTQueue);
         
-        if (pMsg && (state == BLE_STATE_CONNECTED))
+        // With credit based flow control only write while the server has room
+        if (pMsg && (state == BLE_STATE_CONNECTED) &&
+            (!sbcCreditFlow || sbcTxCredits))
         {
           // Process message.
           bStatus_t retVal = FAILURE;
@@ -670,16 +874,19 @@ static void SPPBLEClient_taskFxn(UArg a0, UArg a1)
               //LCD_WRITE_STRING_VALUE("Data length:", req.len, 10, LCD_PAGE7);
             }else
             {
-              //Remove from the queue
-              Util_dequeueMsg(appUARTMsgQueue);
+              if (sbcCreditFlow)
+              {
+                sbcTxCredits--;
+              }
+
+              //Remove from the queue, the block goes back to the pool
+              SPPUARTQueue_Release(&sbcUARTQueue);
+              SPPBLEClient_updateUARTHold();
 
               //Toggle LED to indicate data received from UART terminal and sent over the air
               //SPPBLEClient_toggleLed(Board_GLED, Board_LED_TOGGLE);
-                  
-              // Free the space from the message.
-              ICall_free(pMsg);
               
-              if(!Queue_empty(appUARTMsgQueue))
+              if(SPPUARTQueue_Peek(&sbcUARTQueue) != NULL)
               {
                 // Wake up the application to flush out any remaining UART data in the queue.
                 Semaphore_post(sem);
@@ -734,7 +941,63 @@ static void SPPBLEClient_taskFxn(UArg a0, UArg a1)
         {
           DEBUG("Notification enabled...\n\r");
         }
-      }          
+      }
+
+      // Take part in credit based flow control if the server supports it
+      if (charCreditsCCCDHdl)
+      {
+        req.pValue = GATT_bm_alloc(connHandle, ATT_WRITE_REQ, 2, NULL);
+
+        if (req.pValue != NULL)
+        {
+          req.handle = charCreditsCCCDHdl;
+          req.len = 2;
+          memcpy(req.pValue, configData, 2);
+          req.cmd = TRUE;
+          req.sig = FALSE;
+          retVal = GATT_WriteNoRsp(connHandle, &req);
+          if (retVal != SUCCESS)
+          {
+            GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
+          }
+          else
+          {
+            // Server grants its credits at its next connection event, ours
+            // go out at ours
+            sbcCreditFlow = TRUE;
+          }
+        }
+      }
+
+#ifdef SPP_RELIABLE
+      // Run a reliable session if the server supports it: session
+      // notifications on, then our hello
+      if (charSessionCCCDHdl && (sbcSession != NULL))
+      {
+        req.pValue = GATT_bm_alloc(connHandle, ATT_WRITE_REQ, 2, NULL);
+
+        if (req.pValue != NULL)
+        {
+          req.handle = charSessionCCCDHdl;
+          req.len = 2;
+          memcpy(req.pValue, configData, 2);
+          req.cmd = TRUE;
+          req.sig = FALSE;
+          retVal = GATT_WriteNoRsp(connHandle, &req);
+          if (retVal != SUCCESS)
+          {
+            GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
+          }
+          else
+          {
+            // Data waits for the server's hello, see SPPSession_NextTx
+            sbcReliable = TRUE;
+            SPPSession_StartHello(sbcSession);
+            SPPBLEClient_sendSessionRecord();
+          }
+        }
+      }
+#endif
     }
     
 
@@ -791,6 +1054,11 @@ static void SPPBLEClient_processStackMsg(ICall_Hdr *pMsg)
             SPPBLEClient_processCmdCompleteEvt((hciEvt_CmdComplete_t *)pMsg);
             break;
 
+          case HCI_LE_EVENT_CODE:
+            // Data length change
+            LinkTune_ProcessHCIEvt(pMsg);
+            break;
+
           default:
             break;
         }
@@ -945,6 +1213,25 @@ static void SPPBLEClient_processRoleEvent(gapCentralRoleEvent_t *pEvent)
           procedureInProgress = TRUE;
 
           SPPBLEClient_toggleLed(Board_GLED, Board_LED_TOGGLE);
+
+          // Ask for the largest MTU and data length, UART chunks are
+          // resized as the results come in
+          VOID LinkTune_Start(connHandle);
+
+          // Credits are granted at the end of every connection event
+          sbcCreditFlow = FALSE;
+          sbcTxCredits = 0;
+          sbcRxCredits = 0;
+          HCI_EXT_ConnEventNoticeCmd(connHandle, selfEntity,
+                                     SBC_CONN_EVT_END_EVT);
+
+#ifdef SPP_RELIABLE
+          // Picks up where the last link to the same server left off
+          sbcReliable = FALSE;
+          sbcSession = SPPSession_Open(connHandle,
+                                       pEvent->linkCmpl.devAddrType,
+                                       pEvent->linkCmpl.devAddr);
+#endif
           
           // If service discovery not performed initiate service discovery
           if (charDataHdl == 0)
@@ -969,12 +1256,70 @@ static void SPPBLEClient_processRoleEvent(gapCentralRoleEvent_t *pEvent)
 
     case GAP_LINK_TERMINATED_EVENT:
       {
+        LinkTune_Stop(connHandle);
+
         state = BLE_STATE_IDLE;
         connHandle = GAP_CONNHANDLE_INIT;
         discState = BLE_DISC_STATE_IDLE;
         charDataHdl = 0;
+        charCreditsHdl = 0;
+        charCreditsCCCDHdl = 0;
+        charSessionHdl = 0;
+        charSessionCCCDHdl = 0;
+        sbcCreditFlow = FALSE;
         procedureInProgress = FALSE;
 
+        // Drop UART bytes still waiting to be merged or sent
+#if SBC_UART_AGGR_LATENCY
+        Util_stopClock(&uartAggrClock);
+#endif
+        {
+          ICall_CSState key;
+          sppUARTMsg_t *pFill;
+
+          key = ICall_enterCriticalSection();
+          pFill = sbcUARTFill;
+          sbcUARTFill = NULL;
+#ifdef SPP_RELIABLE
+          // Kept with the session, partly filled or not. Queued in the
+          // same critical section, like SPPBLEClient_flushUARTFill, so
+          // the SDI task is never a second producer.
+          if (pFill && pFill->length && (sbcSession != NULL))
+          {
+            SPPUARTQueue_Put(&sbcUARTQueue, pFill);
+            pFill = NULL;
+          }
+#endif
+          ICall_leaveCriticalSection(key);
+
+          if (pFill)
+          {
+            SPPUARTQueue_Free(pFill);
+          }
+
+#ifdef SPP_RELIABLE
+          // The session keeps what the server has not acknowledged for
+          // the next link
+          sbcReliable = FALSE;
+          if (sbcSession != NULL)
+          {
+            SPPSession_Close(sbcSession, &sbcUARTQueue);
+            sbcSession = NULL;
+          }
+#endif
+          SPPUARTQueue_Drain(&sbcUARTQueue);
+
+          SPPBLEClient_updateUARTHold();
+        }
+
+#ifdef SPP_BENCH
+        // Report how far the run got
+        if (sbcBench.active)
+        {
+          SPPBLEClient_benchFinish();
+        }
+#endif
+
         // Cancel RSSI reads
         //SPPBLEClient_CancelRssi(pEvent->linkTerminate.connectionHandle);
 
@@ -1020,12 +1365,10 @@ static void SPPBLEClient_handleKeys(uint8_t shift, uint8_t keys)
     if (state == BLE_STATE_CONNECTED )
     {    
 
-      //Request max supported size
-      uint16_t requestedPDUSize = 251;
-      uint16_t requestedTxTime = 2120;
-   
+      //Request max supported size again, link tuning asks once on connect
       //This API is documented in hci.h
-      if(SUCCESS != HCI_LE_SetDataLenCmd(connHandle, requestedPDUSize, requestedTxTime))
+      if(SUCCESS != HCI_LE_SetDataLenCmd(connHandle, LINKTUNE_TX_OCTETS,
+                                         LINKTUNE_TX_TIME))
       {
         DEBUG("Data length update failed");
       }
@@ -1153,10 +1496,87 @@ static void SPPBLEClient_processGATTMsg(gattMsgEvent_t *pMsg)
   if (state == BLE_STATE_CONNECTED)
   {
     
-    if(pMsg->method == ATT_HANDLE_VALUE_NOTI)
+    if (LinkTune_ProcessGATTMsg(pMsg))
+    {
+      // MTU exchange result, nothing else to do
+    }
+    else if ((pMsg->method == ATT_HANDLE_VALUE_NOTI) && charCreditsHdl &&
+        (pMsg->msg.handleValueNoti.handle == charCreditsHdl))
+    {
+      // Server granted more writes, the UART queue is serviced right after
+      if (pMsg->msg.handleValueNoti.len == SERIALPORTSERVICE_CREDITS_LEN)
+      {
+        sbcTxCredits += pMsg->msg.handleValueNoti.pValue[0];
+      }
+    }
+#ifdef SPP_RELIABLE
+    else if ((pMsg->method == ATT_HANDLE_VALUE_NOTI) && charSessionHdl &&
+             (pMsg->msg.handleValueNoti.handle == charSessionHdl))
+    {
+      // Session record from the server, acknowledged data goes back to
+      // the pool and the UART queue is serviced right after
+      if (sbcSession != NULL)
+      {
+        VOID SPPSession_ProcessRecord(sbcSession,
+                                      pMsg->msg.handleValueNoti.pValue,
+                                      pMsg->msg.handleValueNoti.len);
+        SPPBLEClient_updateUARTHold();
+      }
+    }
+#endif
+    else if(pMsg->method == ATT_HANDLE_VALUE_NOTI)
     { 
-      //Send received bytes to serial port
-      SDITask_sendToUART(pMsg->msg.handleValueNoti.pValue, pMsg->msg.handleValueNoti.len); 
+      uint8_t *pData = pMsg->msg.handleValueNoti.pValue;
+      uint16_t len = pMsg->msg.handleValueNoti.len;
+      bool deliver = TRUE;
+
+      // The server spent one of its credits
+      if (sbcRxCredits)
+      {
+        sbcRxCredits--;
+      }
+
+#ifdef SPP_RELIABLE
+      {
+        uint16_t hdrLen;
+
+        // Sequence number checked and stripped, data resent after a
+        // reconnect that already reached the UART is dropped
+        deliver = SPPSession_Rx(connHandle, pData, len, &hdrLen);
+        pData += hdrLen;
+        len -= hdrLen;
+      }
+#endif
+
+      //Send received bytes to serial port, written straight into an SDI TX frame
+      uint8_t *pFrame = NULL;
+
+#ifdef SPP_BENCH
+      // Probes coming back are measured, not written to the UART
+      if (deliver && SPPBLEClient_benchRx(pData, len))
+      {
+        deliver = FALSE;
+      }
+#endif
+
+      if (deliver)
+      {
+        pFrame = SDITask_reserveTxFrame(len);
+      }
+
+      if (pFrame != NULL)
+      {
+        memcpy(pFrame, pData, len);
+        SDITask_commitTxFrame(pFrame, len);
+      }
+#ifdef SPP_RELIABLE
+      else if (deliver)
+      {
+        // Not acknowledged, the server resends it
+        SPPSession_RxDropped(connHandle, pMsg->msg.handleValueNoti.pValue,
+                             pMsg->msg.handleValueNoti.len);
+      }
+#endif
       
       //Toggle LED to indicate data received from client
       SPPBLEClient_toggleLed(Board_RLED, Board_LED_TOGGLE);
@@ -1211,11 +1631,6 @@ static void SPPBLEClient_processGATTMsg(gattMsgEvent_t *pMsg)
       // Display the opcode of the message that caused the violation.
       Display_print1(dispHandle, 4, 0, "FC Violated: %d", pMsg->msg.flowCtrlEvt.opcode);
     }
-    else if (pMsg->method == ATT_MTU_UPDATED_EVENT)
-    {
-      // MTU size updated
-      Display_print1(dispHandle, 4, 0, "MTU Size: %d", pMsg->msg.mtuEvt.MTU);
-    }
     else if (discState != BLE_DISC_STATE_IDLE)
     {
       SPPBLEClient_processGATTDiscEvent(pMsg);
@@ -1503,19 +1918,21 @@ static void SPPBLEClient_processPasscode(uint16_t connectionHandle,
  */
 static void SPPBLEClient_startDiscovery(void)
 {
-  attExchangeMTUReq_t req;
+  uint8_t uuid[ATT_UUID_SIZE] = { TI_BASE_UUID_128(SERIALPORTSERVICE_SERV_UUID) };
 
   // Initialize cached handles
-  svcStartHdl = svcEndHdl = charDataHdl = 0;
+  svcStartHdl = svcEndHdl = charDataHdl = charCCCDHdl = 0;
+  charCreditsHdl = charCreditsCCCDHdl = 0;
+  charSessionHdl = charSessionCCCDHdl = 0;
 
-  discState = BLE_DISC_STATE_MTU;
+  // The ATT MTU was already exchanged by link tuning on connect
+  discState = BLE_DISC_STATE_SVC;
 
-  // Discover GATT Server's Rx MTU size
-  req.clientRxMTU = maxPduSize - L2CAP_HDR_SIZE;
+  DEBUG("Discovering services...");
 
-  // ATT MTU size should be set to the minimum of the Client Rx MTU
-  // and Server Rx MTU values
-  VOID GATT_ExchangeMTU(connHandle, &req, selfEntity);
+  // Discovery simple BLE service
+  VOID GATT_DiscPrimaryServiceByUUID(connHandle, uuid, ATT_UUID_SIZE,
+                                     selfEntity);
 }
 
 /*********************************************************************
@@ -1527,26 +1944,7 @@ static void SPPBLEClient_startDiscovery(void)
  */
 static void SPPBLEClient_processGATTDiscEvent(gattMsgEvent_t *pMsg)
 { 
-  if (discState == BLE_DISC_STATE_MTU)
-  {
-    // MTU size response received, discover simple BLE service
-    if (pMsg->method == ATT_EXCHANGE_MTU_RSP)
-    {
-      uint8_t uuid[ATT_UUID_SIZE] = { TI_BASE_UUID_128(SERIALPORTSERVICE_SERV_UUID) };
-      
-      // Just in case we're using the default MTU size (23 octets)
-      //LCD_WRITE_STRING_VALUE("MTU Size:", ATT_MTU_SIZE, 10, LCD_PAGE4);
-        
-      discState = BLE_DISC_STATE_SVC;
-      
-      DEBUG("Discovering services...");
-      
-      // Discovery simple BLE service
-      VOID GATT_DiscPrimaryServiceByUUID(connHandle, uuid, ATT_UUID_SIZE,
-                                         selfEntity);
-    }
-  }
-  else if (discState == BLE_DISC_STATE_SVC)
+  if (discState == BLE_DISC_STATE_SVC)
   {
     // Service found, store handles
     if (pMsg->method == ATT_FIND_BY_TYPE_VALUE_RSP &&
@@ -1603,11 +2001,25 @@ static void SPPBLEClient_processGATTDiscEvent(gattMsgEvent_t *pMsg)
           if (ATT_BT_PAIR_UUID(pMsg->msg.findInfoRsp.pInfo, i) ==
               GATT_CLIENT_CHAR_CFG_UUID)
           {
-            // CCCD found
-            DEBUG("CCCD for Data Char Found..."); DEBUG_NEWLINE();
-            charCCCDHdl = ATT_PAIR_HANDLE(pMsg->msg.findInfoRsp.pInfo, i);
-            //LCD_WRITE_STRING_VALUE("CCCD Handle:", charCCCDHdl, 10, LCD_PAGE6);
-            break;
+            uint16_t hdl = ATT_PAIR_HANDLE(pMsg->msg.findInfoRsp.pInfo, i);
+
+            // Handles come in ascending order, so a CCCD belongs to the
+            // characteristic value found last
+            if ((charSessionHdl > charDataHdl) && (charSessionHdl > charCreditsHdl))
+            {
+              charSessionCCCDHdl = hdl;
+            }
+            else if (charCreditsHdl > charDataHdl)
+            {
+              charCreditsCCCDHdl = hdl;
+            }
+            else if (charDataHdl && (charCCCDHdl == 0))
+            {
+              // CCCD found
+              DEBUG("CCCD for Data Char Found..."); DEBUG_NEWLINE();
+              charCCCDHdl = hdl;
+              //LCD_WRITE_STRING_VALUE("CCCD Handle:", charCCCDHdl, 10, LCD_PAGE6);
+            }
           }
         }
         else if(pMsg->msg.findInfoRsp.format == ATT_HANDLE_UUID_TYPE)
@@ -1619,7 +2031,16 @@ static void SPPBLEClient_processGATTDiscEvent(gattMsgEvent_t *pMsg)
             DEBUG("Data Char Found..."); //DEBUG_NEWLINE();
             charDataHdl = ATT_PAIR_HANDLE(pMsg->msg.findInfoRsp.pInfo, i);
             //LCD_WRITE_STRING_VALUE("Data Char Hdl: ", charDataHdl, 10, LCD_PAGE7);
-            break;
+          }
+          // Look for Serial Credits Char.
+          else if (memcmp(&(pMsg->msg.findInfoRsp.pInfo[ATT_PAIR_UUID_IDX(i)]), uuidCreditsChar, ATT_UUID_SIZE) == 0)
+          {
+            charCreditsHdl = ATT_PAIR_HANDLE(pMsg->msg.findInfoRsp.pInfo, i);
+          }
+          // Look for Serial Session Char.
+          else if (memcmp(&(pMsg->msg.findInfoRsp.pInfo[ATT_PAIR_UUID_IDX(i)]), uuidSessionChar, ATT_UUID_SIZE) == 0)
+          {
+            charSessionHdl = ATT_PAIR_HANDLE(pMsg->msg.findInfoRsp.pInfo, i);
           }
         }
       }
@@ -1877,35 +2298,700 @@ static void SPPBLEClient_genericHandler(UArg arg)
 }
 
 /*********************************************************************
- * @fn      SPPBLEClient_enqueueMsg
+ * @fn      SPPBLEClient_enqueueUARTMsg
  *
- * @brief   Creates a message and puts the message in RTOS queue.
+ * @brief   SDI RX callback. Merges consecutive UART chunks into writes
+ *          as large as the link allows. A full write is queued straight
+ *          away, while the BLE side is still busy with earlier ones; a
+ *          partial one is queued once SBC_UART_AGGR_LATENCY has passed
+ *          since its first byte arrived.
  *
  * @param   event - message event.
- * @param   status - message status.
- * @param   pData - message data pointer.
+ * @param   data - received UART bytes.
+ * @param   len - number of bytes.
  *
- * @return  TRUE or FALSE
+ * @return  None.
  */
-void SPPBLEClient_enqueueUARTMsg(uint8_t event, uint8_t *data, uint8_t len)
+void SPPBLEClient_enqueueUARTMsg(uint8_t event, uint8_t *data, uint16_t len)
 {
-  sbcUARTEvt_t *pMsg;
-  
+  ICall_CSState key;
+  sppUARTMsg_t *pMsg;
+  uint16_t limit;
+  uint16_t chunk;
+
   //Enqueue message only in a connected state
-  if(state == BLE_STATE_CONNECTED)
+  while ((state == BLE_STATE_CONNECTED) && len)
   {
-    // Create dynamic pointer to message.
-    if (pMsg = ICall_malloc(sizeof(sbcUARTEvt_t)))
+    key = ICall_enterCriticalSection();
+
+    if (sbcUARTFill == NULL)
     {
-      memcpy(pMsg->data , data, len);
-      pMsg->length = len;
-      
-      // Enqueue the message.
-      Util_enqueueMsg(appUARTMsgQueue, sem, (uint8_t *)pMsg);
+      ICall_leaveCriticalSection(key);
+
+      // Delivery is held before the pool runs dry, so this only fails if
+      // SDI ignored the hold
+      pMsg = SPPUARTQueue_Alloc();
+      if (pMsg == NULL)
+      {
+        SPPBLEClient_updateUARTHold();
+        return;
+      }
+
+      pMsg->length = 0;
+
+      key = ICall_enterCriticalSection();
+      sbcUARTFill = pMsg;
+      ICall_leaveCriticalSection(key);
+
+#if SBC_UART_AGGR_LATENCY
+      // Latency cap counts from the first byte of the write
+      Util_startClock(&uartAggrClock);
+#endif
+      continue;
+    }
+
+    limit = sbcUARTPayload;
+    if (sbcUARTFill->length < limit)
+    {
+      chunk = MIN(len, limit - sbcUARTFill->length);
+      memcpy(&sbcUARTFill->data[sbcUARTFill->length], data, chunk);
+      sbcUARTFill->length += chunk;
+      data += chunk;
+      len -= chunk;
+    }
+
+    ICall_leaveCriticalSection(key);
+
+#if SBC_UART_AGGR_LATENCY
+    if (sbcUARTFill && (sbcUARTFill->length >= limit))
+#endif
+    {
+      SPPBLEClient_flushUARTFill();
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_flushUARTFill
+ *
+ * @brief   Queue the UART message being filled for a write. Runs in the
+ *          SDI task when the message is full and in the application task
+ *          when the latency cap expires, so taking the message and
+ *          queueing it is done in one go to keep the queue single
+ *          producer.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_flushUARTFill(void)
+{
+  ICall_CSState key;
+  sppUARTMsg_t *pMsg;
+
+  key = ICall_enterCriticalSection();
+
+  pMsg = sbcUARTFill;
+  sbcUARTFill = NULL;
+
+  if (pMsg && pMsg->length)
+  {
+    SPPUARTQueue_Put(&sbcUARTQueue, pMsg);
+  }
+
+  ICall_leaveCriticalSection(key);
+
+#if SBC_UART_AGGR_LATENCY
+  Util_stopClock(&uartAggrClock);
+#endif
+
+  if (pMsg == NULL)
+  {
+    return;
+  }
+
+  if (pMsg->length)
+  {
+    // Wake up the application
+    SPPBLEClient_updateUARTHold();
+    Semaphore_post(sem);
+  }
+  else
+  {
+    // Only ever empty when the latency cap expires, in the application task
+    SPPUARTQueue_Free(pMsg);
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_updateUARTHold
+ *
+ * @brief   Hold SDI RX deliveries while the UART message pool is nearly
+ *          empty, so a host that writes faster than the link drains is
+ *          held off by flow control instead of losing data. Called by
+ *          the SDI task after queueing and by the application task after
+ *          releasing a message.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_updateUARTHold(void)
+{
+  ICall_CSState key;
+  uint8_t numFree;
+
+  // Decided and applied in one go, so the two tasks can never leave SDI
+  // held with nothing queued to release it
+  key = ICall_enterCriticalSection();
+
+  numFree = SPPUARTQueue_NumFree();
+  if (!sbcUARTHeld && (numFree < SBC_UART_POOL_HOLD))
+  {
+    sbcUARTHeld = TRUE;
+    SDITask_holdRx(TRUE);
+  }
+  else if (sbcUARTHeld && (numFree >= SBC_UART_POOL_RESUME))
+  {
+    sbcUARTHeld = FALSE;
+    SDITask_holdRx(FALSE);
+  }
+
+  ICall_leaveCriticalSection(key);
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_grantCredits
+ *
+ * @brief   Grant the server as many Data Characteristic notifications as
+ *          SDI has free TX frames for. Every notification lands in one
+ *          frame, so the server can never send more than SDI can take.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void SPPBLEClient_grantCredits(void)
+{
+  attWriteReq_t req;
+  uint8_t freeFrames;
+  uint8_t grant;
+
+  if ((state != BLE_STATE_CONNECTED) || !sbcCreditFlow)
+  {
+    return;
+  }
+
+  // Credits already granted may still be spent on frames free right now
+  freeFrames = SDITask_getTxFreeFrames(SDI_CHANNEL_DEFAULT);
+  if (freeFrames <= sbcRxCredits)
+  {
+    return;
+  }
+
+  grant = freeFrames - sbcRxCredits;
+  if ((grant < SBC_CREDITS_GRANT_MIN) && sbcRxCredits)
+  {
+    return;
+  }
+
+  req.pValue = GATT_bm_alloc(connHandle, ATT_WRITE_REQ,
+                             SERIALPORTSERVICE_CREDITS_LEN, NULL);
+  if (req.pValue != NULL)
+  {
+    req.handle = charCreditsHdl;
+    req.len = SERIALPORTSERVICE_CREDITS_LEN;
+    req.pValue[0] = grant;
+    req.sig = FALSE;
+    req.cmd = TRUE;
+
+    if (GATT_WriteNoRsp(connHandle, &req) == SUCCESS)
+    {
+      sbcRxCredits += grant;
+    }
+    else
+    {
+      GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
     }
   }
 }
 
+#ifdef SPP_RELIABLE
+/*********************************************************************
+ * @fn      SPPBLEClient_sendSessionData
+ *
+ * @brief   Write the session's next block to the server, with its
+ *          sequence number in front. Blocks stay in the session until
+ *          the server acknowledges them, see SPPSession_ProcessRecord.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_sendSessionData(void)
+{
+  sppUARTMsg_t *pMsg;
+  attWriteReq_t req;
+  uint16_t seq;
+
+  SPPSession_Fill(sbcSession, &sbcUARTQueue);
+
+  pMsg = SPPSession_NextTx(sbcSession, &seq);
+
+  // With credit based flow control only write while the server has room
+  if ((pMsg == NULL) || (state != BLE_STATE_CONNECTED) || !charDataHdl ||
+      (sbcCreditFlow && !sbcTxCredits))
+  {
+    return;
+  }
+
+  req.pValue = GATT_bm_alloc(connHandle, ATT_WRITE_REQ,
+                             SPP_SESSION_HDR_SIZE + pMsg->length, NULL);
+  if (req.pValue == NULL)
+  {
+    return;
+  }
+
+  req.handle = charDataHdl;
+  req.len = SPP_SESSION_HDR_SIZE + pMsg->length;
+  req.pValue[0] = LO_UINT16(seq);
+  req.pValue[1] = HI_UINT16(seq);
+  memcpy(req.pValue + SPP_SESSION_HDR_SIZE, pMsg->data, pMsg->length);
+  req.sig = FALSE;
+  req.cmd = TRUE;
+
+  if (GATT_WriteNoRsp(connHandle, &req) != SUCCESS)
+  {
+    GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
+    return;
+  }
+
+  if (sbcCreditFlow)
+  {
+    sbcTxCredits--;
+  }
+
+  SPPSession_Sent(sbcSession);
+
+  if (SPPSession_NextTx(sbcSession, &seq) != NULL)
+  {
+    // Wake up the application to send the rest
+    Semaphore_post(sem);
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_sendSessionRecord
+ *
+ * @brief   Write our session record to the server's Session
+ *          characteristic if a hello or an acknowledgement is due. One
+ *          that cannot be sent now goes out at the end of a later
+ *          connection event.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_sendSessionRecord(void)
+{
+  uint8_t record[SPP_SESSION_RECORD_LEN];
+  attWriteReq_t req;
+
+  if ((state != BLE_STATE_CONNECTED) || !sbcReliable || !charSessionHdl ||
+      !SPPSession_RecordDue(sbcSession))
+  {
+    return;
+  }
+
+  req.pValue = GATT_bm_alloc(connHandle, ATT_WRITE_REQ,
+                             SPP_SESSION_RECORD_LEN, NULL);
+  if (req.pValue != NULL)
+  {
+    SPPSession_BuildRecord(sbcSession, record);
+
+    req.handle = charSessionHdl;
+    req.len = SPP_SESSION_RECORD_LEN;
+    memcpy(req.pValue, record, SPP_SESSION_RECORD_LEN);
+    req.sig = FALSE;
+    req.cmd = TRUE;
+
+    if (GATT_WriteNoRsp(connHandle, &req) == SUCCESS)
+    {
+      SPPSession_RecordSent(sbcSession, record);
+    }
+    else
+    {
+      GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
+    }
+  }
+}
+#endif //SPP_RELIABLE
+
+/*********************************************************************
+ * @fn      SPPBLEClient_linkTuned
+ *
+ * @brief   Link tuning callback. Resizes the UART chunks SDI delivers so
+ *          each one fills a write command at the negotiated MTU.
+ *
+ * @param   pResult - current link parameters
+ *
+ * @return  none
+ */
+static void SPPBLEClient_linkTuned(linkTuneResult_t *pResult)
+{
+  sbcUARTPayload = SBC_UART_DELIVERY_SIZE(pResult->payload);
+  SDITask_setRxDeliverySize(sbcUARTPayload);
+
+  Display_print3(dispHandle, 4, 0, "MTU %d DLE %d/%d", pResult->mtu,
+                 pResult->txOctets, pResult->rxOctets);
+}
+
+#ifdef SPP_BENCH
+/*********************************************************************
+ * @fn      SPPBLEClient_benchLine
+ *
+ * @brief   SDI RX callback of benchmark builds. Collects a command line
+ *          and hands it to the application task once complete:
+ *
+ *          BENCH <echo|bulk> <count> <size>
+ *
+ *          Echo runs send count probes of size bytes one at a time, each
+ *          returned by the server, and time the round trips. Bulk runs
+ *          send them back to back and ask the server how many arrived.
+ *          Either way one result line is written back, see
+ *          SPPBench_FormatResult.
+ *
+ * @param   event - message event.
+ * @param   data - received UART bytes.
+ * @param   len - number of bytes.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_benchLine(uint8_t event, uint8_t *data, uint16_t len)
+{
+  char c;
+
+  while (len--)
+  {
+    c = (char)*data++;
+
+    if ((c != '\r') && (c != '\n'))
+    {
+      // Overlong lines are cut short and rejected by the parser
+      if (sbcBenchLineLen < (SBC_BENCH_LINE_LEN - 1))
+      {
+        sbcBenchLine[sbcBenchLineLen++] = c;
+      }
+      continue;
+    }
+
+    // A line arriving while the previous one is still pending is dropped
+    if (sbcBenchLineLen && !sbcBenchCmdPending)
+    {
+      memcpy(sbcBenchCmd, sbcBenchLine, sbcBenchLineLen);
+      sbcBenchCmd[sbcBenchLineLen] = '\0';
+      sbcBenchCmdPending = TRUE;
+
+      SPPBLEClient_genericHandler(SBC_BENCH_CMD_EVT);
+    }
+
+    sbcBenchLineLen = 0;
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_benchStart
+ *
+ * @brief   Parse the pending benchmark command and start the run. Probe
+ *          sizes are clamped to what one write carries on the link.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_benchStart(void)
+{
+  static const char error[] = "BENCH,error\r\n";
+  sppBenchResult_t *pResult = &sbcBench.result;
+  uint32_t value[2] = {0, 0};
+  char *p = sbcBenchCmd;
+  uint8_t mode = SPPBENCH_MODE_ECHO;
+  uint8_t i;
+
+  if (strncmp(p, "BENCH ", 6) == 0)
+  {
+    p += 6;
+  }
+  else
+  {
+    p = NULL;
+  }
+
+  if (p && (strncmp(p, "echo ", 5) == 0))
+  {
+    mode = SPPBENCH_MODE_ECHO;
+    p += 5;
+  }
+  else if (p && (strncmp(p, "bulk ", 5) == 0))
+  {
+    mode = SPPBENCH_MODE_BULK;
+    p += 5;
+  }
+  else
+  {
+    p = NULL;
+  }
+
+  // Count, then size
+  for (i = 0; p && (i < 2); i++)
+  {
+    while (*p == ' ')
+    {
+      p++;
+    }
+
+    if ((*p < '0') || (*p > '9'))
+    {
+      p = NULL;
+      break;
+    }
+
+    while ((*p >= '0') && (*p <= '9') && (value[i] <= 0xFFFF))
+    {
+      value[i] = (value[i] * 10) + (*p++ - '0');
+    }
+  }
+
+  sbcBenchCmdPending = FALSE;
+
+  if ((p == NULL) || (*p != '\0') || (value[0] == 0) ||
+      (value[0] > 0xFFFF) || (value[1] > 0xFFFF) || sbcBench.active ||
+      (state != BLE_STATE_CONNECTED) || (charDataHdl == 0))
+  {
+    SDITask_sendToUART((uint8_t *)error, sizeof(error) - 1);
+    return;
+  }
+
+  memset(&sbcBench, 0, sizeof(sbcBench));
+  SPPBench_LatencyReset(&sbcBench.latency);
+
+  pResult->mode = mode;
+  pResult->count = (uint16_t)value[0];
+  pResult->size = MAX((uint16_t)value[1], SPPBENCH_HDR_SIZE);
+  pResult->size = MIN(pResult->size, sbcUARTPayload);
+
+  sbcBench.active = TRUE;
+  sbcBench.startUs = SPPBench_Now();
+
+  SPPBLEClient_benchPump();
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_benchPump
+ *
+ * @brief   Queue the current run's next probes. An echo run keeps one
+ *          probe in flight. A bulk run keeps the UART block pool full,
+ *          the write loop drains it as fast as the link and the server's
+ *          credits allow, and ends with an END probe.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_benchPump(void)
+{
+  sppBenchResult_t *pResult = &sbcBench.result;
+
+  if (!sbcBench.active || (state != BLE_STATE_CONNECTED))
+  {
+    return;
+  }
+
+  if (pResult->mode == SPPBENCH_MODE_ECHO)
+  {
+    if ((sbcBench.done == pResult->sent) && (pResult->sent < pResult->count) &&
+        SPPBLEClient_benchQueueProbe(SPPBENCH_TYPE_ECHO, pResult->sent,
+                                     pResult->size))
+    {
+      pResult->sent++;
+      Util_startClock(&benchClock);
+    }
+  }
+  else
+  {
+    while ((pResult->sent < pResult->count) &&
+           (SPPUARTQueue_NumFree() > SBC_UART_POOL_HOLD) &&
+           SPPBLEClient_benchQueueProbe(SPPBENCH_TYPE_BULK, pResult->sent,
+                                        pResult->size))
+    {
+      pResult->sent++;
+    }
+
+    if ((pResult->sent == pResult->count) && !sbcBench.endSent &&
+        SPPBLEClient_benchQueueProbe(SPPBENCH_TYPE_END, pResult->sent,
+                                     SPPBENCH_HDR_SIZE))
+    {
+      sbcBench.endSent = TRUE;
+      Util_startClock(&benchClock);
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_benchQueueProbe
+ *
+ * @brief   Build a probe in a UART block and queue it for writing.
+ *
+ * @param   type - SPPBENCH_TYPE_xxx
+ * @param   seq - probe number
+ * @param   size - probe size
+ *
+ * @return  TRUE if queued, FALSE if the pool is empty
+ */
+static bool SPPBLEClient_benchQueueProbe(uint8_t type, uint16_t seq,
+                                         uint16_t size)
+{
+  ICall_CSState key;
+  sppUARTMsg_t *pMsg = SPPUARTQueue_Alloc();
+
+  if (pMsg == NULL)
+  {
+    return (FALSE);
+  }
+
+  VOID SPPBench_BuildProbe(pMsg->data, size, type, seq);
+  pMsg->length = size;
+
+  key = ICall_enterCriticalSection();
+  SPPUARTQueue_Put(&sbcUARTQueue, pMsg);
+  ICall_leaveCriticalSection(key);
+
+  return (TRUE);
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_benchRx
+ *
+ * @brief   Account for a probe notified by the server.
+ *
+ * @param   pData - notified data
+ * @param   len - length of data
+ *
+ * @return  TRUE if the data belongs to the run, FALSE otherwise
+ */
+static bool SPPBLEClient_benchRx(uint8_t *pData, uint16_t len)
+{
+  sppBenchResult_t *pResult = &sbcBench.result;
+  sppBenchProbe_t probe;
+  sppBenchRx_t report;
+
+  if (!sbcBench.active || !SPPBench_ParseProbe(pData, len, &probe))
+  {
+    return (FALSE);
+  }
+
+  if ((probe.type == SPPBENCH_TYPE_ECHO) &&
+      (pResult->mode == SPPBENCH_MODE_ECHO) &&
+      (sbcBench.done < pResult->sent) && (probe.seq == pResult->sent - 1))
+  {
+    Util_stopClock(&benchClock);
+
+    SPPBench_LatencyAdd(&sbcBench.latency, SPPBench_Now() - probe.timestamp);
+    sbcBench.bytes += len;
+    pResult->received++;
+    sbcBench.done++;
+
+    if (sbcBench.done == pResult->count)
+    {
+      SPPBLEClient_benchFinish();
+    }
+  }
+  else if ((pResult->mode == SPPBENCH_MODE_BULK) && sbcBench.endSent &&
+           SPPBench_ParseReport(pData, len, &report))
+  {
+    // Goodput over the server's time from first to last probe
+    pResult->received = report.received;
+    pResult->goodputBps = SPPBench_Goodput(report.bytes, report.lastUs);
+
+    SPPBLEClient_benchFinish();
+  }
+
+  // Late replies of a probe already given up on are dropped too
+  return (TRUE);
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_benchTimeout
+ *
+ * @brief   No reply within SBC_BENCH_TIMEOUT. The echo probe in flight
+ *          is counted lost and the run moves on; a bulk run without a
+ *          report ends with nothing received.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_benchTimeout(void)
+{
+  sppBenchResult_t *pResult = &sbcBench.result;
+
+  if (!sbcBench.active)
+  {
+    return;
+  }
+
+  if (pResult->mode == SPPBENCH_MODE_ECHO)
+  {
+    if (sbcBench.done < pResult->sent)
+    {
+      sbcBench.done++;
+    }
+
+    if (sbcBench.done == pResult->count)
+    {
+      SPPBLEClient_benchFinish();
+    }
+  }
+  else if (sbcBench.endSent)
+  {
+    SPPBLEClient_benchFinish();
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEClient_benchFinish
+ *
+ * @brief   End the current run and write its result line to the UART.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEClient_benchFinish(void)
+{
+  sppBenchResult_t *pResult = &sbcBench.result;
+  char line[SPPBENCH_RESULT_LEN];
+  uint16_t len;
+
+  Util_stopClock(&benchClock);
+  sbcBench.active = FALSE;
+
+  pResult->lost = pResult->sent - pResult->received;
+
+  if (pResult->mode == SPPBENCH_MODE_ECHO)
+  {
+    pResult->p50Us = SPPBench_LatencyPercentile(&sbcBench.latency, 50);
+    pResult->p99Us = SPPBench_LatencyPercentile(&sbcBench.latency, 99);
+    pResult->maxUs = sbcBench.latency.max;
+    pResult->goodputBps = SPPBench_Goodput(sbcBench.bytes,
+                                           SPPBench_Now() - sbcBench.startUs);
+  }
+
+  len = SPPBench_FormatResult(line, pResult);
+  VOID SDITask_sendToUART((uint8_t *)line, len);
+}
+#endif
+
 /*********************************************************************
  * @fn      SPPBLEClient_enqueueMsg
  *
@@ -78,7 +78,12 @@
 #include "board.h"
 
 #include "serial_port_service.h"
+#include "link_tune.h"
+#include "spp_uart_queue.h"
+#include "spp_bench.h"
+#include "spp_session.h"
 #include "spp_ble_server.h"
+#include "inc/sdi_config.h"
 #include "inc/sdi_task.h" 
 #include "inc/sdi_tl_uart.h"
 
@@ -130,6 +135,53 @@
 // How often to perform periodic event (in msec)
 #define SBP_PERIODIC_EVT_PERIOD               5000
 
+// Free UART message blocks below which SDI stops delivering, and the level
+// at which it resumes. The hold takes effect with one block still free, for
+// a delivery already on its way when SDI is held.
+#define SBP_UART_POOL_HOLD                    2
+#define SBP_UART_POOL_RESUME                  (SPP_UART_MSG_CNT / 2)
+
+// Credit based flow control, see SPPBLEServer_grantCredits. Credits are only
+// granted to the client in batches of at least this many writes, unless it
+// holds none at all.
+#define SBP_CREDITS_GRANT_MIN                 2
+
+// Centrals served at once, each with its own notification queue, credits
+// and counters, see sbpConn_t. Going beyond one needs a GAP role and a stack
+// built for several links (MAX_NUM_BLE_CONNS).
+#define SBP_MAX_CONNS                         SERIALPORTSERVICE_MAX_CONNS
+
+// How the UART is shared between centrals. SBP_STREAM_FANOUT notifies all
+// UART data to every central and passes the data of all centrals to the UART
+// on SDI_CHANNEL_DEFAULT. SBP_STREAM_DEMUX pairs the central in stream slot i
+// with SDI channel i both ways, the host tells the streams apart by the
+// channel of each SDI frame (SDI_USE_FRAMING).
+#define SBP_STREAM_FANOUT                     0
+#define SBP_STREAM_DEMUX                      1
+
+#ifndef SBP_STREAM_MODE
+#define SBP_STREAM_MODE                       SBP_STREAM_FANOUT
+#endif
+
+#if (SBP_STREAM_MODE == SBP_STREAM_DEMUX) && (SBP_MAX_CONNS > SDI_CHANNEL_CNT)
+#error "SBP_STREAM_DEMUX needs an SDI channel per central, raise SDI_CHANNEL_CNT"
+#endif
+
+#if defined(SPP_RELIABLE) && (SPP_SESSION_MAX < SBP_MAX_CONNS)
+#error "SPP_RELIABLE needs a session per central, raise SPP_SESSION_MAX"
+#endif
+
+// Largest UART chunk that fits in one notification, for the payload size
+// reported by the link tuning module. Reliable sessions send a sequence
+// number in front of the data.
+#ifdef SPP_RELIABLE
+#define SBP_UART_DELIVERY_SIZE(payload)       ((((payload) - SPP_SESSION_HDR_SIZE) < SERIALPORTSERVICE_DATA_LEN) ? \
+                                               ((payload) - SPP_SESSION_HDR_SIZE) : SERIALPORTSERVICE_DATA_LEN)
+#else
+#define SBP_UART_DELIVERY_SIZE(payload)       (((payload) < SERIALPORTSERVICE_DATA_LEN) ? \
+                                               (payload) : SERIALPORTSERVICE_DATA_LEN)
+#endif
+
 #ifdef FEATURE_OAD
 // The size of an OAD packet.
 #define OAD_PACKET_SIZE                       ((OAD_BLOCK_SIZE) + 2)
@@ -149,9 +201,6 @@
 #define SBP_PERIODIC_EVT                      0x0004
 #define SBP_CONN_EVT_END_EVT                  0x0008
 
-#define APP_SUGGESTED_PDU_SIZE 27
-#define APP_SUGGESTED_TX_TIME 328
-
 /*********************************************************************
  * TYPEDEFS
  */
@@ -165,16 +214,37 @@ typedef struct _queueRec_
 // App event passed from profiles.
 typedef struct
 {
-  appEvtHdr_t hdr;  // event header.
+  appEvtHdr_t hdr;      // event header.
+  uint16_t connHandle;  // connection the event came from, if any
 } sbpEvt_t;
 
-// App event passed from profiles.
+// UART stream to one central
+typedef struct
+{
+  uint16_t connHandle;        // INVALID_CONNHANDLE while the slot is free
+  uint8_t channel;            // SDI channel the stream uses
+  uint8_t txBlocked;          // Stack out of buffers until the next event
+  uint16_t txThisEvent;       // Notifications since the last event end
+  uint16_t txCredits;         // Notifications the central will still take
+  uint16_t rxCredits;         // Writes the central may still send us
+  uint16_t payload;           // Bytes per notification at the current MTU
+  sppUARTQueue_t uartQueue;   // UART data waiting to be notified
+#ifdef SPP_RELIABLE
+  sppSession_t *pSession;     // Reliable session with the central, if any
+#endif
+} sbpConn_t;
+
+// Notification burst counters, see SPPBLEServer_sendUARTBurst. Average
+// notifications per connection event is notifications / connEvents.
 typedef struct
 {
-  uint8_t event;  // Type of event
-  uint8_t data[SERIALPORTSERVICE_DATA_LEN];  // New data
-  uint8_t length; // New status
-} sbpUARTEvt_t; //size = 22 bytes
+  uint32_t connEvents;    // Connection events seen while connected
+  uint32_t notifications; // Notifications handed to the stack
+  uint32_t bytes;         // UART bytes carried by them
+  uint32_t noResources;   // Bursts cut short by the stack running out of buffers
+  uint32_t noCredits;     // Bursts cut short by the client's credits running out
+  uint16_t maxPerEvent;   // Most notifications queued in one connection interval
+} sbpBurstStats_t;
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -202,9 +272,25 @@ static Clock_Struct periodicClock;
 static Queue_Struct appMsg;
 static Queue_Handle appMsgQueue;
 
-// Queue object used for UART messages
-static Queue_Struct appUARTMsg;
-static Queue_Handle appUARTMsgQueue; 
+// UART messages waiting for BLE live in the spp_uart_queue block pool.
+// TRUE while SDI delivery is held because the pool is running out.
+static bool sbpUARTHeld = FALSE;
+
+// One UART stream per connected central. A burst that ran the stack out of
+// buffers (txBlocked) is picked up at the next connection event end.
+// Credit based flow control is used once a central enables Credits
+// Characteristic notifications: txCredits is how many more notifications
+// it will take, rxCredits how many more writes it may send us. A slot's
+// connHandle is only valid while the SDI task may queue data to it.
+static sbpConn_t sbpConn[SBP_MAX_CONNS];
+
+// Notification burst counters, all streams together
+static sbpBurstStats_t sbpBurstStats;
+
+#ifdef SPP_BENCH
+// Bulk benchmark run counters of each stream, kept in the stack's context
+static sppBenchRx_t sbpBenchRx[SBP_MAX_CONNS];
+#endif
 
 #if defined(FEATURE_OAD)
 // Event data from OAD profile.
@@ -313,7 +399,8 @@ static uint8_t SPPBLEServer_processStackMsg(ICall_Hdr *pMsg);
 static uint8_t SPPBLEServer_processGATTMsg(gattMsgEvent_t *pMsg);
 static void SPPBLEServer_processAppMsg(sbpEvt_t *pMsg);
 static void SPPBLEServer_processStateChangeEvt(gaprole_States_t newState);
-static void SPPBLEServer_processCharValueChangeEvt(uint8_t paramID);
+static void SPPBLEServer_processCharValueChangeEvt(uint16_t connHandle,
+                                                   uint8_t paramID);
 static void SPPBLEServer_performPeriodicTask(void);
 static void SPPBLEServer_clockHandler(UArg arg);
 
@@ -322,10 +409,30 @@ static void SPPBLEServer_freeAttRsp(uint8_t status);
 
 static void SPPBLEServer_stateChangeCB(gaprole_States_t newState);
 #ifndef FEATURE_OAD_ONCHIP
-static void SPPBLEServer_charValueChangeCB(uint8_t paramID);
+static void SPPBLEServer_charValueChangeCB(uint16_t connHandle, uint8_t paramID);
 #endif //!FEATURE_OAD_ONCHIP
-static void SPPBLEServer_enqueueMsg(uint8_t event, uint8_t state);
-void SPPBLEServer_enqueueUARTMsg(uint8_t event, uint8_t *data, uint8_t len);
+static void SPPBLEServer_enqueueMsg(uint8_t event, uint8_t state,
+                                   uint16_t connHandle);
+void SPPBLEServer_enqueueUARTMsg(uint8_t event, uint8_t *data, uint16_t len);
+static void SPPBLEServer_updateUARTHold(void);
+static sbpConn_t *SPPBLEServer_findConn(uint16_t connHandle);
+static void SPPBLEServer_openConn(uint16_t connHandle);
+static void SPPBLEServer_closeConns(void);
+static void SPPBLEServer_processConnEvtEnd(void);
+static void SPPBLEServer_sendUARTBurst(void);
+static void SPPBLEServer_sendConnBurst(sbpConn_t *pConn);
+static void SPPBLEServer_grantCredits(void);
+static void SPPBLEServer_grantConnCredits(sbpConn_t *pConn);
+static void SPPBLEServer_linkTuned(linkTuneResult_t *pResult);
+#ifdef SPP_RELIABLE
+static void SPPBLEServer_sendSessionBurst(sbpConn_t *pConn, uint8_t creditFlow);
+static void SPPBLEServer_processSessionRecord(sbpConn_t *pConn);
+static void SPPBLEServer_sendSessionRecords(void);
+#endif
+#ifdef SPP_BENCH
+static void SPPBLEServer_benchReply(uint16_t connHandle, uint8_t *pData,
+                                    uint16_t len);
+#endif
 #ifdef FEATURE_OAD
 void SPPBLEServer_processOadWriteCB(uint8_t event, uint16_t connHandle,
                                            uint8_t *pData);
@@ -471,7 +578,19 @@ static void SPPBLEServer_init(void)
 
   // Create an RTOS queue for message from profile to be sent to app.
   appMsgQueue = Util_constructQueue(&appMsg);
-  appUARTMsgQueue = Util_constructQueue(&appUARTMsg);
+  SPPUARTQueue_Init();
+  {
+    uint8_t i;
+
+    for (i = 0; i < SBP_MAX_CONNS; i++)
+    {
+      sbpConn[i].connHandle = INVALID_CONNHANDLE;
+      SPPUARTQueue_InitQueue(&sbpConn[i].uartQueue);
+    }
+  }
+#ifdef SPP_RELIABLE
+  SPPSession_Init();
+#endif
   // Create one-shot clocks for internal periodic events.
   Util_constructClock(&periodicClock, SPPBLEServer_clockHandler,
                       SBP_PERIODIC_EVT_PERIOD, 0, false, SBP_PERIODIC_EVT);
@@ -590,14 +709,28 @@ static void SPPBLEServer_init(void)
   // Register for GATT local events and ATT Responses pending for transmission
   GATT_RegisterForMsgs(selfEntity);
 
+  // Negotiate MTU and data length on every new link, the exchange is a
+  // GATT client procedure
+  VOID GATT_InitClient();
+  LinkTune_Init(selfEntity, SPPBLEServer_linkTuned);
+
   //Register to receive UART messages
+#if (SBP_STREAM_MODE == SBP_STREAM_DEMUX)
+  {
+    uint8_t i;
+
+    // One channel per stream slot, see SPPBLEServer_enqueueUARTMsg
+    for (i = 0; i < SBP_MAX_CONNS; i++)
+    {
+      SDITask_registerChannelRxCB(i, SPPBLEServer_enqueueUARTMsg);
+    }
+  }
+#else
   SDITask_registerIncomingRXEventAppCB(SPPBLEServer_enqueueUARTMsg); //ZH
+#endif
   
   HCI_LE_ReadMaxDataLenCmd();
 
-  //This API is documented in hci.h
-  //HCI_LE_WriteSuggestedDefaultDataLenCmd(APP_SUGGESTED_PDU_SIZE , APP_SUGGESTED_TX_TIME);
-
   //unsigned char hello[] = "Hello from SPP BLE Server! With Data Length Extension support!\n\r";
   //DEBUG(hello);
   
@@ -660,6 +793,20 @@ static void SPPBLEServer_taskFxn(UArg a0, UArg a1)
             {
               // Try to retransmit pending ATT Response (if any)
               SPPBLEServer_sendAttRsp();
+
+              // The controller has freed the buffers sent in this event,
+              // start the next burst
+              SPPBLEServer_processConnEvtEnd();
+
+              SPPBLEServer_sendUARTBurst();
+
+#ifdef SPP_RELIABLE
+              // Acknowledge what the centrals wrote in this event
+              SPPBLEServer_sendSessionRecords();
+#endif
+
+              // Hand the client whatever SDI has freed up since
+              SPPBLEServer_grantCredits();
             }
           }
           else
@@ -676,71 +823,9 @@ static void SPPBLEServer_taskFxn(UArg a0, UArg a1)
       }
 
       
-                  // If RTOS queue is not empty, process app message.
-      if (!Queue_empty(appUARTMsgQueue))
-      {
-        //Get the message at the front of the queue but still keep it in the queue 
-        queueRec_t *pRec = Queue_head(appUARTMsgQueue);
-        sbpUARTEvt_t *pMsg = (sbpUARTEvt_t *)pRec->pData;
-          
-        if (pMsg && ((gapProfileState == GAPROLE_CONNECTED) || (gapProfileState == GAPROLE_CONNECTED_ADV)))
-        {
-            bStatus_t retVal = FAILURE;
+      // Notify as much queued UART data as the stack will take right now
+      SPPBLEServer_sendUARTBurst();
 
-            switch(pMsg->event)
-            {
-//              case SBP_UART_ERROR_EVT:
-//              {
-//                SerialPortService_AddStatusErrorCount((UART_Status)pMsg->data);
-//                //Remove from queue
-//                Util_dequeueMsg(appUARTMsgQueue);
-//                // Free the space from the message.
-//                ICall_free(pMsg);
-//                
-//                break;
-//              }
-              
-              case SBP_UART_DATA_EVT:
-              {
-                //Send the notification
-                retVal = SerialPortService_SetParameter(SERIALPORTSERVICE_CHAR_DATA, pMsg->length, pMsg->data); 
-
-                if(retVal != SUCCESS)
-                {
-                  //Display_print1(dispHandle, 5, 0, "FC Violated: %d", pMsg->msg.flowCtrlEvt.opcode);
-                  Display_print1(dispHandle, 4, 0, " %d", retVal);
-                  //LCD_WRITE_STRING_VALUE("Data length:", pMsg->length, 10, LCD_PAGE5);
-                  //LCD_WRITE_STRING(pMsg->data, LCD_PAGE6);
-                }
-                else
-                {
-                  //Increment TX status counter
-                  SerialPortService_AddStatusTXBytes(pMsg->length);      
-                  
-                  //Remove from queue
-                  Util_dequeueMsg(appUARTMsgQueue);
-                  
-                  //Toggle LED to indicate data received from UART terminal and sent over the air
-                  //SPPBLEServer_toggleLed(Board_LED2, Board_LED_TOGGLE);
-                    
-                  // Free the space from the message.
-                  ICall_free(pMsg);
-                }
-                
-                  if(!Queue_empty(appUARTMsgQueue))
-                  {
-                    // Wake up the application to flush out any remaining UART data in the queue.
-                    Semaphore_post(sem);
-                  }
-                break;
-              }
-            default:
-              break;
-          }
-        }
-      }
-      
-      
       // If RTOS queue is not empty, process app message.
       while (!Queue_empty(appMsgQueue))
       {
@@ -818,6 +903,11 @@ static uint8_t SPPBLEServer_processStackMsg(ICall_Hdr *pMsg)
             // Process HCI Command Complete Event
             break;
 
+          case HCI_LE_EVENT_CODE:
+            // Data length change
+            LinkTune_ProcessHCIEvt(pMsg);
+            break;
+
           default:
             break;
         }
@@ -841,8 +931,13 @@ static uint8_t SPPBLEServer_processStackMsg(ICall_Hdr *pMsg)
  */
 static uint8_t SPPBLEServer_processGATTMsg(gattMsgEvent_t *pMsg)
 {
+  // MTU exchange results go to the link tuning module
+  if (LinkTune_ProcessGATTMsg(pMsg))
+  {
+    // Nothing else to do
+  }
   // See if GATT server was unable to transmit an ATT response
-  if (pMsg->hdr.status == blePending)
+  else if (pMsg->hdr.status == blePending)
   {
     // No HCI buffer was available. Let's try to retransmit the response
     // on the next connection event.
@@ -868,11 +963,6 @@ static uint8_t SPPBLEServer_processGATTMsg(gattMsgEvent_t *pMsg)
     // Display the opcode of the message that caused the violation.
     Display_print1(dispHandle, 5, 0, "FC Violated: %d", pMsg->msg.flowCtrlEvt.opcode);
   }
-  else if (pMsg->method == ATT_MTU_UPDATED_EVENT)
-  {
-    // MTU size updated
-    Display_print1(dispHandle, 5, 0, "MTU Size: $d", pMsg->msg.mtuEvt.MTU);
-  }
 
   // Free message payload. Needed only for ATT Protocol messages
   GATT_bm_free(&pMsg->msg, pMsg->method);
@@ -905,8 +995,8 @@ static void SPPBLEServer_sendAttRsp(void)
     status = GATT_SendRsp(pAttRsp->connHandle, pAttRsp->method, &(pAttRsp->msg));
     if ((status != blePending) && (status != MSG_BUFFER_NOT_AVAIL))
     {
-      // Disable connection event end notice
-      HCI_EXT_ConnEventNoticeCmd(pAttRsp->connHandle, selfEntity, 0);
+      // The connection event end notice stays enabled, the UART burst
+      // sender runs off it for as long as the link is up
 
       // We're done with the response message
       SPPBLEServer_freeAttRsp(status);
@@ -974,7 +1064,8 @@ static void SPPBLEServer_processAppMsg(sbpEvt_t *pMsg)
       break;
 
     case SBP_CHAR_CHANGE_EVT:
-      SPPBLEServer_processCharValueChangeEvt(pMsg->hdr.state);
+      SPPBLEServer_processCharValueChangeEvt(pMsg->connHandle,
+                                             pMsg->hdr.state);
       break;
 
     default:
@@ -994,7 +1085,7 @@ static void SPPBLEServer_processAppMsg(sbpEvt_t *pMsg)
  */
 static void SPPBLEServer_stateChangeCB(gaprole_States_t newState)
 {
-  SPPBLEServer_enqueueMsg(SBP_STATE_CHANGE_EVT, newState);
+  SPPBLEServer_enqueueMsg(SBP_STATE_CHANGE_EVT, newState, INVALID_CONNHANDLE);
 }
 
 /*********************************************************************
@@ -1079,8 +1170,13 @@ static void SPPBLEServer_processStateChangeEvt(gaprole_States_t newState)
       {
         linkDBInfo_t linkInfo;
         uint8_t numActive = 0;
+        uint16_t connHandle;
 
         Util_startClock(&periodicClock);
+
+        // Give the new central a UART stream of its own
+        GAPRole_GetParameter(GAPROLE_CONNHANDLE, &connHandle);
+        SPPBLEServer_openConn(connHandle);
         
         numActive = linkDB_NumActive();
 
@@ -1134,6 +1230,7 @@ static void SPPBLEServer_processStateChangeEvt(gaprole_States_t newState)
     case GAPROLE_WAITING:
       Util_stopClock(&periodicClock);
       SPPBLEServer_freeAttRsp(bleNotConnected);
+      SPPBLEServer_closeConns();
 
       Display_print0(dispHandle, 2, 0, "Disconnected");
 
@@ -1143,6 +1240,7 @@ static void SPPBLEServer_processStateChangeEvt(gaprole_States_t newState)
 
     case GAPROLE_WAITING_AFTER_TIMEOUT:
       SPPBLEServer_freeAttRsp(bleNotConnected);
+      SPPBLEServer_closeConns();
 
       Display_print0(dispHandle, 2, 0, "Timed Out");
 
@@ -1175,13 +1273,14 @@ static void SPPBLEServer_processStateChangeEvt(gaprole_States_t newState)
  * @brief   Callback from Simple Profile indicating a characteristic
  *          value change.
  *
+ * @param   connHandle - connection of the client that wrote the value.
  * @param   paramID - parameter ID of the value that was changed.
  *
  * @return  None.
  */
-static void SPPBLEServer_charValueChangeCB(uint8_t paramID)
+static void SPPBLEServer_charValueChangeCB(uint16_t connHandle, uint8_t paramID)
 {
-  SPPBLEServer_enqueueMsg(SBP_CHAR_CHANGE_EVT, paramID);
+  SPPBLEServer_enqueueMsg(SBP_CHAR_CHANGE_EVT, paramID, connHandle);
 }
 #endif //!FEATURE_OAD_ONCHIP
 
@@ -1191,24 +1290,67 @@ static void SPPBLEServer_charValueChangeCB(uint8_t paramID)
  * @brief   Process a pending Simple Profile characteristic value change
  *          event.
  *
+ * @param   connHandle - connection of the client that wrote the value.
  * @param   paramID - parameter ID of the value that was changed.
  *
  * @return  None.
  */
-static void SPPBLEServer_processCharValueChangeEvt(uint8_t paramID)
+static void SPPBLEServer_processCharValueChangeEvt(uint16_t connHandle,
+                                                   uint8_t paramID)
 {
+  sbpConn_t *pConn = SPPBLEServer_findConn(connHandle);
 
-  
+  switch (paramID)
+  {
+    case SERIALPORTSERVICE_CHAR_DATA:
+      // The client spent one of its credits
+      if ((pConn != NULL) && pConn->rxCredits)
+      {
+        pConn->rxCredits--;
+      }
+      break;
+
+    case SERIALPORTSERVICE_CHAR_DATA_RECORD:
+      // A long write is only passed on once all of it has been executed,
+      // and costs the client one credit however many segments it took
+      if ((SerialPortService_FlushDataRecord(connHandle) != 0) &&
+          (pConn != NULL) && pConn->rxCredits)
+      {
+        pConn->rxCredits--;
+      }
+      break;
+
+    case SERIALPORTSERVICE_CHAR_CREDITS:
+      // The client granted more notifications
+      if (pConn != NULL)
+      {
+        SPPBLEServer_sendConnBurst(pConn);
+      }
+      break;
+
+#ifdef SPP_RELIABLE
+    case SERIALPORTSERVICE_CHAR_SESSION:
+      // Session record from the client
+      if (pConn != NULL)
+      {
+        SPPBLEServer_processSessionRecord(pConn);
+      }
+      break;
+#endif
+
+    default:
+      break;
+  }
 }
 
 /*********************************************************************
  * @fn      SPPBLEServer_performPeriodicTask
  *
  * @brief   Perform a periodic application task. This function gets called
- *          every five seconds (SBP_PERIODIC_EVT_PERIOD). In this example,
- *          the value of the third characteristic in the SimpleGATTProfile
- *          service is retrieved from the profile, and then copied into the
- *          value of the the fourth characteristic.
+ *          every five seconds (SBP_PERIODIC_EVT_PERIOD) while connected.
+ *          Shows the notification burst counters and, with SPP_STATUS_EXT,
+ *          copies the SDI runtime counters into the Status Characteristic
+ *          extension.
  *
  * @param   None.
  *
@@ -1216,7 +1358,57 @@ static void SPPBLEServer_processCharValueChangeEvt(uint8_t paramID)
  */
 static void SPPBLEServer_performPeriodicTask(void)
 {
+  Display_print2(dispHandle, 6, 0, "Noti/evt: %d max %d",
+                 (uint16_t)(sbpBurstStats.connEvents ?
+                            (sbpBurstStats.notifications / sbpBurstStats.connEvents) : 0),
+                 sbpBurstStats.maxPerEvent);
+
+#ifdef SPP_STATUS_EXT
+  SDI_Stats_t stats;
+  uint8_t ext[SERIALPORTSERVICE_STATUS_EXT_LEN];
+  uint8_t i;
+
+  // Publish the SDI counters in the Status Characteristic extension, big
+  // endian like the base status bytes and saturated where narrowed
+  SDITask_getStats(&stats);
 
+  ext[0] = BREAK_UINT32(stats.rxBytes, 3);
+  ext[1] = BREAK_UINT32(stats.rxBytes, 2);
+  ext[2] = BREAK_UINT32(stats.rxBytes, 1);
+  ext[3] = BREAK_UINT32(stats.rxBytes, 0);
+  ext[4] = BREAK_UINT32(stats.txBytes, 3);
+  ext[5] = BREAK_UINT32(stats.txBytes, 2);
+  ext[6] = BREAK_UINT32(stats.txBytes, 1);
+  ext[7] = BREAK_UINT32(stats.txBytes, 0);
+
+  if (stats.rxDroppedBytes > 0xFFFF)
+  {
+    stats.rxDroppedBytes = 0xFFFF;
+  }
+  ext[8] = HI_UINT16(stats.rxDroppedBytes);
+  ext[9] = LO_UINT16(stats.rxDroppedBytes);
+
+  if (stats.uartErrors > 0xFFFF)
+  {
+    stats.uartErrors = 0xFFFF;
+  }
+  ext[10] = HI_UINT16(stats.uartErrors);
+  ext[11] = LO_UINT16(stats.uartErrors);
+
+  ext[12] = (stats.txQueueHighWater > 0xFF) ? 0xFF : stats.txQueueHighWater;
+
+  // Slowest TX latency bucket seen, see SDI_STATS_LAT_BUCKETS
+  ext[13] = 0;
+  for (i = 0; i < SDI_STATS_LAT_BUCKETS; i++)
+  {
+    if (stats.txLatency[i])
+    {
+      ext[13] = i;
+    }
+  }
+
+  SerialPortService_SetStatusExt(sizeof(ext), ext);
+#endif //SPP_STATUS_EXT
 }
 
 
@@ -1279,34 +1471,783 @@ static void SPPBLEServer_clockHandler(UArg arg)
 }
 
 /*********************************************************************
- * @fn      SPPBLEServer_enqueueMsg
+ * @fn      SPPBLEServer_enqueueUARTMsg
  *
- * @brief   Creates a message and puts the message in RTOS queue.
+ * @brief   SDI RX callback. Queues a UART chunk to the streams it is for:
+ *          every open stream with SBP_STREAM_FANOUT, the stream paired
+ *          with the chunk's SDI channel with SBP_STREAM_DEMUX. Fanned out
+ *          chunks are shared, not copied per stream.
  *
- * @param   event  - message event.
- * @param   status - message status.
+ * @param   event - SDI event.
+ * @param   data - UART data.
+ * @param   len - length of data.
  *
  * @return  None.
  */
-void SPPBLEServer_enqueueUARTMsg(uint8_t event, uint8_t *data, uint8_t len)
+void SPPBLEServer_enqueueUARTMsg(uint8_t event, uint8_t *data, uint16_t len)
 {
-  sbpUARTEvt_t *pMsg;
+  sppUARTQueue_t *pQueues[SBP_MAX_CONNS];
+  sppUARTMsg_t *pMsg = NULL;
+  ICall_CSState key;
+  uint8_t numQueues = 0;
+  uint8_t i;
+#if (SBP_STREAM_MODE == SBP_STREAM_DEMUX)
+  uint8_t channel = SDITask_getRxChannel();
+#endif
 
-  //Enqueue message only in a connected state
-  if((gapProfileState == GAPROLE_CONNECTED) || (gapProfileState == GAPROLE_CONNECTED_ADV))
+  // Delivery is held before the last block is taken, so this only fails
+  // if SDI ignored the hold. The section only keeps out the benchmark
+  // replies, which take blocks from the stack's context.
+  key = ICall_enterCriticalSection();
+  pMsg = SPPUARTQueue_Alloc();
+  ICall_leaveCriticalSection(key);
+
+  // Filled in before it is published, with interrupts on
+  if (pMsg != NULL)
   {
-    // Create dynamic pointer to message.
-    if (pMsg = ICall_malloc(sizeof(sbpUARTEvt_t)))
-    { 
-      
-      pMsg->event = event;
-      memcpy(pMsg->data , data, len);
-      pMsg->length = len;
+    pMsg->event = event;
+    memcpy(pMsg->data , data, len);
+    pMsg->length = len;
+  }
+
+  // Streams are opened and closed by the application task, the chunk is
+  // queued to the ones open right now in one go
+  key = ICall_enterCriticalSection();
+
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+#if (SBP_STREAM_MODE == SBP_STREAM_DEMUX)
+    if ((sbpConn[i].connHandle != INVALID_CONNHANDLE) &&
+        (sbpConn[i].channel == channel))
+#else
+    if (sbpConn[i].connHandle != INVALID_CONNHANDLE)
+#endif
+    {
+      pQueues[numQueues++] = &sbpConn[i].uartQueue;
+    }
+  }
+
+  if (pMsg != NULL)
+  {
+    if (numQueues)
+    {
+      SPPUARTQueue_PutShared(pQueues, numQueues, pMsg);
+    }
+    else
+    {
+      // No stream to take it
+      SPPUARTQueue_PutBack(pMsg);
+    }
+  }
+
+  ICall_leaveCriticalSection(key);
 
-      // Enqueue the message.
-      Util_enqueueMsg(appUARTMsgQueue, sem, (uint8*)pMsg);
+  if (numQueues)
+  {
+    // Wake up the application
+    SPPBLEServer_updateUARTHold();
+    Semaphore_post(sem);
+  }
+}
+
+#ifdef SPP_BENCH
+/*********************************************************************
+ * @fn      SPPBLEServer_benchRx
+ *
+ * @brief   Answer a benchmark probe written by a central, see
+ *          spp_bench.h. Echo probes are notified back unchanged, bulk
+ *          probes are counted and an END probe is answered with the
+ *          counts. Called from the Data Characteristic write callback.
+ *
+ * @param   connHandle - connection of the central.
+ * @param   pData - data written.
+ * @param   len - length of data.
+ *
+ * @return  TRUE if the data was a probe and is not to be passed on
+ */
+uint8_t SPPBLEServer_benchRx(uint16_t connHandle, uint8_t *pData, uint16_t len)
+{
+  uint8_t report[SPPBENCH_REPORT_SIZE];
+  sppBenchProbe_t probe;
+  sppBenchRx_t *pRx;
+  sbpConn_t *pConn;
+
+  if (!SPPBench_ParseProbe(pData, len, &probe))
+  {
+    return (FALSE);
+  }
+
+  pConn = SPPBLEServer_findConn(connHandle);
+  if (pConn == NULL)
+  {
+    return (TRUE);
+  }
+
+  pRx = &sbpBenchRx[pConn - sbpConn];
+
+  switch (probe.type)
+  {
+    case SPPBENCH_TYPE_ECHO:
+      SPPBLEServer_benchReply(connHandle, pData, len);
+      break;
+
+    case SPPBENCH_TYPE_BULK:
+      // Every run starts at 0, whatever the last one left behind
+      if (probe.seq == 0)
+      {
+        SPPBench_RxReset(pRx);
+      }
+      SPPBench_RxAdd(pRx, &probe, len);
+      break;
+
+    case SPPBENCH_TYPE_END:
+      SPPBLEServer_benchReply(connHandle, report,
+                              SPPBench_BuildReport(report, pRx));
+      SPPBench_RxReset(pRx);
+      break;
+
+    default:
+      break;
+  }
+
+  return (TRUE);
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_benchReply
+ *
+ * @brief   Queue a probe to be notified to a central, behind the UART
+ *          data already waiting for it.
+ *
+ * @param   connHandle - connection of the central.
+ * @param   pData - probe.
+ * @param   len - length of probe.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_benchReply(uint16_t connHandle, uint8_t *pData,
+                                    uint16_t len)
+{
+  sppUARTMsg_t *pMsg = NULL;
+  sbpConn_t *pConn;
+  ICall_CSState key;
+
+  // Queued like UART data from the SDI task, the stream may not close
+  // in between
+  key = ICall_enterCriticalSection();
+
+  pConn = SPPBLEServer_findConn(connHandle);
+  if (pConn != NULL)
+  {
+    pMsg = SPPUARTQueue_Alloc();
+  }
+
+  if (pMsg != NULL)
+  {
+    pMsg->event = SBP_UART_DATA_EVT;
+    memcpy(pMsg->data, pData, len);
+    pMsg->length = len;
+
+    SPPUARTQueue_Put(&pConn->uartQueue, pMsg);
+  }
+
+  ICall_leaveCriticalSection(key);
+
+  // No free block, the central counts the probe lost
+  if (pMsg != NULL)
+  {
+    SPPBLEServer_updateUARTHold();
+    Semaphore_post(sem);
+  }
+}
+#endif
+
+/*********************************************************************
+ * @fn      SPPBLEServer_updateUARTHold
+ *
+ * @brief   Hold SDI RX deliveries while the UART message pool is nearly
+ *          empty, so a host that writes faster than the link drains is
+ *          held off by flow control instead of losing data. Called by
+ *          the SDI task after queueing and by the application task after
+ *          releasing a message.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_updateUARTHold(void)
+{
+  ICall_CSState key;
+  uint8_t numFree;
+
+  // Decided and applied in one go, so the two tasks can never leave SDI
+  // held with nothing queued to release it
+  key = ICall_enterCriticalSection();
+
+  numFree = SPPUARTQueue_NumFree();
+  if (!sbpUARTHeld && (numFree < SBP_UART_POOL_HOLD))
+  {
+    sbpUARTHeld = TRUE;
+    SDITask_holdRx(TRUE);
+  }
+  else if (sbpUARTHeld && (numFree >= SBP_UART_POOL_RESUME))
+  {
+    sbpUARTHeld = FALSE;
+    SDITask_holdRx(FALSE);
+  }
+
+  ICall_leaveCriticalSection(key);
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_findConn
+ *
+ * @brief   Stream of a central.
+ *
+ * @param   connHandle - connection of the central.
+ *
+ * @return  Pointer to the stream, NULL if the central has none.
+ */
+static sbpConn_t *SPPBLEServer_findConn(uint16_t connHandle)
+{
+  uint8_t i;
+
+  if (connHandle == INVALID_CONNHANDLE)
+  {
+    return (NULL);
+  }
+
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+    if (sbpConn[i].connHandle == connHandle)
+    {
+      return (&sbpConn[i]);
     }
   }
+
+  return (NULL);
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_openConn
+ *
+ * @brief   Open a UART stream for a newly connected central.
+ *
+ * @param   connHandle - connection of the central.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_openConn(uint16_t connHandle)
+{
+  sbpConn_t *pConn;
+  uint8_t slot;
+
+  if (SPPBLEServer_findConn(connHandle) != NULL)
+  {
+    return;
+  }
+
+  // Streams still held for links that are gone are reclaimed first
+  SPPBLEServer_closeConns();
+
+  for (slot = 0; slot < SBP_MAX_CONNS; slot++)
+  {
+    if (sbpConn[slot].connHandle == INVALID_CONNHANDLE)
+    {
+      break;
+    }
+  }
+
+  if (slot == SBP_MAX_CONNS)
+  {
+    Display_print0(dispHandle, 4, 0, "No free stream");
+    return;
+  }
+
+  pConn = &sbpConn[slot];
+
+#if (SBP_STREAM_MODE == SBP_STREAM_DEMUX)
+  pConn->channel = slot;
+#else
+  pConn->channel = SDI_CHANNEL_DEFAULT;
+#endif
+
+  // Credits never carry over from a previous link
+  pConn->txBlocked = FALSE;
+  pConn->txThisEvent = 0;
+  pConn->txCredits = 0;
+  pConn->rxCredits = 0;
+  pConn->payload = ATT_MTU_SIZE - LINKTUNE_ATT_HDR_SIZE;
+  VOID SerialPortService_OpenConn(connHandle, pConn->channel);
+#ifdef SPP_RELIABLE
+  {
+    linkDBItem_t *pItem = linkDB_Find(connHandle);
+
+    // Picks up where the last link to the same central left off
+    pConn->pSession = (pItem != NULL) ?
+                      SPPSession_Open(connHandle, pItem->addrType,
+                                      pItem->addr) : NULL;
+  }
+#endif
+#ifdef SPP_BENCH
+  SPPBench_RxReset(&sbpBenchRx[slot]);
+#endif
+
+  // Burst UART data out at the end of every connection event
+  HCI_EXT_ConnEventNoticeCmd(connHandle, selfEntity, SBP_CONN_EVT_END_EVT);
+
+  // From here on the SDI task queues UART data to the stream
+  pConn->connHandle = connHandle;
+
+  // Ask for the largest MTU and data length, UART chunks are resized as
+  // the results come in
+  VOID LinkTune_Start(connHandle);
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_closeConns
+ *
+ * @brief   Close the streams of links that are gone, returning the UART
+ *          data still waiting for them to the pool.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_closeConns(void)
+{
+  uint16_t connHandle;
+  uint8_t i;
+
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+    connHandle = sbpConn[i].connHandle;
+
+    if ((connHandle == INVALID_CONNHANDLE) || linkDB_Up(connHandle))
+    {
+      continue;
+    }
+
+    // The SDI task stops queueing to the stream before it is drained
+    sbpConn[i].connHandle = INVALID_CONNHANDLE;
+
+    LinkTune_Stop(connHandle);
+    SerialPortService_CloseConn(connHandle);
+#ifdef SPP_RELIABLE
+    // A session keeps what the central has not acknowledged for its
+    // next link
+    if (sbpConn[i].pSession != NULL)
+    {
+      SPPSession_Close(sbpConn[i].pSession, &sbpConn[i].uartQueue);
+      sbpConn[i].pSession = NULL;
+    }
+#endif
+    SPPUARTQueue_Drain(&sbpConn[i].uartQueue);
+  }
+
+  SPPBLEServer_updateUARTHold();
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_processConnEvtEnd
+ *
+ * @brief   Account for a connection event end. The notice does not say
+ *          which link the event was on, so every stream gets a fresh
+ *          burst, one still short of buffers is blocked again.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_processConnEvtEnd(void)
+{
+  uint8_t i;
+
+  sbpBurstStats.connEvents++;
+
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+    if (sbpConn[i].txThisEvent > sbpBurstStats.maxPerEvent)
+    {
+      sbpBurstStats.maxPerEvent = sbpConn[i].txThisEvent;
+    }
+    sbpConn[i].txThisEvent = 0;
+    sbpConn[i].txBlocked = FALSE;
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_sendUARTBurst
+ *
+ * @brief   Notify queued UART data on every open stream, see
+ *          SPPBLEServer_sendConnBurst.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_sendUARTBurst(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+    if (sbpConn[i].connHandle != INVALID_CONNHANDLE)
+    {
+      SPPBLEServer_sendConnBurst(&sbpConn[i]);
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_sendConnBurst
+ *
+ * @brief   Notify a stream's queued UART data until its queue is empty or
+ *          the stack runs out of buffers. In the latter case the burst
+ *          resumes at the end of the next connection event
+ *          (SBP_CONN_EVT_END_EVT), so several notifications go out in
+ *          every connection interval. With credit based flow control the
+ *          burst also stops once the central's credits are used up.
+ *
+ * @param   pConn - stream to send on.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_sendConnBurst(sbpConn_t *pConn)
+{
+  sppUARTMsg_t *pMsg;
+  uint8_t creditFlow;
+
+  if (pConn->txBlocked)
+  {
+    return;
+  }
+
+  creditFlow = SerialPortService_CreditsEnabled(pConn->connHandle);
+  pConn->txCredits += SerialPortService_TakeCredits(pConn->connHandle);
+
+#ifdef SPP_RELIABLE
+  // Centrals that enabled session notifications run a session
+  if ((pConn->pSession != NULL) &&
+      SerialPortService_SessionEnabled(pConn->connHandle))
+  {
+    SPPBLEServer_sendSessionBurst(pConn, creditFlow);
+    return;
+  }
+#endif
+
+  // Peek, the message only leaves the queue once the stack has it
+  while ((pMsg = SPPUARTQueue_Peek(&pConn->uartQueue)) != NULL)
+  {
+
+    if (pMsg->event == SBP_UART_DATA_EVT)
+    {
+      if (creditFlow && (pConn->txCredits == 0))
+      {
+        // Client has no room, the next Credits write restarts the burst
+        sbpBurstStats.noCredits++;
+        break;
+      }
+
+      bStatus_t status = SerialPortService_SendNotification(pConn->connHandle,
+                                                            pMsg->length,
+                                                            pMsg->data);
+
+      if ((status == blePending) || (status == MSG_BUFFER_NOT_AVAIL) ||
+          (status == bleMemAllocError) || (status == bleNoResources))
+      {
+        // Controller is full, retry on the next connection event
+        pConn->txBlocked = TRUE;
+        sbpBurstStats.noResources++;
+        break;
+      }
+
+      if (status == SUCCESS)
+      {
+        //Increment TX status counter
+        SerialPortService_AddStatusTXBytes(pMsg->length);
+
+        sbpBurstStats.notifications++;
+        sbpBurstStats.bytes += pMsg->length;
+        pConn->txThisEvent++;
+
+        if (creditFlow)
+        {
+          pConn->txCredits--;
+        }
+      }
+      else
+      {
+        // Notifications disabled or data not fitting the MTU, drop it
+        Display_print1(dispHandle, 4, 0, " %d", status);
+      }
+    }
+
+    //Remove from queue, the block goes back to the pool once every stream
+    //it was fanned out to has sent it
+    SPPUARTQueue_Release(&pConn->uartQueue);
+    SPPBLEServer_updateUARTHold();
+  }
+}
+
+#ifdef SPP_RELIABLE
+/*********************************************************************
+ * @fn      SPPBLEServer_sendSessionBurst
+ *
+ * @brief   SPPBLEServer_sendConnBurst for a central running a reliable
+ *          session. UART data moves from the stream into the session,
+ *          which keeps each block until the central acknowledges it and
+ *          hands out retransmissions first after a reconnect.
+ *
+ * @param   pConn - stream to send on.
+ * @param   creditFlow - TRUE if the central grants credits.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_sendSessionBurst(sbpConn_t *pConn, uint8_t creditFlow)
+{
+  sppSession_t *pSession = pConn->pSession;
+  sppUARTMsg_t *pMsg;
+  bStatus_t status;
+  uint16_t len;
+  uint16_t seq;
+
+  SPPSession_Fill(pSession, &pConn->uartQueue);
+
+  while ((pMsg = SPPSession_NextTx(pSession, &seq)) != NULL)
+  {
+    if (creditFlow && (pConn->txCredits == 0))
+    {
+      sbpBurstStats.noCredits++;
+      break;
+    }
+
+    // Anything but data keeps its sequence number, without a payload
+    len = (pMsg->event == SBP_UART_DATA_EVT) ? pMsg->length : 0;
+
+    status = SerialPortService_SendSeqNotification(pConn->connHandle, seq,
+                                                   len, pMsg->data);
+
+    if (status == SUCCESS)
+    {
+      SerialPortService_AddStatusTXBytes(len);
+
+      sbpBurstStats.notifications++;
+      sbpBurstStats.bytes += len;
+      pConn->txThisEvent++;
+
+      if (creditFlow)
+      {
+        pConn->txCredits--;
+      }
+    }
+    else if (status == bleInvalidRange)
+    {
+      // Never fits, skipped, the central counts it as lost
+      Display_print1(dispHandle, 4, 0, " %d", status);
+    }
+    else
+    {
+      // Out of buffers or notifications off, the block stays in the
+      // session for the next burst
+      if (status != bleIncorrectMode)
+      {
+        pConn->txBlocked = TRUE;
+        sbpBurstStats.noResources++;
+      }
+      break;
+    }
+
+    SPPSession_Sent(pSession);
+  }
+
+  SPPBLEServer_updateUARTHold();
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_processSessionRecord
+ *
+ * @brief   Apply the session record a central wrote. A hello is answered
+ *          with ours straight away, acknowledged data makes room in the
+ *          window for more.
+ *
+ * @param   pConn - stream of the central.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_processSessionRecord(sbpConn_t *pConn)
+{
+  uint8_t record[SPP_SESSION_RECORD_LEN];
+  uint8_t len;
+
+  len = SerialPortService_TakeSessionRecord(pConn->connHandle, record);
+  if ((pConn->pSession == NULL) || (len == 0))
+  {
+    return;
+  }
+
+  if (SPPSession_ProcessRecord(pConn->pSession, record, len) == SUCCESS)
+  {
+    SPPBLEServer_sendSessionRecords();
+    SPPBLEServer_sendConnBurst(pConn);
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_sendSessionRecords
+ *
+ * @brief   Notify a session record to every central that is owed a hello
+ *          or an acknowledgement. One that cannot be sent now goes out
+ *          at the end of a later connection event.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_sendSessionRecords(void)
+{
+  uint8_t record[SPP_SESSION_RECORD_LEN];
+  sppSession_t *pSession;
+  uint8_t i;
+
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+    pSession = sbpConn[i].pSession;
+
+    if ((sbpConn[i].connHandle == INVALID_CONNHANDLE) || (pSession == NULL) ||
+        !SPPSession_RecordDue(pSession))
+    {
+      continue;
+    }
+
+    SPPSession_BuildRecord(pSession, record);
+    if (SerialPortService_SendSessionRecord(sbpConn[i].connHandle, record) == SUCCESS)
+    {
+      SPPSession_RecordSent(pSession, record);
+    }
+  }
+}
+#endif //SPP_RELIABLE
+
+/*********************************************************************
+ * @fn      SPPBLEServer_grantCredits
+ *
+ * @brief   Grant credits on every open stream, see
+ *          SPPBLEServer_grantConnCredits.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_grantCredits(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+    if (sbpConn[i].connHandle != INVALID_CONNHANDLE)
+    {
+      SPPBLEServer_grantConnCredits(&sbpConn[i]);
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_grantConnCredits
+ *
+ * @brief   Grant a central as many Data Characteristic writes as SDI has
+ *          free TX frames for on its channel. Every write lands in one
+ *          frame, so the centrals can never send more than SDI can take.
+ *          Centrals sharing a channel each get an equal share of it.
+ *
+ * @param   pConn - stream of the central.
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_grantConnCredits(sbpConn_t *pConn)
+{
+  uint16_t granted = 0;
+  uint8_t sharing = 0;
+  uint8_t freeFrames;
+  uint8_t share;
+  uint8_t grant;
+  uint8_t i;
+
+  if (!SerialPortService_CreditsEnabled(pConn->connHandle))
+  {
+    return;
+  }
+
+  // Credits already granted may still be spent on frames free right now
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+    if ((sbpConn[i].connHandle != INVALID_CONNHANDLE) &&
+        (sbpConn[i].channel == pConn->channel))
+    {
+      granted += sbpConn[i].rxCredits;
+      sharing++;
+    }
+  }
+
+  freeFrames = SDITask_getTxFreeFrames(pConn->channel);
+  share = freeFrames / sharing;
+  if (share == 0)
+  {
+    share = 1;
+  }
+
+  if ((freeFrames <= granted) || (pConn->rxCredits >= share))
+  {
+    return;
+  }
+
+  grant = MIN(freeFrames - granted, share - pConn->rxCredits);
+  if ((grant < SBP_CREDITS_GRANT_MIN) && pConn->rxCredits)
+  {
+    return;
+  }
+
+  if (SerialPortService_SendCredits(pConn->connHandle, grant) == SUCCESS)
+  {
+    pConn->rxCredits += grant;
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBLEServer_linkTuned
+ *
+ * @brief   Link tuning callback. Resizes the UART chunks SDI delivers so
+ *          each one fills a notification at the negotiated MTU. SDI has a
+ *          single delivery size, the smallest MTU of all streams wins.
+ *
+ * @param   pResult - current link parameters
+ *
+ * @return  None.
+ */
+static void SPPBLEServer_linkTuned(linkTuneResult_t *pResult)
+{
+  sbpConn_t *pConn = SPPBLEServer_findConn(pResult->connHandle);
+  uint16_t payload = pResult->payload;
+  uint8_t i;
+
+  if (pConn != NULL)
+  {
+    pConn->payload = pResult->payload;
+  }
+
+  for (i = 0; i < SBP_MAX_CONNS; i++)
+  {
+    if ((sbpConn[i].connHandle != INVALID_CONNHANDLE) &&
+        (sbpConn[i].payload < payload))
+    {
+      payload = sbpConn[i].payload;
+    }
+  }
+
+  SDITask_setRxDeliverySize(SBP_UART_DELIVERY_SIZE(payload));
+
+  Display_print3(dispHandle, 5, 0, "MTU %d DLE %d/%d", pResult->mtu,
+                 pResult->txOctets, pResult->rxOctets);
 }
 
 /*********************************************************************
@@ -1316,10 +2257,13 @@ void SPPBLEServer_enqueueUARTMsg(uint8_t event, uint8_t *data, uint8_t len)
  *
  * @param   event - message event.
  * @param   state - message state.
+ * @param   connHandle - connection the event came from, or
+ *                       INVALID_CONNHANDLE.
  *
  * @return  None.
  */
-static void SPPBLEServer_enqueueMsg(uint8_t event, uint8_t state)
+static void SPPBLEServer_enqueueMsg(uint8_t event, uint8_t state,
+                                   uint16_t connHandle)
 {
   sbpEvt_t *pMsg;
 
@@ -1328,6 +2272,7 @@ static void SPPBLEServer_enqueueMsg(uint8_t event, uint8_t state)
   {
     pMsg->hdr.event = event;
     pMsg->hdr.state = state;
+    pMsg->connHandle = connHandle;
 
     // Enqueue the message.
     Util_enqueueMsg(appMsgQueue, sem, (uint8*)pMsg);
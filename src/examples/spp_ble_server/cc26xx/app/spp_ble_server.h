@@ -102,6 +102,10 @@ extern "C"
 extern void SPPBLEServer_createTask(void);
 extern void SPPBLEServer_toggleLed(uint8_t led, uint8_t state);
 extern char* convInt32ToText(int32 value);
+#ifdef SPP_BENCH
+extern uint8_t SPPBLEServer_benchRx(uint16_t connHandle, uint8_t *pData,
+                                    uint16_t len);
+#endif
 /*********************************************************************
 *********************************************************************/
 
@@ -48,6 +48,11 @@
 #include <ti/sysbios/knl/Semaphore.h>
 #include <ti/sysbios/knl/Queue.h>
 
+#if defined(THROUGHPUT_SWEEP) || defined(THROUGHPUT_LATENCY)
+#include <xdc/runtime/System.h>
+#include <ti/drivers/UART.h>
+#endif //THROUGHPUT_SWEEP || THROUGHPUT_LATENCY
+
 #include "bcomdef.h"
 
 #include "hci_tl.h"
@@ -58,6 +63,10 @@
 #include "central.h"
 #include "gapbondmgr.h"
 #include "simple_gatt_profile.h"
+#if defined(THROUGHPUT_DUPLEX) || defined(THROUGHPUT_LATENCY)
+#include "gatt_uuid.h"
+#include "throughput_service.h"
+#endif //THROUGHPUT_DUPLEX || THROUGHPUT_LATENCY
 
 #include "osal_snv.h"
 #include "icall_apimsg.h"
@@ -76,6 +85,9 @@
  * MACROS
  */
 
+// Number of entries of a sweep table
+#define SWEEP_NUM(a) (sizeof(a) / sizeof((a)[0]))
+
 /*********************************************************************
  * CONSTANTS
  */
@@ -88,6 +100,8 @@
 #define SBC_KEY_CHANGE_EVT                    0x0010
 #define SBC_STATE_CHANGE_EVT                  0x0020
 #define SBC_MEASURE_SPEED_EVT                 0x0040
+#define SBC_CONN_EVT_END_EVT                  0x0080
+#define SBC_LATENCY_EVT                       0x0100
 
 // Maximum number of scan responses
 #define DEFAULT_MAX_SCAN_RES                  8
@@ -169,6 +183,96 @@
 #define DEFAULT_PDU_SIZE 27
 #define DEFAULT_TX_TIME 328
 
+// LL packet overhead on air (preamble, access address, header, MIC, CRC)
+#define LL_PACKET_OVERHEAD 14
+
+// Notifications start with a 4 byte big endian message counter, byte i
+// after it holds (counter + i) & 0xFF
+#define SEQ_HDR_SIZE 4
+
+// Recent sequence numbers remembered to tell duplicates from late arrivals
+#define SEQ_WINDOW 32
+
+#if defined(THROUGHPUT_SWEEP) && defined(THROUGHPUT_LATENCY)
+#error "THROUGHPUT_SWEEP and THROUGHPUT_LATENCY both start on KEY_RIGHT"
+#endif
+
+#if defined(THROUGHPUT_SWEEP) || defined(THROUGHPUT_LATENCY)
+// UART baud rate of the sweep results
+#ifndef SWEEP_UART_BR
+#define SWEEP_UART_BR                         115200
+#endif
+#endif //THROUGHPUT_SWEEP || THROUGHPUT_LATENCY
+
+#ifdef THROUGHPUT_SWEEP
+// Seconds to let a sweep point settle before measuring it
+#ifndef SWEEP_SETTLE_TIME
+#define SWEEP_SETTLE_TIME                     1
+#endif
+
+// Seconds each sweep point is measured for
+#ifndef SWEEP_HOLD_TIME
+#define SWEEP_HOLD_TIME                       5
+#endif
+
+// ATT notification header (opcode and handle)
+#define ATT_NOTI_HDR_SIZE                     3
+
+// Sweep steps
+enum
+{
+  SWEEP_IDLE,                         // Not sweeping
+  SWEEP_SETUP,                        // Applying the parameters of a point
+  SWEEP_RUN                           // Measuring a point
+};
+
+// Parameters of the current point already applied
+#define SWEEP_SET_INTERVAL                    0x01
+#define SWEEP_SET_PDU                         0x02
+#define SWEEP_SET_NOTI                        0x04
+#define SWEEP_SET_ALL                         0x07
+#endif //THROUGHPUT_SWEEP
+
+#ifdef THROUGHPUT_DUPLEX
+// ATT write command header (opcode and handle)
+#define ATT_WRITE_HDR_SIZE                    3
+#endif //THROUGHPUT_DUPLEX
+
+#ifdef THROUGHPUT_LATENCY
+// Probes sent per latency point
+#ifndef LAT_NUM_PROBES
+#define LAT_NUM_PROBES                        100
+#endif
+
+// Milliseconds from a reply to the next probe. Not a multiple of any
+// connection interval, so the probes are written at every phase of it.
+#define LAT_PROBE_GAP                         7
+
+// Milliseconds after which a probe counts as lost
+#define LAT_PROBE_TIMEOUT                     2000
+
+// Probe: sequence number (2 bytes) and send time in us (4 bytes)
+#define LAT_PROBE_LEN                         6
+
+// Histogram bins, one connection interval wide. The last one takes
+// everything longer.
+#define LAT_HIST_BINS                         12
+
+#define LAT_NUM(a)                            (sizeof(a) / sizeof(a[0]))
+
+// Latency steps
+enum
+{
+  LAT_IDLE,                           // Not measuring
+  LAT_SETUP,                          // Applying the parameters of a point
+  LAT_RUN                             // Probing
+};
+
+// Parameters of the current point already applied
+#define LAT_SET_ECHO                          0x01
+#define LAT_SET_PARAMS                        0x02
+#endif //THROUGHPUT_LATENCY
+
 // Application states
 enum
 {
@@ -184,7 +288,10 @@ enum
   BLE_DISC_STATE_IDLE,                // Idle
   BLE_DISC_STATE_MTU,                 // Exchange ATT MTU size
   BLE_DISC_STATE_SVC,                 // Service discovery
-  BLE_DISC_STATE_CHAR                 // Characteristic discovery
+  BLE_DISC_STATE_CHAR,                // Characteristic discovery
+  BLE_DISC_STATE_CHAR3,               // Characteristic 3 discovery
+  BLE_DISC_STATE_SINK,                // Sink characteristic discovery
+  BLE_DISC_STATE_ECHO                 // Echo characteristic discovery
 };
 
 /*********************************************************************
@@ -198,6 +305,17 @@ typedef struct
   uint8_t *pData;  // event data 
 } sbcEvt_t;
 
+#ifdef THROUGHPUT_SWEEP
+// One point of the throughput sweep
+typedef struct
+{
+  uint16_t connInterval;  // connection interval, units of 1.25ms
+  uint16_t mtu;           // ATT MTU
+  uint8_t pduSize;        // LL PDU size (TX octets) of both sides
+  uint8_t notiLen;        // notification payload length
+} sweepPoint_t;
+#endif //THROUGHPUT_SWEEP
+
 
 /*********************************************************************
  * GLOBAL VARIABLES
@@ -255,8 +373,9 @@ static uint8_t discState = BLE_DISC_STATE_IDLE;
 static uint16_t svcStartHdl = 0;
 static uint16_t svcEndHdl = 0;
 
-// Discovered characteristic handle
+// Discovered characteristic handles
 static uint16_t charHdl = 0;
+static uint16_t char3Hdl = 0;
 
 // Value to write
 static uint8_t charVal = 0;
@@ -271,6 +390,106 @@ static uint8_t throughput_peripheral_peer_addr[B_ADDR_LEN] = { 0xFF, 0xEE, 0xDD,
 static volatile uint32_t bytesRecvd = 0;
 static volatile uint32_t bytesRecvdShadow = 0;
 
+// Goodput: payload of new notifications that passed the pattern check
+static volatile uint32_t goodRecvd = 0;
+static volatile uint32_t goodRecvdShadow = 0;
+
+// Sequence check of the current connection. Bit n of seqSeen is set if
+// seqNext - 1 - n was received, bit n of seqMissing if it was counted as
+// lost.
+static bool seqSynced = FALSE;
+static uint32_t seqNext;
+static uint32_t seqSeen;
+static uint32_t seqMissing;
+
+// Notifications missing, received twice, received late and with a bad
+// payload on the current connection
+static uint32_t seqLost = 0;
+static uint32_t seqDup = 0;
+static uint32_t seqReorder = 0;
+static uint32_t seqCorrupt = 0;
+
+#ifdef THROUGHPUT_SWEEP
+// Sweep matrix, every combination is measured except notifications that do
+// not fit in the MTU. The MTU is the outer loop as changing it takes a new
+// connection.
+static const uint16_t sweepIntervals[] = { 8, 24, 80, 160 };
+static const uint16_t sweepMtus[] = { 23, 131, 247 };
+static const uint8_t sweepPduSizes[] = { 27, 251 };
+static const uint8_t sweepNotiLens[] = { 20, 128, 244 };
+
+// Sweep progress
+static uint8_t sweepState = SWEEP_IDLE;
+static uint16_t sweepIdx;
+static sweepPoint_t sweepPoint;
+static uint8_t sweepSet;
+static bool sweepBusy;
+static uint8_t sweepSecs;
+static uint32_t sweepBytes;
+static uint32_t sweepGood;
+static uint32_t sweepLost;
+
+// MTU of the current connection, connMtu is 0 until the MTU exchange
+// completes
+static uint16_t connMtuOffer;
+static uint16_t connMtu;
+#endif //THROUGHPUT_SWEEP
+
+#if defined(THROUGHPUT_SWEEP) || defined(THROUGHPUT_LATENCY)
+// Connection parameters the link actually uses
+static uint16_t connInterval;
+static uint16_t connLatency;
+
+// UART the results are written to
+static UART_Handle sweepUart = NULL;
+#endif //THROUGHPUT_SWEEP || THROUGHPUT_LATENCY
+
+#ifdef THROUGHPUT_DUPLEX
+// Value handle of the peripheral's Sink Characteristic
+static uint16_t sinkHdl = 0;
+
+// Writes are wanted (KEY_LEFT toggles) and are being sent
+static bool duplexOn = TRUE;
+static bool duplexActive = FALSE;
+
+// ATT MTU of the current connection
+static uint16_t duplexMtu = ATT_MTU_SIZE;
+
+// Running counter at the start of every write
+static uint32_t writeCounter = 0;
+
+// Sent byte counters
+static volatile uint32_t bytesSent = 0;
+static volatile uint32_t bytesSentShadow = 0;
+#endif //THROUGHPUT_DUPLEX
+
+#ifdef THROUGHPUT_LATENCY
+// Latency matrix, every connection interval with every slave latency
+static const uint16_t latIntervals[] = { 8, 24, 80, 160 };
+static const uint16_t latSlaveLatencies[] = { 0, 4 };
+
+// Value handle of the peripheral's Echo Characteristic, its configuration
+// follows it
+static uint16_t echoHdl = 0;
+
+// Progress
+static uint8_t latState = LAT_IDLE;
+static uint16_t latIdx;
+static uint16_t latInterval;
+static uint16_t latSlaveLatency;
+static uint8_t latSet;
+static bool latBusy;
+
+// Probe in flight and what came back so far, round trips in us
+static Clock_Struct latClock;
+static bool latWaiting;
+static uint16_t latSeq;
+static uint16_t latSent;
+static uint16_t latLost;
+static uint16_t latNum;
+static uint32_t latSamples[LAT_NUM_PROBES];
+#endif //THROUGHPUT_LATENCY
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -305,6 +524,44 @@ void SimpleBLECentral_keyChangeHandler(uint8 keys);
 static uint8_t SimpleBLECentral_enqueueMsg(uint8_t event, uint8_t status,
                                            uint8_t *pData);
 static void SimpleBLECentral_speedHandler(UArg a0);
+static uint16_t SimpleBLECentral_rxMtu(void);
+static void SimpleBLECentral_checkNoti(uint8_t *pValue, uint16_t len);
+static void SimpleBLECentral_resetSeq(void);
+
+#ifdef THROUGHPUT_DUPLEX
+static void SimpleBLECentral_startDuplex(void);
+static void SimpleBLECentral_stopDuplex(void);
+static void SimpleBLECentral_fillWrites(void);
+#endif //THROUGHPUT_DUPLEX
+
+#if defined(THROUGHPUT_DUPLEX) || defined(THROUGHPUT_LATENCY)
+static void SimpleBLECentral_discThroughputChar(uint8_t newState,
+                                                uint16_t uuid);
+#endif //THROUGHPUT_DUPLEX || THROUGHPUT_LATENCY
+static void SimpleBLECentral_discNext(void);
+
+#ifdef THROUGHPUT_LATENCY
+static void SimpleBLECentral_startLatency(void);
+static void SimpleBLECentral_nextLatencyPoint(void);
+static void SimpleBLECentral_latencyStep(void);
+static void SimpleBLECentral_sendProbe(void);
+static void SimpleBLECentral_latencyEcho(uint8_t *pValue, uint16_t len);
+static void SimpleBLECentral_latencyReport(void);
+static void SimpleBLECentral_latencyHandler(UArg a0);
+#endif //THROUGHPUT_LATENCY
+
+#ifdef THROUGHPUT_SWEEP
+static void SimpleBLECentral_startSweep(void);
+static void SimpleBLECentral_nextSweepPoint(void);
+static void SimpleBLECentral_sweepStep(void);
+static void SimpleBLECentral_sweepMeasure(uint32_t bytes, uint32_t good);
+#endif //THROUGHPUT_SWEEP
+
+#if defined(THROUGHPUT_SWEEP) || defined(THROUGHPUT_LATENCY)
+static bStatus_t SimpleBLECentral_writeChar(uint16_t handle, uint8_t *pValue,
+                                            uint8_t len);
+static void SimpleBLECentral_sweepPrint(const char *pStr);
+#endif //THROUGHPUT_SWEEP || THROUGHPUT_LATENCY
 
 /*********************************************************************
  * PROFILE CALLBACKS
@@ -464,6 +721,25 @@ static void SimpleBLECentral_init(void)
 
   Display_print0(dispHandle, 0, 0, "Throughput Central");
 
+#ifdef THROUGHPUT_LATENCY
+  Util_constructClock(&latClock, SimpleBLECentral_latencyHandler,
+                      LAT_PROBE_GAP, 0, false, 0);
+#endif //THROUGHPUT_LATENCY
+
+#if defined(THROUGHPUT_SWEEP) || defined(THROUGHPUT_LATENCY)
+  // Sweep results go out on the UART, one CSV row per point
+  {
+    UART_Params uartParams;
+
+    UART_Params_init(&uartParams);
+    uartParams.baudRate = SWEEP_UART_BR;
+    uartParams.writeDataMode = UART_DATA_BINARY;
+    uartParams.readDataMode = UART_DATA_BINARY;
+    uartParams.readEcho = UART_ECHO_OFF;
+
+    sweepUart = UART_open(Board_UART, &uartParams);
+  }
+#endif //THROUGHPUT_SWEEP || THROUGHPUT_LATENCY
 }
 
 /*********************************************************************
@@ -500,8 +776,24 @@ static void SimpleBLECentral_taskFxn(UArg a0, UArg a1)
       {
         if ((src == ICALL_SERVICE_CLASS_BLE) && (dest == selfEntity))
         {
-          // Process inter-task message
-          SimpleBLECentral_processStackMsg((ICall_Hdr *)pMsg);
+          ICall_Stack_Event *pEvt = (ICall_Stack_Event *)pMsg;
+
+          // Check for BLE stack events first
+          if (pEvt->signature == 0xffff)
+          {
+#ifdef THROUGHPUT_DUPLEX
+            if (pEvt->event_flag & SBC_CONN_EVT_END_EVT)
+            {
+              // Refill the buffers the connection event has freed
+              SimpleBLECentral_fillWrites();
+            }
+#endif //THROUGHPUT_DUPLEX
+          }
+          else
+          {
+            // Process inter-task message
+            SimpleBLECentral_processStackMsg((ICall_Hdr *)pMsg);
+          }
         }
 
         if (pMsg)
@@ -531,11 +823,42 @@ static void SimpleBLECentral_taskFxn(UArg a0, UArg a1)
 
       SimpleBLECentral_startDiscovery();
     }
+
+#ifdef THROUGHPUT_LATENCY
+    if (events & SBC_LATENCY_EVT)
+    {
+      events &= ~SBC_LATENCY_EVT;
+
+      // Probe timed out, or the gap after a reply is over
+      if (latWaiting)
+      {
+        latWaiting = FALSE;
+        latLost++;
+        latSeq++;
+      }
+      SimpleBLECentral_sendProbe();
+    }
+#endif //THROUGHPUT_LATENCY
+
     if (events & SBC_MEASURE_SPEED_EVT)
     {
       events &= ~SBC_MEASURE_SPEED_EVT;
 
+      // Raw rate, goodput and what went wrong on this connection so far
+#ifdef THROUGHPUT_DUPLEX
+      Display_print3(dispHandle, 7, 0, "Rx:%d Tx:%d Sum:%d", bytesRecvdShadow,
+                     bytesSentShadow, bytesRecvdShadow + bytesSentShadow);
+#else
       Display_print1(dispHandle, 7, 0, "Rate (B/s): %d", bytesRecvdShadow);
+#endif //THROUGHPUT_DUPLEX
+      Display_print2(dispHandle, 5, 0, "Good:%d Lost:%d", goodRecvdShadow,
+                     seqLost);
+      Display_print3(dispHandle, 6, 0, "Dup:%d Ooo:%d Bad:%d", seqDup,
+                     seqReorder, seqCorrupt);
+
+#ifdef THROUGHPUT_SWEEP
+      SimpleBLECentral_sweepMeasure(bytesRecvdShadow, goodRecvdShadow);
+#endif //THROUGHPUT_SWEEP
     }
   }
 }
@@ -704,12 +1027,30 @@ static void SimpleBLECentral_processRoleEvent(gapCentralRoleEvent_t *pEvent)
           }
           Util_startClock(&speedClock);
 
+          // The peer's counter carries on from the last link, sync to it
+          SimpleBLECentral_resetSeq();
+
           Display_print0(dispHandle, 2, 0, "Connected");
           Display_print0(dispHandle, 3, 0, Util_convertBdAddr2Str(pEvent->linkCmpl.devAddr));
 
           // Discover GATT Server's Rx MTU size
-          req.clientRxMTU = maxPduSize - L2CAP_HDR_SIZE;
+          req.clientRxMTU = SimpleBLECentral_rxMtu();
           VOID GATT_ExchangeMTU(connHandle, &req, selfEntity);
+
+#if defined(THROUGHPUT_SWEEP) || defined(THROUGHPUT_LATENCY)
+          connInterval = pEvent->linkCmpl.connInterval;
+          connLatency = pEvent->linkCmpl.connLatency;
+#endif //THROUGHPUT_SWEEP || THROUGHPUT_LATENCY
+
+#ifdef THROUGHPUT_SWEEP
+          connMtuOffer = req.clientRxMTU;
+          connMtu = 0;
+#endif //THROUGHPUT_SWEEP
+
+#ifdef THROUGHPUT_DUPLEX
+          duplexActive = FALSE;
+          duplexMtu = ATT_MTU_SIZE;
+#endif //THROUGHPUT_DUPLEX
         }
         else
         {
@@ -720,6 +1061,12 @@ static void SimpleBLECentral_processRoleEvent(gapCentralRoleEvent_t *pEvent)
           Display_print0(dispHandle, 2, 0, "Connect Failed");
           Display_print1(dispHandle, 3, 0, "Reason: %d", pEvent->gap.hdr.status);
         }
+
+#ifdef THROUGHPUT_SWEEP
+        sweepBusy = FALSE;
+        sweepSet = 0;
+        SimpleBLECentral_sweepStep();
+#endif //THROUGHPUT_SWEEP
       }
       break;
 
@@ -729,16 +1076,71 @@ static void SimpleBLECentral_processRoleEvent(gapCentralRoleEvent_t *pEvent)
         connHandle = GAP_CONNHANDLE_INIT;
         discState = BLE_DISC_STATE_IDLE;
         charHdl = 0;
+        char3Hdl = 0;
+
+#ifdef THROUGHPUT_DUPLEX
+        // The connection event notice went with the connection
+        sinkHdl = 0;
+        duplexActive = FALSE;
+#endif //THROUGHPUT_DUPLEX
+
+#ifdef THROUGHPUT_LATENCY
+        // Points are not measured across connections, give up
+        echoHdl = 0;
+        if (latState != LAT_IDLE)
+        {
+          latState = LAT_IDLE;
+          latWaiting = FALSE;
+          Util_stopClock(&latClock);
+          SimpleBLECentral_sweepPrint("LATENCY,aborted\r\n");
+          Display_print0(dispHandle, 1, 0, "Latency aborted");
+        }
+#endif //THROUGHPUT_LATENCY
 
         Display_print0(dispHandle, 2, 0, "Disconnected");
         Display_print1(dispHandle, 3, 0, "Reason: %d", pEvent->linkTerminate.reason);
         Display_clearLine(dispHandle, 4);
+
+#ifdef THROUGHPUT_SWEEP
+        // A point cut short by the disconnect is measured again
+        if (sweepState == SWEEP_RUN)
+        {
+          sweepState = SWEEP_SETUP;
+        }
+        sweepBusy = FALSE;
+        sweepSet = 0;
+        SimpleBLECentral_sweepStep();
+#endif //THROUGHPUT_SWEEP
       }
       break;
 
     case GAP_LINK_PARAM_UPDATE_EVENT:
       {
         Display_print1(dispHandle, 2, 0, "Param Update: %d", pEvent->linkUpdate.status);
+
+#if defined(THROUGHPUT_SWEEP) || defined(THROUGHPUT_LATENCY)
+        // Keep going with whatever parameters the link ended up with, the
+        // result row shows them
+        if (pEvent->linkUpdate.status == SUCCESS)
+        {
+          connInterval = pEvent->linkUpdate.connInterval;
+          connLatency = pEvent->linkUpdate.connLatency;
+        }
+#endif //THROUGHPUT_SWEEP || THROUGHPUT_LATENCY
+
+#ifdef THROUGHPUT_LATENCY
+        if (latState == LAT_SETUP)
+        {
+          latBusy = FALSE;
+          SimpleBLECentral_latencyStep();
+        }
+#endif //THROUGHPUT_LATENCY
+
+#ifdef THROUGHPUT_SWEEP
+        sweepSet |= SWEEP_SET_INTERVAL;
+        sweepBusy = FALSE;
+        SimpleBLECentral_sweepStep();
+#endif //THROUGHPUT_SWEEP
       }
       break;
 
@@ -754,8 +1156,9 @@ static void SimpleBLECentral_processRoleEvent(gapCentralRoleEvent_t *pEvent)
  *
  * @param   shift - true if in shift/alt.
  * @param   keys - bit field for key events. Valid entries:
- *                 KEY_LEFT
- *                 KEY_RIGHT
+ *                 KEY_LEFT - full duplex writes on/off (THROUGHPUT_DUPLEX)
+ *                 KEY_RIGHT - start a sweep (THROUGHPUT_SWEEP) or a
+ *                             latency run (THROUGHPUT_LATENCY)
  *
  * @return  none
  */
@@ -776,12 +1179,30 @@ static void SimpleBLECentral_handleKeys(uint8_t shift, uint8_t keys)
 
   if (keys & KEY_LEFT)
   {
+#ifdef THROUGHPUT_DUPLEX
+    // Turn the central's half of the traffic on or off
+    duplexOn = !duplexOn;
+    if (duplexOn)
+    {
+      SimpleBLECentral_startDuplex();
+    }
+    else
+    {
+      SimpleBLECentral_stopDuplex();
+    }
+    Display_print1(dispHandle, 4, 0, "Duplex: %d", duplexOn);
+#endif //THROUGHPUT_DUPLEX
     return;
   }
 
   if (keys & KEY_RIGHT)
   {
-
+#ifdef THROUGHPUT_SWEEP
+    SimpleBLECentral_startSweep();
+#endif //THROUGHPUT_SWEEP
+#ifdef THROUGHPUT_LATENCY
+    SimpleBLECentral_startLatency();
+#endif //THROUGHPUT_LATENCY
     return;
   }
 
@@ -835,6 +1256,24 @@ static void SimpleBLECentral_processGATTMsg(gattMsgEvent_t *pMsg)
         Display_print1(dispHandle, 4, 0, "Write sent: %d", charVal++);
       }
 
+#ifdef THROUGHPUT_SWEEP
+      // A sweep parameter went out, move on to the next one
+      if (sweepBusy)
+      {
+        sweepBusy = FALSE;
+        SimpleBLECentral_sweepStep();
+      }
+#endif //THROUGHPUT_SWEEP
+
+#ifdef THROUGHPUT_LATENCY
+      // Echo configuration written
+      if (latBusy)
+      {
+        latBusy = FALSE;
+        SimpleBLECentral_latencyStep();
+      }
+#endif //THROUGHPUT_LATENCY
+
     }
     else if (pMsg->method == ATT_FLOW_CTRL_VIOLATED_EVENT)
     {
@@ -847,12 +1286,36 @@ static void SimpleBLECentral_processGATTMsg(gattMsgEvent_t *pMsg)
 	}
     else if (pMsg->method == ATT_HANDLE_VALUE_NOTI)
     {
-      bytesRecvd += pMsg->msg.handleValueNoti.len;
+#ifdef THROUGHPUT_LATENCY
+      // Echoed probes are not throughput data
+      if ((echoHdl != 0) && (pMsg->msg.handleValueNoti.handle == echoHdl))
+      {
+        SimpleBLECentral_latencyEcho(pMsg->msg.handleValueNoti.pValue,
+                                     pMsg->msg.handleValueNoti.len);
+      }
+      else
+#endif //THROUGHPUT_LATENCY
+      {
+        bytesRecvd += pMsg->msg.handleValueNoti.len;
+
+        SimpleBLECentral_checkNoti(pMsg->msg.handleValueNoti.pValue,
+                                   pMsg->msg.handleValueNoti.len);
+      }
     }
     else if (pMsg->method == ATT_MTU_UPDATED_EVENT)
     {
       // MTU size updated
       Display_print1(dispHandle, 4, 0, "MTU Size: %d", pMsg->msg.mtuEvt.MTU);
+
+#ifdef THROUGHPUT_SWEEP
+      connMtu = pMsg->msg.mtuEvt.MTU;
+      SimpleBLECentral_sweepStep();
+#endif //THROUGHPUT_SWEEP
+
+#ifdef THROUGHPUT_DUPLEX
+      // Writes queued from now on fill the larger MTU
+      duplexMtu = pMsg->msg.mtuEvt.MTU;
+#endif //THROUGHPUT_DUPLEX
     }
     else if (discState != BLE_DISC_STATE_IDLE)
     {
@@ -972,12 +1435,18 @@ static void SimpleBLECentral_startDiscovery(void)
   attExchangeMTUReq_t req;
 
   // Initialize cached handles
-  svcStartHdl = svcEndHdl = charHdl = 0;
+  svcStartHdl = svcEndHdl = charHdl = char3Hdl = 0;
+#ifdef THROUGHPUT_DUPLEX
+  sinkHdl = 0;
+#endif //THROUGHPUT_DUPLEX
+#ifdef THROUGHPUT_LATENCY
+  echoHdl = 0;
+#endif //THROUGHPUT_LATENCY
 
   discState = BLE_DISC_STATE_MTU;
 
   // Discover GATT Server's Rx MTU size
-  req.clientRxMTU = maxPduSize - L2CAP_HDR_SIZE;
+  req.clientRxMTU = SimpleBLECentral_rxMtu();
 
   // ATT MTU size should be set to the minimum of the Client Rx MTU
   // and Server Rx MTU values
@@ -1046,15 +1515,159 @@ static void SimpleBLECentral_processGATTDiscEvent(gattMsgEvent_t *pMsg)
     if ((pMsg->method == ATT_READ_BY_TYPE_RSP) && 
         (pMsg->msg.readByTypeRsp.numPairs > 0))
     {
+      attReadByTypeReq_t req;
+
       charHdl = BUILD_UINT16(pMsg->msg.readByTypeRsp.pDataList[0],
                              pMsg->msg.readByTypeRsp.pDataList[1]);
 
       Display_print0(dispHandle, 2, 0, "Simple Svc Found");
+
+      // Characteristic 3 is write only, find its declaration instead
+      discState = BLE_DISC_STATE_CHAR3;
+
+      req.startHandle = svcStartHdl;
+      req.endHandle = svcEndHdl;
+      req.type.len = ATT_BT_UUID_SIZE;
+      req.type.uuid[0] = LO_UINT16(SIMPLEPROFILE_CHAR3_UUID);
+      req.type.uuid[1] = HI_UINT16(SIMPLEPROFILE_CHAR3_UUID);
+
+      VOID GATT_DiscCharsByUUID(connHandle, &req, selfEntity);
+    }
+    else
+    {
+      discState = BLE_DISC_STATE_IDLE;
+    }
+  }
+  else if (discState == BLE_DISC_STATE_CHAR3)
+  {
+    // Declaration found, the value handle follows the properties
+    if ((pMsg->method == ATT_READ_BY_TYPE_RSP) &&
+        (pMsg->msg.readByTypeRsp.numPairs > 0))
+    {
+      char3Hdl = BUILD_UINT16(pMsg->msg.readByTypeRsp.pDataList[3],
+                              pMsg->msg.readByTypeRsp.pDataList[4]);
+    }
+
+    // If procedure complete
+    if (((pMsg->method == ATT_READ_BY_TYPE_RSP) &&
+         (pMsg->hdr.status == bleProcedureComplete)) ||
+        (pMsg->method == ATT_ERROR_RSP))
+    {
+      SimpleBLECentral_discNext();
+    }
+  }
+#ifdef THROUGHPUT_DUPLEX
+  else if (discState == BLE_DISC_STATE_SINK)
+  {
+    // Declaration found, the value handle follows the properties
+    if ((pMsg->method == ATT_READ_BY_TYPE_RSP) &&
+        (pMsg->msg.readByTypeRsp.numPairs > 0))
+    {
+      sinkHdl = BUILD_UINT16(pMsg->msg.readByTypeRsp.pDataList[3],
+                             pMsg->msg.readByTypeRsp.pDataList[4]);
+    }
+
+    // If procedure complete
+    if (((pMsg->method == ATT_READ_BY_TYPE_RSP) &&
+         (pMsg->hdr.status == bleProcedureComplete)) ||
+        (pMsg->method == ATT_ERROR_RSP))
+    {
+      // A peripheral without the sink just gets no writes
+      SimpleBLECentral_startDuplex();
+
+      SimpleBLECentral_discNext();
+    }
+  }
+#endif //THROUGHPUT_DUPLEX
+#ifdef THROUGHPUT_LATENCY
+  else if (discState == BLE_DISC_STATE_ECHO)
+  {
+    // Declaration found, the value handle follows the properties
+    if ((pMsg->method == ATT_READ_BY_TYPE_RSP) &&
+        (pMsg->msg.readByTypeRsp.numPairs > 0))
+    {
+      echoHdl = BUILD_UINT16(pMsg->msg.readByTypeRsp.pDataList[3],
+                             pMsg->msg.readByTypeRsp.pDataList[4]);
     }
 
-    discState = BLE_DISC_STATE_IDLE;
+    // If procedure complete
+    if (((pMsg->method == ATT_READ_BY_TYPE_RSP) &&
+         (pMsg->hdr.status == bleProcedureComplete)) ||
+        (pMsg->method == ATT_ERROR_RSP))
+    {
+      SimpleBLECentral_discNext();
+    }
+  }
+#endif //THROUGHPUT_LATENCY
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_discNext
+ *
+ * @brief   Move on to the next characteristic to discover once the
+ *          current one is done: the throughput service characteristics
+ *          the build uses, then back to idle.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_discNext(void)
+{
+#ifdef THROUGHPUT_DUPLEX
+  if (discState == BLE_DISC_STATE_CHAR3)
+  {
+    SimpleBLECentral_discThroughputChar(BLE_DISC_STATE_SINK,
+                                        THROUGHPUTSERVICE_SINK_UUID);
+    return;
+  }
+#endif //THROUGHPUT_DUPLEX
+
+#ifdef THROUGHPUT_LATENCY
+  if (discState != BLE_DISC_STATE_ECHO)
+  {
+    SimpleBLECentral_discThroughputChar(BLE_DISC_STATE_ECHO,
+                                        THROUGHPUTSERVICE_ECHO_UUID);
+    return;
   }
+#endif //THROUGHPUT_LATENCY
+
+  discState = BLE_DISC_STATE_IDLE;
+
+#ifdef THROUGHPUT_SWEEP
+  SimpleBLECentral_sweepStep();
+#endif //THROUGHPUT_SWEEP
+}
+
+#if defined(THROUGHPUT_DUPLEX) || defined(THROUGHPUT_LATENCY)
+/*********************************************************************
+ * @fn      SimpleBLECentral_discThroughputChar
+ *
+ * @brief   Discover a characteristic of the peripheral's Throughput
+ *          Service. It is a service of its own, the whole database is
+ *          searched.
+ *
+ * @param   newState - discovery state while it runs
+ * @param   uuid - 16 bit part of the characteristic's TI base UUID
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_discThroughputChar(uint8_t newState,
+                                                uint16_t uuid)
+{
+  attReadByTypeReq_t req;
+  uint8_t baseUuid[ATT_UUID_SIZE] = { TI_BASE_UUID_128(0) };
+
+  discState = newState;
+
+  req.startHandle = 0x0001;
+  req.endHandle = 0xFFFF;
+  req.type.len = ATT_UUID_SIZE;
+  memcpy(req.type.uuid, baseUuid, ATT_UUID_SIZE);
+  req.type.uuid[12] = LO_UINT16(uuid);
+  req.type.uuid[13] = HI_UINT16(uuid);
+
+  VOID GATT_DiscCharsByUUID(connHandle, &req, selfEntity);
 }
+#endif //THROUGHPUT_DUPLEX || THROUGHPUT_LATENCY
 
 /*********************************************************************
  * @fn      SimpleBLECentral_findSvcUuid
@@ -1285,7 +1898,7 @@ static uint8_t SimpleBLECentral_enqueueMsg(uint8_t event, uint8_t state,
  * @fn      SimpleBLECentral_speedHandler
  *
  * @brief   RTOS clock handler that counts number of bytes recieved
- *			in a clock period.
+ *			in a clock period, raw and goodput.
  *
  * @param   a0 - RTOS clock arg0.
  *
@@ -1295,9 +1908,824 @@ static void SimpleBLECentral_speedHandler(UArg a0)
 {
   bytesRecvdShadow = bytesRecvd;
   bytesRecvd = 0;
+  goodRecvdShadow = goodRecvd;
+  goodRecvd = 0;
+#ifdef THROUGHPUT_DUPLEX
+  bytesSentShadow = bytesSent;
+  bytesSent = 0;
+#endif //THROUGHPUT_DUPLEX
   events |= SBC_MEASURE_SPEED_EVT;
   Semaphore_post(sem);
 }
 
+/*********************************************************************
+ * @fn      SimpleBLECentral_rxMtu
+ *
+ * @brief   ATT MTU to offer in the MTU exchange.
+ *
+ * @return  the largest the PDU size allows, or the MTU of the current
+ *          sweep point
+ */
+static uint16_t SimpleBLECentral_rxMtu(void)
+{
+#ifdef THROUGHPUT_SWEEP
+  if (sweepState != SWEEP_IDLE)
+  {
+    return sweepPoint.mtu;
+  }
+#endif //THROUGHPUT_SWEEP
+
+  return maxPduSize - L2CAP_HDR_SIZE;
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_resetSeq
+ *
+ * @brief   Start the sequence check over, the next notification sets
+ *          the expected counter.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_resetSeq(void)
+{
+  seqSynced = FALSE;
+  seqLost = 0;
+  seqDup = 0;
+  seqReorder = 0;
+  seqCorrupt = 0;
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_checkNoti
+ *
+ * @brief   Check the message counter and payload pattern of a received
+ *          notification and account it. Only new notifications with an
+ *          intact payload count towards goodput. A counter that skips
+ *          ahead counts the skipped ones as lost. One that goes back is a
+ *          duplicate if it was seen before, otherwise a late arrival that
+ *          is no longer lost.
+ *
+ * @param   pValue - notification payload
+ * @param   len - payload length
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_checkNoti(uint8_t *pValue, uint16_t len)
+{
+  uint32_t seq;
+  uint32_t age;
+  uint16_t i;
+
+  if (len < SEQ_HDR_SIZE)
+  {
+    seqCorrupt++;
+    return;
+  }
+
+  seq = BUILD_UINT32(pValue[3], pValue[2], pValue[1], pValue[0]);
+
+  for (i = SEQ_HDR_SIZE; i < len; i++)
+  {
+    if (pValue[i] != (uint8_t)(seq + i))
+    {
+      // The counter can't be trusted either, leave it to the gap check
+      seqCorrupt++;
+      return;
+    }
+  }
+
+  if (!seqSynced)
+  {
+    seqSynced = TRUE;
+    seqNext = seq + 1;
+    seqSeen = 1;
+    seqMissing = 0;
+  }
+  else if (seq == seqNext)
+  {
+    seqNext++;
+    seqSeen = (seqSeen << 1) | 1;
+    seqMissing <<= 1;
+  }
+  else if ((int32_t)(seq - seqNext) > 0)
+  {
+    // Gap, everything between was lost (so far)
+    age = seq - seqNext;
+    seqLost += age;
+    if (age + 1 < SEQ_WINDOW)
+    {
+      seqSeen = (seqSeen << (age + 1)) | 1;
+      seqMissing = (seqMissing << (age + 1)) | ((((uint32_t)1 << age) - 1) << 1);
+    }
+    else
+    {
+      seqSeen = 1;
+      seqMissing = ~(uint32_t)1;
+    }
+    seqNext = seq + 1;
+  }
+  else
+  {
+    age = seqNext - 1 - seq;
+
+    if ((age < SEQ_WINDOW) && (seqSeen & ((uint32_t)1 << age)))
+    {
+      seqDup++;
+      return;
+    }
+
+    seqReorder++;
+
+    if (age >= SEQ_WINDOW)
+    {
+      // Too old to tell whether it is new
+      return;
+    }
+
+    seqSeen |= (uint32_t)1 << age;
+
+    // Only taken back if its gap was counted, one from before the check
+    // synchronised never was
+    if (seqMissing & ((uint32_t)1 << age))
+    {
+      seqMissing &= ~((uint32_t)1 << age);
+      seqLost--;
+    }
+  }
+
+  goodRecvd += len;
+}
+
+#ifdef THROUGHPUT_DUPLEX
+/*********************************************************************
+ * @fn      SimpleBLECentral_startDuplex
+ *
+ * @brief   Start writing to the peripheral's Sink Characteristic, if it
+ *          has one and full duplex is turned on. Writes are queued until
+ *          the stack runs out of buffers, then topped up at the end of
+ *          every connection event.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_startDuplex(void)
+{
+  if (!duplexOn || duplexActive || (sinkHdl == 0) ||
+      (state != BLE_STATE_CONNECTED))
+  {
+    return;
+  }
+
+  // Get notified at the end of every connection event
+  if (HCI_EXT_ConnEventNoticeCmd(connHandle, selfEntity,
+                                 SBC_CONN_EVT_END_EVT) != SUCCESS)
+  {
+    return;
+  }
+
+  duplexActive = TRUE;
+
+  SimpleBLECentral_fillWrites();
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_stopDuplex
+ *
+ * @brief   Stop writing to the Sink Characteristic. Writes already queued
+ *          still go out.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_stopDuplex(void)
+{
+  if (duplexActive)
+  {
+    HCI_EXT_ConnEventNoticeCmd(connHandle, selfEntity, 0);
+    duplexActive = FALSE;
+  }
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_fillWrites
+ *
+ * @brief   Queue writes without response of a full MTU to the Sink
+ *          Characteristic until the stack has no buffer left. Each write
+ *          starts with a running counter (big endian), like the
+ *          peripheral's notifications.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_fillWrites(void)
+{
+  attWriteReq_t req;
+  uint16_t len = duplexMtu - ATT_WRITE_HDR_SIZE;
+
+  while (duplexActive)
+  {
+    req.pValue = GATT_bm_alloc(connHandle, ATT_WRITE_REQ, len, NULL);
+    if (req.pValue == NULL)
+    {
+      break;
+    }
+
+    req.handle = sinkHdl;
+    req.len = len;
+    req.sig = FALSE;
+    req.cmd = TRUE;
+
+    req.pValue[0] = BREAK_UINT32(writeCounter, 3);
+    req.pValue[1] = BREAK_UINT32(writeCounter, 2);
+    req.pValue[2] = BREAK_UINT32(writeCounter, 1);
+    req.pValue[3] = BREAK_UINT32(writeCounter, 0);
+
+    if (GATT_WriteNoRsp(connHandle, &req) != SUCCESS)
+    {
+      GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
+      break;
+    }
+
+    writeCounter++;
+    bytesSent += len;
+  }
+}
+#endif //THROUGHPUT_DUPLEX
+
+#ifdef THROUGHPUT_LATENCY
+/*********************************************************************
+ * @fn      SimpleBLECentral_startLatency
+ *
+ * @brief   Start the round trip latency run. For every connection interval
+ *          and slave latency of the matrix LAT_NUM_PROBES timestamped
+ *          probes are written to the peripheral's Echo Characteristic one
+ *          at a time, each notified straight back. One CSV row with the
+ *          percentiles and one with the histogram of the round trips go
+ *          out on the UART per point.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_startLatency(void)
+{
+  if ((latState != LAT_IDLE) || (state != BLE_STATE_CONNECTED))
+  {
+    return;
+  }
+
+  if (echoHdl == 0)
+  {
+    Display_print0(dispHandle, 1, 0, "Peer has no echo");
+    return;
+  }
+
+#ifdef THROUGHPUT_DUPLEX
+  // Queued writes would sit in front of the probes
+  SimpleBLECentral_stopDuplex();
+#endif //THROUGHPUT_DUPLEX
+
+  SimpleBLECentral_sweepPrint("LATENCY,point,conn_interval,slave_latency,"
+                              "probes,lost,p50_us,p90_us,p99_us,max_us\r\n");
+
+  latIdx = 0xFFFF;
+  latSet = 0;
+  SimpleBLECentral_nextLatencyPoint();
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_nextLatencyPoint
+ *
+ * @brief   Move on to the next point of the latency matrix. Ends the run
+ *          after the last one and turns the echo off again.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_nextLatencyPoint(void)
+{
+  uint8_t cfg[2] = { LO_UINT16(0), HI_UINT16(0) };
+
+  if (++latIdx >= LAT_NUM(latIntervals) * LAT_NUM(latSlaveLatencies))
+  {
+    latState = LAT_IDLE;
+
+    // The peripheral resumes its notifications
+    VOID SimpleBLECentral_writeChar(echoHdl + 1, cfg, sizeof(cfg));
+
+    SimpleBLECentral_sweepPrint("LATENCY,done\r\n");
+    Display_print0(dispHandle, 1, 0, "Latency done");
+
+#ifdef THROUGHPUT_DUPLEX
+    SimpleBLECentral_startDuplex();
+#endif //THROUGHPUT_DUPLEX
+    return;
+  }
+
+  // Slave latency is the inner loop
+  latInterval = latIntervals[latIdx / LAT_NUM(latSlaveLatencies)];
+  latSlaveLatency = latSlaveLatencies[latIdx % LAT_NUM(latSlaveLatencies)];
+
+  Display_print1(dispHandle, 1, 0, "Latency point %d", latIdx);
+
+  // The echo stays on between points
+  latState = LAT_SETUP;
+  latSet &= LAT_SET_ECHO;
+  SimpleBLECentral_latencyStep();
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_latencyStep
+ *
+ * @brief   Take the next step towards the current latency point. Called
+ *          again whenever the step before completes: echo notifications
+ *          enabled, connection parameters updated.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_latencyStep(void)
+{
+  uint8_t cfg[2] = { LO_UINT16(GATT_CLIENT_CFG_NOTIFY),
+                     HI_UINT16(GATT_CLIENT_CFG_NOTIFY) };
+
+  if ((latState != LAT_SETUP) || latBusy)
+  {
+    return;
+  }
+
+  if (!(latSet & LAT_SET_ECHO))
+  {
+    latSet |= LAT_SET_ECHO;
+
+    // The configuration descriptor follows the value
+    if (SimpleBLECentral_writeChar(echoHdl + 1, cfg, sizeof(cfg)) == SUCCESS)
+    {
+      latBusy = TRUE;
+      return;
+    }
+  }
+
+  if (!(latSet & LAT_SET_PARAMS))
+  {
+    latSet |= LAT_SET_PARAMS;
+
+    if (((connInterval != latInterval) ||
+         (connLatency != latSlaveLatency)) &&
+        (GAPCentralRole_UpdateLink(connHandle, latInterval, latInterval,
+                                   latSlaveLatency,
+                                   DEFAULT_UPDATE_CONN_TIMEOUT) == SUCCESS))
+    {
+      latBusy = TRUE;
+      return;
+    }
+  }
+
+  // All set, probe
+  latState = LAT_RUN;
+  latWaiting = FALSE;
+  latSent = 0;
+  latLost = 0;
+  latNum = 0;
+  SimpleBLECentral_sendProbe();
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_sendProbe
+ *
+ * @brief   Write the next probe to the Echo Characteristic: sequence
+ *          number and send time in us, both big endian. Reports the point
+ *          once all probes are out and answered or lost.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_sendProbe(void)
+{
+  attWriteReq_t req;
+  uint32_t now;
+
+  if (latState != LAT_RUN)
+  {
+    return;
+  }
+
+  if (latSent >= LAT_NUM_PROBES)
+  {
+    SimpleBLECentral_latencyReport();
+    SimpleBLECentral_nextLatencyPoint();
+    return;
+  }
+
+  req.pValue = GATT_bm_alloc(connHandle, ATT_WRITE_REQ, LAT_PROBE_LEN, NULL);
+  if (req.pValue != NULL)
+  {
+    req.handle = echoHdl;
+    req.len = LAT_PROBE_LEN;
+    req.sig = FALSE;
+    req.cmd = TRUE;
+
+    now = Clock_getTicks() * Clock_tickPeriod;
+
+    req.pValue[0] = HI_UINT16(latSeq);
+    req.pValue[1] = LO_UINT16(latSeq);
+    req.pValue[2] = BREAK_UINT32(now, 3);
+    req.pValue[3] = BREAK_UINT32(now, 2);
+    req.pValue[4] = BREAK_UINT32(now, 1);
+    req.pValue[5] = BREAK_UINT32(now, 0);
+
+    if (GATT_WriteNoRsp(connHandle, &req) == SUCCESS)
+    {
+      latSent++;
+      latWaiting = TRUE;
+      Util_restartClock(&latClock, LAT_PROBE_TIMEOUT);
+      return;
+    }
+
+    GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
+  }
+
+  // Out of buffers, try again after the gap
+  Util_restartClock(&latClock, LAT_PROBE_GAP);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_latencyEcho
+ *
+ * @brief   Take the round trip of an echoed probe. Echoes of probes that
+ *          already timed out are ignored.
+ *
+ * @param   pValue - notification payload
+ * @param   len - notification payload length
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_latencyEcho(uint8_t *pValue, uint16_t len)
+{
+  uint32_t now = Clock_getTicks() * Clock_tickPeriod;
+
+  if ((latState != LAT_RUN) || !latWaiting || (len < LAT_PROBE_LEN) ||
+      (BUILD_UINT16(pValue[1], pValue[0]) != latSeq))
+  {
+    return;
+  }
+
+  latSamples[latNum++] = now - BUILD_UINT32(pValue[5], pValue[4],
+                                            pValue[3], pValue[2]);
+  latWaiting = FALSE;
+  latSeq++;
+
+  Util_restartClock(&latClock, LAT_PROBE_GAP);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_latencyReport
+ *
+ * @brief   Write the result rows of the current latency point: the
+ *          percentiles of the round trips (nearest rank) and their
+ *          histogram in bins of one connection interval.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_latencyReport(void)
+{
+  uint32_t hist[LAT_HIST_BINS] = { 0 };
+  uint32_t binWidth = (uint32_t)connInterval * 1250;
+  uint32_t pct[3] = { 0 };
+  uint32_t rtt;
+  uint32_t bin;
+  uint16_t i;
+  uint16_t j;
+  uint16_t pos;
+  char row[96];
+
+  // Few enough samples for an insertion sort
+  for (i = 1; i < latNum; i++)
+  {
+    rtt = latSamples[i];
+    for (j = i; (j > 0) && (latSamples[j - 1] > rtt); j--)
+    {
+      latSamples[j] = latSamples[j - 1];
+    }
+    latSamples[j] = rtt;
+  }
+
+  if (latNum > 0)
+  {
+    pct[0] = latSamples[(latNum * 50 + 99) / 100 - 1];
+    pct[1] = latSamples[(latNum * 90 + 99) / 100 - 1];
+    pct[2] = latSamples[(latNum * 99 + 99) / 100 - 1];
+  }
+
+  for (i = 0; i < latNum; i++)
+  {
+    bin = (binWidth != 0) ? (latSamples[i] / binWidth) : 0;
+    hist[(bin < LAT_HIST_BINS) ? bin : (LAT_HIST_BINS - 1)]++;
+  }
+
+  System_snprintf(row, sizeof(row), "LATENCY,%d,%d,%d,%d,%d,%d,%d,%d,%d\r\n",
+                  latIdx, connInterval, connLatency, latNum, latLost,
+                  pct[0], pct[1], pct[2],
+                  (latNum > 0) ? latSamples[latNum - 1] : 0);
+  SimpleBLECentral_sweepPrint(row);
+
+  pos = System_snprintf(row, sizeof(row), "LATHIST,%d", latIdx);
+  for (i = 0; i < LAT_HIST_BINS; i++)
+  {
+    pos += System_snprintf(row + pos, sizeof(row) - pos, ",%d", hist[i]);
+  }
+  System_snprintf(row + pos, sizeof(row) - pos, "\r\n");
+  SimpleBLECentral_sweepPrint(row);
+
+  Display_print2(dispHandle, 1, 0, "p50:%dus p99:%dus", pct[0], pct[2]);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_latencyHandler
+ *
+ * @brief   RTOS clock handler of the probe timeout and the gap between
+ *          probes.
+ *
+ * @param   a0 - RTOS clock arg0.
+ *
+ * @return  void
+ */
+static void SimpleBLECentral_latencyHandler(UArg a0)
+{
+  events |= SBC_LATENCY_EVT;
+  Semaphore_post(sem);
+}
+#endif //THROUGHPUT_LATENCY
+
+#ifdef THROUGHPUT_SWEEP
+/*********************************************************************
+ * @fn      SimpleBLECentral_startSweep
+ *
+ * @brief   Start the throughput sweep. Every point of the sweep matrix is
+ *          applied, left to settle for SWEEP_SETTLE_TIME seconds and
+ *          measured for SWEEP_HOLD_TIME seconds, then one CSV row with the
+ *          parameters the link actually used and the receive rate is
+ *          written to the UART.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_startSweep(void)
+{
+  if (sweepState != SWEEP_IDLE)
+  {
+    return;
+  }
+
+  SimpleBLECentral_sweepPrint("SWEEP,point,conn_interval,mtu,ll_pdu,noti_len,"
+                              "bytes_per_s,goodput_per_s,lost\r\n");
+
+  sweepIdx = 0xFFFF;
+  SimpleBLECentral_nextSweepPoint();
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_nextSweepPoint
+ *
+ * @brief   Move on to the next point of the sweep matrix, skipping
+ *          notifications that do not fit in the MTU. Ends the sweep
+ *          after the last one.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_nextSweepPoint(void)
+{
+  uint16_t numPoints = SWEEP_NUM(sweepMtus) * SWEEP_NUM(sweepIntervals) *
+                       SWEEP_NUM(sweepPduSizes) * SWEEP_NUM(sweepNotiLens);
+  uint16_t idx;
+
+  for (;;)
+  {
+    if (++sweepIdx >= numPoints)
+    {
+      sweepState = SWEEP_IDLE;
+      SimpleBLECentral_sweepPrint("SWEEP,done\r\n");
+      Display_print0(dispHandle, 1, 0, "Sweep done");
+      return;
+    }
+
+    // Notification length is the inner loop, MTU the outer one
+    idx = sweepIdx;
+    sweepPoint.notiLen = sweepNotiLens[idx % SWEEP_NUM(sweepNotiLens)];
+    idx /= SWEEP_NUM(sweepNotiLens);
+    sweepPoint.pduSize = sweepPduSizes[idx % SWEEP_NUM(sweepPduSizes)];
+    idx /= SWEEP_NUM(sweepPduSizes);
+    sweepPoint.connInterval = sweepIntervals[idx % SWEEP_NUM(sweepIntervals)];
+    idx /= SWEEP_NUM(sweepIntervals);
+    sweepPoint.mtu = sweepMtus[idx];
+
+    if (sweepPoint.notiLen <= sweepPoint.mtu - ATT_NOTI_HDR_SIZE)
+    {
+      break;
+    }
+  }
+
+  Display_print1(dispHandle, 1, 0, "Sweep point %d", sweepIdx);
+
+  sweepState = SWEEP_SETUP;
+  sweepSet = 0;
+  SimpleBLECentral_sweepStep();
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_sweepStep
+ *
+ * @brief   Take the next step towards the parameters of the current sweep
+ *          point. Called again whenever the step before completes: link
+ *          up with the right MTU, discovery done, connection interval
+ *          updated, peer LL PDU size and notification length written.
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_sweepStep(void)
+{
+  if ((sweepState != SWEEP_SETUP) || sweepBusy)
+  {
+    return;
+  }
+
+  if (state == BLE_STATE_IDLE)
+  {
+    // Connect, the MTU exchange then offers the MTU of the point
+    if (GAPCentralRole_EstablishLink(DEFAULT_LINK_HIGH_DUTY_CYCLE,
+                                     DEFAULT_LINK_WHITE_LIST,
+                                     ADDRTYPE_PUBLIC,
+                                     throughput_peripheral_peer_addr) == SUCCESS)
+    {
+      state = BLE_STATE_CONNECTING;
+      sweepBusy = TRUE;
+    }
+    return;
+  }
+
+  if (state != BLE_STATE_CONNECTED)
+  {
+    return;
+  }
+
+  if (connMtuOffer != sweepPoint.mtu)
+  {
+    // The MTU can only be exchanged once per connection, start over
+    GAPCentralRole_TerminateLink(connHandle);
+    state = BLE_STATE_DISCONNECTING;
+    sweepBusy = TRUE;
+    return;
+  }
+
+  if (connMtu == 0)
+  {
+    // MTU exchange still running
+    return;
+  }
+
+  if ((charHdl == 0) || (char3Hdl == 0) || (discState != BLE_DISC_STATE_IDLE))
+  {
+    // Discovery still running
+    return;
+  }
+
+  if (!(sweepSet & SWEEP_SET_INTERVAL))
+  {
+    if ((connInterval != sweepPoint.connInterval) &&
+        (GAPCentralRole_UpdateLink(connHandle, sweepPoint.connInterval,
+                                   sweepPoint.connInterval, 0,
+                                   DEFAULT_UPDATE_CONN_TIMEOUT) == SUCCESS))
+    {
+      sweepBusy = TRUE;
+      return;
+    }
+
+    sweepSet |= SWEEP_SET_INTERVAL;
+  }
+
+  if (!(sweepSet & SWEEP_SET_PDU))
+  {
+    sweepSet |= SWEEP_SET_PDU;
+
+    // Same LL PDU size both ways, the peer sets its own on the write
+    HCI_LE_SetDataLenCmd(connHandle, sweepPoint.pduSize,
+                         (sweepPoint.pduSize + LL_PACKET_OVERHEAD) * 8);
+
+    if (SimpleBLECentral_writeChar(charHdl, &sweepPoint.pduSize, 1) == SUCCESS)
+    {
+      sweepBusy = TRUE;
+      return;
+    }
+  }
+
+  if (!(sweepSet & SWEEP_SET_NOTI))
+  {
+    sweepSet |= SWEEP_SET_NOTI;
+
+    if (SimpleBLECentral_writeChar(char3Hdl, &sweepPoint.notiLen, 1) == SUCCESS)
+    {
+      sweepBusy = TRUE;
+      return;
+    }
+  }
+
+  // All set, measure
+  sweepState = SWEEP_RUN;
+  sweepSecs = 0;
+  sweepBytes = 0;
+  sweepGood = 0;
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_sweepMeasure
+ *
+ * @brief   Account one second of received data to the current sweep point
+ *          and write its result row once it has been held long enough.
+ *
+ * @param   bytes - bytes received in the last second
+ * @param   good - goodput of the last second
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_sweepMeasure(uint32_t bytes, uint32_t good)
+{
+  char row[64];
+
+  if (sweepState != SWEEP_RUN)
+  {
+    return;
+  }
+
+  if (++sweepSecs <= SWEEP_SETTLE_TIME)
+  {
+    // Losses count from the end of the settle time
+    sweepLost = seqLost;
+    return;
+  }
+
+  sweepBytes += bytes;
+  sweepGood += good;
+
+  if (sweepSecs < SWEEP_SETTLE_TIME + SWEEP_HOLD_TIME)
+  {
+    return;
+  }
+
+  System_snprintf(row, sizeof(row), "SWEEP,%d,%d,%d,%d,%d,%d,%d,%d\r\n",
+                  sweepIdx, connInterval, connMtu, sweepPoint.pduSize,
+                  sweepPoint.notiLen, sweepBytes / SWEEP_HOLD_TIME,
+                  sweepGood / SWEEP_HOLD_TIME, seqLost - sweepLost);
+  SimpleBLECentral_sweepPrint(row);
+
+  SimpleBLECentral_nextSweepPoint();
+}
+#endif //THROUGHPUT_SWEEP
+
+#if defined(THROUGHPUT_SWEEP) || defined(THROUGHPUT_LATENCY)
+/*********************************************************************
+ * @fn      SimpleBLECentral_writeChar
+ *
+ * @brief   Write a short characteristic value or descriptor of the peer.
+ *
+ * @param   handle - value handle
+ * @param   pValue - value to write
+ * @param   len - length of the value
+ *
+ * @return  SUCCESS if the write request went out
+ */
+static bStatus_t SimpleBLECentral_writeChar(uint16_t handle, uint8_t *pValue,
+                                            uint8_t len)
+{
+  attWriteReq_t req;
+  bStatus_t status = bleNoResources;
+
+  req.pValue = GATT_bm_alloc(connHandle, ATT_WRITE_REQ, len, NULL);
+  if (req.pValue != NULL)
+  {
+    req.handle = handle;
+    req.len = len;
+    memcpy(req.pValue, pValue, len);
+    req.sig = 0;
+    req.cmd = 0;
+
+    status = GATT_WriteCharValue(connHandle, &req, selfEntity);
+    if (status != SUCCESS)
+    {
+      GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
+    }
+  }
+
+  return status;
+}
+
+/*********************************************************************
+ * @fn      SimpleBLECentral_sweepPrint
+ *
+ * @brief   Write a line of sweep output to the UART.
+ *
+ * @param   pStr - NUL terminated line
+ *
+ * @return  none
+ */
+static void SimpleBLECentral_sweepPrint(const char *pStr)
+{
+  if (sweepUart != NULL)
+  {
+    UART_write(sweepUart, pStr, strlen(pStr));
+  }
+}
+#endif //THROUGHPUT_SWEEP || THROUGHPUT_LATENCY
+
 /*********************************************************************
 *********************************************************************/
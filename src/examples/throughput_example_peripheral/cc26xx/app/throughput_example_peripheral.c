@@ -49,6 +49,10 @@
 #include <ti/sysbios/knl/Semaphore.h>
 #include <ti/sysbios/knl/Queue.h>
 
+#include <ti/drivers/Power.h>
+#include <ti/drivers/power/PowerCC26XX.h>
+#include <driverlib/aon_rtc.h>
+
 #include "hci_tl.h"
 #include "gatt.h"
 #include "linkdb.h"
@@ -56,6 +60,7 @@
 #include "gattservapp.h"
 #include "devinfoservice.h"
 #include "simple_gatt_profile.h"
+#include "throughput_service.h"
 
 #if defined(FEATURE_OAD) || defined(IMAGE_INVALIDATE)
 #include "oad_target.h"
@@ -125,8 +130,9 @@
 // Connection Pause Peripheral time value (in seconds)
 #define DEFAULT_CONN_PAUSE_PERIPHERAL         2
 
-// How often to perform periodic event (in msec)
-#define SBP_PERIODIC_EVT_PERIOD               DEFAULT_DESIRED_MIN_CONN_INTERVAL+2
+// How often to perform periodic event (in msec). The periodic event reports
+// the throughput, awake time and estimated energy of the last period.
+#define SBP_PERIODIC_EVT_PERIOD               1000
 
 #ifdef FEATURE_OAD
 // The size of an OAD packet.
@@ -147,6 +153,8 @@
 #define SBP_PERIODIC_EVT                      0x0004
 #define SBP_CONN_EVT_END_EVT                  0x0008
 #define SBP_KEY_CHANGE_EVT                    0x0010
+#define SBP_PUMP_EVT                          0x0020
+#define SBP_ECHO_CHANGE_EVT                   0x0040
 
 #define DLE_MAX_PDU_SIZE 251
 #define DLE_MAX_TX_TIME 2120
@@ -160,6 +168,39 @@
 // GATT notifications for throughput example don't require an authenticated link
 #define GATT_NO_AUTHENTICATION 0
 
+// Handle of the Simple Profile characteristic 4 value, the notifications
+// carry the throughput data
+#define SBP_THROUGHPUT_NOTI_HANDLE 0x1E
+
+// Default notification payload, one full L2CAP PDU minus the ATT and L2CAP
+// headers. A peer can pick a shorter one by writing characteristic 3.
+#define SBP_THROUGHPUT_NOTI_LEN (MAX_PDU_SIZE - TOTAL_PACKET_OVERHEAD)
+
+// Shortest notification payload, room for the message counter
+#define SBP_THROUGHPUT_NOTI_MIN_LEN 4
+
+// ATT notification header (opcode and handle)
+#define ATT_NOTI_HDR_SIZE 3
+
+// LL packet overhead on air (preamble, access address, header, MIC, CRC) in
+// bytes, and the time around each packet spent on inter frame spaces and the
+// master's empty packet (in usec)
+#define LL_PACKET_OVERHEAD 14
+#define LL_PACKET_TURNAROUND_US (150 + 80 + 150)
+
+// Drain ticks in a row that may free no buffer before the pump stops polling
+// and waits for the next connection event end. Covers the gap between two
+// connection events.
+#define SBP_PUMP_MAX_IDLE_TICKS 2
+
+// Typical currents (in uA) and supply voltage (in mV) used for the energy
+// estimate, see the CC2640 datasheet. The estimate charges the whole awake
+// time at the active MCU current, measure with EnergyTrace for exact numbers.
+#define SBP_EST_MCU_ACTIVE_UA 2900
+#define SBP_EST_RADIO_TX_UA   6100
+#define SBP_EST_RADIO_RX_UA   5900
+#define SBP_EST_VDD_MV        3000
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -200,6 +241,7 @@ static ICall_Semaphore sem;
 
 // Clock instances for internal periodic events.
 static Clock_Struct periodicClock;
+static Clock_Struct pumpClock;
 
 // Queue object used for app messages
 static Queue_Struct appMsg;
@@ -301,6 +343,29 @@ static uint8_t rspTxRetry = 0;
 static uint16_t txOctets = DEFAULT_PDU_SIZE;
 static uint16_t txTime   = DEFAULT_TX_TIME;
 
+// Notification pump state
+static bool pumpActive = FALSE;
+static uint16_t pumpConnHandle = GAP_CONNHANDLE_INIT;
+static uint8_t pumpIdleTicks = 0;
+
+// The peer measures latency, the pump holds off so probes are answered on
+// an otherwise idle link
+static bool echoActive = FALSE;
+
+// Notification payload asked for by the peer, and what the ATT MTU allows
+static uint16_t notiLenReq = SBP_THROUGHPUT_NOTI_LEN;
+static uint16_t notiLen = SBP_THROUGHPUT_NOTI_LEN;
+static uint16_t attMtu = ATT_MTU_SIZE;
+
+// Notifications and payload bytes queued in the current report period
+static uint32_t notiSent = 0;
+static uint32_t notiBytes = 0;
+
+// Time spent in standby, in AON RTC units (1/65536 s)
+static Power_NotifyObj standbyNotifyObj;
+static uint32_t standbyEnter = 0;
+static uint32_t standbyTime = 0;
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -313,6 +378,7 @@ static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg);
 static void SimpleBLEPeripheral_processAppMsg(sbpEvt_t *pMsg);
 static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState);
 static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID);
+static void SimpleBLEPeripheral_processEchoChangeEvt(uint8_t paramID);
 static void SimpleBLEPeripheral_performPeriodicTask(void);
 static void SimpleBLEPeripheral_clockHandler(UArg arg);
 
@@ -323,6 +389,7 @@ static void SimpleBLEPeripheral_stateChangeCB(gaprole_States_t newState);
 #ifndef FEATURE_OAD_ONCHIP
 static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID);
 #endif //!FEATURE_OAD_ONCHIP
+static void SimpleBLEPeripheral_echoChangeCB(uint8_t paramID);
 static void SimpleBLEPeripheral_enqueueMsg(uint8_t event, uint8_t state);
 
 #ifdef FEATURE_OAD
@@ -333,7 +400,16 @@ void SimpleBLEPeripheral_processOadWriteCB(uint8_t event, uint16_t connHandle,
 void SimpleBLEPeripheral_keyChangeHandler(uint8 keys);
 static void SimpleBLEPeripheral_handleKeys(uint8_t shift, uint8_t keys);
 
-static void SimpleBLEPeripheral_blastData();
+static void SimpleBLEPeripheral_startPump(uint16_t connHandle);
+static void SimpleBLEPeripheral_stopPump(void);
+static void SimpleBLEPeripheral_runPump(bool connEvtEnd);
+static uint8_t SimpleBLEPeripheral_fillTxBuffers(void);
+static uint32_t SimpleBLEPeripheral_drainTicks(void);
+static void SimpleBLEPeripheral_setNotiLen(uint16_t len);
+static void SimpleBLEPeripheral_setDataLen(uint16_t octets);
+static uint8_t SimpleBLEPeripheral_standbyNotifyCB(uint8_t eventType,
+                                                   uint32_t *eventArg,
+                                                   uint32_t *clientArg);
 
 /*********************************************************************
  * PROFILE CALLBACKS
@@ -360,6 +436,12 @@ static simpleProfileCBs_t SimpleBLEPeripheral_simpleProfileCBs =
 };
 #endif //!FEATURE_OAD_ONCHIP
 
+// Throughput Service Callbacks
+static ThroughputServiceCBs_t SimpleBLEPeripheral_throughputServiceCBs =
+{
+  SimpleBLEPeripheral_echoChangeCB // Echo probe and configuration callback
+};
+
 #ifdef FEATURE_OAD
 static oadTargetCBs_t simpleBLEPeripheral_oadCBs =
 {
@@ -425,9 +507,19 @@ static void SimpleBLEPeripheral_init(void)
   // Create an RTOS queue for message from profile to be sent to app.
   appMsgQueue = Util_constructQueue(&appMsg);
 
-  // Create one-shot clocks for internal periodic events.
+  // Create a periodic clock for the throughput report and a one-shot clock
+  // pacing the notification pump while the controller drains its buffers.
   Util_constructClock(&periodicClock, SimpleBLEPeripheral_clockHandler,
-                      SBP_PERIODIC_EVT_PERIOD, 0, false, SBP_PERIODIC_EVT);
+                      SBP_PERIODIC_EVT_PERIOD, SBP_PERIODIC_EVT_PERIOD, false,
+                      SBP_PERIODIC_EVT);
+  Util_constructClock(&pumpClock, SimpleBLEPeripheral_clockHandler,
+                      1, 0, false, SBP_PUMP_EVT);
+
+  // Account for the time spent in standby
+  Power_registerNotify(&standbyNotifyObj,
+                       PowerCC26XX_ENTERING_STANDBY | PowerCC26XX_AWAKE_STANDBY,
+                       (Power_NotifyFxn)SimpleBLEPeripheral_standbyNotifyCB,
+                       NULL);
 
   dispHandle = Display_open(Display_Type_LCD, NULL);
   if(dispHandle == NULL)
@@ -528,6 +620,12 @@ static void SimpleBLEPeripheral_init(void)
   Reset_addService();
 #endif //IMAGE_INVALIDATE
 
+  // Sink for the central's writes in full duplex mode and echo of its
+  // latency probes. Added last so the SimpleProfile handles
+  // (SBP_THROUGHPUT_NOTI_HANDLE) stay where they are.
+  ThroughputService_AddService();
+  ThroughputService_RegisterAppCBs(&SimpleBLEPeripheral_throughputServiceCBs);
+
 
 #ifndef FEATURE_OAD_ONCHIP
   // Setup the SimpleProfile Characteristic Values
@@ -606,7 +704,7 @@ static void SimpleBLEPeripheral_taskFxn(UArg a0, UArg a1)
     // Note that the semaphore associated with a thread is signaled when a
     // message is queued to the message receive queue of the thread or when
     // ICall_signal() function is called onto the semaphore.
-    ICall_Errno errno = ICall_wait(0);
+    ICall_Errno errno = ICall_wait(ICALL_TIMEOUT_FOREVER);
 
     if (errno == ICALL_ERRNO_SUCCESS)
     {
@@ -630,6 +728,9 @@ static void SimpleBLEPeripheral_taskFxn(UArg a0, UArg a1)
             {
               // Try to retransmit pending ATT Response (if any)
               SimpleBLEPeripheral_sendAttRsp();
+
+              // Refill the buffers the connection event has freed
+              SimpleBLEPeripheral_runPump(TRUE);
             }
           }
           else
@@ -660,12 +761,17 @@ static void SimpleBLEPeripheral_taskFxn(UArg a0, UArg a1)
       }
     }
 
+    if (events & SBP_PUMP_EVT)
+    {
+      events &= ~SBP_PUMP_EVT;
+
+      SimpleBLEPeripheral_runPump(FALSE);
+    }
+
     if (events & SBP_PERIODIC_EVT)
     {
       events &= ~SBP_PERIODIC_EVT;
 
-      //Util_startClock(&periodicClock);
-
       // Perform periodic application task
       SimpleBLEPeripheral_performPeriodicTask();
     }
@@ -778,8 +884,11 @@ static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg)
     // MTU size updated
     Display_print1(dispHandle, 4, 0, "MTU Size: %d", pMsg->msg.mtuEvt.MTU);
 
-    // Fall into SimpleBLEPeripheral_blastData function for throughput testing
-    SimpleBLEPeripheral_blastData();
+    attMtu = pMsg->msg.mtuEvt.MTU;
+    SimpleBLEPeripheral_setNotiLen(notiLenReq);
+
+    // Start streaming notifications for throughput testing
+    SimpleBLEPeripheral_startPump(pMsg->connHandle);
   }
 
   // Free message payload. Needed only for ATT Protocol messages
@@ -813,8 +922,11 @@ static void SimpleBLEPeripheral_sendAttRsp(void)
     status = GATT_SendRsp(pAttRsp->connHandle, pAttRsp->method, &(pAttRsp->msg));
     if ((status != blePending) && (status != MSG_BUFFER_NOT_AVAIL))
     {
-      // Disable connection event end notice
-      HCI_EXT_ConnEventNoticeCmd(pAttRsp->connHandle, selfEntity, 0);
+      // Disable connection event end notice, unless the pump still needs it
+      if (!pumpActive)
+      {
+        HCI_EXT_ConnEventNoticeCmd(pAttRsp->connHandle, selfEntity, 0);
+      }
 
       // We're done with the response message
       SimpleBLEPeripheral_freeAttRsp(status);
@@ -885,6 +997,10 @@ static void SimpleBLEPeripheral_processAppMsg(sbpEvt_t *pMsg)
       SimpleBLEPeripheral_processCharValueChangeEvt(pMsg->hdr.state);
       break;
 
+    case SBP_ECHO_CHANGE_EVT:
+      SimpleBLEPeripheral_processEchoChangeEvt(pMsg->hdr.state);
+      break;
+
     case SBP_KEY_CHANGE_EVT:
       SimpleBLEPeripheral_handleKeys(0, pMsg->hdr.state);
       break;
@@ -982,6 +1098,7 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
         // Reset flag for next connection.
         firstConnFlag = false;
 
+        SimpleBLEPeripheral_stopPump();
         SimpleBLEPeripheral_freeAttRsp(bleNotConnected);
       }
       break;
@@ -1025,7 +1142,7 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
       break;
 
     case GAPROLE_WAITING:
-      Util_stopClock(&periodicClock);
+      SimpleBLEPeripheral_stopPump();
       SimpleBLEPeripheral_freeAttRsp(bleNotConnected);
 
       Display_print0(dispHandle, 2, 0, "Disconnected");
@@ -1035,6 +1152,7 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
       break;
 
     case GAPROLE_WAITING_AFTER_TIMEOUT:
+      SimpleBLEPeripheral_stopPump();
       SimpleBLEPeripheral_freeAttRsp(bleNotConnected);
 
       Display_print0(dispHandle, 2, 0, "Timed Out");
@@ -1078,6 +1196,21 @@ static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID)
 }
 #endif //!FEATURE_OAD_ONCHIP
 
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_echoChangeCB
+ *
+ * @brief   Callback from the Throughput Service indicating a latency
+ *          probe or a change of the echo configuration.
+ *
+ * @param   paramID - THROUGHPUTSERVICE_ECHO or THROUGHPUTSERVICE_ECHO_CFG
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_echoChangeCB(uint8_t paramID)
+{
+  SimpleBLEPeripheral_enqueueMsg(SBP_ECHO_CHANGE_EVT, paramID);
+}
+
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_processCharValueChangeEvt
  *
@@ -1096,15 +1229,18 @@ static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID)
   switch(paramID)
   {
     case SIMPLEPROFILE_CHAR1:
+      // LL PDU size (TX octets) to use, see SimpleBLEPeripheral_setDataLen
       SimpleProfile_GetParameter(SIMPLEPROFILE_CHAR1, &newValue);
 
-      Display_print1(dispHandle, 4, 0, "Char 1: %d", (uint16_t)newValue);
+      SimpleBLEPeripheral_setDataLen(newValue);
       break;
 
     case SIMPLEPROFILE_CHAR3:
+      // Notification payload length, 0 for as much as the MTU allows
       SimpleProfile_GetParameter(SIMPLEPROFILE_CHAR3, &newValue);
 
-      Display_print1(dispHandle, 4, 0, "Char 3: %d", (uint16_t)newValue);
+      SimpleBLEPeripheral_setNotiLen(newValue ? newValue :
+                                     SBP_THROUGHPUT_NOTI_LEN);
       break;
 
     default:
@@ -1114,14 +1250,53 @@ static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID)
 #endif //!FEATURE_OAD_ONCHIP
 }
 
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_processEchoChangeEvt
+ *
+ * @brief   Answer a latency probe, or pause and resume the notification
+ *          pump as the peer turns echo notifications on and off.
+ *
+ * @param   paramID - THROUGHPUTSERVICE_ECHO or THROUGHPUTSERVICE_ECHO_CFG
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_processEchoChangeEvt(uint8_t paramID)
+{
+  uint16_t connectionHandle;
+
+  switch(paramID)
+  {
+    case THROUGHPUTSERVICE_ECHO:
+      // A probe that can't go out now is timed out by the peer
+      VOID ThroughputService_SendEcho();
+      break;
+
+    case THROUGHPUTSERVICE_ECHO_CFG:
+      GAPRole_GetParameter(GAPROLE_CONNHANDLE, &connectionHandle);
+      echoActive = ThroughputService_EchoEnabled(connectionHandle);
+
+      Display_print1(dispHandle, 5, 0, "Echo: %d", echoActive);
+
+      if (!echoActive)
+      {
+        SimpleBLEPeripheral_runPump(TRUE);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_performPeriodicTask
  *
  * @brief   Perform a periodic application task. This function gets called
- *          every five seconds (SBP_PERIODIC_EVT_PERIOD). In this example,
- *          the value of the third characteristic in the SimpleGATTProfile
- *          service is retrieved from the profile, and then copied into the
- *          value of the the fourth characteristic.
+ *          every second (SBP_PERIODIC_EVT_PERIOD) while the pump runs and
+ *          reports the throughput of the last period, notifications sent
+ *          and central writes received, together with what each kilobyte
+ *          cost: the time the device was awake, and an estimate of the
+ *          energy spent by the MCU and the radio.
  *
  * @param   None.
  *
@@ -1129,7 +1304,78 @@ static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID)
  */
 static void SimpleBLEPeripheral_performPeriodicTask(void)
 {
-  asm(" NOP ");
+  uint32_t bytes;
+  uint32_t count;
+  uint32_t rxBytes;
+  uint32_t rxCount;
+  uint32_t pduLen;
+  uint32_t awakeUs;
+  uint32_t airTxUs;
+  uint32_t airRxUs;
+  uint32_t frags;
+  uint64_t chargePc;
+  uint32_t sleep;
+  uint32_t key;
+
+  // Collect and restart the counters of this period
+  key = ICall_enterCriticalSection();
+  sleep = standbyTime;
+  standbyTime = 0;
+  ICall_leaveCriticalSection(key);
+
+  bytes = notiBytes;
+  count = notiSent;
+  notiBytes = 0;
+  notiSent = 0;
+
+  // Writes of the central in full duplex mode
+  rxBytes = ThroughputService_TakeSinkBytes(&rxCount);
+
+  // Awake time is the part of the period not spent in standby
+  sleep = (uint32_t)(((uint64_t)sleep * 1000000) >> 16);
+  awakeUs = (uint32_t)SBP_PERIODIC_EVT_PERIOD * 1000;
+  awakeUs = (sleep < awakeUs) ? (awakeUs - sleep) : 0;
+
+  // Air time of the notifications, each split into LL packets of txOctets
+  pduLen = notiLen + TOTAL_PACKET_OVERHEAD;
+  frags = (pduLen + txOctets - 1) / txOctets;
+  airTxUs = count * (pduLen + frags * LL_PACKET_OVERHEAD) * 8;
+  airRxUs = count * frags * LL_PACKET_TURNAROUND_US;
+
+  // Same for the writes received, assuming the central uses our LL size
+  if (rxCount)
+  {
+    pduLen = rxBytes + rxCount * TOTAL_PACKET_OVERHEAD;
+    frags = (pduLen + txOctets - 1) / txOctets;
+    airRxUs += (pduLen + frags * LL_PACKET_OVERHEAD) * 8;
+    airTxUs += frags * LL_PACKET_TURNAROUND_US;
+  }
+
+  // uA * us = pC, pC * mV = fJ, 1e9 fJ = 1 uJ
+  chargePc = (uint64_t)awakeUs * SBP_EST_MCU_ACTIVE_UA +
+             (uint64_t)airTxUs * SBP_EST_RADIO_TX_UA +
+             (uint64_t)airRxUs * SBP_EST_RADIO_RX_UA;
+
+  Display_print3(dispHandle, 6, 0, "Tx:%d Rx:%d Sum:%d",
+                 bytes * 1000 / SBP_PERIODIC_EVT_PERIOD,
+                 rxBytes * 1000 / SBP_PERIODIC_EVT_PERIOD,
+                 (bytes + rxBytes) * 1000 / SBP_PERIODIC_EVT_PERIOD);
+
+  // Cost is per kilobyte carried in either direction
+  bytes += rxBytes;
+
+  if (bytes)
+  {
+    // Per kilobyte: awake time in us and energy in uJ
+    Display_print2(dispHandle, 7, 0, "us/KB: %d uJ/KB: %d",
+                   (uint32_t)((uint64_t)awakeUs * 1024 / bytes),
+                   (uint32_t)(chargePc * SBP_EST_VDD_MV * 1024 / bytes /
+                              1000000000));
+  }
+  else
+  {
+    Display_clearLine(dispHandle, 7);
+  }
 }
 
 
@@ -1258,23 +1504,7 @@ static void SimpleBLEPeripheral_handleKeys(uint8_t shift, uint8_t keys)
     // Only toggle size once for now
     if(DEFAULT_PDU_SIZE == txOctets)
     {
-      txOctets = DLE_MAX_PDU_SIZE;
-      txTime = DLE_MAX_TX_TIME;
-
-      uint16_t connectionHandle;
-      uint8_t gapRoleState;
-      GAPRole_GetParameter(GAPROLE_STATE, &gapRoleState);
-      GAPRole_GetParameter(GAPROLE_CONNHANDLE, &connectionHandle);
-
-      if(GAPROLE_CONNECTED == gapRoleState)
-      {
-        HCI_LE_SetDataLenCmd(connectionHandle,
-                             txOctets,
-                             txTime );
-
-        // Print the results to the screen
-        Display_print1(dispHandle, 5, 0, "DLE Payload size: %d", txOctets);
-      }
+      SimpleBLEPeripheral_setDataLen(DLE_MAX_PDU_SIZE);
     }
     return;
   }
@@ -1288,80 +1518,290 @@ static void SimpleBLEPeripheral_handleKeys(uint8_t shift, uint8_t keys)
 }
 
 /*********************************************************************
- * @fn      SimpleBLEPeripheral_blastData
+ * @fn      SimpleBLEPeripheral_startPump
+ *
+ * @brief   Start streaming notifications on a connection. The buffers are
+ *          filled right away and refilled whenever a connection event ends
+ *          or the controller had time to drain part of them. In between the
+ *          task blocks, so the device can sleep.
+ *
+ * @param   connHandle - connection to stream on
+ *
+ * @return  none
+ */
+static void SimpleBLEPeripheral_startPump(uint16_t connHandle)
+{
+  if (pumpActive)
+  {
+    return;
+  }
+
+  // Get notified at the end of every connection event
+  if (HCI_EXT_ConnEventNoticeCmd(connHandle, selfEntity,
+                                 SBP_CONN_EVT_END_EVT) != SUCCESS)
+  {
+    return;
+  }
+
+  pumpActive = TRUE;
+  pumpConnHandle = connHandle;
+
+  // Start a fresh report period
+  {
+    uint32_t key = ICall_enterCriticalSection();
+
+    standbyTime = 0;
+    ICall_leaveCriticalSection(key);
+  }
+  notiSent = 0;
+  notiBytes = 0;
+  VOID ThroughputService_TakeSinkBytes(NULL);
+
+  Util_startClock(&periodicClock);
+
+  SimpleBLEPeripheral_runPump(TRUE);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_stopPump
  *
- * @brief   Sends ATT notifications in a tight while loop to demo
- *          throughput
+ * @brief   Stop streaming notifications, the link is gone.
  *
  * @param   none
  *
  * @return  none
  */
-static void SimpleBLEPeripheral_blastData()
+static void SimpleBLEPeripheral_stopPump(void)
 {
-  // Subtract the total packet overhead of ATT and L2CAP layer from notification payload
-  uint16_t len = MAX_PDU_SIZE-TOTAL_PACKET_OVERHEAD;
-  attHandleValueNoti_t noti;
-  bStatus_t status;
-  noti.handle = 0x1E;
-  noti.len = len;
+  pumpActive = FALSE;
+  pumpConnHandle = GAP_CONNHANDLE_INIT;
+
+  // The next link starts over with default packet and MTU sizes
+  txOctets = DEFAULT_PDU_SIZE;
+  txTime = DEFAULT_TX_TIME;
+  attMtu = ATT_MTU_SIZE;
+  notiLenReq = SBP_THROUGHPUT_NOTI_LEN;
+  echoActive = FALSE;
+
+  Util_stopClock(&pumpClock);
+  Util_stopClock(&periodicClock);
+  events &= ~(SBP_PUMP_EVT | SBP_PERIODIC_EVT);
+}
 
-  // Store hte connection handle for future reference
-  uint16_t connectionHandle;
-  GAPRole_GetParameter(GAPROLE_CONNHANDLE, &connectionHandle);
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_runPump
+ *
+ * @brief   Refill the controller buffers and decide when to look again.
+ *          While buffers get freed the pump checks back after the time
+ *          the controller needs to send half of them. Once a few checks
+ *          in a row find nothing freed, the connection event is over and
+ *          the pump waits for the next connection event end instead.
+ *
+ * @param   connEvtEnd - TRUE if called for a connection event end
+ *
+ * @return  none
+ */
+static void SimpleBLEPeripheral_runPump(bool connEvtEnd)
+{
+  if (!pumpActive || echoActive)
+  {
+    return;
+  }
 
-  while(1)
+  if (SimpleBLEPeripheral_fillTxBuffers() || connEvtEnd)
   {
-    // If RTOS queue is not empty, process app message.
-    // We need to process the app message here in the case of a keypress
-    while (!Queue_empty(appMsgQueue))
-    {
-      sbpEvt_t *pMsg = (sbpEvt_t *)Util_dequeueMsg(appMsgQueue);
-      if (pMsg)
-      {
-        // Process message.
-        SimpleBLEPeripheral_processAppMsg(pMsg);
+    pumpIdleTicks = 0;
+  }
+  else if (++pumpIdleTicks >= SBP_PUMP_MAX_IDLE_TICKS)
+  {
+    // Nothing drains, sleep until the next connection event ends
+    return;
+  }
 
-        // Free the space from the message.
-        ICall_free(pMsg);
-      }
-    }
+  if (!Util_isActive(&pumpClock))
+  {
+    Clock_setTimeout(Clock_handle(&pumpClock),
+                     SimpleBLEPeripheral_drainTicks());
+    Clock_start(Clock_handle(&pumpClock));
+  }
+}
 
-    noti.pValue = (uint8 *)GATT_bm_alloc( connectionHandle, ATT_HANDLE_VALUE_NOTI, GATT_MAX_MTU, &len );
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_fillTxBuffers
+ *
+ * @brief   Queue notifications until the stack runs out of buffers.
+ *          Each carries msg_counter in its first four bytes (big endian),
+ *          followed by the pattern (msg_counter + i) & 0xFF in byte i so
+ *          the receiver can check the payload.
+ *
+ * @param   none
+ *
+ * @return  number of notifications queued
+ */
+static uint8_t SimpleBLEPeripheral_fillTxBuffers(void)
+{
+  attHandleValueNoti_t noti;
+  uint8_t queued = 0;
+  uint16_t i;
 
-    if ( noti.pValue != NULL ) //if allocated
+  noti.handle = SBP_THROUGHPUT_NOTI_HANDLE;
+  noti.len = notiLen;
+
+  for (;;)
+  {
+    noti.pValue = (uint8 *)GATT_bm_alloc(pumpConnHandle, ATT_HANDLE_VALUE_NOTI,
+                                         notiLen, NULL);
+    if (noti.pValue == NULL)
     {
+      // bleNoResources, wait for the controller to free some
+      break;
+    }
 
-      // Place index
-      noti.pValue[0] = (msg_counter >> 24) & 0xFF;
-      noti.pValue[1] = (msg_counter >> 16) & 0xFF;
-      noti.pValue[2] = (msg_counter >> 8) & 0xFF;
-      noti.pValue[3] = msg_counter & 0xFF;
+    // Place index
+    noti.pValue[0] = (msg_counter >> 24) & 0xFF;
+    noti.pValue[1] = (msg_counter >> 16) & 0xFF;
+    noti.pValue[2] = (msg_counter >> 8) & 0xFF;
+    noti.pValue[3] = msg_counter & 0xFF;
 
-      // Attempt to send the notification
-      status = GATT_Notification( connectionHandle, &noti, GATT_NO_AUTHENTICATION);
-      if ( status != SUCCESS ) //if noti not sent
-      {
-        PIN_setOutputValue(hSbpPins, Board_LED1 , Board_LED_ON);
-        GATT_bm_free( (gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI );
-      }
-      else
-      {
-        // Notification is successfully sent, increment counters
-        PIN_setOutputValue(hSbpPins, Board_LED2 , Board_LED_ON);
-        msg_counter++;
-      }
+    // Fill the rest with the check pattern
+    for (i = SBP_THROUGHPUT_NOTI_MIN_LEN; i < notiLen; i++)
+    {
+      noti.pValue[i] = (uint8_t)(msg_counter + i);
     }
-    else
+
+    // Attempt to send the notification
+    if (GATT_Notification(pumpConnHandle, &noti,
+                          GATT_NO_AUTHENTICATION) != SUCCESS)
     {
-      // bleNoResources was returned
-      asm(" NOP ");
+      PIN_setOutputValue(hSbpPins, Board_LED1, Board_LED_ON);
+      GATT_bm_free((gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI);
+      break;
     }
 
-    // Reset debug pins
-    PIN_setOutputValue(hSbpPins, Board_LED1 , Board_LED_OFF);
-    PIN_setOutputValue(hSbpPins, Board_LED2 , Board_LED_OFF);
+    // Notification is successfully queued, increment counters
+    msg_counter++;
+    notiSent++;
+    notiBytes += notiLen;
+    queued++;
   }
+
+  // LED2 lit while data flows, LED1 when the queue was full
+  PIN_setOutputValue(hSbpPins, Board_LED2, queued ? Board_LED_ON : Board_LED_OFF);
+  PIN_setOutputValue(hSbpPins, Board_LED1, Board_LED_OFF);
+
+  return queued;
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_drainTicks
+ *
+ * @brief   Time the controller needs to send half of its buffers with
+ *          the current LL packet length, so the queue never runs empty
+ *          while the pump sleeps.
+ *
+ * @param   none
+ *
+ * @return  clock ticks
+ */
+static uint32_t SimpleBLEPeripheral_drainTicks(void)
+{
+  uint32_t pduLen = notiLen + TOTAL_PACKET_OVERHEAD;
+  uint32_t frags = (pduLen + txOctets - 1) / txOctets;
+  uint32_t us = frags * (txTime + LL_PACKET_TURNAROUND_US) * (MAX_NUM_PDU / 2);
+  uint32_t ticks = us / Clock_tickPeriod;
+
+  return ticks ? ticks : 1;
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_setNotiLen
+ *
+ * @brief   Set the notification payload length, limited to what fits in
+ *          the ATT MTU and to at least the message counter.
+ *
+ * @param   len - requested payload length in bytes
+ *
+ * @return  none
+ */
+static void SimpleBLEPeripheral_setNotiLen(uint16_t len)
+{
+  notiLenReq = len;
+
+  if (len > attMtu - ATT_NOTI_HDR_SIZE)
+  {
+    len = attMtu - ATT_NOTI_HDR_SIZE;
+  }
+  if (len < SBP_THROUGHPUT_NOTI_MIN_LEN)
+  {
+    len = SBP_THROUGHPUT_NOTI_MIN_LEN;
+  }
+  notiLen = len;
+
+  Display_print1(dispHandle, 5, 0, "Noti len: %d", notiLen);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_setDataLen
+ *
+ * @brief   Ask the controller to use a LL PDU size (TX octets) on the
+ *          current connection. The TX time follows from the size.
+ *
+ * @param   octets - 27 to 251, anything else is ignored
+ *
+ * @return  none
+ */
+static void SimpleBLEPeripheral_setDataLen(uint16_t octets)
+{
+  uint16_t connectionHandle;
+  uint8_t gapRoleState;
+
+  if ((octets < DEFAULT_PDU_SIZE) || (octets > DLE_MAX_PDU_SIZE))
+  {
+    return;
+  }
+
+  GAPRole_GetParameter(GAPROLE_STATE, &gapRoleState);
+  GAPRole_GetParameter(GAPROLE_CONNHANDLE, &connectionHandle);
+
+  if (GAPROLE_CONNECTED == gapRoleState)
+  {
+    txOctets = octets;
+    txTime = (octets + LL_PACKET_OVERHEAD) * 8;
+
+    HCI_LE_SetDataLenCmd(connectionHandle, txOctets, txTime);
+
+    // Print the results to the screen
+    Display_print1(dispHandle, 5, 0, "DLE Payload size: %d", txOctets);
+  }
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_standbyNotifyCB
+ *
+ * @brief   Power driver callback keeping track of the time spent in
+ *          standby, measured with the always on RTC.
+ *
+ * @param   eventType - The state change.
+ * @param   eventArg  - Not used.
+ * @param   clientArg - Not used.
+ *
+ * @return  Power_NOTIFYDONE to indicate success.
+ */
+static uint8_t SimpleBLEPeripheral_standbyNotifyCB(uint8_t eventType,
+                                                   uint32_t *eventArg,
+                                                   uint32_t *clientArg)
+{
+  if (eventType == PowerCC26XX_ENTERING_STANDBY)
+  {
+    standbyEnter = AONRTCCurrentCompareValueGet();
+  }
+  else if (eventType == PowerCC26XX_AWAKE_STANDBY)
+  {
+    standbyTime += AONRTCCurrentCompareValueGet() - standbyEnter;
+  }
+
+  // Notification handled successfully
+  return Power_NOTIFYDONE;
 }
 /*********************************************************************
 *********************************************************************/
@@ -0,0 +1,395 @@
+/*
+ * Filename: link_tune.c
+ *
+ * Description: Link tuning for the SPP examples. Negotiates the ATT
+ * MTU and data length extension on every new link and reports the payload
+ * size the application should send in.
+ *
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "bcomdef.h"
+#include "hci.h"
+#include "l2cap.h"
+#include "att.h"
+#include "gatt.h"
+#include "icall.h"
+#include "icall_apimsg.h"
+
+#include "link_tune.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// ATT MTU requested from the peer, as large as the stack's PDU buffers
+#ifdef MAX_PDU_SIZE
+#define LINKTUNE_REQ_MTU                        (MAX_PDU_SIZE - L2CAP_HDR_SIZE)
+#else
+#define LINKTUNE_REQ_MTU                        ATT_MTU_SIZE
+#endif
+
+// Link layer payload before data length extension
+#define LINKTUNE_DEFAULT_OCTETS                 27
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static ICall_EntityID linkTuneEntity;
+static linkTuneCB_t linkTuneCB = NULL;
+
+// One entry per link being tuned, free while connHandle is invalid
+static linkTuneResult_t linkTuneResult[LINKTUNE_MAX_CONNS];
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static linkTuneResult_t *LinkTune_find(uint16 connHandle);
+static void LinkTune_reset(linkTuneResult_t *pResult, uint16 connHandle);
+static void LinkTune_setMTU(linkTuneResult_t *pResult, uint16 mtu);
+static void LinkTune_report(linkTuneResult_t *pResult);
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      LinkTune_Init
+ *
+ * @brief   Register the application task and callback.
+ *
+ * @param   taskEntity - ICall entity ATT responses are sent to
+ * @param   pfnCB - called whenever the link parameters change
+ *
+ * @return  None
+ */
+void LinkTune_Init(ICall_EntityID taskEntity, linkTuneCB_t pfnCB)
+{
+  uint8 i;
+
+  linkTuneEntity = taskEntity;
+  linkTuneCB = pfnCB;
+
+  for (i = 0; i < LINKTUNE_MAX_CONNS; i++)
+  {
+    LinkTune_reset(&linkTuneResult[i], INVALID_CONNHANDLE);
+  }
+}
+
+/*********************************************************************
+ * @fn      LinkTune_Start
+ *
+ * @brief   Request the largest ATT MTU and data length on a new link.
+ *
+ * @param   connHandle - new link
+ *
+ * @return  SUCCESS, bleNoResources when all entries are taken, or the
+ *          status of the first request that failed
+ */
+bStatus_t LinkTune_Start(uint16 connHandle)
+{
+  attExchangeMTUReq_t req;
+  linkTuneResult_t *pResult;
+  bStatus_t status = SUCCESS;
+
+  // Restart tuning of a known link, otherwise take a free entry
+  pResult = LinkTune_find(connHandle);
+  if (pResult == NULL)
+  {
+    pResult = LinkTune_find(INVALID_CONNHANDLE);
+    if (pResult == NULL)
+    {
+      return (bleNoResources);
+    }
+  }
+
+  LinkTune_reset(pResult, connHandle);
+
+  // Controller answers with a data length change event, if the peer agrees
+  // to anything other than the defaults
+  if (HCI_LE_SetDataLenCmd(connHandle, LINKTUNE_TX_OCTETS,
+                           LINKTUNE_TX_TIME) == SUCCESS)
+  {
+    pResult->pending |= LINKTUNE_PENDING_DLE;
+  }
+  else
+  {
+    status = FAILURE;
+  }
+
+  if (LINKTUNE_REQ_MTU > ATT_MTU_SIZE)
+  {
+    req.clientRxMTU = LINKTUNE_REQ_MTU;
+
+    if (GATT_ExchangeMTU(connHandle, &req, linkTuneEntity) == SUCCESS)
+    {
+      pResult->pending |= LINKTUNE_PENDING_MTU;
+    }
+    else if (status == SUCCESS)
+    {
+      // The peer may already have started its own exchange, its result
+      // still arrives as ATT_MTU_UPDATED_EVENT
+      status = FAILURE;
+    }
+  }
+
+  // Application can start sending with the defaults straight away
+  LinkTune_report(pResult);
+
+  return (status);
+}
+
+/*********************************************************************
+ * @fn      LinkTune_Stop
+ *
+ * @brief   Forget the link.
+ *
+ * @param   connHandle - terminated link
+ *
+ * @return  None
+ */
+void LinkTune_Stop(uint16 connHandle)
+{
+  linkTuneResult_t *pResult;
+
+  if (connHandle == INVALID_CONNHANDLE)
+  {
+    return;
+  }
+
+  pResult = LinkTune_find(connHandle);
+  if (pResult != NULL)
+  {
+    LinkTune_reset(pResult, INVALID_CONNHANDLE);
+  }
+}
+
+/*********************************************************************
+ * @fn      LinkTune_ProcessGATTMsg
+ *
+ * @brief   Pick the MTU exchange results out of a GATT message.
+ *
+ * @param   pMsg - GATT message received by the application
+ *
+ * @return  TRUE if the message was an MTU exchange response for a
+ *          tuned link and needs no further processing
+ */
+uint8 LinkTune_ProcessGATTMsg(gattMsgEvent_t *pMsg)
+{
+  linkTuneResult_t *pResult;
+
+  if (pMsg->connHandle == INVALID_CONNHANDLE)
+  {
+    return (FALSE);
+  }
+
+  pResult = LinkTune_find(pMsg->connHandle);
+  if (pResult == NULL)
+  {
+    return (FALSE);
+  }
+
+  if (pMsg->method == ATT_MTU_UPDATED_EVENT)
+  {
+    // Sent whichever side started the exchange
+    LinkTune_setMTU(pResult, pMsg->msg.mtuEvt.MTU);
+  }
+  else if (pMsg->method == ATT_EXCHANGE_MTU_RSP)
+  {
+    // Effective MTU is the smaller of the two sides
+    LinkTune_setMTU(pResult, MIN(pMsg->msg.exchangeMTURsp.serverRxMTU,
+                                 LINKTUNE_REQ_MTU));
+    return (TRUE);
+  }
+  else if ((pMsg->method == ATT_ERROR_RSP) &&
+           (pMsg->msg.errorRsp.reqOpcode == ATT_EXCHANGE_MTU_REQ))
+  {
+    // Peer refused, the link stays at the default MTU
+    LinkTune_setMTU(pResult, ATT_MTU_SIZE);
+    return (TRUE);
+  }
+
+  return (FALSE);
+}
+
+/*********************************************************************
+ * @fn      LinkTune_ProcessHCIEvt
+ *
+ * @brief   Pick the data length change out of an HCI_GAP_EVENT_EVENT.
+ *
+ * @param   pMsg - HCI event received by the application
+ *
+ * @return  None
+ */
+void LinkTune_ProcessHCIEvt(ICall_Hdr *pMsg)
+{
+  hciEvt_BLEDataLengthChange_t *pEvt = (hciEvt_BLEDataLengthChange_t *)pMsg;
+  linkTuneResult_t *pResult;
+
+  if ((pMsg->event != HCI_GAP_EVENT_EVENT) ||
+      (pMsg->status != HCI_LE_EVENT_CODE) ||
+      (pEvt->BLEEventCode != HCI_BLE_DATA_LENGTH_CHANGE_EVENT) ||
+      (pEvt->connHandle == INVALID_CONNHANDLE))
+  {
+    return;
+  }
+
+  pResult = LinkTune_find(pEvt->connHandle);
+  if (pResult == NULL)
+  {
+    return;
+  }
+
+  pResult->txOctets = pEvt->maxTxOctets;
+  pResult->rxOctets = pEvt->maxRxOctets;
+  pResult->pending &= ~LINKTUNE_PENDING_DLE;
+
+  LinkTune_report(pResult);
+}
+
+/*********************************************************************
+ * @fn      LinkTune_GetResult
+ *
+ * @brief   Current parameters of a link.
+ *
+ * @param   connHandle - tuned link
+ *
+ * @return  Pointer to the parameters, NULL if the link is not tuned
+ */
+const linkTuneResult_t *LinkTune_GetResult(uint16 connHandle)
+{
+  if (connHandle == INVALID_CONNHANDLE)
+  {
+    return (NULL);
+  }
+
+  return (LinkTune_find(connHandle));
+}
+
+/*********************************************************************
+ * @fn      LinkTune_find
+ *
+ * @brief   Entry of a link, or a free entry for INVALID_CONNHANDLE.
+ *
+ * @param   connHandle - link to look up
+ *
+ * @return  Pointer to the entry, NULL if there is none
+ */
+static linkTuneResult_t *LinkTune_find(uint16 connHandle)
+{
+  uint8 i;
+
+  for (i = 0; i < LINKTUNE_MAX_CONNS; i++)
+  {
+    if (linkTuneResult[i].connHandle == connHandle)
+    {
+      return (&linkTuneResult[i]);
+    }
+  }
+
+  return (NULL);
+}
+
+/*********************************************************************
+ * @fn      LinkTune_reset
+ *
+ * @brief   Put an entry back to the defaults of a fresh link.
+ *
+ * @param   pResult - entry to reset
+ * @param   connHandle - link it now belongs to, INVALID_CONNHANDLE to
+ *          free it
+ *
+ * @return  None
+ */
+static void LinkTune_reset(linkTuneResult_t *pResult, uint16 connHandle)
+{
+  pResult->connHandle = connHandle;
+  pResult->mtu = ATT_MTU_SIZE;
+  pResult->payload = ATT_MTU_SIZE - LINKTUNE_ATT_HDR_SIZE;
+  pResult->txOctets = LINKTUNE_DEFAULT_OCTETS;
+  pResult->rxOctets = LINKTUNE_DEFAULT_OCTETS;
+  pResult->pending = 0;
+}
+
+/*********************************************************************
+ * @fn      LinkTune_setMTU
+ *
+ * @brief   Record the outcome of the MTU exchange.
+ *
+ * @param   pResult - entry of the link
+ * @param   mtu - effective ATT MTU
+ *
+ * @return  None
+ */
+static void LinkTune_setMTU(linkTuneResult_t *pResult, uint16 mtu)
+{
+  // Both the response and the update event arrive for an exchange we
+  // started, only report the first
+  if ((mtu == pResult->mtu) &&
+      !(pResult->pending & LINKTUNE_PENDING_MTU))
+  {
+    return;
+  }
+
+  pResult->mtu = mtu;
+  pResult->payload = mtu - LINKTUNE_ATT_HDR_SIZE;
+  pResult->pending &= ~LINKTUNE_PENDING_MTU;
+
+  LinkTune_report(pResult);
+}
+
+/*********************************************************************
+ * @fn      LinkTune_report
+ *
+ * @brief   Pass the current parameters of a link to the application.
+ *
+ * @param   pResult - entry of the link
+ *
+ * @return  None
+ */
+static void LinkTune_report(linkTuneResult_t *pResult)
+{
+  if (linkTuneCB != NULL)
+  {
+    linkTuneCB(pResult);
+  }
+}
+
+/*********************************************************************
+*********************************************************************/
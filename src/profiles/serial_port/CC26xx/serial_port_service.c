@@ -45,6 +45,7 @@
 
 #include "bcomdef.h"
 #include "OSAL.h"
+#include "icall.h"
 #include "linkdb.h"
 #include "att.h"
 #include "gatt.h"
@@ -53,6 +54,7 @@
 #include "gapbondmgr.h"
 
 #ifdef SDI_USE_UART
+#include "inc/sdi_config.h"
 #include "inc/sdi_task.h"
 #endif
 
@@ -66,6 +68,10 @@
 #include "board.h"
 #include "spp_ble_server.h"
 
+#ifdef SPP_RELIABLE
+#include "spp_session.h"
+#endif
+
 /*********************************************************************
  * MACROS
  */
@@ -74,9 +80,17 @@
  * CONSTANTS
  */
 
-#define SERVAPP_NUM_ATTR_SUPPORTED        11
+// Position of the Data, Credits and Session Characteristic values in
+// SerialPortServiceAttrTbl. The Session Characteristic comes last, so the
+// handles of the others are the same with and without SPP_RELIABLE.
+#define SERIALPORTSERVICE_DATA_VALUE_IDX        2
+#define SERIALPORTSERVICE_CREDITS_VALUE_IDX     12
+#ifdef SPP_RELIABLE
+#define SERIALPORTSERVICE_SESSION_VALUE_IDX     16
+#endif
 
 gattAttribute_t SerialPortServiceAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED];   
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -100,6 +114,34 @@ typedef enum UART_CONFIG_CHAR {
     UART_CONFIG_EVEN  = 4,        /*!< Parity level  */
     UART_CONFIG_FLOW = 5          /*!< Flow control enabled  */
 } UART_CONFIG_BIT_DEF;
+
+#if defined(SDI_USE_UART) && (SERIALPORTSERVICE_DATA_LEN > SDI_TX_FRAME_SIZE)
+#error "SERIALPORTSERVICE_DATA_LEN must not exceed SDI_TX_FRAME_SIZE, writes are passed on in one SDI TX frame"
+#endif
+
+#if defined(SDI_USE_UART) && !defined(SERIALPORTSERVICE_DATA_READBACK)
+// Long writes are reassembled in the SDI TX frame they go to the UART in
+#define SERIALPORTSERVICE_RECORD_IN_FRAME
+#endif
+
+// Data stream state of one connected client
+typedef struct
+{
+  uint16 connHandle;        // INVALID_CONNHANDLE while the entry is free
+  uint8 channel;            // SDI channel data written by the client goes out on
+  uint16 peerCredits;       // Credits granted and not yet collected
+  uint16 dataRecordLen;     // Bytes of a long write not yet passed on
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+  uint8 *dataRecordFrame;   // Frame the long write is reassembled in, or NULL
+#endif
+  uint32 txBytes;           // Bytes notified to the client
+  uint32 rxBytes;           // Bytes written by the client
+#ifdef SPP_RELIABLE
+  uint8 dataRecordHdr[SPP_SESSION_HDR_SIZE]; // Sequence number of the long write
+  uint8 sessionRecordLen;   // Session record written and not yet collected
+  uint8 sessionRecord[SPP_SESSION_RECORD_LEN];
+#endif
+} spsConn_t;
 /*********************************************************************
 
  * GLOBAL VARIABLES
@@ -128,6 +170,20 @@ CONST uint8 SerialPortServiceConfigUUID[ATT_UUID_SIZE] =
   TI_BASE_UUID_128(SERIALPORTSERVICE_CONFIG_UUID)
 };
 
+// Characteristic Credits UUID: 0xC0E4
+CONST uint8 SerialPortServiceCreditsUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(SERIALPORTSERVICE_CREDITS_UUID)
+};
+
+#ifdef SPP_RELIABLE
+// Characteristic Session UUID: 0xC0E5
+CONST uint8 SerialPortServiceSessionUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(SERIALPORTSERVICE_SESSION_UUID)
+};
+#endif
+
 
 /*********************************************************************
  * EXTERNAL VARIABLES
@@ -150,8 +206,10 @@ static SerialPortServiceCBs_t *SerialPortService_AppCBs = NULL;
 // Serial Port Profile Service attribute
 static CONST gattAttrType_t SerialPortService = { ATT_UUID_SIZE, SerialPortServUUID };
 
-// Serial Port Profile Characteristic Data Properties
-static uint8 SerialPortServiceDataProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY;
+// Serial Port Profile Characteristic Data Properties. Write (with response)
+// is what allows prepared writes, ie. records longer than the ATT MTU.
+static uint8 SerialPortServiceDataProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_WRITE |
+                                          GATT_PROP_NOTIFY;
 
 // Serial Port Profile Characteristic Configuration Each client has its own
 // instantiation of the Client Characteristic Configuration. Reads of the
@@ -169,7 +227,8 @@ static uint8 SerialPortServiceDataUserDesp[21] = "Data Characteristic \0";
 static uint8 SerialPortServiceStatusProps = GATT_PROP_READ;
 
 // Characteristic Status Value
-static uint8 SerialPortServiceStatus[SERIALPORTSERVICE_STATUS_LEN] = {0,0,0,0,0,0,0};
+static uint8 SerialPortServiceStatus[SERIALPORTSERVICE_STATUS_LEN +
+                                     SERIALPORTSERVICE_STATUS_EXT_LEN] = {0};
 
 // Serial Port Profile Characteristic Status User Description
 static uint8 SerialPortServiceStatusUserDesp[23] = "Status Characteristic \0";
@@ -190,8 +249,39 @@ static uint8 SerialPortServiceConfig[SERIALPORTSERVICE_CONFIG_LEN] = {0x2D,0x00,
 // Serial Port Profile Characteristic Config User Description
 static uint8 SerialPortServiceConfigUserDesp[23] = "Config Characteristic \0";
 
+// Serial Port Profile Characteristic Credits Properties
+static uint8 SerialPortServiceCreditsProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY;
+
+// Serial Port Profile Characteristic Credits Configuration, one per client
+static gattCharCfg_t *SerialPortServiceCreditsConfig;
+
+// Characteristic Credits Value
+static uint8 SerialPortServiceCredits[SERIALPORTSERVICE_CREDITS_LEN] = {0};
+
+// Serial Port Profile Characteristic Credits User Description
+static uint8 SerialPortServiceCreditsUserDesp[24] = "Credits Characteristic \0";
+
+#ifdef SPP_RELIABLE
+// Serial Port Profile Characteristic Session Properties. Session records
+// are written by the client and notified by the server.
+static uint8 SerialPortServiceSessionProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY;
+
+// Serial Port Profile Characteristic Session Configuration, one per client
+static gattCharCfg_t *SerialPortServiceSessionConfig;
+
+// Characteristic Session Value, records are kept per client in spsConn
+static uint8 SerialPortServiceSession[SPP_SESSION_RECORD_LEN] = {0};
+
+// Serial Port Profile Characteristic Session User Description
+static uint8 SerialPortServiceSessionUserDesp[24] = "Session Characteristic \0";
+#endif
+
 //Keep track of length
-static uint8 charDataValueLen = SERIALPORTSERVICE_DATA_LEN;
+static uint16 charDataValueLen = SERIALPORTSERVICE_DATA_LEN;
+
+// Per client stream state, see SerialPortService_OpenConn. Credits and
+// long write records are written from the GATT server callback.
+static spsConn_t spsConn[SERIALPORTSERVICE_MAX_CONNS];
 
 /*********************************************************************
  * Profile Attributes - Table
@@ -287,6 +377,72 @@ gattAttribute_t SerialPortServiceAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED] =
         0, 
         SerialPortServiceConfigUserDesp 
       },
+
+    // Characteristic Credits Declaration
+    {
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ,
+      0,
+      &SerialPortServiceCreditsProps
+    },
+
+      // Characteristic Credits Value
+      {
+        { ATT_UUID_SIZE, SerialPortServiceCreditsUUID },
+        GATT_PERMIT_WRITE,
+        0,
+        SerialPortServiceCredits
+      },
+
+      // Characteristic Credits configuration
+      {
+        { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+        0,
+        (uint8 *)&SerialPortServiceCreditsConfig
+      },
+
+      // Characteristic Credits User Description
+      {
+        { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ,
+        0,
+        SerialPortServiceCreditsUserDesp
+      },
+
+#ifdef SPP_RELIABLE
+    // Characteristic Session Declaration
+    {
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ,
+      0,
+      &SerialPortServiceSessionProps
+    },
+
+      // Characteristic Session Value
+      {
+        { ATT_UUID_SIZE, SerialPortServiceSessionUUID },
+        GATT_PERMIT_WRITE,
+        0,
+        SerialPortServiceSession
+      },
+
+      // Characteristic Session configuration
+      {
+        { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+        0,
+        (uint8 *)&SerialPortServiceSessionConfig
+      },
+
+      // Characteristic Session User Description
+      {
+        { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ,
+        0,
+        SerialPortServiceSessionUserDesp
+      },
+#endif
       
 };
 
@@ -299,6 +455,13 @@ static bStatus_t SerialPortService_ReadAttrCB( uint16 connHandle, gattAttribute_
 static bStatus_t SerialPortService_WriteAttrCB( uint16 connHandle, gattAttribute_t *pAttr,
                                             uint8 *pValue, uint16 len, uint16 offset,
                                             uint8 method );
+static bStatus_t SerialPortService_Notify( uint16 connHandle, gattCharCfg_t *charCfgTbl,
+                                           uint8 attrIdx, uint8 *pHdr, uint8 hdrLen,
+                                           uint16 len, void *value );
+static spsConn_t *SerialPortService_FindConn( uint16 connHandle, uint8 alloc );
+static bStatus_t SerialPortService_ForwardData( spsConn_t *pConn, uint8 *pData, uint16 len );
+static void SerialPortService_DataForwarded( spsConn_t *pConn, uint16 len );
+static uint8 *SerialPortService_RecordBuf( spsConn_t *pConn, uint16 offset );
 
 
 /*********************************************************************
@@ -330,6 +493,12 @@ CONST gattServiceCBs_t SerialPortServiceCBs =
 bStatus_t SerialPortService_AddService( uint32 services )
 {
   uint8 status;
+  uint8 i;
+
+  for ( i = 0; i < SERIALPORTSERVICE_MAX_CONNS; i++ )
+  {
+    spsConn[i].connHandle = INVALID_CONNHANDLE;
+  }
 
   // Allocate Client Characteristic Configuration table
   SerialPortServiceDataConfig = (gattCharCfg_t *)ICall_malloc( sizeof(gattCharCfg_t) *
@@ -340,8 +509,36 @@ bStatus_t SerialPortService_AddService( uint32 services )
     return ( bleMemAllocError );
   }
 
+  SerialPortServiceCreditsConfig = (gattCharCfg_t *)ICall_malloc( sizeof(gattCharCfg_t) *
+                                                               linkDBNumConns );
+
+  if ( SerialPortServiceCreditsConfig == NULL )
+  {
+    ICall_free( SerialPortServiceDataConfig );
+    SerialPortServiceDataConfig = NULL;
+    return ( bleMemAllocError );
+  }
+
+#ifdef SPP_RELIABLE
+  SerialPortServiceSessionConfig = (gattCharCfg_t *)ICall_malloc( sizeof(gattCharCfg_t) *
+                                                               linkDBNumConns );
+
+  if ( SerialPortServiceSessionConfig == NULL )
+  {
+    ICall_free( SerialPortServiceCreditsConfig );
+    SerialPortServiceCreditsConfig = NULL;
+    ICall_free( SerialPortServiceDataConfig );
+    SerialPortServiceDataConfig = NULL;
+    return ( bleMemAllocError );
+  }
+#endif
+
   // Initialize Client Characteristic Configuration attributes
   GATTServApp_InitCharCfg( INVALID_CONNHANDLE, SerialPortServiceDataConfig );
+  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, SerialPortServiceCreditsConfig );
+#ifdef SPP_RELIABLE
+  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, SerialPortServiceSessionConfig );
+#endif
 
 #if (defined(AUTO_NOTIFICATION)  && (AUTO_NOTIFICATION == TRUE))
   //Hardcode to enable notification in GATT table
@@ -527,6 +724,326 @@ bStatus_t SerialPortService_AddStatusErrorCount( UART_Status errorCode )
   return ( ret );
 }
 
+/*********************************************************************
+ * @fn      SerialPortService_SendNotification
+ *
+ * @brief   Notify the Data Characteristic to one connection, straight
+ *          from the caller's buffer into a stack buffer.
+ *
+ * @param   connHandle - connection to notify
+ * @param   len - length of data, at most ATT MTU - 3
+ * @param   value - pointer to data to send
+ *
+ * @return  SUCCESS or the reason nothing was sent
+ */
+bStatus_t SerialPortService_SendNotification( uint16 connHandle, uint16 len,
+                                              void *value )
+{
+  bStatus_t status;
+  spsConn_t *pConn;
+
+  status = SerialPortService_Notify( connHandle, SerialPortServiceDataConfig,
+                                     SERIALPORTSERVICE_DATA_VALUE_IDX, NULL, 0,
+                                     len, value );
+
+  if ( ( status == SUCCESS ) &&
+       ( ( pConn = SerialPortService_FindConn( connHandle, FALSE ) ) != NULL ) )
+  {
+    pConn->txBytes += len;
+  }
+
+  return ( status );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_SendCredits
+ *
+ * @brief   Grant the peer more Data Characteristic writes.
+ *
+ * @param   connHandle - connection to notify
+ * @param   credits - number of writes granted
+ *
+ * @return  SUCCESS or the reason nothing was sent
+ */
+bStatus_t SerialPortService_SendCredits( uint16 connHandle, uint8 credits )
+{
+  return ( SerialPortService_Notify( connHandle, SerialPortServiceCreditsConfig,
+                                     SERIALPORTSERVICE_CREDITS_VALUE_IDX, NULL, 0,
+                                     SERIALPORTSERVICE_CREDITS_LEN, &credits ) );
+}
+
+#ifdef SPP_RELIABLE
+/*********************************************************************
+ * @fn      SerialPortService_SendSeqNotification
+ *
+ * @brief   Notify the Data Characteristic to one connection with the
+ *          session sequence number in front of the data.
+ *
+ * @param   connHandle - connection to notify
+ * @param   seq - sequence number of the message
+ * @param   len - length of data, at most ATT MTU - 3 - SPP_SESSION_HDR_SIZE
+ * @param   value - pointer to data to send
+ *
+ * @return  SUCCESS or the reason nothing was sent
+ */
+bStatus_t SerialPortService_SendSeqNotification( uint16 connHandle, uint16 seq,
+                                                 uint16 len, void *value )
+{
+  uint8 hdr[SPP_SESSION_HDR_SIZE] = { LO_UINT16( seq ), HI_UINT16( seq ) };
+  bStatus_t status;
+  spsConn_t *pConn;
+
+  status = SerialPortService_Notify( connHandle, SerialPortServiceDataConfig,
+                                     SERIALPORTSERVICE_DATA_VALUE_IDX,
+                                     hdr, SPP_SESSION_HDR_SIZE, len, value );
+
+  if ( ( status == SUCCESS ) &&
+       ( ( pConn = SerialPortService_FindConn( connHandle, FALSE ) ) != NULL ) )
+  {
+    pConn->txBytes += len;
+  }
+
+  return ( status );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_SendSessionRecord
+ *
+ * @brief   Notify a session record on the Session Characteristic.
+ *
+ * @param   connHandle - connection to notify
+ * @param   pRecord - record of SPP_SESSION_RECORD_LEN bytes
+ *
+ * @return  SUCCESS or the reason nothing was sent
+ */
+bStatus_t SerialPortService_SendSessionRecord( uint16 connHandle, uint8 *pRecord )
+{
+  return ( SerialPortService_Notify( connHandle, SerialPortServiceSessionConfig,
+                                     SERIALPORTSERVICE_SESSION_VALUE_IDX, NULL, 0,
+                                     SPP_SESSION_RECORD_LEN, pRecord ) );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_TakeSessionRecord
+ *
+ * @brief   Collect the session record a client wrote to the Session
+ *          Characteristic. Records written since the last call are
+ *          merged, a hello among them is kept.
+ *
+ * @param   connHandle - connection of the client
+ * @param   pBuf - buffer of SPP_SESSION_RECORD_LEN bytes
+ *
+ * @return  Length of the record, 0 if none was written
+ */
+uint8 SerialPortService_TakeSessionRecord( uint16 connHandle, uint8 *pBuf )
+{
+  ICall_CSState key;
+  spsConn_t *pConn;
+  uint8 len = 0;
+
+  key = ICall_enterCriticalSection();
+  pConn = SerialPortService_FindConn( connHandle, FALSE );
+  if ( ( pConn != NULL ) && pConn->sessionRecordLen )
+  {
+    len = pConn->sessionRecordLen;
+    VOID memcpy( pBuf, pConn->sessionRecord, len );
+    pConn->sessionRecordLen = 0;
+  }
+  ICall_leaveCriticalSection( key );
+
+  return ( len );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_SessionEnabled
+ *
+ * @brief   Whether the peer has enabled Session Characteristic
+ *          notifications, ie. runs a session.
+ *
+ * @param   connHandle - connection to check
+ *
+ * @return  TRUE if session notifications are enabled
+ */
+uint8 SerialPortService_SessionEnabled( uint16 connHandle )
+{
+  return ( ( GATTServApp_ReadCharCfg( connHandle, SerialPortServiceSessionConfig ) &
+             GATT_CLIENT_CFG_NOTIFY ) ? TRUE : FALSE );
+}
+#endif //SPP_RELIABLE
+
+/*********************************************************************
+ * @fn      SerialPortService_TakeCredits
+ *
+ * @brief   Collect the credits granted by a client since the last call.
+ *
+ * @param   connHandle - connection of the client
+ *
+ * @return  Number of notifications the client has granted
+ */
+uint16 SerialPortService_TakeCredits( uint16 connHandle )
+{
+  ICall_CSState key;
+  spsConn_t *pConn;
+  uint16 credits = 0;
+
+  key = ICall_enterCriticalSection();
+  pConn = SerialPortService_FindConn( connHandle, FALSE );
+  if ( pConn != NULL )
+  {
+    credits = pConn->peerCredits;
+    pConn->peerCredits = 0;
+  }
+  ICall_leaveCriticalSection( key );
+
+  return ( credits );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_OpenConn
+ *
+ * @brief   Start the data stream of a newly connected client.
+ *
+ * @param   connHandle - connection of the client
+ * @param   channel - SDI channel the client's writes go out on
+ *
+ * @return  SUCCESS or bleNoResources if all streams are taken
+ */
+bStatus_t SerialPortService_OpenConn( uint16 connHandle, uint8 channel )
+{
+  ICall_CSState key;
+  spsConn_t *pConn;
+
+  if ( connHandle == INVALID_CONNHANDLE )
+  {
+    return ( bleInvalidRange );
+  }
+
+  key = ICall_enterCriticalSection();
+  pConn = SerialPortService_FindConn( connHandle, TRUE );
+  if ( pConn != NULL )
+  {
+    pConn->channel = channel;
+  }
+  ICall_leaveCriticalSection( key );
+
+  return ( ( pConn != NULL ) ? SUCCESS : bleNoResources );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_CloseConn
+ *
+ * @brief   End the data stream of a disconnected client, dropping any
+ *          long write it left unfinished.
+ *
+ * @param   connHandle - connection of the client
+ *
+ * @return  None
+ */
+void SerialPortService_CloseConn( uint16 connHandle )
+{
+  ICall_CSState key;
+  spsConn_t *pConn;
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+  uint8 *pFrame = NULL;
+#endif
+
+  if ( connHandle == INVALID_CONNHANDLE )
+  {
+    return;
+  }
+
+  key = ICall_enterCriticalSection();
+  pConn = SerialPortService_FindConn( connHandle, FALSE );
+  if ( pConn != NULL )
+  {
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+    pFrame = pConn->dataRecordFrame;
+#endif
+    pConn->connHandle = INVALID_CONNHANDLE;
+  }
+  ICall_leaveCriticalSection( key );
+
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+  if ( pFrame != NULL )
+  {
+    SDITask_releaseTxFrame( pFrame );
+  }
+#endif
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_GetConnBytes
+ *
+ * @brief   Bytes carried on one client's data stream since it opened.
+ *
+ * @param   connHandle - connection of the client
+ * @param   pTxBytes - bytes notified to the client
+ * @param   pRxBytes - bytes written by the client
+ *
+ * @return  SUCCESS or bleNotConnected if the stream is not open
+ */
+bStatus_t SerialPortService_GetConnBytes( uint16 connHandle, uint32 *pTxBytes,
+                                          uint32 *pRxBytes )
+{
+  spsConn_t *pConn;
+
+  if ( ( connHandle == INVALID_CONNHANDLE ) ||
+       ( ( pConn = SerialPortService_FindConn( connHandle, FALSE ) ) == NULL ) )
+  {
+    return ( bleNotConnected );
+  }
+
+  *pTxBytes = pConn->txBytes;
+  *pRxBytes = pConn->rxBytes;
+
+  return ( SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_CreditsEnabled
+ *
+ * @brief   Whether the peer has enabled Credits Characteristic
+ *          notifications.
+ *
+ * @param   connHandle - connection to check
+ *
+ * @return  TRUE if credit notifications are enabled
+ */
+uint8 SerialPortService_CreditsEnabled( uint16 connHandle )
+{
+  return ( ( GATTServApp_ReadCharCfg( connHandle, SerialPortServiceCreditsConfig ) &
+             GATT_CLIENT_CFG_NOTIFY ) ? TRUE : FALSE );
+}
+
+#ifdef SPP_STATUS_EXT
+/*********************************************************************
+ * @fn      SerialPortService_SetStatusExt
+ *
+ * @brief   Set the extension appended to the Status Characteristic.
+ *
+ * @param   len - length of data to write, SERIALPORTSERVICE_STATUS_EXT_LEN
+ * @param   value - pointer to data to write
+ *
+ * @return  bStatus_t
+ */
+bStatus_t SerialPortService_SetStatusExt( uint8 len, void *value )
+{
+  bStatus_t ret = SUCCESS;
+
+  if ( len == SERIALPORTSERVICE_STATUS_EXT_LEN )
+  {
+    VOID memcpy( &SerialPortServiceStatus[SERIALPORTSERVICE_STATUS_LEN], value,
+                 SERIALPORTSERVICE_STATUS_EXT_LEN );
+  }
+  else
+  {
+    ret = bleInvalidRange;
+  }
+
+  return ( ret );
+}
+#endif //SPP_STATUS_EXT
+
 /*********************************************************************
  * @fn      SerialPortService_SetStatusRXBytes
  *
@@ -730,6 +1247,329 @@ bStatus_t SerialPortService_GetParameter( uint8 param, void *value )
   return ( ret );
 }
 
+/*********************************************************************
+ * @fn      SerialPortService_FlushDataRecord
+ *
+ * @brief   Pass a client's Data Characteristic long write on to the UART
+ *          once the stack has executed all of its prepared segments. In
+ *          a reliable session the record's sequence number is checked
+ *          and stripped as for a single write.
+ *
+ * @param   connHandle - connection of the client
+ *
+ * @return  Number of bytes passed on, 0 if no long write was pending
+ */
+uint16 SerialPortService_FlushDataRecord( uint16 connHandle )
+{
+  ICall_CSState key;
+  spsConn_t *pConn;
+  uint16 len = 0;
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+  uint8 *pFrame = NULL;
+  uint8 channel = 0;
+#endif
+#ifdef SPP_RELIABLE
+  uint8 hdr[SPP_SESSION_HDR_SIZE];
+  uint16 hdrLen;
+  uint8 fresh;
+#endif
+
+  // Segments are written from the stack's context, and the slot may be
+  // closed and reopened on another channel once the section is left
+  key = ICall_enterCriticalSection();
+  pConn = SerialPortService_FindConn( connHandle, FALSE );
+  if ( pConn != NULL )
+  {
+    len = pConn->dataRecordLen;
+    pConn->dataRecordLen = 0;
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+    pFrame = len ? pConn->dataRecordFrame : NULL;
+    if ( pFrame != NULL )
+    {
+      pConn->dataRecordFrame = NULL;
+    }
+    channel = pConn->channel;
+#endif
+#ifdef SPP_RELIABLE
+    memcpy( hdr, pConn->dataRecordHdr, SPP_SESSION_HDR_SIZE );
+#endif
+  }
+  ICall_leaveCriticalSection(key);
+
+  if ( len == 0 )
+  {
+    return ( 0 );
+  }
+
+#ifdef SPP_RELIABLE
+  // A record without a frame is dropped within the same critical
+  // section, so no single write can take its sequence number meanwhile
+  key = ICall_enterCriticalSection();
+  fresh = SPPSession_Rx( connHandle, hdr, len, &hdrLen );
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+  if ( fresh && ( pFrame == NULL ) )
+  {
+    SPPSession_RxDropped( connHandle, hdr, len );
+  }
+#endif
+  ICall_leaveCriticalSection(key);
+
+  if ( !fresh )
+  {
+    // Retransmission of data already passed on
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+    if ( pFrame != NULL )
+    {
+      SDITask_releaseTxFrame( pFrame );
+    }
+#endif
+    return ( 0 );
+  }
+
+  len -= hdrLen;
+#endif
+
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+  // Already in place, the frame itself goes to the UART
+  if ( pFrame != NULL )
+  {
+#ifdef SPP_RELIABLE
+    memmove( pFrame, pFrame + hdrLen, len );
+#endif
+    SDITask_commitChannelTxFrame( channel, pFrame, len );
+  }
+  else
+  {
+    //No TX frame was available, the data is lost
+    SerialPortService_AddStatusErrorCount(UART_OVERRUN_ERROR);
+  }
+
+  // The slot may have been closed or reopened since the first section,
+  // so it is looked up again for the byte count
+  key = ICall_enterCriticalSection();
+  pConn = SerialPortService_FindConn( connHandle, FALSE );
+  if ( pConn != NULL )
+  {
+    SerialPortService_DataForwarded( pConn, len );
+  }
+  ICall_leaveCriticalSection(key);
+#elif defined(SPP_RELIABLE)
+  if ( SerialPortService_ForwardData( pConn, SerialPortServiceData + hdrLen,
+                                      len ) != SUCCESS )
+  {
+    SPPSession_RxDropped( connHandle, hdr, len + hdrLen );
+  }
+#else
+  SerialPortService_ForwardData( pConn, SerialPortServiceData, len );
+#endif
+
+  return ( len );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_FindConn
+ *
+ * @brief   Stream state of a client.
+ *
+ * @param   connHandle - connection of the client
+ * @param   alloc - TRUE to take a free entry if the client has none
+ *
+ * @return  Pointer to the entry, NULL if there is none
+ */
+static spsConn_t *SerialPortService_FindConn( uint16 connHandle, uint8 alloc )
+{
+  spsConn_t *pFree = NULL;
+  uint8 i;
+
+  for ( i = 0; i < SERIALPORTSERVICE_MAX_CONNS; i++ )
+  {
+    if ( spsConn[i].connHandle == connHandle )
+    {
+      return ( &spsConn[i] );
+    }
+
+    if ( ( pFree == NULL ) && ( spsConn[i].connHandle == INVALID_CONNHANDLE ) )
+    {
+      pFree = &spsConn[i];
+    }
+  }
+
+  if ( alloc && ( pFree != NULL ) )
+  {
+    memset( pFree, 0, sizeof(spsConn_t) );
+    pFree->connHandle = connHandle;
+
+    // Until told otherwise, SDI_CHANNEL_DEFAULT
+    pFree->channel = 0;
+  }
+  else
+  {
+    pFree = NULL;
+  }
+
+  return ( pFree );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_RecordBuf
+ *
+ * @brief   Buffer a long write is reassembled in. With SDI this is the
+ *          TX frame the record will be sent to the UART in, reserved
+ *          when the first segment arrives, so each byte is copied once.
+ *
+ * @param   pConn - stream of the client writing
+ * @param   offset - offset of the segment being written
+ *
+ * @return  Start of the record buffer, NULL if no frame is available
+ */
+static uint8 *SerialPortService_RecordBuf( spsConn_t *pConn, uint16 offset )
+{
+#ifdef SERIALPORTSERVICE_RECORD_IN_FRAME
+  // A frame left over from a record that failed part way is reused
+  if ( ( offset == 0 ) && ( pConn->dataRecordFrame == NULL ) )
+  {
+    pConn->dataRecordFrame =
+      SDITask_reserveChannelTxFrame( pConn->channel, SERIALPORTSERVICE_DATA_LEN );
+  }
+
+  return ( pConn->dataRecordFrame );
+#else
+  return ( SerialPortServiceData );
+#endif
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_ForwardData
+ *
+ * @brief   Pass data written by a client on to the UART.
+ *
+ * @param   pConn - stream of the client
+ * @param   pData - data written to the Data Characteristic
+ * @param   len - length of data
+ *
+ * @return  SUCCESS or bleNoResources if no TX frame was available
+ */
+static bStatus_t SerialPortService_ForwardData( spsConn_t *pConn, uint8 *pData, uint16 len )
+{
+  bStatus_t status = SUCCESS;
+
+#ifdef SPP_BENCH
+  // Benchmark probes are answered by the application, not passed on
+  if ( SPPBLEServer_benchRx( pConn->connHandle, pData, len ) )
+  {
+    SerialPortService_DataForwarded( pConn, len );
+    return ( SUCCESS );
+  }
+#endif
+
+#ifdef SDI_USE_UART          
+  //Send Data to UART, written straight into an SDI TX frame on the
+  //client's channel
+  uint8 *pFrame = SDITask_reserveChannelTxFrame(pConn->channel, len);
+
+  if (pFrame != NULL)
+  {
+    memcpy(pFrame, pData, len);
+    SDITask_commitChannelTxFrame(pConn->channel, pFrame, len);
+  }
+  else
+  {
+    //No TX frame available, the data is lost
+    SerialPortService_AddStatusErrorCount(UART_OVERRUN_ERROR);
+    status = bleNoResources;
+  }
+#else         
+  SNP_replyToHost_send(0x55, 0xFF, NULL, len, pData);
+#endif
+
+  SerialPortService_DataForwarded( pConn, len );
+
+  return ( status );
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_DataForwarded
+ *
+ * @brief   Bookkeeping for data passed on to the UART.
+ *
+ * @param   pConn - stream of the client
+ * @param   len - length of data
+ *
+ * @return  None
+ */
+static void SerialPortService_DataForwarded( spsConn_t *pConn, uint16 len )
+{
+  //Toggle LED to indicate data received from client
+  SPPBLEServer_toggleLed(Board_RLED, Board_LED_TOGGLE);
+  
+  if (len > 0)
+  {
+   pConn->rxBytes += len;
+   SerialPortService_AddStatusRXBytes( len );
+  }
+}
+
+/*********************************************************************
+ * @fn      SerialPortService_Notify
+ *
+ * @brief   Notify a characteristic value to one connection, straight
+ *          from the caller's buffer into a stack buffer.
+ *
+ * @param   connHandle - connection to notify
+ * @param   charCfgTbl - client characteristic configuration of the value
+ * @param   attrIdx - position of the value in SerialPortServiceAttrTbl
+ * @param   pHdr - bytes to send ahead of the data, may be NULL
+ * @param   hdrLen - length of pHdr
+ * @param   len - length of data, at most ATT MTU - 3 - hdrLen
+ * @param   value - pointer to data to send
+ *
+ * @return  SUCCESS or the reason nothing was sent
+ */
+static bStatus_t SerialPortService_Notify( uint16 connHandle, gattCharCfg_t *charCfgTbl,
+                                           uint8 attrIdx, uint8 *pHdr, uint8 hdrLen,
+                                           uint16 len, void *value )
+{
+  attHandleValueNoti_t noti;
+  uint16 allocLen;
+  bStatus_t ret;
+
+  if ( !( GATTServApp_ReadCharCfg( connHandle, charCfgTbl ) &
+          GATT_CLIENT_CFG_NOTIFY ) )
+  {
+    return ( bleIncorrectMode );
+  }
+
+  noti.pValue = (uint8 *)GATT_bm_alloc( connHandle, ATT_HANDLE_VALUE_NOTI,
+                                        hdrLen + len, &allocLen );
+  if ( noti.pValue == NULL )
+  {
+    return ( bleMemAllocError );
+  }
+
+  // The stack trims the buffer to the ATT MTU
+  if ( allocLen < ( hdrLen + len ) )
+  {
+    GATT_bm_free( (gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI );
+    return ( bleInvalidRange );
+  }
+
+  noti.handle = SerialPortServiceAttrTbl[attrIdx].handle;
+  noti.len = hdrLen + len;
+  if ( hdrLen )
+  {
+    VOID memcpy( noti.pValue, pHdr, hdrLen );
+  }
+  VOID memcpy( noti.pValue + hdrLen, value, len );
+
+  ret = GATT_Notification( connHandle, &noti, FALSE );
+  if ( ret != SUCCESS )
+  {
+    GATT_bm_free( (gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI );
+  }
+
+  return ( ret );
+}
+
 /*********************************************************************
  * @fn          SerialPortService_ReadAttrCB
  *
@@ -784,8 +1624,8 @@ static bStatus_t SerialPortService_ReadAttrCB( uint16 connHandle, gattAttribute_
         break;
         
       case SERIALPORTSERVICE_STATUS_UUID:
-        *pLen = SERIALPORTSERVICE_STATUS_LEN;
-        VOID memcpy( pValue, pAttr->pValue, SERIALPORTSERVICE_STATUS_LEN );
+        *pLen = SERIALPORTSERVICE_STATUS_LEN + SERIALPORTSERVICE_STATUS_EXT_LEN;
+        VOID memcpy( pValue, pAttr->pValue, *pLen );
         
         //Reset all counters
         numTxBytes = 0;
@@ -797,6 +1637,21 @@ static bStatus_t SerialPortService_ReadAttrCB( uint16 connHandle, gattAttribute_
         numRFLinkOverRun = 0;
         numFramingError = 0;
         numParityError = 0;
+
+#ifdef SPP_RELIABLE
+        // Followed by the session state of the reader, for inspection
+        {
+          sppSession_t *pSession = SPPSession_Find( connHandle );
+
+          if ( ( pSession != NULL ) &&
+               ( maxLen >= ( *pLen + SPP_SESSION_RECORD_LEN ) ) )
+          {
+            SPPSession_BuildRecord( pSession, pValue + *pLen );
+            pValue[*pLen] &= ~SPP_SESSION_FLAG_HELLO;
+            *pLen += SPP_SESSION_RECORD_LEN;
+          }
+        }
+#endif
         break;        
       case SERIALPORTSERVICE_CONFIG_UUID:
         *pLen = SERIALPORTSERVICE_CONFIG_LEN;
@@ -852,6 +1707,7 @@ static bStatus_t SerialPortService_WriteAttrCB( uint16 connHandle, gattAttribute
 {
   bStatus_t status = SUCCESS;
   uint8 notifyApp = 0xFF;
+  spsConn_t *pConn;
   
   // If attribute permissions require authorization to write, return error
   if ( gattPermitAuthorWrite( pAttr->permissions ) )
@@ -867,7 +1723,33 @@ static bStatus_t SerialPortService_WriteAttrCB( uint16 connHandle, gattAttribute
     switch ( uuid )
     {
       case SERIALPORTSERVICE_DATA_UUID:
-        if ( offset == 0 )
+        // Clients the application has not opened a stream for yet get one
+        // on the default channel
+        pConn = SerialPortService_FindConn( connHandle, TRUE );
+
+        if ( pConn == NULL )
+        {
+          status = ATT_ERR_INSUFFICIENT_RESOURCES;
+        }
+        else if ( method == ATT_EXECUTE_WRITE_REQ )
+        {
+          // One segment of a long write. The stack hands the prepared
+          // segments over in order, a record starts at offset 0.
+          if ( offset == 0 )
+          {
+            pConn->dataRecordLen = 0;
+          }
+
+          if ( offset != pConn->dataRecordLen )
+          {
+            status = ATT_ERR_INVALID_OFFSET;
+          }
+          else if ( ( offset + len ) > SERIALPORTSERVICE_DATA_LEN )
+          {
+            status = ATT_ERR_INVALID_VALUE_SIZE;
+          }
+        }
+        else if ( offset == 0 )
         {
           if ( len > SERIALPORTSERVICE_DATA_LEN )
           {
@@ -882,27 +1764,60 @@ static bStatus_t SerialPortService_WriteAttrCB( uint16 connHandle, gattAttribute
         //Write the value
         if ( status == SUCCESS )
         {
-          uint8 *pCurValue = (uint8 *)pAttr->pValue;
-          
-          //Copy/Store data to the GATT table entry
-          memset(pCurValue, 0, SERIALPORTSERVICE_DATA_LEN);
-          memcpy(pCurValue, pValue, len);
-          
-#ifdef SDI_USE_UART          
-          //Send Data to UART 
-          SDITask_sendToUART(pCurValue, len); 
-#else         
-          SNP_replyToHost_send(0x55, 0xFF, NULL, len, pCurValue);
+          if ( method == ATT_EXECUTE_WRITE_REQ )
+          {
+            uint8 *pRecord = SerialPortService_RecordBuf( pConn, offset );
+
+            // Reassemble, the record goes to the UART in one piece from
+            // SerialPortService_FlushDataRecord
+            if ( pRecord != NULL )
+            {
+              memcpy(pRecord + offset, pValue, len);
+            }
+#ifdef SPP_RELIABLE
+            // Kept apart, so a record that found no frame can still be
+            // told apart from a retransmission
+            if ( offset < SPP_SESSION_HDR_SIZE )
+            {
+              memcpy(pConn->dataRecordHdr + offset, pValue,
+                     MIN(len, SPP_SESSION_HDR_SIZE - offset));
+            }
 #endif
-          //Toggle LED to indicate data received from client
-          SPPBLEServer_toggleLed(Board_RLED, Board_LED_TOGGLE);
-          
-          if (len > 0)
+            pConn->dataRecordLen = offset + len;
+#ifdef SERIALPORTSERVICE_DATA_READBACK
+            charDataValueLen = pConn->dataRecordLen;
+#endif
+          }
+          else
           {
-           SerialPortService_AddStatusRXBytes( len );
+#ifdef SERIALPORTSERVICE_DATA_READBACK
+            //Copy/Store data to the GATT table entry
+            memcpy(pAttr->pValue, pValue, len);
+            charDataValueLen = len;
+#endif
+
+#ifdef SPP_RELIABLE
+            // The session sequence number is checked and stripped,
+            // retransmissions of data already passed on are dropped.
+            // Data that finds no TX frame is not acknowledged, the
+            // client resends it.
+            uint16 hdrLen;
+
+            if ( SPPSession_Rx( connHandle, pValue, len, &hdrLen ) &&
+                 ( SerialPortService_ForwardData( pConn, pValue + hdrLen,
+                                                  len - hdrLen ) != SUCCESS ) )
+            {
+              SPPSession_RxDropped( connHandle, pValue, len );
+            }
+#else
+            // Straight from the stack's buffer into an SDI TX frame
+            SerialPortService_ForwardData( pConn, pValue, len );
+#endif
           }
       
-          notifyApp = SERIALPORTSERVICE_CHAR_DATA;
+          notifyApp = ( method == ATT_EXECUTE_WRITE_REQ ) ?
+                      SERIALPORTSERVICE_CHAR_DATA_RECORD :
+                      SERIALPORTSERVICE_CHAR_DATA;
         }
              
         break;
@@ -936,6 +1851,91 @@ static bStatus_t SerialPortService_WriteAttrCB( uint16 connHandle, gattAttribute
              
         break;
 
+      case SERIALPORTSERVICE_CREDITS_UUID:
+
+        //Validate the value
+        if ( offset == 0 )
+        {
+          if ( len != SERIALPORTSERVICE_CREDITS_LEN )
+          {
+            status = ATT_ERR_INVALID_VALUE_SIZE;
+          }
+        }
+        else
+        {
+          status = ATT_ERR_ATTR_NOT_LONG;
+        }
+
+        //Add the grant to what the application has yet to collect
+        if ( status == SUCCESS )
+        {
+          ICall_CSState key;
+
+          *(uint8 *)pAttr->pValue = pValue[0];
+
+          key = ICall_enterCriticalSection();
+          pConn = SerialPortService_FindConn( connHandle, TRUE );
+          if ( pConn != NULL )
+          {
+            pConn->peerCredits += pValue[0];
+          }
+          ICall_leaveCriticalSection( key );
+
+          notifyApp = SERIALPORTSERVICE_CHAR_CREDITS;
+        }
+
+        break;
+
+#ifdef SPP_RELIABLE
+      case SERIALPORTSERVICE_SESSION_UUID:
+
+        //Validate the value
+        if ( offset == 0 )
+        {
+          if ( len != SPP_SESSION_RECORD_LEN )
+          {
+            status = ATT_ERR_INVALID_VALUE_SIZE;
+          }
+        }
+        else
+        {
+          status = ATT_ERR_ATTR_NOT_LONG;
+        }
+
+        //Keep the record for the application, each client has its own
+        if ( status == SUCCESS )
+        {
+          ICall_CSState key;
+          uint8 hello;
+
+          key = ICall_enterCriticalSection();
+          pConn = SerialPortService_FindConn( connHandle, TRUE );
+          if ( pConn != NULL )
+          {
+            hello = ( pConn->sessionRecordLen &&
+                      ( pConn->sessionRecord[0] & SPP_SESSION_FLAG_HELLO ) );
+            memcpy( pConn->sessionRecord, pValue, SPP_SESSION_RECORD_LEN );
+            if ( hello )
+            {
+              pConn->sessionRecord[0] |= SPP_SESSION_FLAG_HELLO;
+            }
+            pConn->sessionRecordLen = SPP_SESSION_RECORD_LEN;
+          }
+          ICall_leaveCriticalSection( key );
+
+          if ( pConn == NULL )
+          {
+            status = ATT_ERR_INSUFFICIENT_RESOURCES;
+          }
+          else
+          {
+            notifyApp = SERIALPORTSERVICE_CHAR_SESSION;
+          }
+        }
+
+        break;
+#endif //SPP_RELIABLE
+
       default:
         // Should never get here! (characteristics 2 and 4 do not have write permissions)
         status = ATT_ERR_ATTR_NOT_FOUND;
@@ -967,7 +1967,7 @@ static bStatus_t SerialPortService_WriteAttrCB( uint16 connHandle, gattAttribute
   // If a charactersitic value changed then callback function to notify application of change
   if ( (notifyApp != 0xFF ) && SerialPortService_AppCBs && SerialPortService_AppCBs->pfnSerialPortServiceChange )
   {
-    SerialPortService_AppCBs->pfnSerialPortServiceChange( notifyApp );  
+    SerialPortService_AppCBs->pfnSerialPortServiceChange( connHandle, notifyApp );
   }
   
   return ( status );
@@ -0,0 +1,477 @@
+/*
+ * Filename: spp_bench.c
+ *
+ * Description: Probe frames and result bookkeeping for the SPP BLE
+ * benchmark mode (SPP_BENCH), shared by the client and the server.
+ *
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <ti/sysbios/knl/Clock.h>
+
+#include "bcomdef.h"
+
+#include "spp_bench.h"
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void SPPBench_put16(uint8 *pBuf, uint16 value);
+static void SPPBench_put32(uint8 *pBuf, uint32 value);
+static uint32 SPPBench_get32(const uint8 *pBuf);
+static char *SPPBench_appendUInt(char *pBuf, uint32 value);
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      SPPBench_Now
+ *
+ * @brief   Local time for probe timestamps.
+ *
+ * @return  Microseconds, wrapping
+ */
+uint32 SPPBench_Now(void)
+{
+  return (Clock_getTicks() * Clock_tickPeriod);
+}
+
+/*********************************************************************
+ * @fn      SPPBench_BuildProbe
+ *
+ * @brief   Write a probe header and filler.
+ *
+ * @param   pBuf - buffer of len bytes
+ * @param   len - probe size, at least SPPBENCH_HDR_SIZE
+ * @param   type - SPPBENCH_TYPE_xxx
+ * @param   seq - probe number
+ *
+ * @return  SUCCESS or FAILURE if len is too short
+ */
+uint8 SPPBench_BuildProbe(uint8 *pBuf, uint16 len, uint8 type, uint16 seq)
+{
+  uint16 i;
+
+  if (len < SPPBENCH_HDR_SIZE)
+  {
+    return (FAILURE);
+  }
+
+  pBuf[0] = SPPBENCH_MAGIC;
+  pBuf[1] = type;
+  SPPBench_put16(&pBuf[2], seq);
+  SPPBench_put32(&pBuf[4], SPPBench_Now());
+
+  for (i = SPPBENCH_HDR_SIZE; i < len; i++)
+  {
+    pBuf[i] = (uint8)i;
+  }
+
+  return (SUCCESS);
+}
+
+/*********************************************************************
+ * @fn      SPPBench_ParseProbe
+ *
+ * @brief   Read the header of a received probe.
+ *
+ * @param   pBuf - received data
+ * @param   len - length of data
+ * @param   pProbe - header out
+ *
+ * @return  TRUE if the data is a probe
+ */
+uint8 SPPBench_ParseProbe(const uint8 *pBuf, uint16 len,
+                          sppBenchProbe_t *pProbe)
+{
+  if ((len < SPPBENCH_HDR_SIZE) || (pBuf[0] != SPPBENCH_MAGIC))
+  {
+    return (FALSE);
+  }
+
+  pProbe->type = pBuf[1];
+  pProbe->seq = BUILD_UINT16(pBuf[2], pBuf[3]);
+  pProbe->timestamp = SPPBench_get32(&pBuf[4]);
+
+  return (TRUE);
+}
+
+/*********************************************************************
+ * @fn      SPPBench_RxReset
+ *
+ * @brief   Clear the counters of a bulk run.
+ *
+ * @param   pRx - counters
+ *
+ * @return  None
+ */
+void SPPBench_RxReset(sppBenchRx_t *pRx)
+{
+  pRx->received = 0;
+  pRx->lost = 0;
+  pRx->bytes = 0;
+  pRx->firstUs = 0;
+  pRx->lastUs = 0;
+  pRx->nextSeq = 0;
+}
+
+/*********************************************************************
+ * @fn      SPPBench_RxAdd
+ *
+ * @brief   Count a received bulk probe.
+ *
+ * @param   pRx - counters
+ * @param   pProbe - probe header
+ * @param   len - probe size
+ *
+ * @return  None
+ */
+void SPPBench_RxAdd(sppBenchRx_t *pRx, const sppBenchProbe_t *pProbe,
+                    uint16 len)
+{
+  uint32 now = SPPBench_Now();
+
+  if (pRx->received == 0)
+  {
+    pRx->firstUs = now;
+  }
+
+  // Writes without response are never reordered, a jump ahead is loss
+  if ((uint16)(pProbe->seq - pRx->nextSeq) < 0x8000)
+  {
+    pRx->lost += pProbe->seq - pRx->nextSeq;
+    pRx->nextSeq = pProbe->seq + 1;
+  }
+
+  pRx->received++;
+  pRx->bytes += len;
+  pRx->lastUs = now;
+}
+
+/*********************************************************************
+ * @fn      SPPBench_BuildReport
+ *
+ * @brief   Write a report probe carrying bulk run counters.
+ *
+ * @param   pBuf - buffer of at least SPPBENCH_REPORT_SIZE bytes
+ * @param   pRx - counters
+ *
+ * @return  Report size
+ */
+uint16 SPPBench_BuildReport(uint8 *pBuf, const sppBenchRx_t *pRx)
+{
+  VOID SPPBench_BuildProbe(pBuf, SPPBENCH_HDR_SIZE, SPPBENCH_TYPE_REPORT,
+                           pRx->received);
+
+  SPPBench_put16(&pBuf[SPPBENCH_HDR_SIZE], pRx->received);
+  SPPBench_put16(&pBuf[SPPBENCH_HDR_SIZE + 2], pRx->lost);
+  SPPBench_put32(&pBuf[SPPBENCH_HDR_SIZE + 4], pRx->bytes);
+  SPPBench_put32(&pBuf[SPPBENCH_HDR_SIZE + 8], pRx->lastUs - pRx->firstUs);
+
+  return (SPPBENCH_REPORT_SIZE);
+}
+
+/*********************************************************************
+ * @fn      SPPBench_ParseReport
+ *
+ * @brief   Read the counters out of a report probe. The span goes to
+ *          lastUs, firstUs is set to 0.
+ *
+ * @param   pBuf - received data
+ * @param   len - length of data
+ * @param   pRx - counters out
+ *
+ * @return  TRUE if the data is a report probe
+ */
+uint8 SPPBench_ParseReport(const uint8 *pBuf, uint16 len, sppBenchRx_t *pRx)
+{
+  if ((len < SPPBENCH_REPORT_SIZE) || (pBuf[0] != SPPBENCH_MAGIC) ||
+      (pBuf[1] != SPPBENCH_TYPE_REPORT))
+  {
+    return (FALSE);
+  }
+
+  pRx->received = BUILD_UINT16(pBuf[SPPBENCH_HDR_SIZE],
+                               pBuf[SPPBENCH_HDR_SIZE + 1]);
+  pRx->lost = BUILD_UINT16(pBuf[SPPBENCH_HDR_SIZE + 2],
+                           pBuf[SPPBENCH_HDR_SIZE + 3]);
+  pRx->bytes = SPPBench_get32(&pBuf[SPPBENCH_HDR_SIZE + 4]);
+  pRx->firstUs = 0;
+  pRx->lastUs = SPPBench_get32(&pBuf[SPPBENCH_HDR_SIZE + 8]);
+  pRx->nextSeq = pRx->received + pRx->lost;
+
+  return (TRUE);
+}
+
+/*********************************************************************
+ * @fn      SPPBench_LatencyReset
+ *
+ * @brief   Drop all latency samples.
+ *
+ * @param   pLat - samples
+ *
+ * @return  None
+ */
+void SPPBench_LatencyReset(sppBenchLatency_t *pLat)
+{
+  pLat->count = 0;
+  pLat->max = 0;
+}
+
+/*********************************************************************
+ * @fn      SPPBench_LatencyAdd
+ *
+ * @brief   Add a latency sample.
+ *
+ * @param   pLat - samples
+ * @param   us - latency
+ *
+ * @return  None
+ */
+void SPPBench_LatencyAdd(sppBenchLatency_t *pLat, uint32 us)
+{
+  if (pLat->count < SPPBENCH_MAX_SAMPLES)
+  {
+    pLat->samples[pLat->count] = us;
+  }
+
+  if (pLat->count < 0xFFFF)
+  {
+    pLat->count++;
+  }
+
+  if (us > pLat->max)
+  {
+    pLat->max = us;
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPBench_LatencyPercentile
+ *
+ * @brief   Latency below which the given share of the kept samples
+ *          fall, nearest rank.
+ *
+ * @param   pLat - samples
+ * @param   percent - 1 to 100
+ *
+ * @return  Latency, us, 0 without samples
+ */
+uint32 SPPBench_LatencyPercentile(sppBenchLatency_t *pLat, uint8 percent)
+{
+  uint16 kept = MIN(pLat->count, SPPBENCH_MAX_SAMPLES);
+  uint16 rank;
+  uint16 i;
+  uint16 j;
+  uint32 sample;
+
+  if (kept == 0)
+  {
+    return (0);
+  }
+
+  // Insertion sort, the samples are nearly in order already and there
+  // are few of them
+  for (i = 1; i < kept; i++)
+  {
+    sample = pLat->samples[i];
+
+    for (j = i; (j > 0) && (pLat->samples[j - 1] > sample); j--)
+    {
+      pLat->samples[j] = pLat->samples[j - 1];
+    }
+
+    pLat->samples[j] = sample;
+  }
+
+  rank = (uint16)(((uint32)kept * percent + 99) / 100);
+  if (rank == 0)
+  {
+    rank = 1;
+  }
+
+  return (pLat->samples[rank - 1]);
+}
+
+/*********************************************************************
+ * @fn      SPPBench_Goodput
+ *
+ * @brief   Bits per second for bytes moved in a time span.
+ *
+ * @param   bytes - bytes moved
+ * @param   us - time span
+ *
+ * @return  Bits per second, 0 for an empty span
+ */
+uint32 SPPBench_Goodput(uint32 bytes, uint32 us)
+{
+  if (us == 0)
+  {
+    return (0);
+  }
+
+  return ((uint32)(((uint64_t)bytes * 8 * 1000000) / us));
+}
+
+/*********************************************************************
+ * @fn      SPPBench_FormatResult
+ *
+ * @brief   Write a result as a CSV line for the host.
+ *
+ * @param   pBuf - buffer of at least SPPBENCH_RESULT_LEN bytes
+ * @param   pResult - result
+ *
+ * @return  Line length
+ */
+uint16 SPPBench_FormatResult(char *pBuf, const sppBenchResult_t *pResult)
+{
+  static const char prefix[] = "BENCH,";
+  char *p = pBuf;
+  uint8 i;
+
+  for (i = 0; prefix[i]; i++)
+  {
+    *p++ = prefix[i];
+  }
+
+  if (pResult->mode == SPPBENCH_MODE_ECHO)
+  {
+    *p++ = 'e'; *p++ = 'c'; *p++ = 'h'; *p++ = 'o';
+  }
+  else
+  {
+    *p++ = 'b'; *p++ = 'u'; *p++ = 'l'; *p++ = 'k';
+  }
+
+  // Ten fields of at most ten digits and a comma each fit in
+  // SPPBENCH_RESULT_LEN along with the prefix and line end
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->size);
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->count);
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->sent);
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->received);
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->lost);
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->p50Us);
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->p99Us);
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->maxUs);
+  *p++ = ','; p = SPPBench_appendUInt(p, pResult->goodputBps);
+  *p++ = '\r';
+  *p++ = '\n';
+
+  return ((uint16)(p - pBuf));
+}
+
+/*********************************************************************
+ * @fn      SPPBench_put16
+ *
+ * @brief   Store a 16 bit value little endian.
+ *
+ * @param   pBuf - destination
+ * @param   value - value
+ *
+ * @return  None
+ */
+static void SPPBench_put16(uint8 *pBuf, uint16 value)
+{
+  pBuf[0] = LO_UINT16(value);
+  pBuf[1] = HI_UINT16(value);
+}
+
+/*********************************************************************
+ * @fn      SPPBench_put32
+ *
+ * @brief   Store a 32 bit value little endian.
+ *
+ * @param   pBuf - destination
+ * @param   value - value
+ *
+ * @return  None
+ */
+static void SPPBench_put32(uint8 *pBuf, uint32 value)
+{
+  pBuf[0] = BREAK_UINT32(value, 0);
+  pBuf[1] = BREAK_UINT32(value, 1);
+  pBuf[2] = BREAK_UINT32(value, 2);
+  pBuf[3] = BREAK_UINT32(value, 3);
+}
+
+/*********************************************************************
+ * @fn      SPPBench_get32
+ *
+ * @brief   Load a little endian 32 bit value.
+ *
+ * @param   pBuf - source
+ *
+ * @return  Value
+ */
+static uint32 SPPBench_get32(const uint8 *pBuf)
+{
+  return (BUILD_UINT32(pBuf[0], pBuf[1], pBuf[2], pBuf[3]));
+}
+
+/*********************************************************************
+ * @fn      SPPBench_appendUInt
+ *
+ * @brief   Append an unsigned value in decimal.
+ *
+ * @param   pBuf - where the digits go
+ * @param   value - value
+ *
+ * @return  Position after the last digit
+ */
+static char *SPPBench_appendUInt(char *pBuf, uint32 value)
+{
+  char digits[10];
+  uint8 n = 0;
+
+  do
+  {
+    digits[n++] = '0' + (char)(value % 10);
+    value /= 10;
+  } while (value);
+
+  while (n)
+  {
+    *pBuf++ = digits[--n];
+  }
+
+  return (pBuf);
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -0,0 +1,634 @@
+/*
+ * Filename: spp_session.c
+ *
+ * Description: Reliable, resumable SPP data sessions (SPP_RELIABLE).
+ * Sequence numbers every Data Characteristic message, holds sent UART
+ * blocks until the peer acknowledges them and picks a session up
+ * where it left off when the same peer reconnects.
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include "bcomdef.h"
+#include "icall.h"
+#include "gapbondmgr.h"
+
+#include "spp_session.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#if (SPP_SESSION_WINDOW > SPP_UART_MSG_CNT) || (SPP_SESSION_WINDOW == 0)
+#error "SPP_SESSION_WINDOW must be between 1 and SPP_UART_MSG_CNT"
+#endif
+
+/*********************************************************************
+ * MACROS
+ */
+
+// Sequence numbers wrap, a is after b if less than half the space ahead
+#define SPPSESSION_SEQ_AFTER(a, b)              ((int16)((uint16)(a) - (uint16)(b)) > 0)
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static sppSession_t sppSessions[SPP_SESSION_MAX];
+
+// Counts link drops, orders parked sessions by age
+static uint32 sppSessionParkCount = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void SPPSession_ack(sppSession_t *pSession, uint16 ack);
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      SPPSession_Init
+ *
+ * @brief   Forget all sessions.
+ *
+ * @return  None
+ */
+void SPPSession_Init(void)
+{
+  uint8 i;
+
+  for (i = 0; i < SPP_SESSION_MAX; i++)
+  {
+    sppSessions[i].inUse = FALSE;
+    sppSessions[i].connHandle = INVALID_CONNHANDLE;
+    SPPUARTQueue_InitQueue(&sppSessions[i].txQueue);
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPSession_Open
+ *
+ * @brief   Attach a new link to the session of its peer, or start a new
+ *          session if there is none.
+ *
+ * @param   connHandle - link to the peer
+ * @param   addrType - type of the peer's address on this link
+ * @param   pAddr - peer's address on this link
+ *
+ * @return  The session, NULL if every session is connected
+ */
+sppSession_t *SPPSession_Open(uint16 connHandle, uint8 addrType, uint8 *pAddr)
+{
+  sppSession_t *pSession = NULL;
+  sppSession_t *pReuse = NULL;
+  uint8 identity[B_ADDR_LEN];
+  uint8 i;
+
+  // A bonded peer is known by its identity address, a resolvable private
+  // address changes with every link. Others only have the one they use.
+  if (GAPBondMgr_ResolveAddr(addrType, pAddr, identity) < GAP_BONDINGS_MAX)
+  {
+    pAddr = identity;
+  }
+
+  for (i = 0; i < SPP_SESSION_MAX; i++)
+  {
+    if (!sppSessions[i].inUse)
+    {
+      if (pReuse == NULL || pReuse->inUse)
+      {
+        pReuse = &sppSessions[i];
+      }
+    }
+    else if (sppSessions[i].connHandle == INVALID_CONNHANDLE)
+    {
+      if (memcmp(sppSessions[i].addr, pAddr, B_ADDR_LEN) == 0)
+      {
+        pSession = &sppSessions[i];
+        break;
+      }
+
+      // Otherwise the one parked longest, unless a free slot turns up
+      if ((pReuse == NULL) ||
+          (pReuse->inUse && (sppSessions[i].parkedAt < pReuse->parkedAt)))
+      {
+        pReuse = &sppSessions[i];
+      }
+    }
+  }
+
+  if (pSession != NULL)
+  {
+    pSession->resumed = TRUE;
+  }
+  else if (pReuse != NULL)
+  {
+    // The previous peer's data is lost with its session
+    pSession = pReuse;
+    SPPUARTQueue_Drain(&pSession->txQueue);
+
+    pSession->inUse = TRUE;
+    memcpy(pSession->addr, pAddr, B_ADDR_LEN);
+    pSession->resumed = FALSE;
+    pSession->txBase = 0;
+    pSession->rxNext = 0;
+    pSession->rxLost = 0;
+  }
+  else
+  {
+    return (NULL);
+  }
+
+  pSession->synced = FALSE;
+  pSession->helloDue = FALSE;
+  pSession->helloSent = FALSE;
+  pSession->txSent = 0;
+  pSession->rxAcked = pSession->rxNext;
+  pSession->rxGap = FALSE;
+  pSession->resendDue = FALSE;
+
+  // Published last, SPPSession_Rx may look for it from the stack
+  pSession->connHandle = connHandle;
+
+  return (pSession);
+}
+
+/*********************************************************************
+ * @fn      SPPSession_Close
+ *
+ * @brief   Park the session of a link that went down.
+ *
+ * @param   pSession - session
+ * @param   pPending - queue of UART data not taken in yet, emptied,
+ *                     may be NULL
+ *
+ * @return  None
+ */
+void SPPSession_Close(sppSession_t *pSession, sppUARTQueue_t *pPending)
+{
+  ICall_CSState key;
+  uint8 keep;
+
+  // A peer that never said hello does not run sessions, there is
+  // nothing to resume
+  keep = pSession->synced || pSession->resumed;
+
+  key = ICall_enterCriticalSection();
+  pSession->connHandle = INVALID_CONNHANDLE;
+  pSession->synced = FALSE;
+  ICall_leaveCriticalSection(key);
+
+  if (!keep)
+  {
+    pSession->inUse = FALSE;
+    SPPUARTQueue_Drain(&pSession->txQueue);
+  }
+  else if (pPending != NULL)
+  {
+    // Kept up to the window, so parked sessions leave the pool to the
+    // links that are up
+    SPPSession_Fill(pSession, pPending);
+  }
+
+  if (pPending != NULL)
+  {
+    SPPUARTQueue_Drain(pPending);
+  }
+
+  pSession->txSent = 0;
+  pSession->parkedAt = ++sppSessionParkCount;
+}
+
+/*********************************************************************
+ * @fn      SPPSession_Find
+ *
+ * @brief   Session of a link.
+ *
+ * @param   connHandle - link to the peer
+ *
+ * @return  The session, NULL if the link has none
+ */
+sppSession_t *SPPSession_Find(uint16 connHandle)
+{
+  uint8 i;
+
+  if (connHandle == INVALID_CONNHANDLE)
+  {
+    return (NULL);
+  }
+
+  for (i = 0; i < SPP_SESSION_MAX; i++)
+  {
+    if (sppSessions[i].inUse && (sppSessions[i].connHandle == connHandle))
+    {
+      return (&sppSessions[i]);
+    }
+  }
+
+  return (NULL);
+}
+
+/*********************************************************************
+ * @fn      SPPSession_Fill
+ *
+ * @brief   Take UART blocks into the session window.
+ *
+ * @param   pSession - session
+ * @param   pQueue - queue to take the blocks from
+ *
+ * @return  None
+ */
+void SPPSession_Fill(sppSession_t *pSession, sppUARTQueue_t *pQueue)
+{
+  while ((SPPUARTQueue_Count(&pSession->txQueue) < SPP_SESSION_WINDOW) &&
+         (SPPUARTQueue_Move(pQueue, &pSession->txQueue) != NULL))
+  {
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPSession_NextTx
+ *
+ * @brief   Next block to send on the link.
+ *
+ * @param   pSession - session
+ * @param   pSeq - sequence number of the block
+ *
+ * @return  The block, left in the session, NULL if there is none
+ */
+sppUARTMsg_t *SPPSession_NextTx(sppSession_t *pSession, uint16 *pSeq)
+{
+  sppUARTMsg_t *pMsg;
+
+  // The peer has to know where we start before the first message
+  if (!pSession->synced || pSession->helloDue)
+  {
+    return (NULL);
+  }
+
+  pMsg = SPPUARTQueue_PeekAt(&pSession->txQueue, pSession->txSent);
+  if (pMsg != NULL)
+  {
+    *pSeq = pSession->txBase + pSession->txSent;
+  }
+
+  return (pMsg);
+}
+
+/*********************************************************************
+ * @fn      SPPSession_Sent
+ *
+ * @brief   The block returned by SPPSession_NextTx is with the stack.
+ *
+ * @param   pSession - session
+ *
+ * @return  None
+ */
+void SPPSession_Sent(sppSession_t *pSession)
+{
+  pSession->txSent++;
+}
+
+/*********************************************************************
+ * @fn      SPPSession_Rx
+ *
+ * @brief   Check the sequence number of a Data Characteristic message.
+ *
+ * @param   connHandle - link the message came on
+ * @param   pData - message
+ * @param   len - length of message
+ * @param   pOffset - where the UART data starts in the message
+ *
+ * @return  TRUE to pass the data on, FALSE for a retransmission of
+ *          data already passed on
+ */
+uint8 SPPSession_Rx(uint16 connHandle, uint8 *pData, uint16 len,
+                    uint16 *pOffset)
+{
+  ICall_CSState key;
+  sppSession_t *pSession;
+  uint16 seq;
+  uint8 fresh = TRUE;
+
+  *pOffset = 0;
+
+  key = ICall_enterCriticalSection();
+
+  pSession = SPPSession_Find(connHandle);
+  if ((pSession != NULL) && pSession->synced)
+  {
+    if (len < SPP_SESSION_HDR_SIZE)
+    {
+      fresh = FALSE;
+    }
+    else
+    {
+      seq = BUILD_UINT16(pData[0], pData[1]);
+      *pOffset = SPP_SESSION_HDR_SIZE;
+
+      if (seq == pSession->rxNext)
+      {
+        pSession->rxNext++;
+        pSession->rxGap = FALSE;
+      }
+      else if (pSession->rxGap)
+      {
+        // Sent before the peer got our resend request, it comes again
+        fresh = FALSE;
+      }
+      else if (SPPSESSION_SEQ_AFTER(seq, pSession->rxNext))
+      {
+        // Never happens on one link, the peer skipped what it lost
+        pSession->rxLost += seq - pSession->rxNext;
+        pSession->rxNext = seq + 1;
+      }
+      else
+      {
+        // Resent after a reconnect, already passed on
+        fresh = FALSE;
+      }
+    }
+  }
+
+  ICall_leaveCriticalSection(key);
+
+  return (fresh);
+}
+
+/*********************************************************************
+ * @fn      SPPSession_RxDropped
+ *
+ * @brief   A message SPPSession_Rx passed on could not be delivered.
+ *
+ * @param   connHandle - link the message came on
+ * @param   pData - message
+ * @param   len - length of message
+ *
+ * @return  None
+ */
+void SPPSession_RxDropped(uint16 connHandle, uint8 *pData, uint16 len)
+{
+  ICall_CSState key;
+  sppSession_t *pSession;
+  uint16 seq;
+
+  if (len < SPP_SESSION_HDR_SIZE)
+  {
+    return;
+  }
+
+  seq = BUILD_UINT16(pData[0], pData[1]);
+
+  key = ICall_enterCriticalSection();
+
+  // Not acknowledged yet, so the peer still holds it
+  pSession = SPPSession_Find(connHandle);
+  if ((pSession != NULL) && pSession->synced &&
+      ((uint16)(seq + 1) == pSession->rxNext))
+  {
+    pSession->rxNext = seq;
+    pSession->rxGap = TRUE;
+    pSession->resendDue = TRUE;
+  }
+
+  ICall_leaveCriticalSection(key);
+}
+
+/*********************************************************************
+ * @fn      SPPSession_StartHello
+ *
+ * @brief   Have the next record sent on the link be a hello.
+ *
+ * @param   pSession - session
+ *
+ * @return  None
+ */
+void SPPSession_StartHello(sppSession_t *pSession)
+{
+  pSession->helloDue = TRUE;
+}
+
+/*********************************************************************
+ * @fn      SPPSession_RecordDue
+ *
+ * @brief   Whether a hello or a new acknowledgement is waiting.
+ *
+ * @param   pSession - session
+ *
+ * @return  TRUE if a record should be sent
+ */
+uint8 SPPSession_RecordDue(sppSession_t *pSession)
+{
+  return (pSession->helloDue ||
+          (pSession->synced && (pSession->resendDue ||
+                                (pSession->rxAcked != pSession->rxNext))));
+}
+
+/*********************************************************************
+ * @fn      SPPSession_BuildRecord
+ *
+ * @brief   Write the session record for the peer.
+ *
+ * @param   pSession - session
+ * @param   pBuf - buffer of SPP_SESSION_RECORD_LEN bytes
+ *
+ * @return  None
+ */
+void SPPSession_BuildRecord(sppSession_t *pSession, uint8 *pBuf)
+{
+  uint16 rxNext = pSession->rxNext;
+
+  pBuf[0] = 0;
+  if (pSession->helloDue)
+  {
+    pBuf[0] |= SPP_SESSION_FLAG_HELLO;
+  }
+  if (pSession->resumed)
+  {
+    pBuf[0] |= SPP_SESSION_FLAG_RESUME;
+  }
+  if (pSession->resendDue)
+  {
+    pBuf[0] |= SPP_SESSION_FLAG_RESEND;
+  }
+
+  pBuf[1] = LO_UINT16(rxNext);
+  pBuf[2] = HI_UINT16(rxNext);
+  pBuf[3] = LO_UINT16(pSession->txBase);
+  pBuf[4] = HI_UINT16(pSession->txBase);
+}
+
+/*********************************************************************
+ * @fn      SPPSession_RecordSent
+ *
+ * @brief   A record built with SPPSession_BuildRecord was sent.
+ *
+ * @param   pSession - session
+ * @param   pBuf - the record
+ *
+ * @return  None
+ */
+void SPPSession_RecordSent(sppSession_t *pSession, uint8 *pBuf)
+{
+  if (pBuf[0] & SPP_SESSION_FLAG_HELLO)
+  {
+    pSession->helloDue = FALSE;
+    pSession->helloSent = TRUE;
+  }
+  if (pBuf[0] & SPP_SESSION_FLAG_RESEND)
+  {
+    pSession->resendDue = FALSE;
+  }
+
+  pSession->rxAcked = BUILD_UINT16(pBuf[1], pBuf[2]);
+}
+
+/*********************************************************************
+ * @fn      SPPSession_ProcessRecord
+ *
+ * @brief   Apply a record received from the peer.
+ *
+ * @param   pSession - session
+ * @param   pBuf - record
+ * @param   len - length of record
+ *
+ * @return  SUCCESS or FAILURE for a malformed record
+ */
+uint8 SPPSession_ProcessRecord(sppSession_t *pSession, uint8 *pBuf,
+                               uint16 len)
+{
+  ICall_CSState key;
+  uint8 flags;
+  uint16 ack;
+  uint16 base;
+
+  if (len < SPP_SESSION_RECORD_LEN)
+  {
+    return (FAILURE);
+  }
+
+  flags = pBuf[0];
+  ack = BUILD_UINT16(pBuf[1], pBuf[2]);
+  base = BUILD_UINT16(pBuf[3], pBuf[4]);
+
+  if (!(flags & SPP_SESSION_FLAG_HELLO))
+  {
+    // Acknowledgements mean nothing before the hello
+    if (pSession->synced)
+    {
+      SPPSession_ack(pSession, ack);
+
+      // The peer dropped what came after ack, start over from there
+      if (flags & SPP_SESSION_FLAG_RESEND)
+      {
+        pSession->txSent = 0;
+      }
+    }
+
+    return (SUCCESS);
+  }
+
+  // Both ends held state: the peer's ack is good and it resends from
+  // its base, dropping anything we already have. Otherwise start over
+  // at the peer's base.
+  key = ICall_enterCriticalSection();
+  if (!(flags & SPP_SESSION_FLAG_RESUME) || !pSession->resumed)
+  {
+    pSession->rxNext = base;
+  }
+  else if (SPPSESSION_SEQ_AFTER(base, pSession->rxNext))
+  {
+    // The peer gave up on data before we got it
+    pSession->rxLost += base - pSession->rxNext;
+    pSession->rxNext = base;
+  }
+  pSession->rxGap = FALSE;
+  pSession->synced = TRUE;
+  ICall_leaveCriticalSection(key);
+
+  if ((flags & SPP_SESSION_FLAG_RESUME) && pSession->resumed)
+  {
+    SPPSession_ack(pSession, ack);
+  }
+
+  // Whatever is left may not have made it, send it all again
+  pSession->txSent = 0;
+
+  // Answer a hello with ours, once per link
+  if (!pSession->helloSent)
+  {
+    pSession->helloDue = TRUE;
+  }
+
+  return (SUCCESS);
+}
+
+/*********************************************************************
+ * @fn      SPPSession_ack
+ *
+ * @brief   Free the blocks the peer acknowledged. Acknowledgements
+ *          outside the window are stale and ignored.
+ *
+ * @param   pSession - session
+ * @param   ack - sequence number the peer expects next
+ *
+ * @return  None
+ */
+static void SPPSession_ack(sppSession_t *pSession, uint16 ack)
+{
+  uint16 acked = ack - pSession->txBase;
+
+  if (acked > SPPUARTQueue_Count(&pSession->txQueue))
+  {
+    return;
+  }
+
+  pSession->txBase = ack;
+  pSession->txSent = (pSession->txSent > acked) ? (pSession->txSent - acked) : 0;
+
+  while (acked--)
+  {
+    SPPUARTQueue_Release(&pSession->txQueue);
+  }
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -0,0 +1,367 @@
+/*
+ * Filename: spp_uart_queue.c
+ *
+ * Description: Fixed block pool and message queues carrying UART data
+ * from the SDI task to the SPP application task without heap allocation.
+ *
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "bcomdef.h"
+
+#include "spp_uart_queue.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#if (SPP_UART_MSG_CNT & (SPP_UART_MSG_CNT - 1)) || (SPP_UART_MSG_CNT > 128)
+#error "SPP_UART_MSG_CNT must be a power of two no larger than 128"
+#endif
+
+#define SPPUARTQUEUE_MASK                       (SPP_UART_MSG_CNT - 1)
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// The blocks themselves
+static sppUARTMsg_t sppUARTMsgPool[SPP_UART_MSG_CNT];
+
+// Rings of block pointers with free running indices, masked on access.
+// Blocks travel producer to consumer through the sppUARTQueue_t rings and
+// back through the free ring. Each index has a single writer: the
+// producer owns the queue tails and freeHead, the consumer the queue
+// heads and freeTail.
+static sppUARTMsg_t *sppUARTFreeRing[SPP_UART_MSG_CNT];
+static volatile uint8 freeHead = 0;
+static volatile uint8 freeTail = 0;
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Init
+ *
+ * @brief   Return every block to the pool.
+ *
+ * @return  None
+ */
+void SPPUARTQueue_Init(void)
+{
+  uint8 i;
+
+  for (i = 0; i < SPP_UART_MSG_CNT; i++)
+  {
+    sppUARTFreeRing[i] = &sppUARTMsgPool[i];
+  }
+
+  freeHead = 0;
+  freeTail = SPP_UART_MSG_CNT;
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_InitQueue
+ *
+ * @brief   Empty a queue that holds no blocks.
+ *
+ * @param   pQueue - queue to initialize
+ *
+ * @return  None
+ */
+void SPPUARTQueue_InitQueue(sppUARTQueue_t *pQueue)
+{
+  pQueue->head = pQueue->tail = 0;
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Alloc
+ *
+ * @brief   Take a block from the pool.
+ *
+ * @return  Pointer to the block, NULL when the pool is empty
+ */
+sppUARTMsg_t *SPPUARTQueue_Alloc(void)
+{
+  uint8 head = freeHead;
+  sppUARTMsg_t *pMsg;
+
+  if (head == freeTail)
+  {
+    return (NULL);
+  }
+
+  pMsg = sppUARTFreeRing[head & SPPUARTQUEUE_MASK];
+  freeHead = head + 1;
+
+  return (pMsg);
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Put
+ *
+ * @brief   Append a block to a queue.
+ *
+ * @param   pQueue - queue to append to
+ * @param   pMsg - filled in block
+ *
+ * @return  None
+ */
+void SPPUARTQueue_Put(sppUARTQueue_t *pQueue, sppUARTMsg_t *pMsg)
+{
+  SPPUARTQueue_PutShared(&pQueue, 1, pMsg);
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_PutShared
+ *
+ * @brief   Append one block to several queues.
+ *
+ * @param   ppQueues - queues to append to
+ * @param   numQueues - number of queues, at least 1
+ * @param   pMsg - filled in block
+ *
+ * @return  None
+ */
+void SPPUARTQueue_PutShared(sppUARTQueue_t **ppQueues, uint8 numQueues,
+                            sppUARTMsg_t *pMsg)
+{
+  uint8 tail;
+  uint8 i;
+
+  // Every reference is counted before the first queue can release one
+  pMsg->refCnt = numQueues;
+
+  for (i = 0; i < numQueues; i++)
+  {
+    tail = ppQueues[i]->tail;
+
+    // Never more blocks than ring slots, so there is always room
+    ppQueues[i]->ring[tail & SPPUARTQUEUE_MASK] = pMsg;
+
+    // Publish the block to the consumer only once it is in place
+    ppQueues[i]->tail = tail + 1;
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_PutBack
+ *
+ * @brief   Return an unused block to the pool.
+ *
+ * @param   pMsg - block taken with SPPUARTQueue_Alloc
+ *
+ * @return  None
+ */
+void SPPUARTQueue_PutBack(sppUARTMsg_t *pMsg)
+{
+  uint8 head = freeHead - 1;
+
+  // Pushed back in front of freeHead, so freeTail keeps its one writer.
+  // With pMsg out of the pool the consumer's next slot is never this one
+  // unless every other block is free, and then it has nothing to free.
+  sppUARTFreeRing[head & SPPUARTQUEUE_MASK] = pMsg;
+  freeHead = head;
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Peek
+ *
+ * @brief   Oldest block in a queue.
+ *
+ * @param   pQueue - queue to look at
+ *
+ * @return  Pointer to the block, NULL when the queue is empty
+ */
+sppUARTMsg_t *SPPUARTQueue_Peek(sppUARTQueue_t *pQueue)
+{
+  uint8 head = pQueue->head;
+
+  if (head == pQueue->tail)
+  {
+    return (NULL);
+  }
+
+  return (pQueue->ring[head & SPPUARTQUEUE_MASK]);
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Release
+ *
+ * @brief   Remove the oldest block from a queue.
+ *
+ * @param   pQueue - queue to remove from
+ *
+ * @return  None
+ */
+void SPPUARTQueue_Release(sppUARTQueue_t *pQueue)
+{
+  uint8 head = pQueue->head;
+  sppUARTMsg_t *pMsg;
+
+  if (head == pQueue->tail)
+  {
+    return;
+  }
+
+  pMsg = pQueue->ring[head & SPPUARTQUEUE_MASK];
+  pQueue->head = head + 1;
+
+  // Only the consumer counts references down
+  if (--pMsg->refCnt == 0)
+  {
+    SPPUARTQueue_Free(pMsg);
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Drain
+ *
+ * @brief   Release every block in a queue.
+ *
+ * @param   pQueue - queue to empty
+ *
+ * @return  None
+ */
+void SPPUARTQueue_Drain(sppUARTQueue_t *pQueue)
+{
+  while (SPPUARTQueue_Peek(pQueue) != NULL)
+  {
+    SPPUARTQueue_Release(pQueue);
+  }
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Move
+ *
+ * @brief   Move the oldest block of one queue to the end of another.
+ *
+ * @param   pFrom - queue to take the block from
+ * @param   pTo - queue to append it to
+ *
+ * @return  The block moved, NULL if pFrom is empty
+ */
+sppUARTMsg_t *SPPUARTQueue_Move(sppUARTQueue_t *pFrom, sppUARTQueue_t *pTo)
+{
+  uint8 head = pFrom->head;
+  uint8 tail;
+  sppUARTMsg_t *pMsg;
+
+  if (head == pFrom->tail)
+  {
+    return (NULL);
+  }
+
+  pMsg = pFrom->ring[head & SPPUARTQUEUE_MASK];
+  pFrom->head = head + 1;
+
+  // The reference pFrom held now belongs to pTo
+  tail = pTo->tail;
+  pTo->ring[tail & SPPUARTQUEUE_MASK] = pMsg;
+  pTo->tail = tail + 1;
+
+  return (pMsg);
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_PeekAt
+ *
+ * @brief   Block at a position in a queue.
+ *
+ * @param   pQueue - queue to look at
+ * @param   index - position, 0 being the oldest block
+ *
+ * @return  Pointer to the block, NULL if the queue is shorter
+ */
+sppUARTMsg_t *SPPUARTQueue_PeekAt(sppUARTQueue_t *pQueue, uint8 index)
+{
+  uint8 head = pQueue->head;
+
+  if (index >= (uint8)(pQueue->tail - head))
+  {
+    return (NULL);
+  }
+
+  return (pQueue->ring[(uint8)(head + index) & SPPUARTQUEUE_MASK]);
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Count
+ *
+ * @brief   Number of blocks in a queue.
+ *
+ * @param   pQueue - queue to count
+ *
+ * @return  Blocks in the queue
+ */
+uint8 SPPUARTQueue_Count(sppUARTQueue_t *pQueue)
+{
+  return ((uint8)(pQueue->tail - pQueue->head));
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Free
+ *
+ * @brief   Return a block to the pool.
+ *
+ * @param   pMsg - block taken with SPPUARTQueue_Alloc
+ *
+ * @return  None
+ */
+void SPPUARTQueue_Free(sppUARTMsg_t *pMsg)
+{
+  uint8 tail = freeTail;
+
+  sppUARTFreeRing[tail & SPPUARTQUEUE_MASK] = pMsg;
+  freeTail = tail + 1;
+}
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_NumFree
+ *
+ * @brief   Number of blocks left in the pool.
+ *
+ * @return  Free blocks
+ */
+uint8 SPPUARTQueue_NumFree(void)
+{
+  return ((uint8)(freeTail - freeHead));
+}
+
+/*********************************************************************
+*********************************************************************/
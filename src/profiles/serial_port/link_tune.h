@@ -0,0 +1,197 @@
+/*
+ * Filename: link_tune.h
+ *
+ * Description: Link tuning for the SPP examples. Negotiates the ATT
+ * MTU and data length extension on every new link and reports the payload
+ * size the application should send in.
+ *
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LINKTUNE_H
+#define LINKTUNE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include "bcomdef.h"
+#include "gatt.h"
+#include "icall.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Bytes of a write or notification taken up by the ATT opcode and handle
+#define LINKTUNE_ATT_HDR_SIZE                   3
+
+// Data length extension request, the largest the controller supports
+#ifndef LINKTUNE_TX_OCTETS
+#define LINKTUNE_TX_OCTETS                      251
+#endif
+
+#ifndef LINKTUNE_TX_TIME
+#define LINKTUNE_TX_TIME                        2120
+#endif
+
+// Links tuned at the same time
+#ifndef LINKTUNE_MAX_CONNS
+#ifdef MAX_NUM_BLE_CONNS
+#define LINKTUNE_MAX_CONNS                      MAX_NUM_BLE_CONNS
+#else
+#define LINKTUNE_MAX_CONNS                      1
+#endif
+#endif
+
+// Negotiations still outstanding, see linkTuneResult_t
+#define LINKTUNE_PENDING_MTU                    0x01
+#define LINKTUNE_PENDING_DLE                    0x02
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Link parameters as negotiated so far
+typedef struct
+{
+  uint16 connHandle;    // Link the parameters apply to
+  uint16 mtu;           // ATT MTU
+  uint16 payload;       // Bytes of application data per write/notification
+  uint16 txOctets;      // Link layer TX payload, 27 until DLE succeeds
+  uint16 rxOctets;      // Link layer RX payload
+  uint8 pending;        // LINKTUNE_PENDING_xxx negotiations not yet answered
+} linkTuneResult_t;
+
+/*********************************************************************
+ * Profile Callbacks
+ */
+
+// Called whenever the link parameters change, from the application task
+typedef void (*linkTuneCB_t)( linkTuneResult_t *pResult );
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      LinkTune_Init
+ *
+ * @brief   Register the application task and callback. The task must
+ *          have called GATT_InitClient and registered for GAP and GATT
+ *          messages.
+ *
+ * @param   taskEntity - ICall entity ATT responses are sent to
+ * @param   pfnCB - called whenever the link parameters change
+ *
+ * @return  None
+ */
+extern void LinkTune_Init( ICall_EntityID taskEntity, linkTuneCB_t pfnCB );
+
+/*********************************************************************
+ * @fn      LinkTune_Start
+ *
+ * @brief   Tune a new link: request the largest ATT MTU (MAX_PDU_SIZE -
+ *          L2CAP header) and data length extension. The callback is run
+ *          straight away with the default parameters and again as each
+ *          result arrives. Up to LINKTUNE_MAX_CONNS links are tuned
+ *          at a time.
+ *
+ * @param   connHandle - new link
+ *
+ * @return  SUCCESS, bleNoResources when all entries are taken, or the
+ *          status of the first request that failed
+ */
+extern bStatus_t LinkTune_Start( uint16 connHandle );
+
+/*********************************************************************
+ * @fn      LinkTune_Stop
+ *
+ * @brief   Forget the link, call when it is terminated.
+ *
+ * @param   connHandle - terminated link
+ *
+ * @return  None
+ */
+extern void LinkTune_Stop( uint16 connHandle );
+
+/*********************************************************************
+ * @fn      LinkTune_ProcessGATTMsg
+ *
+ * @brief   Pick the MTU exchange results out of the application's GATT
+ *          messages. The caller still owns and frees the message.
+ *
+ * @param   pMsg - GATT message received by the application
+ *
+ * @return  TRUE if the message was an MTU exchange response for a
+ *          tuned link and needs no further processing
+ */
+extern uint8 LinkTune_ProcessGATTMsg( gattMsgEvent_t *pMsg );
+
+/*********************************************************************
+ * @fn      LinkTune_ProcessHCIEvt
+ *
+ * @brief   Pick the data length change out of the application's
+ *          HCI_GAP_EVENT_EVENT messages.
+ *
+ * @param   pMsg - HCI event received by the application
+ *
+ * @return  None
+ */
+extern void LinkTune_ProcessHCIEvt( ICall_Hdr *pMsg );
+
+/*********************************************************************
+ * @fn      LinkTune_GetResult
+ *
+ * @brief   Current parameters of a link.
+ *
+ * @param   connHandle - tuned link
+ *
+ * @return  Pointer to the parameters, NULL if the link is not tuned
+ */
+extern const linkTuneResult_t *LinkTune_GetResult( uint16 connHandle );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINKTUNE_H */
@@ -66,6 +66,9 @@ extern "C"
 
 #define SERIALPORTSERVICE_SET_UART_CONFIG       3  // W uint8 - Profile SET_UART_CONFIG value
 #define SERIALPORTSERVICE_GET_UART_CONFIG       4  // R uint8 - Profile GET_UART_CONFIG value
+#define SERIALPORTSERVICE_CHAR_CREDITS          5  // W uint8 - Profile Characteristic 5 value
+#define SERIALPORTSERVICE_CHAR_SESSION          6  // W uint8 - Profile Characteristic 6 value (SPP_RELIABLE)
+#define SERIALPORTSERVICE_CHAR_DATA_RECORD      7  // W uint8 - segment of a Characteristic 2 long write (change callback only)
    
 // Serial Port Service UUID
 #define SERIALPORTSERVICE_SERV_UUID             0xC0E0
@@ -74,6 +77,8 @@ extern "C"
 #define SERIALPORTSERVICE_DATA_UUID             0xC0E1
 #define SERIALPORTSERVICE_STATUS_UUID           0xC0E2
 #define SERIALPORTSERVICE_CONFIG_UUID           0xC0E3
+#define SERIALPORTSERVICE_CREDITS_UUID          0xC0E4
+#define SERIALPORTSERVICE_SESSION_UUID          0xC0E5
 
 // Serial Port Profile Services bit fields
 #define SERIALPORTSERVICE_SERVICE               0x00000001
@@ -81,13 +86,52 @@ extern "C"
 // Length of Status Characteristic in bytes
 #define SERIALPORTSERVICE_STATUS_LEN            7
 
+// Length of the optional Status Characteristic extension in bytes. With
+// SPP_STATUS_EXT defined the application appends its own transport counters
+// to the status value, see SerialPortService_SetStatusExt
+#ifdef SPP_STATUS_EXT
+#define SERIALPORTSERVICE_STATUS_EXT_LEN        14
+#else
+#define SERIALPORTSERVICE_STATUS_EXT_LEN        0
+#endif
+
 // Length of Config Characteristic in bytes
 #define SERIALPORTSERVICE_CONFIG_LEN            3
   
-//Length of Data Characteristic in bytes
-#define SERIALPORTSERVICE_DATA_LEN              128 //20  
+//Length of Data Characteristic in bytes. A single write or notification
+//carries up to ATT MTU - 3 of these, the default covers the largest ATT MTU
+//the stack negotiates (247). Longer records need a long (prepared) write.
+#ifndef SERIALPORTSERVICE_DATA_LEN
+#define SERIALPORTSERVICE_DATA_LEN              244
+#endif
+
+//Define to keep every write to the Data Characteristic in
+//SerialPortServiceData, for applications that read it back. Without it
+//written data is copied once, from the stack's buffer into the SDI TX frame
+//it goes out to the UART in.
+//#define SERIALPORTSERVICE_DATA_READBACK
+
+// Clients with a data stream of their own, each keeps its credits, long
+// write record, SDI channel and byte counts
+#ifndef SERIALPORTSERVICE_MAX_CONNS
+#ifdef MAX_NUM_BLE_CONNS
+#define SERIALPORTSERVICE_MAX_CONNS             MAX_NUM_BLE_CONNS
+#else
+#define SERIALPORTSERVICE_MAX_CONNS             1
+#endif
+#endif
+
+// Length of Credits Characteristic in bytes. Each write or notification
+// grants the peer that many more Data Characteristic messages.
+#define SERIALPORTSERVICE_CREDITS_LEN           1
    
-#define SERVAPP_NUM_ATTR_SUPPORTED              11   
+// With SPP_RELIABLE a Session Characteristic carrying session records
+// (see spp_session.h) follows the others, the handles before it do not move
+#ifdef SPP_RELIABLE
+#define SERVAPP_NUM_ATTR_SUPPORTED              19
+#else
+#define SERVAPP_NUM_ATTR_SUPPORTED              15   
+#endif
 extern gattAttribute_t SerialPortServiceAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED];      
 extern uint8 SerialPortServiceData[SERIALPORTSERVICE_DATA_LEN];
 
@@ -104,8 +148,9 @@ extern uint8 SerialPortServiceData[SERIALPORTSERVICE_DATA_LEN];
  * Profile Callbacks
  */
 
-// Callback when a characteristic value has changed
-typedef void (*SerialPortServiceChange_t)( uint8 paramID );
+// Callback when a characteristic value has changed, with the connection
+// of the client that wrote it
+typedef void (*SerialPortServiceChange_t)( uint16 connHandle, uint8 paramID );
 
 typedef struct
 {
@@ -160,6 +205,201 @@ extern bStatus_t SerialPortService_AddStatusErrorCount( UART_Status errorCode );
 
 extern bStatus_t SerialPortService_AddStatusTXBytes( uint16 count );
 extern bStatus_t SerialPortService_AddStatusRXBytes( uint16 count );
+
+/*********************************************************************
+ * @fn      SerialPortService_SendNotification
+ *
+ * @brief   Notify the Data Characteristic to one connection, straight
+ *          from the caller's buffer into a stack buffer. Unlike
+ *          SerialPortService_SetParameter the attribute value is left
+ *          alone and the CCC table is not walked, so several notifications
+ *          can be queued to the controller back to back.
+ *
+ * @param   connHandle - connection to notify
+ * @param   len - length of data, at most ATT MTU - 3
+ * @param   value - pointer to data to send
+ *
+ * @return  SUCCESS, bleIncorrectMode if the peer has not enabled
+ *          notifications, bleInvalidRange if len exceeds the ATT MTU,
+ *          bleMemAllocError, MSG_BUFFER_NOT_AVAIL or blePending while
+ *          the stack is out of buffers, or another GATT_Notification error
+ */
+extern bStatus_t SerialPortService_SendNotification( uint16 connHandle, uint16 len,
+                                                     void *value );
+
+/*********************************************************************
+ * @fn      SerialPortService_SendCredits
+ *
+ * @brief   Grant the peer more Data Characteristic writes by notifying
+ *          the Credits Characteristic.
+ *
+ * @param   connHandle - connection to notify
+ * @param   credits - number of writes granted, added to what the peer holds
+ *
+ * @return  SUCCESS, bleIncorrectMode if the peer has not enabled credit
+ *          notifications, or the reason the notification was not sent
+ */
+extern bStatus_t SerialPortService_SendCredits( uint16 connHandle, uint8 credits );
+
+/*********************************************************************
+ * @fn      SerialPortService_TakeCredits
+ *
+ * @brief   Collect the credits a peer has granted by writing the
+ *          Credits Characteristic since the last call.
+ *
+ * @param   connHandle - connection of the peer
+ *
+ * @return  Number of notifications the peer has granted
+ */
+extern uint16 SerialPortService_TakeCredits( uint16 connHandle );
+
+/*********************************************************************
+ * @fn      SerialPortService_CreditsEnabled
+ *
+ * @brief   Whether the peer takes part in credit based flow control,
+ *          which it signals by enabling Credits Characteristic
+ *          notifications. Peers that do not are sent data without
+ *          credits, as before the characteristic existed.
+ *
+ * @param   connHandle - connection to check
+ *
+ * @return  TRUE if credit notifications are enabled
+ */
+extern uint8 SerialPortService_CreditsEnabled( uint16 connHandle );
+
+#ifdef SPP_RELIABLE
+/*********************************************************************
+ * @fn      SerialPortService_SendSeqNotification
+ *
+ * @brief   As SerialPortService_SendNotification, with the session
+ *          sequence number sent in front of the data.
+ *
+ * @param   connHandle - connection to notify
+ * @param   seq - sequence number of the message
+ * @param   len - length of data, at most ATT MTU - 3 - SPP_SESSION_HDR_SIZE
+ * @param   value - pointer to data to send
+ *
+ * @return  As SerialPortService_SendNotification
+ */
+extern bStatus_t SerialPortService_SendSeqNotification( uint16 connHandle, uint16 seq,
+                                                        uint16 len, void *value );
+
+/*********************************************************************
+ * @fn      SerialPortService_SendSessionRecord
+ *
+ * @brief   Notify a session record on the Session Characteristic.
+ *
+ * @param   connHandle - connection to notify
+ * @param   pRecord - record of SPP_SESSION_RECORD_LEN bytes
+ *
+ * @return  SUCCESS, bleIncorrectMode if the peer has not enabled session
+ *          notifications, or the reason the notification was not sent
+ */
+extern bStatus_t SerialPortService_SendSessionRecord( uint16 connHandle, uint8 *pRecord );
+
+/*********************************************************************
+ * @fn      SerialPortService_TakeSessionRecord
+ *
+ * @brief   Collect the session record the peer wrote to the Session
+ *          Characteristic, call on the SERIALPORTSERVICE_CHAR_SESSION
+ *          change callback. Records written since the last call are
+ *          merged into the newest, keeping a hello among them.
+ *
+ * @param   connHandle - connection of the peer
+ * @param   pBuf - buffer of SPP_SESSION_RECORD_LEN bytes
+ *
+ * @return  Length of the record, 0 if none was written
+ */
+extern uint8 SerialPortService_TakeSessionRecord( uint16 connHandle, uint8 *pBuf );
+
+/*********************************************************************
+ * @fn      SerialPortService_SessionEnabled
+ *
+ * @brief   Whether the peer runs a reliable session, which it signals
+ *          by enabling Session Characteristic notifications. Other peers
+ *          get a plain stream without sequence numbers.
+ *
+ * @param   connHandle - connection to check
+ *
+ * @return  TRUE if session notifications are enabled
+ */
+extern uint8 SerialPortService_SessionEnabled( uint16 connHandle );
+#endif //SPP_RELIABLE
+
+/*********************************************************************
+ * @fn      SerialPortService_FlushDataRecord
+ *
+ * @brief   Pass a Data Characteristic long write on to the UART. The
+ *          segments of a prepared write are reassembled as the stack
+ *          executes them, call this from the application task when the
+ *          SERIALPORTSERVICE_CHAR_DATA_RECORD change callback arrives, by
+ *          which time the whole write has been executed. The callback
+ *          comes once per segment, only the first call passes the record
+ *          on.
+ *
+ * @param   connHandle - connection the callback came with
+ *
+ * @return  Number of bytes passed on, 0 if no long write was pending
+ */
+extern uint16 SerialPortService_FlushDataRecord( uint16 connHandle );
+
+/*********************************************************************
+ * @fn      SerialPortService_OpenConn
+ *
+ * @brief   Start the data stream of a newly connected peer. Data the
+ *          peer writes goes out on the given SDI channel. A peer that
+ *          writes before its stream is opened gets one on
+ *          SDI_CHANNEL_DEFAULT.
+ *
+ * @param   connHandle - connection of the peer
+ * @param   channel - SDI channel, below SDI_CHANNEL_CNT
+ *
+ * @return  SUCCESS or bleNoResources if all
+ *          SERIALPORTSERVICE_MAX_CONNS streams are taken
+ */
+extern bStatus_t SerialPortService_OpenConn( uint16 connHandle, uint8 channel );
+
+/*********************************************************************
+ * @fn      SerialPortService_CloseConn
+ *
+ * @brief   End the data stream of a disconnected peer, dropping any
+ *          long write it left unfinished.
+ *
+ * @param   connHandle - connection of the peer
+ *
+ * @return  None
+ */
+extern void SerialPortService_CloseConn( uint16 connHandle );
+
+/*********************************************************************
+ * @fn      SerialPortService_GetConnBytes
+ *
+ * @brief   Bytes carried on one peer's data stream since it opened. The
+ *          Status Characteristic counts all peers together.
+ *
+ * @param   connHandle - connection of the peer
+ * @param   pTxBytes - bytes notified to the peer
+ * @param   pRxBytes - bytes written by the peer
+ *
+ * @return  SUCCESS or bleNotConnected if the stream is not open
+ */
+extern bStatus_t SerialPortService_GetConnBytes( uint16 connHandle, uint32 *pTxBytes,
+                                                 uint32 *pRxBytes );
+
+#ifdef SPP_STATUS_EXT
+/*********************************************************************
+ * @fn      SerialPortService_SetStatusExt
+ *
+ * @brief   Set the extension appended to the Status Characteristic.
+ *          Unlike the base counters it is not cleared when read.
+ *
+ * @param   len - length of data to write, SERIALPORTSERVICE_STATUS_EXT_LEN
+ * @param   value - pointer to data to write
+ *
+ * @return  bStatus_t
+ */
+extern bStatus_t SerialPortService_SetStatusExt( uint8 len, void *value );
+#endif //SPP_STATUS_EXT
 extern bStatus_t SerialPortService_GetUartConfig( UART_Params *params );  
 extern bStatus_t SerialPortService_SetUartConfig( UART_Params *params );
 
@@ -0,0 +1,297 @@
+/*
+ * Filename: spp_bench.h
+ *
+ * Description: Probe frames and result bookkeeping for the SPP BLE
+ * benchmark mode (SPP_BENCH), shared by the client and the server.
+ *
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SPPBENCH_H
+#define SPPBENCH_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include "bcomdef.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Probe frame, carried as one Data write or notification:
+// [magic][type][seq, 2][timestamp us, 4][filler...], little endian
+#define SPPBENCH_MAGIC                          0xA5
+#define SPPBENCH_HDR_SIZE                       8
+
+// Probe types
+#define SPPBENCH_TYPE_ECHO                      0x01  // Returned unchanged by the server
+#define SPPBENCH_TYPE_BULK                      0x02  // Counted by the server
+#define SPPBENCH_TYPE_END                       0x03  // Ends a bulk run, answered with a report
+#define SPPBENCH_TYPE_REPORT                    0x04  // Server's counters of a bulk run
+
+// Report probe: header, then received count, lost count, bytes and the
+// time from first to last probe received (us)
+#define SPPBENCH_REPORT_SIZE                    (SPPBENCH_HDR_SIZE + 12)
+
+// Run modes
+#define SPPBENCH_MODE_ECHO                      0
+#define SPPBENCH_MODE_BULK                      1
+
+// Latency samples kept per run, later samples only count towards max
+#ifndef SPPBENCH_MAX_SAMPLES
+#define SPPBENCH_MAX_SAMPLES                    128
+#endif
+
+// Longest result line, see SPPBench_FormatResult
+#define SPPBENCH_RESULT_LEN                     96
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Header of a received probe
+typedef struct
+{
+  uint8 type;           // SPPBENCH_TYPE_xxx
+  uint16 seq;           // Probe number within the run
+  uint32 timestamp;     // Sender's clock when the probe was built, us
+} sppBenchProbe_t;
+
+// Receive side counters of a bulk run
+typedef struct
+{
+  uint16 received;      // Probes received
+  uint16 lost;          // Gaps in the sequence numbers
+  uint32 bytes;         // Bytes received, headers included
+  uint32 firstUs;       // Arrival of the first probe
+  uint32 lastUs;        // Arrival of the latest probe
+  uint16 nextSeq;       // Sequence number expected next
+} sppBenchRx_t;
+
+// Latency samples of an echo run
+typedef struct
+{
+  uint16 count;                             // Samples taken
+  uint32 max;                               // Largest sample, us
+  uint32 samples[SPPBENCH_MAX_SAMPLES];     // First SPPBENCH_MAX_SAMPLES samples
+} sppBenchLatency_t;
+
+// Outcome of a run, one line of the report
+typedef struct
+{
+  uint8 mode;           // SPPBENCH_MODE_xxx
+  uint16 size;          // Probe size, bytes
+  uint16 count;         // Probes requested
+  uint16 sent;          // Probes handed to the stack
+  uint16 received;      // Probes that arrived at the far end
+  uint16 lost;          // Probes that did not
+  uint32 p50Us;         // Round trip latency percentiles, echo runs only
+  uint32 p99Us;
+  uint32 maxUs;
+  uint32 goodputBps;    // Probe bits delivered per second
+} sppBenchResult_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      SPPBench_Now
+ *
+ * @brief   Local time for probe timestamps.
+ *
+ * @return  Microseconds, wrapping
+ */
+extern uint32 SPPBench_Now( void );
+
+/*********************************************************************
+ * @fn      SPPBench_BuildProbe
+ *
+ * @brief   Write a probe header stamped with the current time and fill
+ *          the rest of the buffer with a counting pattern.
+ *
+ * @param   pBuf - buffer of len bytes
+ * @param   len - probe size, at least SPPBENCH_HDR_SIZE
+ * @param   type - SPPBENCH_TYPE_xxx
+ * @param   seq - probe number
+ *
+ * @return  SUCCESS or FAILURE if len is too short
+ */
+extern uint8 SPPBench_BuildProbe( uint8 *pBuf, uint16 len, uint8 type,
+                                  uint16 seq );
+
+/*********************************************************************
+ * @fn      SPPBench_ParseProbe
+ *
+ * @brief   Read the header of a received probe.
+ *
+ * @param   pBuf - received data
+ * @param   len - length of data
+ * @param   pProbe - header out
+ *
+ * @return  TRUE if the data is a probe
+ */
+extern uint8 SPPBench_ParseProbe( const uint8 *pBuf, uint16 len,
+                                  sppBenchProbe_t *pProbe );
+
+/*********************************************************************
+ * @fn      SPPBench_RxReset
+ *
+ * @brief   Clear the counters of a bulk run.
+ *
+ * @param   pRx - counters
+ *
+ * @return  None
+ */
+extern void SPPBench_RxReset( sppBenchRx_t *pRx );
+
+/*********************************************************************
+ * @fn      SPPBench_RxAdd
+ *
+ * @brief   Count a received bulk probe.
+ *
+ * @param   pRx - counters
+ * @param   pProbe - probe header
+ * @param   len - probe size
+ *
+ * @return  None
+ */
+extern void SPPBench_RxAdd( sppBenchRx_t *pRx, const sppBenchProbe_t *pProbe,
+                            uint16 len );
+
+/*********************************************************************
+ * @fn      SPPBench_BuildReport
+ *
+ * @brief   Write a report probe carrying bulk run counters.
+ *
+ * @param   pBuf - buffer of at least SPPBENCH_REPORT_SIZE bytes
+ * @param   pRx - counters
+ *
+ * @return  Report size, SPPBENCH_REPORT_SIZE
+ */
+extern uint16 SPPBench_BuildReport( uint8 *pBuf, const sppBenchRx_t *pRx );
+
+/*********************************************************************
+ * @fn      SPPBench_ParseReport
+ *
+ * @brief   Read the counters out of a report probe.
+ *
+ * @param   pBuf - received data
+ * @param   len - length of data
+ * @param   pRx - counters out
+ *
+ * @return  TRUE if the data is a report probe
+ */
+extern uint8 SPPBench_ParseReport( const uint8 *pBuf, uint16 len,
+                                   sppBenchRx_t *pRx );
+
+/*********************************************************************
+ * @fn      SPPBench_LatencyReset
+ *
+ * @brief   Drop all latency samples.
+ *
+ * @param   pLat - samples
+ *
+ * @return  None
+ */
+extern void SPPBench_LatencyReset( sppBenchLatency_t *pLat );
+
+/*********************************************************************
+ * @fn      SPPBench_LatencyAdd
+ *
+ * @brief   Add a latency sample.
+ *
+ * @param   pLat - samples
+ * @param   us - latency
+ *
+ * @return  None
+ */
+extern void SPPBench_LatencyAdd( sppBenchLatency_t *pLat, uint32 us );
+
+/*********************************************************************
+ * @fn      SPPBench_LatencyPercentile
+ *
+ * @brief   Latency below which the given share of the kept samples
+ *          fall. Sorts the samples, call once all have been added.
+ *
+ * @param   pLat - samples
+ * @param   percent - 1 to 100
+ *
+ * @return  Latency, us, 0 without samples
+ */
+extern uint32 SPPBench_LatencyPercentile( sppBenchLatency_t *pLat,
+                                          uint8 percent );
+
+/*********************************************************************
+ * @fn      SPPBench_Goodput
+ *
+ * @brief   Bits per second for bytes moved in a time span.
+ *
+ * @param   bytes - bytes moved
+ * @param   us - time span
+ *
+ * @return  Bits per second, 0 for an empty span
+ */
+extern uint32 SPPBench_Goodput( uint32 bytes, uint32 us );
+
+/*********************************************************************
+ * @fn      SPPBench_FormatResult
+ *
+ * @brief   Write a result as a CSV line for the host:
+ *          BENCH,mode,size,count,sent,received,lost,p50_us,p99_us,
+ *          max_us,goodput_bps followed by CR LF.
+ *
+ * @param   pBuf - buffer of at least SPPBENCH_RESULT_LEN bytes
+ * @param   pResult - result
+ *
+ * @return  Line length
+ */
+extern uint16 SPPBench_FormatResult( char *pBuf,
+                                     const sppBenchResult_t *pResult );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPPBENCH_H */
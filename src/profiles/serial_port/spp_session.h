@@ -0,0 +1,325 @@
+/*
+ * Filename: spp_session.h
+ *
+ * Description: Reliable, resumable SPP data sessions (SPP_RELIABLE).
+ * Sequence numbers every Data Characteristic message, holds sent UART
+ * blocks until the peer acknowledges them and picks a session up
+ * where it left off when the same peer reconnects.
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SPPSESSION_H
+#define SPPSESSION_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include "bcomdef.h"
+#include "spp_uart_queue.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Sessions kept, connected or waiting for their peer to come back. A
+// new peer takes over the session parked longest once all are in use.
+// Parked sessions hold on to UART blocks, each one takes up to
+// SPP_SESSION_WINDOW blocks of the pool.
+#ifndef SPP_SESSION_MAX
+#ifdef MAX_NUM_BLE_CONNS
+#define SPP_SESSION_MAX                         MAX_NUM_BLE_CONNS
+#else
+#define SPP_SESSION_MAX                         1
+#endif
+#endif
+
+// Blocks held per session until the peer acknowledges them, beyond that
+// no new data is sent. Also the most a parked session keeps.
+#ifndef SPP_SESSION_WINDOW
+#define SPP_SESSION_WINDOW                      (SPP_UART_MSG_CNT / 2)
+#endif
+
+// Sequence number in front of every Data Characteristic message,
+// little endian
+#define SPP_SESSION_HDR_SIZE                    2
+
+// Session record, exchanged through the Status Characteristic:
+// [flags][ack, 2][base, 2], little endian. ack is the sequence number
+// the sender expects next, base the oldest one it still holds.
+#define SPP_SESSION_RECORD_LEN                  5
+
+// Session record flags
+#define SPP_SESSION_FLAG_HELLO                  0x01  // Sent once per link, (re)starts the session
+#define SPP_SESSION_FLAG_RESUME                 0x02  // Sender held state for the peer
+#define SPP_SESSION_FLAG_RESEND                 0x04  // Sender dropped data from ack on, resend it
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Session with one peer
+typedef struct
+{
+  uint8 inUse;              // Slot holds a session
+  uint8 addr[B_ADDR_LEN];   // Peer identity address, sessions resume by it
+  uint16 connHandle;        // Link, INVALID_CONNHANDLE while parked
+  uint8 resumed;            // Held state for the peer when the link came up
+  uint8 synced;             // Peer's hello processed on this link
+  uint8 helloDue;           // Own hello still to be sent on this link
+  uint8 helloSent;          // Own hello sent on this link
+  uint16 txBase;            // Sequence number of the oldest block in txQueue
+  uint8 txSent;             // Blocks of txQueue sent on this link
+  uint16 rxNext;            // Sequence number expected next from the peer
+  uint16 rxAcked;           // rxNext last reported to the peer
+  uint16 rxLost;            // Messages the peer could not retransmit
+  uint8 rxGap;              // Dropped rxNext, later messages wait for its resend
+  uint8 resendDue;          // Resend request still to be sent to the peer
+  uint32 parkedAt;          // When the link went down, to pick one to reuse
+  sppUARTQueue_t txQueue;   // Blocks the peer has not acknowledged yet
+} sppSession_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ *
+ * Everything but SPPSession_Rx runs in the application task, which
+ * owns the UART queues (see spp_uart_queue.h).
+ */
+
+/*********************************************************************
+ * @fn      SPPSession_Init
+ *
+ * @brief   Forget all sessions. Call after SPPUARTQueue_Init.
+ *
+ * @return  None
+ */
+extern void SPPSession_Init( void );
+
+/*********************************************************************
+ * @fn      SPPSession_Open
+ *
+ * @brief   Attach a new link to the session of its peer, or start a new
+ *          session if there is none. Bonded peers are matched by the
+ *          identity address GAPBondMgr resolves their address to, others
+ *          by the address they connected with.
+ *
+ * @param   connHandle - link to the peer
+ * @param   addrType - type of the peer's address on this link
+ * @param   pAddr - peer's address on this link
+ *
+ * @return  The session, NULL if every session is connected
+ */
+extern sppSession_t *SPPSession_Open( uint16 connHandle, uint8 addrType,
+                                      uint8 *pAddr );
+
+/*********************************************************************
+ * @fn      SPPSession_Close
+ *
+ * @brief   Park the session of a link that went down. UART data still
+ *          queued for the peer is kept with it, as much as the window
+ *          holds, and sent once it resumes. The rest is dropped, as is
+ *          the whole session if the peer never said hello.
+ *
+ * @param   pSession - session
+ * @param   pPending - queue of UART data not taken in yet, emptied,
+ *                     may be NULL
+ *
+ * @return  None
+ */
+extern void SPPSession_Close( sppSession_t *pSession, sppUARTQueue_t *pPending );
+
+/*********************************************************************
+ * @fn      SPPSession_Find
+ *
+ * @brief   Session of a link.
+ *
+ * @param   connHandle - link to the peer
+ *
+ * @return  The session, NULL if the link has none
+ */
+extern sppSession_t *SPPSession_Find( uint16 connHandle );
+
+/*********************************************************************
+ * @fn      SPPSession_Fill
+ *
+ * @brief   Take UART blocks into the session, as many as the window
+ *          has room for. From here on they are only freed once the peer
+ *          acknowledges them.
+ *
+ * @param   pSession - session
+ * @param   pQueue - queue to take the blocks from
+ *
+ * @return  None
+ */
+extern void SPPSession_Fill( sppSession_t *pSession, sppUARTQueue_t *pQueue );
+
+/*********************************************************************
+ * @fn      SPPSession_NextTx
+ *
+ * @brief   Next block to send on the link: retransmissions first, then
+ *          new data. Nothing is sent before both hellos are through.
+ *
+ * @param   pSession - session
+ * @param   pSeq - sequence number of the block
+ *
+ * @return  The block, left in the session, NULL if there is none
+ */
+extern sppUARTMsg_t *SPPSession_NextTx( sppSession_t *pSession, uint16 *pSeq );
+
+/*********************************************************************
+ * @fn      SPPSession_Sent
+ *
+ * @brief   The block returned by SPPSession_NextTx is with the stack.
+ *
+ * @param   pSession - session
+ *
+ * @return  None
+ */
+extern void SPPSession_Sent( sppSession_t *pSession );
+
+/*********************************************************************
+ * @fn      SPPSession_Rx
+ *
+ * @brief   Check the sequence number of a Data Characteristic message.
+ *          Messages on links without a synchronised session carry no
+ *          sequence number and are passed as they are. May be called
+ *          from the stack's context.
+ *
+ * @param   connHandle - link the message came on
+ * @param   pData - message
+ * @param   len - length of message
+ * @param   pOffset - where the UART data starts in the message
+ *
+ * @return  TRUE to pass the data on, FALSE for a retransmission of
+ *          data already passed on
+ */
+extern uint8 SPPSession_Rx( uint16 connHandle, uint8 *pData, uint16 len,
+                            uint16 *pOffset );
+
+/*********************************************************************
+ * @fn      SPPSession_RxDropped
+ *
+ * @brief   A message SPPSession_Rx passed on could not be delivered, eg.
+ *          for lack of a TX frame. Its sequence number is expected
+ *          again and the peer is asked to resend from there, messages
+ *          after it are dropped until the resend arrives. Call right
+ *          after SPPSession_Rx, from the same context.
+ *
+ * @param   connHandle - link the message came on
+ * @param   pData - message
+ * @param   len - length of message
+ *
+ * @return  None
+ */
+extern void SPPSession_RxDropped( uint16 connHandle, uint8 *pData, uint16 len );
+
+/*********************************************************************
+ * @fn      SPPSession_StartHello
+ *
+ * @brief   Have the next record sent on the link be a hello. The client
+ *          starts, the server answers with its own.
+ *
+ * @param   pSession - session
+ *
+ * @return  None
+ */
+extern void SPPSession_StartHello( sppSession_t *pSession );
+
+/*********************************************************************
+ * @fn      SPPSession_RecordDue
+ *
+ * @brief   Whether a hello, a new acknowledgement or a resend request is
+ *          waiting to be sent to the peer.
+ *
+ * @param   pSession - session
+ *
+ * @return  TRUE if a record should be sent
+ */
+extern uint8 SPPSession_RecordDue( sppSession_t *pSession );
+
+/*********************************************************************
+ * @fn      SPPSession_BuildRecord
+ *
+ * @brief   Write the session record for the peer. Call
+ *          SPPSession_RecordSent once it is on its way.
+ *
+ * @param   pSession - session
+ * @param   pBuf - buffer of SPP_SESSION_RECORD_LEN bytes
+ *
+ * @return  None
+ */
+extern void SPPSession_BuildRecord( sppSession_t *pSession, uint8 *pBuf );
+
+/*********************************************************************
+ * @fn      SPPSession_RecordSent
+ *
+ * @brief   A record built with SPPSession_BuildRecord was sent.
+ *
+ * @param   pSession - session
+ * @param   pBuf - the record
+ *
+ * @return  None
+ */
+extern void SPPSession_RecordSent( sppSession_t *pSession, uint8 *pBuf );
+
+/*********************************************************************
+ * @fn      SPPSession_ProcessRecord
+ *
+ * @brief   Apply a record received from the peer: free what it
+ *          acknowledges and, for a hello, line the sequence numbers of
+ *          both directions up with it. For a hello or a resend request,
+ *          resend whatever it is missing.
+ *
+ * @param   pSession - session
+ * @param   pBuf - record
+ * @param   len - length of record
+ *
+ * @return  SUCCESS or FAILURE for a malformed record
+ */
+extern uint8 SPPSession_ProcessRecord( sppSession_t *pSession, uint8 *pBuf,
+                                       uint16 len );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPPSESSION_H */
@@ -0,0 +1,269 @@
+/*
+ * Filename: spp_uart_queue.h
+ *
+ * Description: Fixed block pool and message queues carrying UART data
+ * from the SDI task to the SPP application task without heap allocation.
+ *
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SPPUARTQUEUE_H
+#define SPPUARTQUEUE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include "bcomdef.h"
+#include "serial_port_service.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Number of UART message blocks, a power of two no larger than 128
+#ifndef SPP_UART_MSG_CNT
+#define SPP_UART_MSG_CNT                        8
+#endif
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// One block of UART data on its way to BLE
+typedef struct
+{
+  uint8 event;                                // Type of event
+  uint8 length;                               // Bytes used in data
+  uint8 refCnt;                               // Queues still holding the block
+  uint8 data[SERIALPORTSERVICE_DATA_LEN];     // UART data
+} sppUARTMsg_t;
+
+// Queue of blocks, a ring of block pointers. Every block is in at most
+// one place per queue, so the ring can never overflow.
+typedef struct
+{
+  sppUARTMsg_t *ring[SPP_UART_MSG_CNT];
+  volatile uint8 head;                        // Written by the consumer only
+  volatile uint8 tail;                        // Written by the producer only
+} sppUARTQueue_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ *
+ * The pool and queues are shared by exactly one producer context (the
+ * SDI task: Alloc, Put, PutShared, PutBack) and one consumer context (the
+ * application task: Peek, Release, Free, Drain, Move, PeekAt, Count)
+ * and need no locking between the two. Every call but PutShared and
+ * Drain is O(1).
+ */
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Init
+ *
+ * @brief   Return every block to the pool. Call before SDI starts
+ *          delivering UART data.
+ *
+ * @return  None
+ */
+extern void SPPUARTQueue_Init( void );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_InitQueue
+ *
+ * @brief   Empty a queue that holds no blocks, eg. at start up.
+ *
+ * @param   pQueue - queue to initialize
+ *
+ * @return  None
+ */
+extern void SPPUARTQueue_InitQueue( sppUARTQueue_t *pQueue );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Alloc
+ *
+ * @brief   Take a block from the pool. Producer side.
+ *
+ * @return  Pointer to the block, NULL when the pool is empty
+ */
+extern sppUARTMsg_t *SPPUARTQueue_Alloc( void );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Put
+ *
+ * @brief   Append a block taken with SPPUARTQueue_Alloc to a queue.
+ *          Producer side.
+ *
+ * @param   pQueue - queue to append to
+ * @param   pMsg - filled in block
+ *
+ * @return  None
+ */
+extern void SPPUARTQueue_Put( sppUARTQueue_t *pQueue, sppUARTMsg_t *pMsg );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_PutShared
+ *
+ * @brief   Append one block to several queues without copying it. The
+ *          block goes back to the pool once every queue has released
+ *          it. Producer side.
+ *
+ * @param   ppQueues - queues to append to
+ * @param   numQueues - number of queues, at least 1
+ * @param   pMsg - filled in block
+ *
+ * @return  None
+ */
+extern void SPPUARTQueue_PutShared( sppUARTQueue_t **ppQueues, uint8 numQueues,
+                                    sppUARTMsg_t *pMsg );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_PutBack
+ *
+ * @brief   Return a block taken with SPPUARTQueue_Alloc that was never
+ *          queued to the pool. Producer side.
+ *
+ * @param   pMsg - block to return
+ *
+ * @return  None
+ */
+extern void SPPUARTQueue_PutBack( sppUARTMsg_t *pMsg );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Peek
+ *
+ * @brief   Oldest block in a queue, left in the queue. Consumer side.
+ *
+ * @param   pQueue - queue to look at
+ *
+ * @return  Pointer to the block, NULL when the queue is empty
+ */
+extern sppUARTMsg_t *SPPUARTQueue_Peek( sppUARTQueue_t *pQueue );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Release
+ *
+ * @brief   Remove the oldest block from a queue, the block goes back to
+ *          the pool once no queue holds it any more. Consumer side.
+ *
+ * @param   pQueue - queue to remove from
+ *
+ * @return  None
+ */
+extern void SPPUARTQueue_Release( sppUARTQueue_t *pQueue );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Drain
+ *
+ * @brief   Release every block in a queue. Consumer side.
+ *
+ * @param   pQueue - queue to empty
+ *
+ * @return  None
+ */
+extern void SPPUARTQueue_Drain( sppUARTQueue_t *pQueue );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Move
+ *
+ * @brief   Move the oldest block of one queue to the end of another
+ *          without touching its references. The destination must be a
+ *          queue only the consumer uses, eg. a retransmit window.
+ *          Consumer side.
+ *
+ * @param   pFrom - queue to take the block from
+ * @param   pTo - queue to append it to
+ *
+ * @return  The block moved, NULL if pFrom is empty
+ */
+extern sppUARTMsg_t *SPPUARTQueue_Move( sppUARTQueue_t *pFrom, sppUARTQueue_t *pTo );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_PeekAt
+ *
+ * @brief   Block at a position in a queue, left in the queue. Consumer
+ *          side.
+ *
+ * @param   pQueue - queue to look at
+ * @param   index - position, 0 being the oldest block
+ *
+ * @return  Pointer to the block, NULL if the queue is shorter
+ */
+extern sppUARTMsg_t *SPPUARTQueue_PeekAt( sppUARTQueue_t *pQueue, uint8 index );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Count
+ *
+ * @brief   Number of blocks in a queue. Consumer side.
+ *
+ * @param   pQueue - queue to count
+ *
+ * @return  Blocks in the queue
+ */
+extern uint8 SPPUARTQueue_Count( sppUARTQueue_t *pQueue );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_Free
+ *
+ * @brief   Return a block that never made it into the queue to the
+ *          pool. Consumer side.
+ *
+ * @param   pMsg - block taken with SPPUARTQueue_Alloc
+ *
+ * @return  None
+ */
+extern void SPPUARTQueue_Free( sppUARTMsg_t *pMsg );
+
+/*********************************************************************
+ * @fn      SPPUARTQueue_NumFree
+ *
+ * @brief   Number of blocks left in the pool.
+ *
+ * @return  Free blocks
+ */
+extern uint8 SPPUARTQueue_NumFree( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPPUARTQUEUE_H */
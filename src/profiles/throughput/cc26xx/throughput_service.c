@@ -0,0 +1,465 @@
+/*
+ * Filename: throughput_service.c
+ *
+ * Description: Throughput example service. A peer writes without response
+ * to the Sink Characteristic (full duplex mode), the service only counts
+ * what arrives. Probes written to the Echo Characteristic are notified
+ * back by the application (latency mode).
+ *
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "icall.h"
+#include "linkdb.h"
+#include "att.h"
+#include "gatt.h"
+#include "gatt_uuid.h"
+#include "gattservapp.h"
+
+#include "throughput_service.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Position of the Echo Characteristic value in ThroughputServiceAttrTbl
+#define THROUGHPUTSERVICE_ECHO_VALUE_IDX        4
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+// Throughput Service UUID: 0xC0F0
+CONST uint8 ThroughputServUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(THROUGHPUTSERVICE_SERV_UUID)
+};
+
+// Characteristic Sink UUID: 0xC0F1
+CONST uint8 ThroughputServiceSinkUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(THROUGHPUTSERVICE_SINK_UUID)
+};
+
+// Characteristic Echo UUID: 0xC0F2
+CONST uint8 ThroughputServiceEchoUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(THROUGHPUTSERVICE_ECHO_UUID)
+};
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Written to the Sink Characteristic since the last
+// ThroughputService_TakeSinkBytes. Counted in the stack task, collected
+// from the application's.
+static uint32 sinkBytes = 0;
+static uint32 sinkWrites = 0;
+
+static ThroughputServiceCBs_t *ThroughputService_AppCBs = NULL;
+
+// Last probe written to the Echo Characteristic and who wrote it, echoLen
+// is 0 once it has been sent back
+static uint16 echoConnHandle = INVALID_CONNHANDLE;
+static uint8 echoLen = 0;
+
+/*********************************************************************
+ * Profile Attributes - variables
+ */
+
+// Throughput Service attribute
+static CONST gattAttrType_t ThroughputService = { ATT_UUID_SIZE, ThroughputServUUID };
+
+// Throughput Characteristic Sink Properties
+static uint8 ThroughputServiceSinkProps = GATT_PROP_WRITE_NO_RSP;
+
+// Characteristic Sink Value. Written data is counted, not stored.
+static uint8 ThroughputServiceSink = 0;
+
+// Throughput Characteristic Echo Properties
+static uint8 ThroughputServiceEchoProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY;
+
+// Characteristic Echo Value
+static uint8 ThroughputServiceEcho[THROUGHPUTSERVICE_ECHO_LEN] = {0};
+
+// Throughput Characteristic Echo Configuration, one per client
+static gattCharCfg_t *ThroughputServiceEchoConfig;
+
+/*********************************************************************
+ * Profile Attributes - Table
+ */
+
+static gattAttribute_t ThroughputServiceAttrTbl[] =
+{
+  // Throughput Service
+  {
+    { ATT_BT_UUID_SIZE, primaryServiceUUID }, /* type */
+    GATT_PERMIT_READ,                         /* permissions */
+    0,                                        /* handle */
+    (uint8 *)&ThroughputService               /* pValue */
+  },
+
+    // Characteristic Sink Declaration
+    {
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ,
+      0,
+      &ThroughputServiceSinkProps
+    },
+
+      // Characteristic Sink Value
+      {
+        { ATT_UUID_SIZE, ThroughputServiceSinkUUID },
+        GATT_PERMIT_WRITE,
+        0,
+        &ThroughputServiceSink
+      },
+
+    // Characteristic Echo Declaration
+    {
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ,
+      0,
+      &ThroughputServiceEchoProps
+    },
+
+      // Characteristic Echo Value
+      {
+        { ATT_UUID_SIZE, ThroughputServiceEchoUUID },
+        GATT_PERMIT_WRITE,
+        0,
+        ThroughputServiceEcho
+      },
+
+      // Characteristic Echo configuration
+      {
+        { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+        0,
+        (uint8 *)&ThroughputServiceEchoConfig
+      },
+};
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static bStatus_t ThroughputService_ReadAttrCB( uint16 connHandle, gattAttribute_t *pAttr,
+                                               uint8 *pValue, uint16 *pLen, uint16 offset,
+                                               uint16 maxLen, uint8 method );
+static bStatus_t ThroughputService_WriteAttrCB( uint16 connHandle, gattAttribute_t *pAttr,
+                                                uint8 *pValue, uint16 len, uint16 offset,
+                                                uint8 method );
+
+/*********************************************************************
+ * PROFILE CALLBACKS
+ */
+// Throughput Service Callbacks
+CONST gattServiceCBs_t ThroughputServiceCBs =
+{
+  ThroughputService_ReadAttrCB,  // Read callback function pointer
+  ThroughputService_WriteAttrCB, // Write callback function pointer
+  NULL                           // Authorization callback function pointer
+};
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      ThroughputService_AddService
+ *
+ * @brief   Register the Throughput Service with the GATT server.
+ *
+ * @return  SUCCESS, bleMemAllocError or the GATTServApp_RegisterService
+ *          error
+ */
+bStatus_t ThroughputService_AddService( void )
+{
+  // Allocate Client Characteristic Configuration table
+  ThroughputServiceEchoConfig = (gattCharCfg_t *)ICall_malloc( sizeof(gattCharCfg_t) *
+                                                               linkDBNumConns );
+  if ( ThroughputServiceEchoConfig == NULL )
+  {
+    return ( bleMemAllocError );
+  }
+
+  // Initialize Client Characteristic Configuration attributes
+  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, ThroughputServiceEchoConfig );
+
+  return GATTServApp_RegisterService( ThroughputServiceAttrTbl,
+                                      GATT_NUM_ATTRS( ThroughputServiceAttrTbl ),
+                                      GATT_MAX_ENCRYPT_KEY_SIZE,
+                                      &ThroughputServiceCBs );
+}
+
+/*********************************************************************
+ * @fn      ThroughputService_RegisterAppCBs
+ *
+ * @brief   Registers the application callback function. Only call this
+ *          function once.
+ *
+ * @param   appCallbacks - pointer to application callbacks
+ *
+ * @return  SUCCESS or bleAlreadyInRequestedMode
+ */
+bStatus_t ThroughputService_RegisterAppCBs( ThroughputServiceCBs_t *appCallbacks )
+{
+  if ( appCallbacks )
+  {
+    ThroughputService_AppCBs = appCallbacks;
+
+    return ( SUCCESS );
+  }
+  else
+  {
+    return ( bleAlreadyInRequestedMode );
+  }
+}
+
+/*********************************************************************
+ * @fn      ThroughputService_SendEcho
+ *
+ * @brief   Notify the last probe back to the peer that wrote it.
+ *
+ * @return  SUCCESS, bleIncorrectMode if the peer has not enabled echo
+ *          notifications or no probe is pending, or the reason the
+ *          notification was not sent
+ */
+bStatus_t ThroughputService_SendEcho( void )
+{
+  attHandleValueNoti_t noti;
+  bStatus_t ret;
+  uint16 connHandle;
+  uint8 len;
+  uint32 key;
+
+  // The next probe may be written any time, take this one as a whole
+  key = ICall_enterCriticalSection();
+  connHandle = echoConnHandle;
+  len = echoLen;
+  echoLen = 0;
+  ICall_leaveCriticalSection( key );
+
+  if ( ( len == 0 ) ||
+       !( GATTServApp_ReadCharCfg( connHandle, ThroughputServiceEchoConfig ) &
+          GATT_CLIENT_CFG_NOTIFY ) )
+  {
+    return ( bleIncorrectMode );
+  }
+
+  noti.pValue = (uint8 *)GATT_bm_alloc( connHandle, ATT_HANDLE_VALUE_NOTI,
+                                        len, NULL );
+  if ( noti.pValue == NULL )
+  {
+    return ( bleMemAllocError );
+  }
+
+  noti.handle = ThroughputServiceAttrTbl[THROUGHPUTSERVICE_ECHO_VALUE_IDX].handle;
+  noti.len = len;
+
+  key = ICall_enterCriticalSection();
+  VOID memcpy( noti.pValue, ThroughputServiceEcho, len );
+  ICall_leaveCriticalSection( key );
+
+  ret = GATT_Notification( connHandle, &noti, FALSE );
+  if ( ret != SUCCESS )
+  {
+    GATT_bm_free( (gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI );
+  }
+
+  return ( ret );
+}
+
+/*********************************************************************
+ * @fn      ThroughputService_EchoEnabled
+ *
+ * @brief   Whether a peer has enabled Echo Characteristic notifications.
+ *
+ * @param   connHandle - connection to check
+ *
+ * @return  TRUE if echo notifications are enabled
+ */
+uint8 ThroughputService_EchoEnabled( uint16 connHandle )
+{
+  return ( ( GATTServApp_ReadCharCfg( connHandle, ThroughputServiceEchoConfig ) &
+             GATT_CLIENT_CFG_NOTIFY ) ? TRUE : FALSE );
+}
+
+/*********************************************************************
+ * @fn      ThroughputService_TakeSinkBytes
+ *
+ * @brief   Collect what was written to the Sink Characteristic since
+ *          the last call.
+ *
+ * @param   pWrites - number of writes, may be NULL
+ *
+ * @return  Number of bytes written
+ */
+uint32 ThroughputService_TakeSinkBytes( uint32 *pWrites )
+{
+  uint32 bytes;
+  uint32 key;
+
+  key = ICall_enterCriticalSection();
+  bytes = sinkBytes;
+  if ( pWrites != NULL )
+  {
+    *pWrites = sinkWrites;
+  }
+  sinkBytes = 0;
+  sinkWrites = 0;
+  ICall_leaveCriticalSection( key );
+
+  return ( bytes );
+}
+
+/*********************************************************************
+ * @fn          ThroughputService_ReadAttrCB
+ *
+ * @brief       Read an attribute. Only the Echo configuration can be
+ *              read, by the GATT server itself.
+ *
+ * @param       connHandle - connection message was received on
+ * @param       pAttr - pointer to attribute
+ * @param       pValue - pointer to data to be read
+ * @param       pLen - length of data to be read
+ * @param       offset - offset of the first octet to be read
+ * @param       maxLen - maximum length of data to be read
+ * @param       method - type of read message
+ *
+ * @return      ATT_ERR_ATTR_NOT_FOUND
+ */
+static bStatus_t ThroughputService_ReadAttrCB( uint16 connHandle, gattAttribute_t *pAttr,
+                                               uint8 *pValue, uint16 *pLen, uint16 offset,
+                                               uint16 maxLen, uint8 method )
+{
+  *pLen = 0;
+
+  return ( ATT_ERR_ATTR_NOT_FOUND );
+}
+
+/*********************************************************************
+ * @fn      ThroughputService_WriteAttrCB
+ *
+ * @brief   Count a write to the Sink Characteristic, keep a probe written
+ *          to the Echo Characteristic, or update the Echo configuration.
+ *          The application is told about the last two.
+ *
+ * @param   connHandle - connection message was received on
+ * @param   pAttr - pointer to attribute
+ * @param   pValue - pointer to data to be written
+ * @param   len - length of data
+ * @param   offset - offset of the first octet to be written
+ * @param   method - type of write message
+ *
+ * @return  SUCCESS, ATT_ERR_INVALID_VALUE_SIZE for an over long probe,
+ *          the CCC write status, or ATT_ERR_ATTR_NOT_FOUND
+ */
+static bStatus_t ThroughputService_WriteAttrCB( uint16 connHandle, gattAttribute_t *pAttr,
+                                                uint8 *pValue, uint16 len, uint16 offset,
+                                                uint8 method )
+{
+  bStatus_t status = SUCCESS;
+  uint8 notifyApp = 0xFF;
+
+  if ( pAttr->type.len == ATT_UUID_SIZE )
+  {
+    // 16-bit UUID
+    uint16 uuid = BUILD_UINT16( pAttr->type.uuid[12], pAttr->type.uuid[13] );
+    switch ( uuid )
+    {
+      case THROUGHPUTSERVICE_SINK_UUID:
+        sinkBytes += len;
+        sinkWrites++;
+        break;
+
+      case THROUGHPUTSERVICE_ECHO_UUID:
+        if ( ( offset != 0 ) || ( len > THROUGHPUTSERVICE_ECHO_LEN ) )
+        {
+          status = ATT_ERR_INVALID_VALUE_SIZE;
+          break;
+        }
+
+        // A probe not sent back yet is overwritten, the peer times it out
+        VOID memcpy( ThroughputServiceEcho, pValue, len );
+        echoConnHandle = connHandle;
+        echoLen = len;
+        notifyApp = THROUGHPUTSERVICE_ECHO;
+        break;
+
+      default:
+        status = ATT_ERR_ATTR_NOT_FOUND;
+        break;
+    }
+  }
+  else if ( ( pAttr->type.len == ATT_BT_UUID_SIZE ) &&
+            ( BUILD_UINT16( pAttr->type.uuid[0], pAttr->type.uuid[1] ) ==
+              GATT_CLIENT_CHAR_CFG_UUID ) )
+  {
+    status = GATTServApp_ProcessCCCWriteReq( connHandle, pAttr, pValue, len,
+                                             offset, GATT_CLIENT_CFG_NOTIFY );
+    notifyApp = THROUGHPUTSERVICE_ECHO_CFG;
+  }
+  else
+  {
+    status = ATT_ERR_ATTR_NOT_FOUND;
+  }
+
+  // Let the application answer the probe or follow the configuration
+  if ( ( status == SUCCESS ) && ( notifyApp != 0xFF ) && ThroughputService_AppCBs &&
+       ThroughputService_AppCBs->pfnThroughputServiceChange )
+  {
+    ThroughputService_AppCBs->pfnThroughputServiceChange( notifyApp );
+  }
+
+  return ( status );
+}
+
+/*********************************************************************
+*********************************************************************/
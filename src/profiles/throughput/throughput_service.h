@@ -0,0 +1,167 @@
+/*
+ * Filename: throughput_service.h
+ *
+ * Description: Throughput example service. A peer writes without response
+ * to the Sink Characteristic (full duplex mode), the service only counts
+ * what arrives. Probes written to the Echo Characteristic are notified
+ * back by the application (latency mode).
+ *
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef THROUGHPUTSERVICE_H
+#define THROUGHPUTSERVICE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Profile Parameters
+#define THROUGHPUTSERVICE_ECHO                  0  // W - probe written
+#define THROUGHPUTSERVICE_ECHO_CFG              1  // Echo notifications turned on or off
+
+// Throughput Service UUID
+#define THROUGHPUTSERVICE_SERV_UUID             0xC0F0
+
+// Sink Characteristic UUID
+#define THROUGHPUTSERVICE_SINK_UUID             0xC0F1
+
+// Echo Characteristic UUID
+#define THROUGHPUTSERVICE_ECHO_UUID             0xC0F2
+
+// Length of the Echo Characteristic in bytes, the longest probe
+#define THROUGHPUTSERVICE_ECHO_LEN              8
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+/*********************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * Profile Callbacks
+ */
+
+// Callback when a probe was written or echo notifications changed
+typedef void (*ThroughputServiceChange_t)( uint8 paramID );
+
+typedef struct
+{
+  ThroughputServiceChange_t        pfnThroughputServiceChange;  // Called when characteristic value changes
+} ThroughputServiceCBs_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      ThroughputService_AddService
+ *
+ * @brief   Register the Throughput Service with the GATT server. Services
+ *          get their handles in the order they are added, add it after
+ *          the ones whose handles a peer relies on.
+ *
+ * @return  SUCCESS, bleMemAllocError or the GATTServApp_RegisterService
+ *          error
+ */
+extern bStatus_t ThroughputService_AddService( void );
+
+/*********************************************************************
+ * @fn      ThroughputService_TakeSinkBytes
+ *
+ * @brief   Collect what was written to the Sink Characteristic since
+ *          the last call, by all peers.
+ *
+ * @param   pWrites - number of writes, may be NULL
+ *
+ * @return  Number of bytes written
+ */
+extern uint32 ThroughputService_TakeSinkBytes( uint32 *pWrites );
+
+/*********************************************************************
+ * @fn      ThroughputService_RegisterAppCBs
+ *
+ * @brief   Registers the application callback function. Only call this
+ *          function once.
+ *
+ * @param   appCallbacks - pointer to application callbacks
+ *
+ * @return  SUCCESS or bleAlreadyInRequestedMode
+ */
+extern bStatus_t ThroughputService_RegisterAppCBs( ThroughputServiceCBs_t *appCallbacks );
+
+/*********************************************************************
+ * @fn      ThroughputService_SendEcho
+ *
+ * @brief   Notify the last probe back to the peer that wrote it. Call
+ *          from the application task on the THROUGHPUTSERVICE_ECHO
+ *          callback.
+ *
+ * @return  SUCCESS, bleIncorrectMode if the peer has not enabled echo
+ *          notifications or no probe is pending, or the reason the
+ *          notification was not sent
+ */
+extern bStatus_t ThroughputService_SendEcho( void );
+
+/*********************************************************************
+ * @fn      ThroughputService_EchoEnabled
+ *
+ * @brief   Whether a peer has enabled Echo Characteristic notifications,
+ *          ie. runs a latency measurement.
+ *
+ * @param   connHandle - connection to check
+ *
+ * @return  TRUE if echo notifications are enabled
+ */
+extern uint8 ThroughputService_EchoEnabled( uint16 connHandle );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THROUGHPUTSERVICE_H */
@@ -0,0 +1,206 @@
+'''
+/*
+ * Filename: sdi_frame.py
+ *
+ * Description: Host side of the SDI wire framing used by the SPP BLE
+ * examples when built with SDI_USE_FRAMING. Each message travels as one
+ * COBS encoded frame [type][seq][payload][CRC-16 LSB first] followed by
+ * a 0x00 delimiter. Can be imported for its encoder/decoder, or run as a
+ * simple terminal that frames stdin lines and prints received frames.
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+'''
+import sys
+import argparse
+import threading
+
+FRAME_DELIM = 0x00
+FRAME_HDR_LEN = 2
+FRAME_CRC_LEN = 2
+FRAME_TYPE_DATA = 0x01
+FRAME_TYPE_MASK = 0x0F
+FRAME_CHANNEL_SHIFT = 4
+
+CRC_INIT = 0xFFFF
+
+
+def crc16(data, crc=CRC_INIT):
+    """CRC-16/CCITT-FALSE, matches SDIFrame_crc16."""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_idx = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_idx] = code
+            code_idx = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_idx] = code
+                code_idx = len(out)
+                out.append(0)
+                code = 1
+    out[code_idx] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError('malformed COBS block')
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frame_channel(frame_type):
+    """Logical channel carried in the high nibble of the type byte."""
+    return frame_type >> FRAME_CHANNEL_SHIFT
+
+
+def encode_frame(payload, seq, frame_type=FRAME_TYPE_DATA, channel=0):
+    """Encode one message as it goes on the wire, delimiter included."""
+    frame_type = (channel << FRAME_CHANNEL_SHIFT) | \
+        (frame_type & FRAME_TYPE_MASK)
+    raw = bytes([frame_type, seq & 0xFF]) + bytes(payload)
+    crc = crc16(raw)
+    raw += bytes([crc & 0xFF, crc >> 8])
+    return cobs_encode(raw) + bytes([FRAME_DELIM])
+
+
+class FrameError(Exception):
+    pass
+
+
+class FrameDecoder(object):
+    """Splits a received byte stream into (type, seq, payload) frames."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.last_seq = None
+        self.seq_gaps = 0
+        self.errors = 0
+
+    def feed(self, data):
+        """Yield every frame completed by data. Bad frames are counted and
+        skipped."""
+        for b in bytearray(data):
+            if b != FRAME_DELIM:
+                self.buf.append(b)
+                continue
+            if not self.buf:
+                continue
+            encoded, self.buf = bytes(self.buf), bytearray()
+            try:
+                frame = self._parse(encoded)
+            except (ValueError, FrameError):
+                self.errors += 1
+                continue
+            if self.last_seq is not None and \
+                    frame[1] != ((self.last_seq + 1) & 0xFF):
+                self.seq_gaps += 1
+            self.last_seq = frame[1]
+            yield frame
+
+    @staticmethod
+    def _parse(encoded):
+        raw = cobs_decode(encoded)
+        if len(raw) < FRAME_HDR_LEN + FRAME_CRC_LEN:
+            raise FrameError('short frame')
+        crc = crc16(raw[:-FRAME_CRC_LEN])
+        if raw[-2] != (crc & 0xFF) or raw[-1] != (crc >> 8):
+            raise FrameError('CRC mismatch')
+        return raw[0], raw[1], raw[FRAME_HDR_LEN:-FRAME_CRC_LEN]
+
+
+def main():
+    from serial import Serial
+
+    parser = argparse.ArgumentParser(
+        description='Exchange SDI frames with an SPP BLE device over UART')
+    parser.add_argument('port', help='serial port, e.g. /dev/ttyACM0')
+    parser.add_argument('-b', '--baud', type=int, default=921600)
+    parser.add_argument('-c', '--channel', type=int, default=0,
+                        help='logical channel to send on (0-15)')
+    args = parser.parse_args()
+
+    ser = Serial(args.port, args.baud, timeout=0.1)
+    decoder = FrameDecoder()
+
+    def reader():
+        while True:
+            data = ser.read(4096)
+            for frame_type, seq, payload in decoder.feed(data):
+                sys.stdout.write('[ch %2d seq %3d] %r\n' %
+                                 (frame_channel(frame_type), seq,
+                                  bytes(payload)))
+                sys.stdout.flush()
+
+    t = threading.Thread(target=reader)
+    t.daemon = True
+    t.start()
+
+    seq = 0
+    try:
+        for line in sys.stdin:
+            ser.write(encode_frame(line.rstrip('\r\n').encode(), seq,
+                                   channel=args.channel))
+            seq = (seq + 1) & 0xFF
+    except KeyboardInterrupt:
+        pass
+
+    sys.stderr.write('frame errors: %d, sequence gaps: %d\n' %
+                     (decoder.errors, decoder.seq_gaps))
+    ser.close()
+
+
+if __name__ == '__main__':
+    main()
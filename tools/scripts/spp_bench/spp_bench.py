@@ -0,0 +1,301 @@
+'''
+/*
+ * Filename: spp_bench.py
+ *
+ * Description: Host driver for the SPP BLE benchmark mode (SPP_BENCH).
+ * Sends BENCH commands to the SPP BLE client over its UART, one per
+ * combination of mode, probe size and probe count, collects the result
+ * line of each run and writes them out as CSV. With --simulate the
+ * sweep runs against a stand-in device on a pseudo terminal instead.
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+'''
+import os
+import sys
+import csv
+import time
+import random
+import select
+import argparse
+import threading
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', 'sdi'))
+
+RESULT_PREFIX = 'BENCH,'
+RESULT_FIELDS = ['mode', 'size', 'count', 'sent', 'received', 'lost',
+                 'p50_us', 'p99_us', 'max_us', 'goodput_bps']
+CSV_FIELDS = ['run', 'status'] + RESULT_FIELDS + ['loss_pct']
+
+# Probe header, see spp_bench.h
+PROBE_HDR_SIZE = 8
+
+
+class PtyPort(object):
+    """Just enough of pyserial's Serial for a pseudo terminal."""
+
+    def __init__(self, path, timeout=0.1):
+        import tty
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        self.timeout = timeout
+
+    def read(self, size=1):
+        ready, _, _ = select.select([self.fd], [], [], self.timeout)
+        if not ready:
+            return b''
+        return os.read(self.fd, size)
+
+    def write(self, data):
+        return os.write(self.fd, data)
+
+    def close(self):
+        os.close(self.fd)
+
+
+class RawLink(object):
+    """Command and result lines over the plain UART byte pipe."""
+
+    def __init__(self, port):
+        self.port = port
+        self.buf = bytearray()
+
+    def send_line(self, line):
+        self.port.write(line.encode() + b'\n')
+
+    def read_line(self, deadline):
+        while True:
+            i = self.buf.find(b'\n')
+            if i >= 0:
+                line, self.buf = bytes(self.buf[:i]), self.buf[i + 1:]
+                return line.decode('ascii', 'replace').strip()
+            if time.time() >= deadline:
+                return None
+            self.buf += self.port.read(256)
+
+
+class FramedLink(RawLink):
+    """Command and result lines carried as SDI frames (SDI_USE_FRAMING)."""
+
+    def __init__(self, port):
+        from sdi_frame import FrameDecoder, encode_frame
+        RawLink.__init__(self, port)
+        self.encode_frame = encode_frame
+        self.decoder = FrameDecoder()
+        self.seq = 0
+
+    def send_line(self, line):
+        self.port.write(self.encode_frame(line.encode() + b'\n', self.seq))
+        self.seq = (self.seq + 1) & 0xFF
+
+    def read_line(self, deadline):
+        while True:
+            i = self.buf.find(b'\n')
+            if i >= 0:
+                line, self.buf = bytes(self.buf[:i]), self.buf[i + 1:]
+                return line.decode('ascii', 'replace').strip()
+            if time.time() >= deadline:
+                return None
+            for _, _, payload in self.decoder.feed(self.port.read(256)):
+                self.buf += payload
+
+
+def parse_result(line):
+    """Result line of the device as a dict, None if it is something else."""
+    if not line.startswith(RESULT_PREFIX):
+        return None
+    fields = line.split(',')[1:]
+    if len(fields) != len(RESULT_FIELDS):
+        return {'status': 'error'}
+    result = {'status': 'ok'}
+    for name, value in zip(RESULT_FIELDS, fields):
+        result[name] = value if name == 'mode' else int(value)
+    result['loss_pct'] = ('%.2f' % (100.0 * result['lost'] / result['sent'])
+                          if result['sent'] else '')
+    return result
+
+
+def run_one(link, mode, count, size, timeout):
+    """Run one benchmark, the device answers with exactly one line."""
+    link.send_line('BENCH %s %d %d' % (mode, count, size))
+    deadline = time.time() + timeout
+    while True:
+        line = link.read_line(deadline)
+        if line is None:
+            return {'status': 'timeout', 'mode': mode, 'size': size,
+                    'count': count}
+        result = parse_result(line)
+        if result is not None:
+            result.setdefault('mode', mode)
+            result.setdefault('size', size)
+            result.setdefault('count', count)
+            return result
+
+
+def run_simulator(master_fd, seed):
+    """Stand-in for the SPP BLE client: answers BENCH commands with
+    plausible numbers for a 7.5 ms connection interval and a 244 byte
+    payload, without any radio."""
+    rng = random.Random(seed)
+    interval_us = 7500
+    max_payload = 244
+    buf = bytearray()
+
+    while True:
+        try:
+            data = os.read(master_fd, 256)
+        except OSError:
+            return
+        if not data:
+            return
+        buf += data
+        while b'\n' in buf:
+            i = buf.index(b'\n')
+            line, buf = bytes(buf[:i]).strip(), buf[i + 1:]
+            words = line.split()
+            try:
+                mode, count, size = (words[1].decode(), int(words[2]),
+                                     int(words[3]))
+                if words[0] != b'BENCH' or mode not in ('echo', 'bulk') or \
+                        not 0 < count <= 0xFFFF or len(words) != 4:
+                    raise ValueError
+            except (ValueError, IndexError):
+                os.write(master_fd, b'BENCH,error\r\n')
+                continue
+
+            size = min(max(size, PROBE_HDR_SIZE), max_payload)
+            if mode == 'echo':
+                samples = sorted(rng.randint(interval_us, 2 * interval_us) +
+                                 size * 20 for _ in range(count))
+                lost = sum(1 for _ in range(count) if rng.random() < 0.001)
+                received = count - lost
+                p50 = samples[(count * 50 + 99) // 100 - 1]
+                p99 = samples[(count * 99 + 99) // 100 - 1]
+                peak = samples[-1]
+                goodput = received * size * 8 * 1000000 // sum(samples)
+            else:
+                lost = sum(1 for _ in range(count) if rng.random() < 0.0005)
+                received = count - lost
+                p50 = p99 = peak = 0
+                per_event = rng.randint(1, 3)
+                goodput = per_event * size * 8 * 1000000 // interval_us
+            os.write(master_fd, ('BENCH,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d\r\n' %
+                                 (mode, size, count, count, received, lost,
+                                  p50, p99, peak, goodput)).encode())
+
+
+def int_list(text):
+    return [int(v) for v in text.split(',') if v]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Sweep SPP BLE benchmark runs and write the results '
+                    'as CSV')
+    parser.add_argument('port', nargs='?',
+                        help='UART of the SPP BLE client, e.g. /dev/ttyACM0')
+    parser.add_argument('-b', '--baud', type=int, default=921600)
+    parser.add_argument('-m', '--modes', default='echo,bulk',
+                        help='comma separated, echo and/or bulk')
+    parser.add_argument('-s', '--sizes', type=int_list, default='20,100,244',
+                        help='probe sizes in bytes, clamped by the device '
+                             'to what one write carries')
+    parser.add_argument('-n', '--counts', type=int_list, default='100,1000',
+                        help='probes per run')
+    parser.add_argument('-r', '--repeat', type=int, default=1,
+                        help='runs per combination')
+    parser.add_argument('-t', '--timeout', type=float, default=60.0,
+                        help='seconds to wait for the result of a run')
+    parser.add_argument('-o', '--output', help='CSV file, default stdout')
+    parser.add_argument('--framed', action='store_true',
+                        help='device built with SDI_USE_FRAMING')
+    parser.add_argument('--simulate', action='store_true',
+                        help='run against a stand-in device on a pty')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='random seed of the stand-in device')
+    args = parser.parse_args()
+
+    modes = [m for m in args.modes.split(',') if m]
+    if any(m not in ('echo', 'bulk') for m in modes):
+        parser.error('modes are echo and bulk')
+
+    if args.simulate:
+        if args.framed:
+            parser.error('the stand-in device only speaks raw UART')
+        master_fd, slave_fd = os.openpty()
+        t = threading.Thread(target=run_simulator,
+                             args=(master_fd, args.seed))
+        t.daemon = True
+        t.start()
+        port = PtyPort(os.ttyname(slave_fd))
+    elif args.port:
+        from serial import Serial
+        port = Serial(args.port, args.baud, timeout=0.1)
+    else:
+        parser.error('a port is needed unless --simulate is given')
+
+    link = FramedLink(port) if args.framed else RawLink(port)
+
+    out = open(args.output, 'w', newline='') if args.output else sys.stdout
+    writer = csv.DictWriter(out, fieldnames=CSV_FIELDS, extrasaction='ignore')
+    writer.writeheader()
+
+    run = 0
+    failed = 0
+    try:
+        for mode in modes:
+            for size in args.sizes:
+                for count in args.counts:
+                    for _ in range(args.repeat):
+                        result = run_one(link, mode, count, size,
+                                         args.timeout)
+                        result['run'] = run
+                        run += 1
+                        if result['status'] != 'ok':
+                            failed += 1
+                        writer.writerow(result)
+                        out.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        port.close()
+        if out is not sys.stdout:
+            out.close()
+
+    sys.stderr.write('%d runs, %d failed\n' % (run, failed))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,205 @@
+'''
+/*
+ * Filename: throughput_sweep.py
+ *
+ * Description: Host collector for the throughput example sweep mode
+ * (THROUGHPUT_SWEEP). Reads the SWEEP rows the throughput central writes
+ * to its UART, one per point of connection interval, ATT MTU, LL PDU size
+ * and notification length, and stores them as CSV. Given a baseline CSV
+ * from an earlier run, every point is compared against it and the run
+ * fails if its goodput (intact, non duplicate payload per second) got
+ * slower than the tolerance allows.
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+'''
+import sys
+import csv
+import time
+import argparse
+
+ROW_PREFIX = 'SWEEP,'
+DONE_ROW = 'SWEEP,done'
+ROW_FIELDS = ['point', 'conn_interval', 'mtu', 'll_pdu', 'noti_len',
+              'bytes_per_s', 'goodput_per_s', 'lost']
+# A point is identified by its parameters, not by its index, so baselines
+# stay comparable when the sweep matrix grows
+KEY_FIELDS = ['conn_interval', 'mtu', 'll_pdu', 'noti_len']
+CSV_FIELDS = ROW_FIELDS + ['conn_interval_ms', 'baseline_goodput_per_s',
+                           'delta_pct', 'status']
+
+
+class LineReader(object):
+    """Lines from a serial port, or from a capture file when replaying."""
+
+    def __init__(self, port):
+        self.port = port
+        self.buf = bytearray()
+
+    def read_line(self, deadline):
+        while True:
+            i = self.buf.find(b'\n')
+            if i >= 0:
+                line, self.buf = bytes(self.buf[:i]), self.buf[i + 1:]
+                return line.decode('ascii', 'replace').strip()
+            if time.time() >= deadline:
+                return None
+            data = self.port.read(256)
+            if not data and not hasattr(self.port, 'in_waiting'):
+                # End of a capture file
+                if not self.buf:
+                    return None
+                self.buf += b'\n'
+            self.buf += data
+
+
+def parse_row(line):
+    """Result row of the device as a dict, None if it is something else."""
+    if not line.startswith(ROW_PREFIX) or line == DONE_ROW:
+        return None
+    fields = line.split(',')[1:]
+    if len(fields) != len(ROW_FIELDS) or fields[0] == 'point':
+        return None
+    try:
+        row = dict(zip(ROW_FIELDS, [int(v) for v in fields]))
+    except ValueError:
+        return None
+    row['conn_interval_ms'] = '%.2f' % (row['conn_interval'] * 1.25)
+    return row
+
+
+def key_of(row):
+    return tuple(int(row[f]) for f in KEY_FIELDS)
+
+
+def load_baseline(path):
+    # Baselines from before goodput was reported only have the raw rate
+    with open(path, newline='') as f:
+        return dict((key_of(row),
+                     int(row.get('goodput_per_s') or row['bytes_per_s']))
+                    for row in csv.DictReader(f))
+
+
+def compare(row, baseline, tolerance):
+    """Fill in the baseline columns of a row, return False on regression."""
+    base = baseline.get(key_of(row))
+    if base is None:
+        row['status'] = 'new'
+        return True
+    row['baseline_goodput_per_s'] = base
+    if base == 0:
+        row['status'] = 'ok'
+        return True
+    delta = 100.0 * (row['goodput_per_s'] - base) / base
+    row['delta_pct'] = '%.1f' % delta
+    if delta < -tolerance:
+        row['status'] = 'slower'
+        return False
+    row['status'] = 'faster' if delta > tolerance else 'ok'
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Collect throughput sweep results and compare them '
+                    'against a baseline')
+    parser.add_argument('port', help='UART of the throughput central, e.g. '
+                                     '/dev/ttyACM0, or a capture file with '
+                                     '--replay')
+    parser.add_argument('-b', '--baud', type=int, default=115200)
+    parser.add_argument('-o', '--output', help='CSV file, default stdout')
+    parser.add_argument('--baseline',
+                        help='CSV of an earlier run to compare against')
+    parser.add_argument('--tolerance', type=float, default=5.0,
+                        help='percent a point may be slower than the '
+                             'baseline before the run fails')
+    parser.add_argument('-t', '--timeout', type=float, default=120.0,
+                        help='seconds to wait for the next row')
+    parser.add_argument('--replay', action='store_true',
+                        help='read a captured UART log instead of a port')
+    args = parser.parse_args()
+
+    if args.replay:
+        port = open(args.port, 'rb')
+    else:
+        from serial import Serial
+        port = Serial(args.port, args.baud, timeout=0.1)
+
+    baseline = load_baseline(args.baseline) if args.baseline else {}
+    reader = LineReader(port)
+
+    out = open(args.output, 'w', newline='') if args.output else sys.stdout
+    writer = csv.DictWriter(out, fieldnames=CSV_FIELDS, extrasaction='ignore')
+    writer.writeheader()
+
+    rows = 0
+    slower = 0
+    seen = set()
+    finished = False
+    try:
+        while True:
+            line = reader.read_line(time.time() + args.timeout)
+            if line is None:
+                break
+            if line == DONE_ROW:
+                finished = True
+                break
+            row = parse_row(line)
+            if row is None:
+                continue
+            rows += 1
+            seen.add(key_of(row))
+            if baseline and not compare(row, baseline, args.tolerance):
+                slower += 1
+            writer.writerow(row)
+            out.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        port.close()
+        if out is not sys.stdout:
+            out.close()
+
+    missing = [k for k in baseline if k not in seen]
+    sys.stderr.write('%d points%s, %d slower than baseline, %d baseline '
+                     'points missing\n' %
+                     (rows, '' if finished else ' (sweep incomplete)',
+                      slower, len(missing)))
+    for k in sorted(missing):
+        sys.stderr.write('  missing: %s\n' %
+                         ', '.join('%s=%d' % kv for kv in zip(KEY_FIELDS, k)))
+    return 1 if slower or missing or not finished else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,163 @@
+'''
+/*
+ * Filename: sdi_frame_check.py
+ *
+ * Description: Checks the C framing in sdi_frame.c against the host side
+ * in tools/scripts/sdi/sdi_frame.py. Random frames are encoded by both and
+ * must match byte for byte, and a random wire stream with corrupted,
+ * truncated and idle bytes mixed in must decode to the same frames and
+ * errors on both. Run by "make test" with the path of sdi_frame_test.
+ *
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+'''
+import os
+import sys
+import random
+import argparse
+import subprocess
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', 'scripts', 'sdi'))
+
+from sdi_frame import encode_frame, FrameDecoder, FRAME_CHANNEL_SHIFT
+
+# Must stay below TEST_MAX_PAYLOAD in sdi_frame_test.c
+MAX_PAYLOAD = 600
+
+
+def random_payload(rng):
+    length = rng.choice([0, 1, 253, 254, 255, 508,
+                         rng.randint(0, MAX_PAYLOAD)])
+    kind = rng.randint(0, 3)
+    if kind == 0:
+        return bytes(length)
+    if kind == 1:
+        return bytes(0xFF if rng.randint(0, 7) else 0 for _ in range(length))
+    return bytes(rng.randint(0, 255) for _ in range(length))
+
+
+def run(binary, mode, lines):
+    proc = subprocess.run([binary, mode], input='\n'.join(lines) + '\n',
+                          stdout=subprocess.PIPE, universal_newlines=True,
+                          check=True)
+    return proc.stdout.splitlines()
+
+
+def check_encode(binary, rng, count):
+    """The C encoder and encode_frame produce the same bytes."""
+    frames = []
+    for _ in range(count):
+        frame_type = rng.randint(0, 255)
+        frames.append((frame_type, rng.randint(0, 255), random_payload(rng)))
+
+    lines = ['%02x %02x %s' % (t, s, p.hex()) for t, s, p in frames]
+    failures = 0
+    for (t, s, p), got in zip(frames, run(binary, '--encode', lines)):
+        want = encode_frame(p, s, frame_type=t & 0x0F,
+                            channel=t >> FRAME_CHANNEL_SHIFT)
+        if bytes.fromhex(got) != want:
+            failures += 1
+            if failures <= 5:
+                sys.stderr.write('encode mismatch for type %02x seq %02x '
+                                 'len %d\n' % (t, s, len(p)))
+    return failures
+
+
+def check_decode(binary, rng, count):
+    """A damaged stream decodes to the same frames on both sides, with a
+    C error wherever FrameDecoder counts one."""
+    wire = bytearray()
+    for seq in range(count):
+        frame = bytearray(encode_frame(random_payload(rng), seq,
+                                       channel=rng.randint(0, 15)))
+        damage = rng.randint(0, 9)
+        if damage == 0:
+            frame[rng.randrange(len(frame) - 1)] ^= 1 << rng.randint(0, 7)
+        elif damage == 1:
+            del frame[rng.randrange(len(frame) - 1)]
+        elif damage == 2:
+            # Cut off, runs into the next frame
+            del frame[rng.randrange(1, len(frame)):]
+        elif damage == 3:
+            frame += bytes(rng.randint(1, 3))
+        wire += frame
+
+    # Hand the stream over in random pieces
+    lines = []
+    pos = 0
+    while pos < len(wire):
+        step = rng.randint(1, 3000)
+        lines.append(wire[pos:pos + step].hex())
+        pos += step
+
+    want = []
+    decoder = FrameDecoder()
+    for frame_type, seq, payload in decoder.feed(bytes(wire)):
+        want.append('ok %02x %02x %s' % (frame_type, seq, bytes(payload).hex()))
+
+    got = run(binary, '--decode', lines)
+    got_frames = [l for l in got if l.startswith('ok ')]
+    got_errors = len(got) - len(got_frames)
+
+    failures = 0
+    if got_frames != want:
+        failures += 1
+        sys.stderr.write('decoded frames differ: C %d, Python %d\n' %
+                         (len(got_frames), len(want)))
+    if got_errors != decoder.errors:
+        failures += 1
+        sys.stderr.write('frame errors differ: C %d, Python %d\n' %
+                         (got_errors, decoder.errors))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Check the C SDI framing against sdi_frame.py')
+    parser.add_argument('binary', help='path of sdi_frame_test')
+    parser.add_argument('-n', '--count', type=int, default=2000,
+                        help='frames per check')
+    parser.add_argument('-s', '--seed', type=int, default=7)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    failures = check_encode(args.binary, rng, args.count)
+    failures += check_decode(args.binary, rng, args.count)
+
+    print('sdi_frame_check: %s' % ('FAILED' if failures else 'passed'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,523 @@
+/******************************************************************************
+
+ @file  sdi_frame_test.c
+
+  Host test of the SDI wire framing. Without arguments it round
+  trips random frames through the encoder and a decoder fed in random
+  pieces, and checks that corrupted, truncated and oversized frames are
+  rejected without losing the frames after them. With --encode or
+  --decode it is the C side of sdi_frame_check.py, which compares it
+  with tools/scripts/sdi/sdi_frame.py.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// ****************************************************************************
+// includes
+// ****************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "inc/sdi_frame.h"
+#include "sdi_host_test.h"
+
+// ****************************************************************************
+// defines
+// ****************************************************************************
+
+//! \brief Largest payload tested, spans several 254 byte COBS blocks
+#define TEST_MAX_PAYLOAD        600
+
+//! \brief Random frames per test
+#define TEST_FRAMES             20000
+
+//! \brief Decode buffer of the test decoder
+#define TEST_DEC_SIZE           SDI_FRAME_RAW_LEN(TEST_MAX_PAYLOAD)
+
+// ****************************************************************************
+// typedefs
+// ****************************************************************************
+
+//! \brief A frame as it was sent
+typedef struct
+{
+    uint8_t  type;
+    uint8_t  seq;
+    uint16_t len;
+    uint8_t  payload[TEST_MAX_PAYLOAD];
+} TestFrame_t;
+
+// ****************************************************************************
+// globals
+// ****************************************************************************
+
+static uint8_t decBuf[TEST_DEC_SIZE];
+static SDIFrame_Decoder_t dec;
+
+// -----------------------------------------------------------------------------
+//! \brief      Random frame. Payloads lean towards zeros and 0xFF runs, the
+//!             COBS corner cases, and towards lengths around block borders.
+//!
+//! \param[out] pFrame - filled in
+//! \param[in]  maxLen - largest payload
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void randomFrame(TestFrame_t *pFrame, uint16_t maxLen)
+{
+    static const uint16_t edges[] = { 0, 1, 250, 251, 252, 253, 254, 255, 508 };
+    uint16_t i;
+    int kind = rand() % 4;
+
+    pFrame->type = (uint8_t)rand();
+    pFrame->seq = (uint8_t)rand();
+
+    if ((rand() % 4) == 0)
+    {
+        pFrame->len = edges[rand() % (sizeof(edges) / sizeof(edges[0]))];
+    }
+    else
+    {
+        pFrame->len = (uint16_t)(rand() % (maxLen + 1));
+    }
+    if (pFrame->len > maxLen)
+    {
+        pFrame->len = maxLen;
+    }
+
+    for (i = 0; i < pFrame->len; i++)
+    {
+        switch (kind)
+        {
+            case 0:  pFrame->payload[i] = 0; break;
+            case 1:  pFrame->payload[i] = (rand() % 8) ? 0xFF : 0; break;
+            case 2:  pFrame->payload[i] = (rand() % 3) ? 0 : (uint8_t)rand(); break;
+            default: pFrame->payload[i] = (uint8_t)rand(); break;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Encode a frame and check the encoding's invariants
+//!
+//! \param[in]  pFrame - frame to encode
+//! \param[out] pOut   - encoded frame, SDI_FRAME_ENCODED_MAX(len) bytes
+//!
+//! \return     uint16_t - encoded length
+// -----------------------------------------------------------------------------
+static uint16_t encodeFrame(const TestFrame_t *pFrame, uint8_t *pOut)
+{
+    uint16_t outLen;
+    uint16_t i;
+
+    outLen = SDIFrame_encode(pFrame->type, pFrame->seq, pFrame->payload,
+                             pFrame->len, pOut,
+                             SDI_FRAME_ENCODED_MAX(pFrame->len));
+
+    CHECK(outLen > SDI_FRAME_RAW_LEN(pFrame->len));
+    CHECK(outLen <= SDI_FRAME_ENCODED_MAX(pFrame->len));
+    CHECK(pOut[outLen - 1] == SDI_FRAME_DELIM);
+    for (i = 0; i + 1 < outLen; i++)
+    {
+        CHECK(pOut[i] != SDI_FRAME_DELIM);
+    }
+
+    return outLen;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Feed bytes to the test decoder in random pieces
+//!
+//! \param[in]  pIn     - received bytes
+//! \param[in]  len     - number of bytes
+//! \param[out] pFrames - frames decoded, with status
+//! \param[out] pStatus - status of each frame
+//! \param[in]  max     - room in pFrames
+//!
+//! \return     uint16_t - number of frames or errors reported
+// -----------------------------------------------------------------------------
+static uint16_t decodeStream(const uint8_t *pIn, uint16_t len,
+                             TestFrame_t *pFrames, uint8_t *pStatus,
+                             uint16_t max)
+{
+    SDIFrame_t frame;
+    uint16_t cnt = 0;
+    uint16_t piece;
+    uint16_t used;
+    uint8_t status;
+
+    while (len)
+    {
+        piece = (uint16_t)(1 + rand() % len);
+
+        while (piece)
+        {
+            used = SDIFrame_decode(&dec, pIn, piece, &frame, &status);
+            CHECK((used > 0) && (used <= piece));
+            pIn += used;
+            len -= used;
+            piece -= used;
+
+            if (status == SDI_FRAME_INCOMPLETE)
+            {
+                CHECK(piece == 0);
+                continue;
+            }
+
+            // Anything else ends at a delimiter
+            CHECK(pIn[-1] == SDI_FRAME_DELIM);
+
+            if (cnt < max)
+            {
+                pStatus[cnt] = status;
+                if (status == SDI_FRAME_OK)
+                {
+                    pFrames[cnt].type = frame.type;
+                    pFrames[cnt].seq = frame.seq;
+                    pFrames[cnt].len = frame.len;
+                    memcpy(pFrames[cnt].payload, frame.pPayload, frame.len);
+                }
+            }
+            cnt++;
+        }
+    }
+
+    return cnt;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Whether two frames are the same
+// -----------------------------------------------------------------------------
+static int sameFrame(const TestFrame_t *pA, const TestFrame_t *pB)
+{
+    return (pA->type == pB->type) && (pA->seq == pB->seq) &&
+           (pA->len == pB->len) && !memcmp(pA->payload, pB->payload, pA->len);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Known answer: the CRC-16/CCITT-FALSE check value
+// -----------------------------------------------------------------------------
+static void testCrc(void)
+{
+    static const uint8_t check[] = "123456789";
+
+    CHECK(SDIFrame_crc16(SDI_FRAME_CRC_INIT, check, 9) == 0x29B1);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Random frames, back to back with idle delimiters between some,
+//!             decode to what was sent
+// -----------------------------------------------------------------------------
+static void testRoundTrip(void)
+{
+    static uint8_t wire[4 * SDI_FRAME_ENCODED_MAX(TEST_MAX_PAYLOAD)];
+    static TestFrame_t sent[3];
+    static TestFrame_t got[3];
+    uint8_t status[3];
+    uint16_t wireLen;
+    uint16_t cnt;
+    uint32_t n;
+    uint8_t i;
+
+    SDIFrame_initDecoder(&dec, decBuf, sizeof(decBuf));
+
+    for (n = 0; n < TEST_FRAMES; n++)
+    {
+        wireLen = 0;
+        for (i = 0; i < 3; i++)
+        {
+            randomFrame(&sent[i], TEST_MAX_PAYLOAD);
+            wireLen += encodeFrame(&sent[i], &wire[wireLen]);
+            if (rand() % 4 == 0)
+            {
+                wire[wireLen++] = SDI_FRAME_DELIM;
+            }
+        }
+
+        cnt = decodeStream(wire, wireLen, got, status, 3);
+        CHECK(cnt == 3);
+        for (i = 0; (i < 3) && (i < cnt); i++)
+        {
+            CHECK(status[i] == SDI_FRAME_OK);
+            CHECK(sameFrame(&sent[i], &got[i]));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      A frame with a flipped bit or a dropped byte is never taken
+//!             for valid, and the frame after it still decodes
+// -----------------------------------------------------------------------------
+static void testCorruption(void)
+{
+    static uint8_t wire[2 * SDI_FRAME_ENCODED_MAX(TEST_MAX_PAYLOAD)];
+    static TestFrame_t sent[2];
+    static TestFrame_t got[4];
+    uint8_t status[4];
+    uint16_t firstLen;
+    uint16_t wireLen;
+    uint16_t pos;
+    uint16_t cnt;
+    uint32_t n;
+    uint16_t i;
+
+    SDIFrame_initDecoder(&dec, decBuf, sizeof(decBuf));
+
+    for (n = 0; n < TEST_FRAMES; n++)
+    {
+        randomFrame(&sent[0], TEST_MAX_PAYLOAD);
+        randomFrame(&sent[1], TEST_MAX_PAYLOAD);
+        firstLen = encodeFrame(&sent[0], wire);
+        wireLen = firstLen + encodeFrame(&sent[1], &wire[firstLen]);
+
+        // Damage the first frame, but not its delimiter
+        pos = (uint16_t)(rand() % (firstLen - 1));
+        if (rand() & 1)
+        {
+            wire[pos] ^= (uint8_t)(1 << (rand() % 8));
+        }
+        else
+        {
+            memmove(&wire[pos], &wire[pos + 1], wireLen - pos - 1);
+            wireLen--;
+        }
+
+        // A damaged code byte can turn into a delimiter and split the
+        // frame, so there may be an extra error. None of them may be valid.
+        cnt = decodeStream(wire, wireLen, got, status, 4);
+        CHECK((cnt >= 2) && (cnt <= 4));
+        for (i = 0; (i + 1 < cnt) && (i < 4); i++)
+        {
+            CHECK(status[i] != SDI_FRAME_OK);
+        }
+        if ((cnt >= 2) && (cnt <= 4))
+        {
+            CHECK(status[cnt - 1] == SDI_FRAME_OK);
+            CHECK(sameFrame(&sent[1], &got[cnt - 1]));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      A frame too big for the decode buffer is reported as an
+//!             overflow, short frames as malformed, and decoding resumes
+// -----------------------------------------------------------------------------
+static void testLimits(void)
+{
+    static uint8_t wire[3 * SDI_FRAME_ENCODED_MAX(TEST_MAX_PAYLOAD)];
+    static uint8_t smallBuf[SDI_FRAME_RAW_LEN(100)];
+    static TestFrame_t sent;
+    static TestFrame_t got[3];
+    uint8_t status[3];
+    uint16_t wireLen;
+    uint16_t cnt;
+
+    SDIFrame_initDecoder(&dec, smallBuf, sizeof(smallBuf));
+
+    // One byte over the buffer, then one that just fits
+    randomFrame(&sent, 0);
+    sent.len = 101;
+    memset(sent.payload, 0x11, sent.len);
+    wireLen = encodeFrame(&sent, wire);
+    sent.len = 100;
+    wireLen += encodeFrame(&sent, &wire[wireLen]);
+
+    cnt = decodeStream(wire, wireLen, got, status, 3);
+    CHECK(cnt == 2);
+    CHECK(status[0] == SDI_FRAME_ERR_OVERFLOW);
+    CHECK(status[1] == SDI_FRAME_OK);
+    CHECK(sameFrame(&sent, &got[1]));
+
+    // Too short to hold a header and CRC
+    wire[0] = 0x04;
+    wire[1] = 0x01;
+    wire[2] = 0x02;
+    wire[3] = 0x03;
+    wire[4] = SDI_FRAME_DELIM;
+    wireLen = 5 + encodeFrame(&sent, &wire[5]);
+
+    cnt = decodeStream(wire, wireLen, got, status, 3);
+    CHECK(cnt == 2);
+    CHECK(status[0] == SDI_FRAME_ERR_FORMAT);
+    CHECK(status[1] == SDI_FRAME_OK);
+
+    // The encoder refuses a buffer smaller than the worst case
+    CHECK(SDIFrame_encode(sent.type, sent.seq, sent.payload, sent.len, wire,
+                          SDI_FRAME_ENCODED_MAX(sent.len) - 1) == 0);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Parse a hex string
+//!
+//! \param[in]  pHex - hex digits, ends at the first non hex character
+//! \param[out] pOut - bytes
+//! \param[in]  max  - room in pOut
+//!
+//! \return     int - number of bytes, -1 on odd length or overflow
+// -----------------------------------------------------------------------------
+static int parseHex(const char *pHex, uint8_t *pOut, int max)
+{
+    int n = 0;
+    unsigned int b;
+
+    while ((pHex[0] != '\0') && (pHex[0] != '\n') && (pHex[0] != ' '))
+    {
+        if ((n == max) || (sscanf(pHex, "%2x", &b) != 1) || (pHex[1] == '\0'))
+        {
+            return -1;
+        }
+        pOut[n++] = (uint8_t)b;
+        pHex += 2;
+    }
+
+    return n;
+}
+
+static void printHex(const uint8_t *pBuf, uint16_t len)
+{
+    while (len--)
+    {
+        printf("%02x", *pBuf++);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      --encode: each stdin line "type seq payloadhex" is answered
+//!             with the hex of the encoded frame
+//!
+//! \return     int - exit status
+// -----------------------------------------------------------------------------
+static int runEncode(void)
+{
+    static char line[2 * TEST_MAX_PAYLOAD + 64];
+    static TestFrame_t frame;
+    static uint8_t out[SDI_FRAME_ENCODED_MAX(TEST_MAX_PAYLOAD)];
+    unsigned int type;
+    unsigned int seq;
+    int pos;
+    int len;
+
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        if (sscanf(line, "%x %x %n", &type, &seq, &pos) != 2)
+        {
+            return 1;
+        }
+        len = parseHex(&line[pos], frame.payload, TEST_MAX_PAYLOAD);
+        if (len < 0)
+        {
+            return 1;
+        }
+
+        printHex(out, SDIFrame_encode((uint8_t)type, (uint8_t)seq,
+                                      frame.payload, (uint16_t)len, out,
+                                      sizeof(out)));
+        printf("\n");
+    }
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      --decode: stdin lines of wire bytes in hex are fed to one
+//!             decoder, and every frame or error is printed as "ok type seq
+//!             payloadhex" or "err status"
+//!
+//! \return     int - exit status
+// -----------------------------------------------------------------------------
+static int runDecode(void)
+{
+    static char line[8192];
+    static uint8_t in[sizeof(line) / 2];
+    SDIFrame_t frame;
+    uint8_t status;
+    uint16_t used;
+    int len;
+    int pos;
+
+    SDIFrame_initDecoder(&dec, decBuf, sizeof(decBuf));
+
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        len = parseHex(line, in, sizeof(in));
+        if (len < 0)
+        {
+            return 1;
+        }
+
+        for (pos = 0; pos < len; pos += used)
+        {
+            used = SDIFrame_decode(&dec, &in[pos], (uint16_t)(len - pos),
+                                   &frame, &status);
+            if (status == SDI_FRAME_OK)
+            {
+                printf("ok %02x %02x ", frame.type, frame.seq);
+                printHex(frame.pPayload, frame.len);
+                printf("\n");
+            }
+            else if (status != SDI_FRAME_INCOMPLETE)
+            {
+                printf("err %d\n", status);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if ((argc == 2) && !strcmp(argv[1], "--encode"))
+    {
+        return runEncode();
+    }
+    if ((argc == 2) && !strcmp(argv[1], "--decode"))
+    {
+        return runDecode();
+    }
+
+    srand(5);
+
+    testCrc();
+    testRoundTrip();
+    testCorruption();
+    testLimits();
+
+    return TEST_RESULT("sdi_frame_test");
+}
@@ -0,0 +1,245 @@
+/******************************************************************************
+
+ @file  sdi_rxbuf_bench.c
+
+  Host benchmark of the SDI RX ring against the byte loop it
+  replaced. Bytes are pushed through in transport sized reads and
+  pulled out in delivery sized copies, and the MB/s of each is printed.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// ****************************************************************************
+// includes
+// ****************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_types.h"
+#include "inc/sdi_config.h"
+#include "inc/sdi_rxbuf.h"
+#include "sdi_host_bench.h"
+
+// ****************************************************************************
+// defines
+// ****************************************************************************
+
+//! \brief Bytes pushed through each ring per run
+#define BENCH_BYTES             (64UL * 1024 * 1024)
+
+//! \brief Transport read and delivery sizes, the SDI defaults
+#define BENCH_READ_LEN          128
+#define BENCH_DELIVERY_LEN      SDI_RX_DELIVERY_SIZE
+
+// ****************************************************************************
+// globals
+// ****************************************************************************
+
+//! \brief Transport stand-in, bytes are copied from here
+static uint8 wire[SDI_RXBUF_SIZE];
+
+//! \brief Where the benchmark's result bytes end up
+static volatile uint8 benchSink;
+
+//! \brief The RX buffer as it was before the power-of-two ring: a
+//!        SDI_TL_BUF_SIZE array with modulo indices, emptied a byte at a time
+static uint8 legacyBuf[SDI_TL_BUF_SIZE];
+static uint16 legacyHead;
+static uint16 legacyTail;
+
+// -----------------------------------------------------------------------------
+//! \brief      Transport layer read both rings pull their bytes from
+//!
+//! \param[out] buf - destination
+//! \param[in]  len - bytes wanted
+//!
+//! \return     uint16 - len
+// -----------------------------------------------------------------------------
+uint16 SDITL_readTL(uint8 *buf, uint16 len)
+{
+    memcpy(buf, wire, len);
+    return len;
+}
+
+static uint16 legacyRead(uint16 len)
+{
+    uint16 partialLen = 0;
+
+    if ((len + legacyTail) > SDI_TL_BUF_SIZE)
+    {
+        partialLen = SDI_TL_BUF_SIZE - legacyTail;
+        SDITL_readTL(&legacyBuf[legacyTail], partialLen);
+        len -= partialLen;
+        legacyTail = 0;
+    }
+
+    SDITL_readTL(&legacyBuf[legacyTail], len);
+    legacyTail = (legacyTail + len) % SDI_TL_BUF_SIZE;
+
+    return len + partialLen;
+}
+
+static uint16 legacyGetLen(void)
+{
+    return ((legacyTail - legacyHead) + SDI_TL_BUF_SIZE) % SDI_TL_BUF_SIZE;
+}
+
+static uint16 legacyReadFromRxBuf(uint8_t *buf, uint16 len)
+{
+    uint16_t idx;
+
+    for (idx = 0; idx < len; idx++)
+    {
+        *buf++ = legacyBuf[legacyHead];
+        legacyHead = (legacyHead + 1) % SDI_TL_BUF_SIZE;
+    }
+
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Push BENCH_BYTES through the byte loop buffer
+//!
+//! \param[out] sink - delivery buffer
+//!
+//! \return     double - seconds taken
+// -----------------------------------------------------------------------------
+static double benchLegacy(uint8_t *sink)
+{
+    uint32_t moved = 0;
+    double start = benchNow();
+    uint16 len;
+
+    while (moved < BENCH_BYTES)
+    {
+        legacyRead(BENCH_READ_LEN);
+
+        // The old buffer could not tell full from empty, never let it fill
+        while ((len = legacyGetLen()) >= BENCH_DELIVERY_LEN)
+        {
+            moved += legacyReadFromRxBuf(sink, BENCH_DELIVERY_LEN);
+        }
+        (void)len;
+    }
+
+    return benchNow() - start;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Push BENCH_BYTES through the ring, copying out
+//!
+//! \param[out] sink - delivery buffer
+//!
+//! \return     double - seconds taken
+// -----------------------------------------------------------------------------
+static double benchRing(uint8_t *sink)
+{
+    uint32_t moved = 0;
+    double start = benchNow();
+
+    while (moved < BENCH_BYTES)
+    {
+        SDIRxBuf_Read(BENCH_READ_LEN);
+
+        while (SDIRxBuf_GetRxBufLen() >= BENCH_DELIVERY_LEN)
+        {
+            moved += SDIRxBuf_ReadFromRxBuf(sink, BENCH_DELIVERY_LEN);
+        }
+    }
+
+    return benchNow() - start;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Push BENCH_BYTES through the ring, handing spans out in place
+//!
+//! \param[out] sink - where the spans are checksummed into
+//!
+//! \return     double - seconds taken
+// -----------------------------------------------------------------------------
+static double benchRingPeek(uint8_t *sink)
+{
+    uint32_t moved = 0;
+    double start = benchNow();
+    uint8_t *pSpan;
+    uint16 span;
+
+    while (moved < BENCH_BYTES)
+    {
+        SDIRxBuf_Read(BENCH_READ_LEN);
+
+        while (SDIRxBuf_GetRxBufLen() >= BENCH_DELIVERY_LEN)
+        {
+            span = SDIRxBuf_Peek(&pSpan);
+            if (span > BENCH_DELIVERY_LEN)
+            {
+                span = BENCH_DELIVERY_LEN;
+            }
+
+            // Touch the span the way an app callback would
+            sink[0] ^= pSpan[0] ^ pSpan[span - 1];
+            SDIRxBuf_Consume(span);
+            moved += span;
+        }
+    }
+
+    return benchNow() - start;
+}
+
+int main(void)
+{
+    static uint8_t sink[SDI_RXBUF_SIZE];
+    uint16 i;
+
+    for (i = 0; i < sizeof(wire); i++)
+    {
+        wire[i] = (uint8)i;
+    }
+
+    printf("%lu MB, %d byte reads, %d byte deliveries\n",
+           BENCH_BYTES >> 20, BENCH_READ_LEN, BENCH_DELIVERY_LEN);
+    benchReport("byte loop (before)", BENCH_BYTES, benchLegacy(sink));
+    benchReport("ring, copy out", BENCH_BYTES, benchRing(sink));
+    benchReport("ring, peek/consume", BENCH_BYTES, benchRingPeek(sink));
+
+    // Keep the peek loop's reads from being optimised away
+    benchSink = sink[0];
+
+    return 0;
+}
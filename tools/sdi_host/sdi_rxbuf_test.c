@@ -0,0 +1,337 @@
+/******************************************************************************
+
+ @file  sdi_rxbuf_test.c
+
+  Host test of the SDI RX ring: empty and full boundaries, spans
+  split at the end of the buffer and the free running indices
+  wrapping past 65535.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// ****************************************************************************
+// includes
+// ****************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_types.h"
+#include "inc/sdi_config.h"
+#include "inc/sdi_rxbuf.h"
+#include "sdi_host_test.h"
+
+// ****************************************************************************
+// globals
+// ****************************************************************************
+
+//! \brief Transport stand-in. Bytes on the wire count up from wireNext, and
+//!        at most wireAvail of them can be read before the next refill.
+static uint8 wireNext;
+static uint16 wireAvail;
+
+//! \brief Value the next byte out of the ring must have
+static uint8 expectNext;
+
+//! \brief Start of RxBuf, taken from the write span of the empty ring
+static uint8_t *rxBase;
+
+// -----------------------------------------------------------------------------
+//! \brief      Transport layer read the ring pulls its bytes from
+//!
+//! \param[out] buf - destination
+//! \param[in]  len - bytes wanted
+//!
+//! \return     uint16 - bytes read, less than len once wireAvail runs out
+// -----------------------------------------------------------------------------
+uint16 SDITL_readTL(uint8 *buf, uint16 len)
+{
+    uint16 i;
+
+    if (len > wireAvail)
+    {
+        len = wireAvail;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        buf[i] = wireNext++;
+    }
+    wireAvail -= len;
+
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Put bytes on the wire and let the ring read them
+//!
+//! \param[in]  len - bytes the transport reports
+//!
+//! \return     uint16 - bytes the ring stored
+// -----------------------------------------------------------------------------
+static uint16 fill(uint16 len)
+{
+    wireAvail = len;
+    return SDIRxBuf_Read(len);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Copy bytes out of the ring and check they come in wire order
+//!
+//! \param[in]  len - bytes to ask for
+//!
+//! \return     uint16 - bytes copied
+// -----------------------------------------------------------------------------
+static uint16 drain(uint16 len)
+{
+    static uint8 buf[SDI_RXBUF_SIZE];
+    uint16 got = SDIRxBuf_ReadFromRxBuf(buf, len);
+    uint16 i;
+
+    for (i = 0; i < got; i++)
+    {
+        CHECK(buf[i] == expectNext);
+        expectNext++;
+    }
+
+    return got;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Consume whatever the ring holds through Peek/Consume
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void drainPeek(void)
+{
+    uint8_t *pSpan;
+    uint16 span;
+    uint16 i;
+    uint8 spans;
+
+    // Wrapped data comes in two spans, never more
+    for (spans = 0; (spans < 2) && ((span = SDIRxBuf_Peek(&pSpan)) != 0);
+         spans++)
+    {
+        for (i = 0; i < span; i++)
+        {
+            CHECK(pSpan[i] == expectNext);
+            expectNext++;
+        }
+        SDIRxBuf_Consume(span);
+    }
+
+    CHECK(SDIRxBuf_GetRxBufLen() == 0);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      An empty ring has nothing to read and can be filled up to the
+//!             end of RxBuf in one span
+//!
+//! \return     uint16 - where in RxBuf the indices are
+// -----------------------------------------------------------------------------
+static uint16 testEmpty(void)
+{
+    uint8_t *pSpan;
+    uint16 span;
+
+    CHECK(SDIRxBuf_GetRxBufLen() == 0);
+    CHECK(SDIRxBuf_Peek(&pSpan) == 0);
+    CHECK(drain(16) == 0);
+
+    span = SDIRxBuf_GetWriteSpan(&pSpan);
+    if (rxBase == NULL)
+    {
+        // Both indices start at 0
+        CHECK(span == SDI_RXBUF_SIZE);
+        rxBase = pSpan;
+    }
+    CHECK(pSpan + span == rxBase + SDI_RXBUF_SIZE);
+
+    return (uint16)(pSpan - rxBase);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      A full ring reports its size, not 0, and takes no more
+// -----------------------------------------------------------------------------
+static void testFull(void)
+{
+    uint8_t *pSpan;
+
+    CHECK(fill(SDI_RXBUF_SIZE) == SDI_RXBUF_SIZE);
+    CHECK(SDIRxBuf_GetRxBufLen() == SDI_RXBUF_SIZE);
+    CHECK(SDIRxBuf_GetWriteSpan(&pSpan) == 0);
+    CHECK(fill(1) == 0);
+
+    // One byte out makes room for exactly one byte in
+    CHECK(drain(1) == 1);
+    CHECK(fill(2) == 1);
+    CHECK(SDIRxBuf_GetRxBufLen() == SDI_RXBUF_SIZE);
+
+    CHECK(drain(SDI_RXBUF_SIZE) == SDI_RXBUF_SIZE);
+    testEmpty();
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Data that runs past the end of RxBuf is read in two spans
+// -----------------------------------------------------------------------------
+static void testWrap(void)
+{
+    uint8_t *pSpan;
+    uint8_t *pBase = rxBase;
+    uint16 used;
+
+    // Move the indices to 10 bytes short of the end
+    used = (SDI_RXBUF_SIZE - 10 - testEmpty()) & (SDI_RXBUF_SIZE - 1);
+    CHECK(fill(used) == used);
+    CHECK(drain(used) == used);
+    CHECK(SDIRxBuf_GetWriteSpan(&pSpan) == 10);
+    CHECK(pSpan == pBase + SDI_RXBUF_SIZE - 10);
+
+    // 30 bytes in: 10 at the end, 20 at the start
+    CHECK(fill(30) == 30);
+    CHECK(SDIRxBuf_GetRxBufLen() == 30);
+    CHECK(SDIRxBuf_Peek(&pSpan) == 10);
+    CHECK(pSpan == pBase + SDI_RXBUF_SIZE - 10);
+
+    // Free space stops at the unread bytes, not at the end of RxBuf
+    CHECK(SDIRxBuf_GetWriteSpan(&pSpan) == SDI_RXBUF_SIZE - 30);
+    CHECK(pSpan == pBase + 20);
+
+    // A copy across the end comes out in order
+    CHECK(drain(25) == 25);
+    CHECK(SDIRxBuf_Peek(&pSpan) == 5);
+    CHECK(pSpan == pBase + 15);
+
+    // In place writes up to the end, then from the start
+    used = SDIRxBuf_GetWriteSpan(&pSpan);
+    CHECK(used == SDI_RXBUF_SIZE - 20);
+    wireAvail = used;
+    CHECK(SDITL_readTL(pSpan, used) == used);
+    SDIRxBuf_Commit(used);
+    CHECK(SDIRxBuf_GetRxBufLen() == SDI_RXBUF_SIZE - 15);
+    CHECK(SDIRxBuf_GetWriteSpan(&pSpan) == 15);
+    CHECK(pSpan == pBase);
+
+    drainPeek();
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      A transport that returns fewer bytes than it reported only
+//!             publishes what arrived
+// -----------------------------------------------------------------------------
+static void testShortRead(void)
+{
+    uint16 got;
+
+    wireAvail = 7;
+    got = SDIRxBuf_Read(20);
+    CHECK(got == 7);
+    CHECK(SDIRxBuf_GetRxBufLen() == 7);
+
+    drainPeek();
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Random traffic through the ring until the 16 bit indices have
+//!             wrapped several times, checking order and bounds throughout
+// -----------------------------------------------------------------------------
+static void testIndexWrap(void)
+{
+    uint32_t moved = 0;
+    uint32_t rounds;
+    uint16 held = SDIRxBuf_GetRxBufLen();
+    uint16 got;
+    uint16 len;
+
+    srand(2);
+
+    // Bounded, so a ring that stops moving data fails instead of hanging
+    for (rounds = 0; (moved < 5UL * 65536) && (rounds < 100000); rounds++)
+    {
+        len = (uint16)(rand() % (SDI_RXBUF_SIZE + 40));
+        got = fill(len);
+        CHECK(got == ((len < SDI_RXBUF_SIZE - held) ?
+                      len : SDI_RXBUF_SIZE - held));
+        held += got;
+        CHECK(SDIRxBuf_GetRxBufLen() == held);
+
+        len = (uint16)(rand() % (SDI_RXBUF_SIZE + 40));
+        if (rand() & 1)
+        {
+            got = drain(len);
+            CHECK(got == ((len < held) ? len : held));
+            held -= got;
+        }
+        else
+        {
+            uint8_t *pSpan;
+            uint16 span = SDIRxBuf_Peek(&pSpan);
+            uint16 i;
+
+            // A span shorter than the data stops at the end of RxBuf
+            CHECK(span <= held);
+            CHECK((span == held) || (pSpan + span == rxBase + SDI_RXBUF_SIZE));
+            for (i = 0; i < span; i++)
+            {
+                CHECK(pSpan[i] == expectNext);
+                expectNext++;
+            }
+            SDIRxBuf_Consume(span);
+            held -= span;
+            got = span;
+        }
+        CHECK(SDIRxBuf_GetRxBufLen() == held);
+
+        moved += got;
+    }
+    CHECK(moved >= 5UL * 65536);
+
+    drainPeek();
+}
+
+int main(void)
+{
+    testEmpty();
+    testFull();
+    testWrap();
+    testShortRead();
+    testIndexWrap();
+
+    return TEST_RESULT("sdi_rxbuf_test");
+}
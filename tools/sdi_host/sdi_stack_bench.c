@@ -0,0 +1,1040 @@
+/******************************************************************************
+
+ @file  sdi_stack_bench.c
+
+  Host benchmark of the whole SDI stack. The SDI task, transport layer
+  and UART transport run unchanged on the POSIX shims, with a pseudo
+  terminal standing in for the UART and this program acting as both the
+  app and the host. Messages are timed and checked each way, and the
+  throughput, latency, CPU time and heap use per message and the SDI
+  counters are printed. The plain build first runs the heap based TX
+  path the frame pool replaced, as a reference.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// ****************************************************************************
+// includes
+// ****************************************************************************
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "hal_types.h"
+#include "bcomdef.h"
+#include "Board.h"
+#include "uart_pty.h"
+#include "inc/sdi_config.h"
+#include "inc/sdi_task.h"
+#include "inc/sdi_tl_uart.h"
+#ifdef SDI_USE_FRAMING
+#include "inc/sdi_frame.h"
+#else
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Event.h>
+#include <ti/sysbios/knl/Queue.h>
+#include "inc/sdi_data.h"
+#include "inc/sdi_tl.h"
+#endif //SDI_USE_FRAMING
+#include "sdi_host_bench.h"
+
+// ****************************************************************************
+// defines
+// ****************************************************************************
+
+//! \brief Each message starts with its sequence number and send time
+#define BENCH_MSG_HDR_LEN       12
+#define BENCH_MSG_SIZE          64
+#define BENCH_BYTES             (4UL * 1024 * 1024)
+#define BENCH_LINE_RATE_BYTES   (64UL * 1024)
+
+//! \brief Give up once nothing has arrived for this long
+#define BENCH_STALL_SECS        5
+
+//! \brief ms to wait for the SDI counters to catch up with the host
+#define BENCH_SETTLE_POLLS      100
+
+//! \brief us an app waits before trying again to reserve a TX frame
+#define BENCH_RESERVE_BACKOFF_US 50
+
+#ifndef SDI_USE_FRAMING
+//! \brief Events of the heap TX path's task, as SDI numbered them
+#define HEAP_TX_DONE_EVENT      Event_Id_01
+#define HEAP_TX_READY_EVENT     Event_Id_02
+#endif //SDI_USE_FRAMING
+
+// ****************************************************************************
+// typedefs
+// ****************************************************************************
+
+//! \brief Receiving end of one direction. Bytes are gathered into whole
+//!        messages, which must arrive complete and in order.
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    uint8_t         msg[SDI_TX_FRAME_SIZE];
+    uint16_t        msgLen;
+    unsigned long   received;
+    unsigned long   errors;
+    int64_t         *pLatency;
+    double          end;
+} BenchSink_t;
+
+//! \brief What one direction cost, beyond the bytes it moved
+typedef struct
+{
+    unsigned long   allocs;     //!< Heap calls
+    size_t          heapBase;   //!< Heap in use at the start
+    size_t          heapPeak;   //!< Most heap in use above heapBase
+    double          cpuStart;
+    double          cpuSecs;    //!< CPU time of every thread in the process
+} BenchCost_t;
+
+#ifndef SDI_USE_FRAMING
+//! \brief Queue record of the heap TX path, as SDI_QueueRec was
+typedef struct
+{
+    Queue_Elem _elem;
+    SDIMSG_msg_t *sdiMsg;
+} BenchHeapRec_t;
+#endif //SDI_USE_FRAMING
+
+//*****************************************************************************
+// globals
+//*****************************************************************************
+
+static uint16_t benchMsgSize = BENCH_MSG_SIZE;
+static unsigned long benchMsgCnt;
+static uint8_t benchLineRate;
+static uint8_t benchBatch;
+
+//! \brief Master side of the pty, ie. the host
+static int hostFd;
+
+static BenchSink_t txSink;
+static BenchSink_t rxSink;
+
+//! \brief Heap calls made by anything linked into this program, and the
+//!        bytes it has in use
+static unsigned long allocCnt;
+static size_t heapInUse;
+static size_t heapPeak;
+
+//! \brief Run the heap TX path instead of starting the SDI task
+static uint8_t benchHeapPath;
+
+#ifndef SDI_USE_FRAMING
+//! \brief Heap TX path: the ASYNC TX queue, the task's events and the
+//!        message being sent, as SDI kept them before the frame pool
+static Queue_Struct heapTxQueueStruct;
+static Queue_Handle heapTxQueue;
+static Event_Struct heapEvent;
+static Event_Handle hHeapEvent;
+static uint8_t *heapLastTxMsg;
+
+//! \brief The copy SDITL_writeTL used to make into sdiTxBuf
+static uint8_t heapTxBuf[SDI_TL_BUF_SIZE];
+#endif //SDI_USE_FRAMING
+
+extern void *__real_malloc(size_t size);
+extern void *__real_calloc(size_t n, size_t size);
+extern void *__real_realloc(void *p, size_t size);
+extern void __real_free(void *p);
+
+// -----------------------------------------------------------------------------
+//! \brief      Count a heap call and the change in bytes in use
+//!
+//! \param[in]  grow   - usable bytes gained
+//! \param[in]  shrink - usable bytes given back
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void heapCount(size_t grow, size_t shrink)
+{
+    size_t used;
+    size_t peak;
+
+    __atomic_add_fetch(&allocCnt, 1, __ATOMIC_RELAXED);
+
+    used = __atomic_add_fetch(&heapInUse, grow - shrink, __ATOMIC_RELAXED);
+    peak = __atomic_load_n(&heapPeak, __ATOMIC_RELAXED);
+    while ((used > peak) &&
+           !__atomic_compare_exchange_n(&heapPeak, &peak, used, TRUE,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *p = __real_malloc(size);
+
+    heapCount(malloc_usable_size(p), 0);
+    return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    void *p = __real_calloc(n, size);
+
+    heapCount(malloc_usable_size(p), 0);
+    return p;
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+    size_t old = malloc_usable_size(p);
+
+    p = __real_realloc(p, size);
+    heapCount(malloc_usable_size(p), old);
+    return p;
+}
+
+void __wrap_free(void *p)
+{
+    __atomic_sub_fetch(&heapInUse, malloc_usable_size(p), __ATOMIC_RELAXED);
+    __real_free(p);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      CPU time used by every thread of this process, in seconds
+//!
+//! \return     double - time
+// -----------------------------------------------------------------------------
+static double cpuNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Start counting what a run costs
+//!
+//! \param[out] pCost - cost of the run
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void costStart(BenchCost_t *pCost)
+{
+    pCost->allocs = __atomic_load_n(&allocCnt, __ATOMIC_RELAXED);
+    pCost->heapBase = __atomic_load_n(&heapInUse, __ATOMIC_RELAXED);
+    __atomic_store_n(&heapPeak, pCost->heapBase, __ATOMIC_RELAXED);
+    pCost->cpuStart = cpuNow();
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Stop counting what a run costs
+//!
+//! \param[out] pCost - cost of the run
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void costEnd(BenchCost_t *pCost)
+{
+    pCost->cpuSecs = cpuNow() - pCost->cpuStart;
+    pCost->allocs = __atomic_load_n(&allocCnt, __ATOMIC_RELAXED) -
+                    pCost->allocs;
+    pCost->heapPeak = __atomic_load_n(&heapPeak, __ATOMIC_RELAXED) -
+                      pCost->heapBase;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Monotonic time in ns
+//!
+//! \return     int64_t - time
+// -----------------------------------------------------------------------------
+static int64_t nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Fill in a message, stamped with the current time
+//!
+//! \param[out] pMsg - benchMsgSize bytes
+//! \param[in]  seq  - sequence number
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void makeMsg(uint8_t *pMsg, uint32_t seq)
+{
+    int64_t now = nowNs();
+    uint16_t i;
+
+    memcpy(pMsg, &seq, sizeof(seq));
+    memcpy(pMsg + sizeof(seq), &now, sizeof(now));
+
+    for (i = BENCH_MSG_HDR_LEN; i < benchMsgSize; i++)
+    {
+        pMsg[i] = (uint8_t)(seq + i);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Prepare a sink for a run
+//!
+//! \param[in]  pSink - sink
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void sinkInit(BenchSink_t *pSink)
+{
+    pthread_mutex_init(&pSink->lock, NULL);
+    pthread_cond_init(&pSink->cond, NULL);
+    pSink->msgLen = 0;
+    pSink->received = 0;
+    pSink->errors = 0;
+    pSink->pLatency = malloc(benchMsgCnt * sizeof(int64_t));
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Pass received bytes to a sink
+//!
+//! \param[in]  pSink - sink
+//! \param[in]  pData - bytes
+//! \param[in]  len   - number of bytes
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void sinkPut(BenchSink_t *pSink, const uint8_t *pData, uint16_t len)
+{
+    int64_t now = nowNs();
+    int64_t sent;
+    uint32_t seq;
+    uint16_t chunk;
+    uint16_t i;
+
+    pthread_mutex_lock(&pSink->lock);
+    while (len)
+    {
+        chunk = benchMsgSize - pSink->msgLen;
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+        memcpy(&pSink->msg[pSink->msgLen], pData, chunk);
+        pSink->msgLen += chunk;
+        pData += chunk;
+        len -= chunk;
+
+        if (pSink->msgLen < benchMsgSize)
+        {
+            break;
+        }
+        pSink->msgLen = 0;
+
+        memcpy(&seq, pSink->msg, sizeof(seq));
+        memcpy(&sent, pSink->msg + sizeof(seq), sizeof(sent));
+
+        for (i = BENCH_MSG_HDR_LEN;
+             (i < benchMsgSize) && (pSink->msg[i] == (uint8_t)(seq + i)); i++)
+        {
+        }
+
+        if ((seq != pSink->received) || (i != benchMsgSize) ||
+            (pSink->received >= benchMsgCnt))
+        {
+            pSink->errors++;
+            continue;
+        }
+
+        pSink->pLatency[pSink->received++] = now - sent;
+        if (pSink->received == benchMsgCnt)
+        {
+            pSink->end = benchNow();
+        }
+    }
+    pthread_cond_broadcast(&pSink->cond);
+    pthread_mutex_unlock(&pSink->lock);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Wait until a sink has every message, or stalls
+//!
+//! \param[in]  pSink - sink
+//!
+//! \return     uint8_t - TRUE if every message arrived intact
+// -----------------------------------------------------------------------------
+static uint8_t sinkWait(BenchSink_t *pSink)
+{
+    struct timespec ts;
+    unsigned long last;
+    int rc = 0;
+
+    pthread_mutex_lock(&pSink->lock);
+    while ((pSink->received < benchMsgCnt) && (rc == 0))
+    {
+        last = pSink->received;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += BENCH_STALL_SECS;
+
+        while ((pSink->received == last) && (rc == 0))
+        {
+            rc = pthread_cond_timedwait(&pSink->cond, &pSink->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&pSink->lock);
+
+    return (pSink->received == benchMsgCnt) && (pSink->errors == 0);
+}
+
+static int cmpLatency(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Print the results of one direction
+//!
+//! \param[in]  name   - direction
+//! \param[in]  pSink  - sink of that direction
+//! \param[in]  start  - when the first message was sent
+//! \param[in]  pCost  - what the run cost
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void report(const char *name, BenchSink_t *pSink, double start,
+                   const BenchCost_t *pCost)
+{
+    char label[32];
+    int64_t *pLat = pSink->pLatency;
+    unsigned long n = pSink->received;
+
+    snprintf(label, sizeof(label), "%s throughput", name);
+    benchReport(label, n * benchMsgSize, pSink->end - start);
+
+    if (n)
+    {
+        qsort(pLat, n, sizeof(*pLat), cmpLatency);
+        snprintf(label, sizeof(label), "%s latency", name);
+        printf("  %-24s %9.1f / %.1f / %.1f us (p50/p99/max)\n", label,
+               pLat[n / 2] / 1e3, pLat[(n * 99) / 100] / 1e3,
+               pLat[n - 1] / 1e3);
+    }
+
+    snprintf(label, sizeof(label), "%s cpu", name);
+    printf("  %-24s %9.1f ns/msg\n", label, pCost->cpuSecs * 1e9 / benchMsgCnt);
+
+    printf("  %-24s %9lu (%.2f/msg)\n", "heap allocations", pCost->allocs,
+           (double)pCost->allocs / benchMsgCnt);
+    printf("  %-24s %9lu bytes\n", "heap high water",
+           (unsigned long)pCost->heapPeak);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Host side of the TX run, reads what SDI sends to the host
+//!
+//! \param[in]  arg - N/A
+//!
+//! \return     void* - NULL
+// -----------------------------------------------------------------------------
+static void *hostReadFxn(void *arg)
+{
+    uint8_t buf[4096];
+    ssize_t n;
+#ifdef SDI_USE_FRAMING
+    static uint8_t frameBuf[SDI_FRAME_RAW_LEN(SDI_TX_FRAME_SIZE)];
+    SDIFrame_Decoder_t dec;
+    SDIFrame_t frame;
+    uint8_t status;
+    uint16_t used;
+    uint16_t off;
+
+    SDIFrame_initDecoder(&dec, frameBuf, sizeof(frameBuf));
+#endif //SDI_USE_FRAMING
+
+    (void)arg;
+
+    while (txSink.received < benchMsgCnt)
+    {
+        n = read(hostFd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            break;
+        }
+
+#ifdef SDI_USE_FRAMING
+        for (off = 0; off < n; off += used)
+        {
+            used = SDIFrame_decode(&dec, &buf[off], n - off, &frame, &status);
+
+            if (status == SDI_FRAME_OK)
+            {
+                sinkPut(&txSink, frame.pPayload, frame.len);
+            }
+            else if (status != SDI_FRAME_INCOMPLETE)
+            {
+                pthread_mutex_lock(&txSink.lock);
+                txSink.errors++;
+                pthread_mutex_unlock(&txSink.lock);
+            }
+        }
+#else
+        sinkPut(&txSink, buf, n);
+#endif //SDI_USE_FRAMING
+    }
+
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Host side of the RX run, sends messages to SDI
+//!
+//! \param[in]  arg - N/A
+//!
+//! \return     void* - NULL
+// -----------------------------------------------------------------------------
+static void *hostWriteFxn(void *arg)
+{
+    uint8_t msg[SDI_TX_FRAME_SIZE];
+#ifdef SDI_USE_FRAMING
+    uint8_t wire[SDI_FRAME_ENCODED_MAX(SDI_TX_FRAME_SIZE)];
+#endif //SDI_USE_FRAMING
+    uint8_t *pWire = msg;
+    uint16_t wireLen = benchMsgSize;
+    unsigned long seq;
+    unsigned long sent = 0;
+    struct timespec ts;
+    int64_t start = nowNs();
+    int64_t due;
+    ssize_t n;
+    uint16_t off;
+
+    (void)arg;
+
+    for (seq = 0; seq < benchMsgCnt; seq++)
+    {
+        makeMsg(msg, seq);
+
+#ifdef SDI_USE_FRAMING
+        wireLen = SDIFrame_encode(SDI_FRAME_MAKE_TYPE(SDI_FRAME_TYPE_DATA,
+                                                      SDI_CHANNEL_DEFAULT),
+                                  (uint8_t)seq, msg, benchMsgSize, wire,
+                                  sizeof(wire));
+        pWire = wire;
+#endif //SDI_USE_FRAMING
+
+        for (off = 0; off < wireLen; off += n)
+        {
+            n = write(hostFd, pWire + off, wireLen - off);
+            if (n <= 0)
+            {
+                return NULL;
+            }
+        }
+        sent += wireLen;
+
+        if (benchLineRate)
+        {
+            // The host's UART cannot go faster than the line either
+            due = start + (int64_t)sent * 10 * 1000000000 / SDI_UART_BR;
+            ts.tv_sec = due / 1000000000;
+            ts.tv_nsec = due % 1000000000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      App RX callback, runs on the SDI task
+//!
+//! \param[in]  event - UART_DATA_EVT
+//! \param[in]  pMsg  - received bytes
+//! \param[in]  len   - number of bytes
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void appRxCB(uint8_t event, uint8_t *pMsg, uint16_t len)
+{
+    if (event == UART_DATA_EVT)
+    {
+        sinkPut(&rxSink, pMsg, len);
+    }
+}
+
+#ifndef SDI_USE_FRAMING
+// -----------------------------------------------------------------------------
+//! \brief      Heap TX path: queue a message the way SDITask_sendToUART did
+//!             before the frame pool, with a message header, a payload and a
+//!             queue record from the heap for every message.
+//!
+//! \param[in]  pMsg    - message
+//! \param[in]  length  - length of the message
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void heapSendToUART(uint8_t *pMsg, uint16_t length)
+{
+    ICall_CSState key;
+    BenchHeapRec_t *recPtr;
+    SDIMSG_msg_t *pSDIMsg = (SDIMSG_msg_t *)malloc(sizeof(SDIMSG_msg_t));
+
+    key = ICall_enterCriticalSection();
+
+    pSDIMsg->msgType = SDIMSG_Type_ASYNC;
+    pSDIMsg->pBuf = (uint8 *)malloc(length);
+    pSDIMsg->pBufSize = length;
+    memcpy(pSDIMsg->pBuf, pMsg, length);
+
+    recPtr = malloc(sizeof(BenchHeapRec_t));
+    recPtr->sdiMsg = pSDIMsg;
+
+    Queue_put(heapTxQueue, &recPtr->_elem);
+    Event_post(hHeapEvent, HEAP_TX_READY_EVENT);
+
+    ICall_leaveCriticalSection(key);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Heap TX path: send the next queued message. The transport
+//!             gets a copy, and the payload is freed on TX done.
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void heapProcessTXQ(void)
+{
+    BenchHeapRec_t *recPtr = (BenchHeapRec_t *)Queue_get(heapTxQueue);
+
+    if ((Queue_Handle)recPtr != heapTxQueue)
+    {
+        heapLastTxMsg = recPtr->sdiMsg->pBuf;
+
+        memcpy(heapTxBuf, recPtr->sdiMsg->pBuf, recPtr->sdiMsg->pBufSize);
+        SDITL_writeTL(heapTxBuf, recPtr->sdiMsg->pBufSize);
+
+        free(recPtr->sdiMsg);
+        free(recPtr);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Heap TX path: transport TX done callback
+//!
+//! \param[in]  size - bytes sent
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void heapTxDoneCB(int size)
+{
+    (void)size;
+
+    free(heapLastTxMsg);
+    heapLastTxMsg = NULL;
+
+    Event_post(hHeapEvent, HEAP_TX_DONE_EVENT);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Heap TX path: transport RX and MRDY callbacks, unused since
+//!             the host only reads
+//!
+//! \param[in]  size - N/A
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void heapIdleCB(int size)
+{
+    (void)size;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Heap TX path: the TX half of the SDI task loop
+//!
+//! \param[in]  arg - N/A
+//!
+//! \return     void* - never returns
+// -----------------------------------------------------------------------------
+static void *heapTaskFxn(void *arg)
+{
+    UInt postedEvents;
+
+    (void)arg;
+
+    SDITL_initTL(heapTxDoneCB, heapIdleCB, heapIdleCB);
+
+    for (;;)
+    {
+        postedEvents = Event_pend(hHeapEvent, Event_Id_NONE,
+                                  HEAP_TX_READY_EVENT | HEAP_TX_DONE_EVENT,
+                                  BIOS_WAIT_FOREVER);
+
+        if (postedEvents & HEAP_TX_READY_EVENT)
+        {
+            if (!Queue_empty(heapTxQueue) && !SDITL_checkSdiBusy())
+            {
+                heapProcessTXQ();
+            }
+
+            if (!Queue_empty(heapTxQueue))
+            {
+                Event_post(hHeapEvent, HEAP_TX_READY_EVENT);
+            }
+        }
+
+        if ((postedEvents & HEAP_TX_DONE_EVENT) && !Queue_empty(heapTxQueue))
+        {
+            Event_post(hHeapEvent, HEAP_TX_READY_EVENT);
+        }
+    }
+
+    return NULL;
+}
+#endif //SDI_USE_FRAMING
+
+// -----------------------------------------------------------------------------
+//! \brief      Send benchMsgCnt messages from the app to the host
+//!
+//! \return     uint8_t - TRUE if the host got them all intact
+// -----------------------------------------------------------------------------
+static uint8_t runTx(void)
+{
+    SDI_Stats_t stats;
+    BenchCost_t cost;
+    pthread_t reader;
+    unsigned long seq;
+    unsigned int i;
+    uint8_t *pFrame;
+    uint8_t ok;
+    double start;
+
+    sinkInit(&txSink);
+    pthread_create(&reader, NULL, hostReadFxn, NULL);
+    SDITask_resetStats();
+
+    costStart(&cost);
+    start = benchNow();
+
+    for (seq = 0; seq < benchMsgCnt; seq++)
+    {
+#ifndef SDI_USE_FRAMING
+        if (benchHeapPath)
+        {
+            uint8_t msg[SDI_TX_FRAME_SIZE];
+
+            // The app builds the message and SDI copies it
+            makeMsg(msg, seq);
+            heapSendToUART(msg, benchMsgSize);
+            continue;
+        }
+#endif //SDI_USE_FRAMING
+
+        // Back off while the TX pool is empty, as an app task would. A
+        // short sleep rather than a yield, so that a spinning app does not
+        // take the CPU from the SDI task on a single core host.
+        while ((pFrame = SDITask_reserveTxFrame(benchMsgSize)) == NULL)
+        {
+            usleep(BENCH_RESERVE_BACKOFF_US);
+        }
+
+        makeMsg(pFrame, seq);
+        SDITask_commitTxFrame(pFrame, benchMsgSize);
+    }
+
+    ok = sinkWait(&txSink);
+    costEnd(&cost);
+
+    // The host can see the last transfer before the SDI task has counted it
+    for (i = 0; ok && !benchHeapPath && (i < BENCH_SETTLE_POLLS); i++)
+    {
+        SDITask_getStats(&stats);
+        if (stats.txFrames == benchMsgCnt)
+        {
+            break;
+        }
+        usleep(1000);
+    }
+
+    report("tx", &txSink, start, &cost);
+
+    if (!ok)
+    {
+        printf("  tx FAILED: %lu of %lu messages, %lu errors\n",
+               txSink.received, benchMsgCnt, txSink.errors);
+        pthread_cancel(reader);
+    }
+    pthread_join(reader, NULL);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Send benchMsgCnt messages from the host to the app
+//!
+//! \return     uint8_t - TRUE if the app got them all intact
+// -----------------------------------------------------------------------------
+static uint8_t runRx(void)
+{
+    BenchCost_t cost;
+    pthread_t writer;
+    uint8_t ok;
+    double start;
+
+    sinkInit(&rxSink);
+    SDITask_resetStats();
+
+    costStart(&cost);
+    start = benchNow();
+    pthread_create(&writer, NULL, hostWriteFxn, NULL);
+
+    ok = sinkWait(&rxSink);
+    costEnd(&cost);
+
+    report("rx", &rxSink, start, &cost);
+
+    if (!ok)
+    {
+        printf("  rx FAILED: %lu of %lu messages, %lu errors\n",
+               rxSink.received, benchMsgCnt, rxSink.errors);
+        pthread_cancel(writer);
+    }
+    pthread_join(writer, NULL);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Print the SDI counters of the last run
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void reportStats(void)
+{
+    SDI_Stats_t stats;
+
+    SDITask_getStats(&stats);
+
+    printf("  %-24s %9lu transfers, %lu frames, %lu retries\n", "sdi tx",
+           (unsigned long)stats.txTransfers, (unsigned long)stats.txFrames,
+           (unsigned long)stats.txRetries);
+    printf("  %-24s %9u high water of %d, %lu empty, %d bytes static\n",
+           "sdi tx pool", stats.txPoolHighWater, SDI_TX_FRAME_CNT,
+           (unsigned long)stats.txPoolEmpty,
+           SDI_TX_FRAME_CNT * SDI_TX_FRAME_SIZE);
+    printf("  %-24s %9lu bytes, %u high water, %lu dropped\n", "sdi rx",
+           (unsigned long)stats.rxBytes, stats.rxBufHighWater,
+           (unsigned long)stats.rxDroppedBytes);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Open the pty and point the UART at its far end
+//!
+//! \return     uint8_t - TRUE on success
+// -----------------------------------------------------------------------------
+static uint8_t openHost(void)
+{
+    hostFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((hostFd < 0) || grantpt(hostFd) || unlockpt(hostFd))
+    {
+        perror("pty");
+        return FALSE;
+    }
+
+    UARTPty_setPath(Board_UART, ptsname(hostFd));
+    UARTPty_setLineRate(benchLineRate);
+
+    return TRUE;
+}
+
+#ifndef SDI_USE_FRAMING
+// -----------------------------------------------------------------------------
+//! \brief      Run the TX direction over the heap TX path, as a reference for
+//!             the frame pool. It drives the transport in place of the SDI
+//!             task, so it runs in a child process of its own.
+//!
+//! \return     uint8_t - TRUE if the host got every message intact
+// -----------------------------------------------------------------------------
+static uint8_t runHeapPath(void)
+{
+    pthread_t task;
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+        benchHeapPath = TRUE;
+        if (!openHost())
+        {
+            _exit(1);
+        }
+
+        Queue_construct(&heapTxQueueStruct, NULL);
+        heapTxQueue = Queue_handle(&heapTxQueueStruct);
+        Event_construct(&heapEvent, NULL);
+        hHeapEvent = Event_handle(&heapEvent);
+        pthread_create(&task, NULL, heapTaskFxn, NULL);
+        UARTPty_waitOpen(Board_UART);
+
+        printf(" heap TX path (before)\n");
+        status = runTx();
+        fflush(stdout);
+        _exit(status ? 0 : 1);
+    }
+
+    if ((pid < 0) || (waitpid(pid, &status, 0) != pid))
+    {
+        perror("fork");
+        return FALSE;
+    }
+
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+#endif //SDI_USE_FRAMING
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n bytes] [-m msg size] [-b] [-l]\n"
+            "  -n  bytes to send each way (default %lu, %lu with -l)\n"
+            "  -m  message size, %d to %d (default %d)\n"
+            "  -b  pack queued TX frames into one transfer\n"
+            "  -l  run at the line rate of %d baud instead of flat out\n",
+            prog, BENCH_BYTES, BENCH_LINE_RATE_BYTES, BENCH_MSG_HDR_LEN,
+            SDI_TX_FRAME_SIZE, BENCH_MSG_SIZE, SDI_UART_BR);
+}
+
+int main(int argc, char **argv)
+{
+    SDI_TxConfig_t txConfig;
+    unsigned long bytes = 0;
+    uint8_t ok = TRUE;
+    int opt;
+    int msgSize = BENCH_MSG_SIZE;
+
+    while ((opt = getopt(argc, argv, "n:m:bl")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                bytes = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'm':
+                msgSize = atoi(optarg);
+                break;
+
+            case 'b':
+                benchBatch = TRUE;
+                break;
+
+            case 'l':
+                benchLineRate = TRUE;
+                break;
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if ((msgSize < BENCH_MSG_HDR_LEN) || (msgSize > SDI_TX_FRAME_SIZE))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (bytes == 0)
+    {
+        bytes = benchLineRate ? BENCH_LINE_RATE_BYTES : BENCH_BYTES;
+    }
+
+    benchMsgSize = msgSize;
+    benchMsgCnt = (bytes + msgSize - 1) / msgSize;
+
+    printf("SDI stack over a pty%s, %lu x %u byte messages each way, %s%s\n",
+#ifdef SDI_USE_FRAMING
+           " (framed)",
+#else
+           "",
+#endif //SDI_USE_FRAMING
+           benchMsgCnt, benchMsgSize,
+           benchLineRate ? "at line rate" : "flat out",
+           benchBatch ? ", batched" : "");
+
+#ifndef SDI_USE_FRAMING
+    // The heap path had no batching to compare against. It runs before any
+    // thread is started here, so that it can fork.
+    if (!benchBatch)
+    {
+        ok = runHeapPath();
+        printf(" frame pool TX path (after)\n");
+    }
+#endif //SDI_USE_FRAMING
+
+    if (!openHost())
+    {
+        return 1;
+    }
+
+    SDITask_registerIncomingRXEventAppCB(appRxCB);
+    SDITask_createTask();
+    UARTPty_waitOpen(Board_UART);
+
+    SDITask_getTxConfig(&txConfig);
+    txConfig.batchEnable = benchBatch;
+    SDITask_setTxConfig(&txConfig);
+
+    ok = runTx() && ok;
+    reportStats();
+
+    ok = runRx() && ok;
+    reportStats();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,390 @@
+/******************************************************************************
+
+ @file  rtos_posix.c
+
+  Host build stand-ins for the SYS/BIOS kernel modules and the ICall
+  critical section SDI uses, on top of POSIX threads.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// ****************************************************************************
+// includes
+// ****************************************************************************
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <time.h>
+
+#include <xdc/std.h>
+#include "hal_types.h"
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Event.h>
+#include <ti/sysbios/knl/Queue.h>
+#include <ti/sysbios/knl/Task.h>
+#include "ICall.h"
+
+// ****************************************************************************
+// globals
+// ****************************************************************************
+
+//! \brief Tick period in us, as configured for the CC26xx
+const UInt32 Clock_tickPeriod = 10;
+
+//! \brief ICall critical section. Recursive, like nested interrupt masking.
+static pthread_mutex_t icallLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+//! \brief Makes Queue_put and Queue_get atomic, as on target
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+
+//! \brief Running clocks are kept in one list served by one thread
+static pthread_mutex_t clockLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t clockCond;
+static pthread_once_t clockOnce = PTHREAD_ONCE_INIT;
+static Clock_Struct *clockList;
+
+// -----------------------------------------------------------------------------
+// ICall
+
+ICall_CSState ICall_enterCriticalSection(void)
+{
+    pthread_mutex_lock(&icallLock);
+
+    return 0;
+}
+
+void ICall_leaveCriticalSection(ICall_CSState key)
+{
+    (void)key;
+
+    pthread_mutex_unlock(&icallLock);
+}
+
+// -----------------------------------------------------------------------------
+// Queue
+
+void Queue_construct(Queue_Struct *obj, const Queue_Params *params)
+{
+    (void)params;
+
+    obj->elem.next = &obj->elem;
+    obj->elem.prev = &obj->elem;
+}
+
+void Queue_put(Queue_Handle queue, Queue_Elem *elem)
+{
+    pthread_mutex_lock(&queueLock);
+    elem->next = &queue->elem;
+    elem->prev = queue->elem.prev;
+    queue->elem.prev->next = elem;
+    queue->elem.prev = elem;
+    pthread_mutex_unlock(&queueLock);
+}
+
+// Returns the queue itself when it is empty, as SYS/BIOS does
+Ptr Queue_get(Queue_Handle queue)
+{
+    Queue_Elem *elem;
+
+    pthread_mutex_lock(&queueLock);
+    elem = queue->elem.next;
+    queue->elem.next = elem->next;
+    elem->next->prev = &queue->elem;
+    pthread_mutex_unlock(&queueLock);
+
+    return elem;
+}
+
+Ptr Queue_head(Queue_Handle queue)
+{
+    return queue->elem.next;
+}
+
+Bool Queue_empty(Queue_Handle queue)
+{
+    return queue->elem.next == &queue->elem;
+}
+
+// -----------------------------------------------------------------------------
+// Event
+
+void Event_Params_init(Event_Params *params)
+{
+    params->dummy = 0;
+}
+
+void Event_construct(Event_Struct *obj, const Event_Params *params)
+{
+    pthread_condattr_t attr;
+
+    (void)params;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&obj->lock, NULL);
+    pthread_cond_init(&obj->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    obj->posted = 0;
+}
+
+void Event_post(Event_Handle event, UInt eventMask)
+{
+    pthread_mutex_lock(&event->lock);
+    event->posted |= eventMask;
+    pthread_cond_broadcast(&event->cond);
+    pthread_mutex_unlock(&event->lock);
+}
+
+UInt Event_pend(Event_Handle event, UInt andMask, UInt orMask, UInt32 timeout)
+{
+    UInt events;
+
+    pthread_mutex_lock(&event->lock);
+    for (;;)
+    {
+        if (andMask && ((event->posted & andMask) == andMask))
+        {
+            events = event->posted & (andMask | orMask);
+            break;
+        }
+
+        if (event->posted & orMask)
+        {
+            events = event->posted & orMask;
+            break;
+        }
+
+        if (timeout == BIOS_NO_WAIT)
+        {
+            events = 0;
+            break;
+        }
+
+        pthread_cond_wait(&event->cond, &event->lock);
+    }
+    event->posted &= ~events;
+    pthread_mutex_unlock(&event->lock);
+
+    return events;
+}
+
+// -----------------------------------------------------------------------------
+// Clock
+
+UInt32 Clock_getTicks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (UInt32)(((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000) /
+                    Clock_tickPeriod);
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Clock thread. Runs each clock function once its deadline has
+//!             passed, with no lock held, as the clock Swi would on target.
+//!
+//! \param[in]  arg - N/A
+//!
+//! \return     void* - does not return
+// -----------------------------------------------------------------------------
+static void *Clock_threadFxn(void *arg)
+{
+    Clock_Struct *clock;
+    Clock_Struct *next;
+    struct timespec ts;
+    UInt32 now;
+    UInt32 wait;
+    uint64_t us;
+
+    (void)arg;
+
+    pthread_mutex_lock(&clockLock);
+    for (;;)
+    {
+        now = Clock_getTicks();
+        next = NULL;
+
+        for (clock = clockList; clock != NULL; clock = clock->next)
+        {
+            if (clock->active &&
+                ((next == NULL) ||
+                 ((Int)(clock->deadline - next->deadline) < 0)))
+            {
+                next = clock;
+            }
+        }
+
+        if (next == NULL)
+        {
+            pthread_cond_wait(&clockCond, &clockLock);
+        }
+        else if ((Int)(next->deadline - now) <= 0)
+        {
+            next->active = (next->period != 0);
+            next->deadline += next->period;
+
+            pthread_mutex_unlock(&clockLock);
+            next->fxn(next->arg);
+            pthread_mutex_lock(&clockLock);
+        }
+        else
+        {
+            wait = next->deadline - now;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            us = ts.tv_nsec / 1000 + (uint64_t)wait * Clock_tickPeriod;
+            ts.tv_sec += us / 1000000;
+            ts.tv_nsec = (us % 1000000) * 1000;
+            pthread_cond_timedwait(&clockCond, &clockLock, &ts);
+        }
+    }
+
+    return NULL;
+}
+
+static void Clock_init(void)
+{
+    pthread_condattr_t attr;
+    pthread_t thread;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&clockCond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_create(&thread, NULL, Clock_threadFxn, NULL);
+    pthread_detach(thread);
+}
+
+void Clock_Params_init(Clock_Params *params)
+{
+    params->period = 0;
+    params->startFlag = FALSE;
+    params->arg = 0;
+}
+
+void Clock_construct(Clock_Struct *obj, Clock_FuncPtr fxn, UInt32 timeout,
+                     const Clock_Params *params)
+{
+    pthread_once(&clockOnce, Clock_init);
+
+    obj->fxn = fxn;
+    obj->arg = params->arg;
+    obj->timeout = timeout;
+    obj->period = params->period;
+    obj->active = FALSE;
+
+    pthread_mutex_lock(&clockLock);
+    obj->next = clockList;
+    clockList = obj;
+    pthread_mutex_unlock(&clockLock);
+
+    if (params->startFlag)
+    {
+        Clock_start(obj);
+    }
+}
+
+void Clock_start(Clock_Handle clock)
+{
+    pthread_mutex_lock(&clockLock);
+    clock->deadline = Clock_getTicks() + clock->timeout;
+    clock->active = TRUE;
+    pthread_cond_signal(&clockCond);
+    pthread_mutex_unlock(&clockLock);
+}
+
+void Clock_stop(Clock_Handle clock)
+{
+    pthread_mutex_lock(&clockLock);
+    clock->active = FALSE;
+    pthread_mutex_unlock(&clockLock);
+}
+
+void Clock_setTimeout(Clock_Handle clock, UInt32 timeout)
+{
+    pthread_mutex_lock(&clockLock);
+    clock->timeout = timeout;
+    pthread_mutex_unlock(&clockLock);
+}
+
+Bool Clock_isActive(Clock_Handle clock)
+{
+    Bool active;
+
+    pthread_mutex_lock(&clockLock);
+    active = clock->active;
+    pthread_mutex_unlock(&clockLock);
+
+    return active;
+}
+
+// -----------------------------------------------------------------------------
+// Task
+
+static void *Task_threadFxn(void *arg)
+{
+    Task_Struct *task = arg;
+
+    task->fxn(task->arg0, task->arg1);
+
+    return NULL;
+}
+
+void Task_Params_init(Task_Params *params)
+{
+    params->arg0 = 0;
+    params->arg1 = 0;
+    params->priority = 1;
+    params->stack = NULL;
+    params->stackSize = 0;
+}
+
+void Task_construct(Task_Struct *obj, Task_FuncPtr fxn,
+                    const Task_Params *params, void *eb)
+{
+    (void)eb;
+
+    obj->fxn = fxn;
+    obj->arg0 = params->arg0;
+    obj->arg1 = params->arg1;
+
+    pthread_create(&obj->thread, NULL, Task_threadFxn, obj);
+    pthread_detach(obj->thread);
+}
@@ -0,0 +1,144 @@
+/******************************************************************************
+
+ @file  UART.h
+
+  Host build stand-in for the UART driver API, implemented over a
+  pseudo terminal by uart_pty.c. Only callback mode is supported.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TI_DRIVERS_UART_H
+#define TI_DRIVERS_UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define UART_STATUS_SUCCESS         0
+#define UART_STATUS_ERROR           (-1)
+#define UART_STATUS_UNDEFINEDCMD    (-2)
+#define UART_ERROR                  UART_STATUS_ERROR
+
+#define UART_CMD_RESERVED           32
+
+typedef struct UART_Config_ *UART_Handle;
+
+typedef void (*UART_Callback)(UART_Handle handle, void *buf, size_t count);
+
+typedef enum UART_Mode_
+{
+    UART_MODE_BLOCKING,
+    UART_MODE_CALLBACK
+} UART_Mode;
+
+typedef enum UART_ReturnMode_
+{
+    UART_RETURN_FULL,
+    UART_RETURN_NEWLINE
+} UART_ReturnMode;
+
+typedef enum UART_DataMode_
+{
+    UART_DATA_BINARY = 0,
+    UART_DATA_TEXT = 1
+} UART_DataMode;
+
+typedef enum UART_Echo_
+{
+    UART_ECHO_OFF = 0,
+    UART_ECHO_ON = 1
+} UART_Echo;
+
+typedef enum UART_LEN_
+{
+    UART_LEN_5 = 0,
+    UART_LEN_6 = 1,
+    UART_LEN_7 = 2,
+    UART_LEN_8 = 3
+} UART_LEN;
+
+typedef enum UART_STOP_
+{
+    UART_STOP_ONE = 0,
+    UART_STOP_TWO = 1
+} UART_STOP;
+
+typedef enum UART_PAR_
+{
+    UART_PAR_NONE = 0,
+    UART_PAR_EVEN = 1,
+    UART_PAR_ODD = 2,
+    UART_PAR_ZERO = 3,
+    UART_PAR_ONE = 4
+} UART_PAR;
+
+typedef struct UART_Params_
+{
+    UART_Mode       readMode;
+    UART_Mode       writeMode;
+    uint32_t        readTimeout;
+    uint32_t        writeTimeout;
+    UART_Callback   readCallback;
+    UART_Callback   writeCallback;
+    UART_ReturnMode readReturnMode;
+    UART_DataMode   readDataMode;
+    UART_DataMode   writeDataMode;
+    UART_Echo       readEcho;
+    uint32_t        baudRate;
+    UART_LEN        dataLength;
+    UART_STOP       stopBits;
+    UART_PAR        parityType;
+    void            *custom;
+} UART_Params;
+
+typedef struct UART_Config_
+{
+    void const *fxnTablePtr;
+    void       *object;
+    void const *hwAttrs;
+} UART_Config;
+
+extern void UART_Params_init(UART_Params *params);
+extern UART_Handle UART_open(unsigned int index, UART_Params *params);
+extern void UART_close(UART_Handle handle);
+extern int UART_control(UART_Handle handle, unsigned int cmd, void *arg);
+extern int UART_read(UART_Handle handle, void *buffer, size_t size);
+extern void UART_readCancel(UART_Handle handle);
+extern int UART_write(UART_Handle handle, const void *buffer, size_t size);
+
+#endif /* TI_DRIVERS_UART_H */
@@ -0,0 +1,67 @@
+/******************************************************************************
+
+ @file  UARTCC26XX.h
+
+  Host build stand-in for the CC26XX UART driver. SDI reads the
+  line status from the driver object after each transfer.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TI_DRIVERS_UART_UARTCC26XX_H
+#define TI_DRIVERS_UART_UARTCC26XX_H
+
+#include <stdint.h>
+#include <ti/drivers/UART.h>
+
+#define UARTCC26XX_RETURN_PARTIAL_ENABLE    (UART_CMD_RESERVED + 0)
+#define UARTCC26XX_RETURN_PARTIAL_DISABLE   (UART_CMD_RESERVED + 1)
+
+typedef struct UARTCC26XX_HWAttrs
+{
+    uint32_t baseAddr;
+} UARTCC26XX_HWAttrs;
+
+typedef struct UARTCC26XX_Object
+{
+    uint32_t status;        //!< Line errors of the last transfer, 0 if none
+} UARTCC26XX_Object;
+
+typedef UARTCC26XX_Object *UARTCC26XX_Handle;
+
+#endif /* TI_DRIVERS_UART_UARTCC26XX_H */
@@ -0,0 +1,87 @@
+/******************************************************************************
+
+ @file  Clock.h
+
+  Host build stand-in for the SYS/BIOS Clock module. Clock functions
+  run on a POSIX thread, standing in for the Swi they run in on target.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TI_SYSBIOS_KNL_CLOCK_H
+#define TI_SYSBIOS_KNL_CLOCK_H
+
+#include <xdc/std.h>
+
+typedef void (*Clock_FuncPtr)(UArg arg);
+
+typedef struct Clock_Params
+{
+    UInt32 period;
+    Bool   startFlag;
+    UArg   arg;
+} Clock_Params;
+
+typedef struct Clock_Struct
+{
+    struct Clock_Struct *next;
+    Clock_FuncPtr       fxn;
+    UArg                arg;
+    UInt32              timeout;
+    UInt32              period;
+    Bool                active;
+    UInt32              deadline;
+} Clock_Struct;
+
+typedef Clock_Struct *Clock_Handle;
+
+#define Clock_handle(s)     ((Clock_Handle)(s))
+
+//! \brief Tick period in us, as configured for the CC26xx
+extern const UInt32 Clock_tickPeriod;
+
+extern void Clock_Params_init(Clock_Params *params);
+extern void Clock_construct(Clock_Struct *obj, Clock_FuncPtr fxn,
+                            UInt32 timeout, const Clock_Params *params);
+extern void Clock_start(Clock_Handle clock);
+extern void Clock_stop(Clock_Handle clock);
+extern void Clock_setTimeout(Clock_Handle clock, UInt32 timeout);
+extern Bool Clock_isActive(Clock_Handle clock);
+extern UInt32 Clock_getTicks(void);
+
+#endif /* TI_SYSBIOS_KNL_CLOCK_H */
@@ -0,0 +1,86 @@
+/******************************************************************************
+
+ @file  Event.h
+
+  Host build stand-in for the SYS/BIOS Event module, a mutex and
+  condition variable around the posted event bits.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TI_SYSBIOS_KNL_EVENT_H
+#define TI_SYSBIOS_KNL_EVENT_H
+
+#include <pthread.h>
+#include <xdc/std.h>
+
+#define Event_Id_NONE   0
+#define Event_Id_00     (1u << 0)
+#define Event_Id_01     (1u << 1)
+#define Event_Id_02     (1u << 2)
+#define Event_Id_03     (1u << 3)
+#define Event_Id_04     (1u << 4)
+#define Event_Id_05     (1u << 5)
+#define Event_Id_06     (1u << 6)
+#define Event_Id_07     (1u << 7)
+
+typedef struct Event_Struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    UInt            posted;
+} Event_Struct;
+
+typedef Event_Struct *Event_Handle;
+
+typedef struct Event_Params
+{
+    UInt32 dummy;
+} Event_Params;
+
+#define Event_handle(s)     ((Event_Handle)(s))
+
+extern void Event_Params_init(Event_Params *params);
+extern void Event_construct(Event_Struct *obj, const Event_Params *params);
+extern void Event_post(Event_Handle event, UInt eventMask);
+
+// Only BIOS_WAIT_FOREVER and BIOS_NO_WAIT are supported as timeouts
+extern UInt Event_pend(Event_Handle event, UInt andMask, UInt orMask,
+                       UInt32 timeout);
+
+#endif /* TI_SYSBIOS_KNL_EVENT_H */
@@ -0,0 +1,78 @@
+/******************************************************************************
+
+ @file  Queue.h
+
+  Host build stand-in for the SYS/BIOS Queue module, an intrusive
+  doubly linked list with the same empty-queue semantics. Put and get
+  are atomic with respect to each other, as on target.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TI_SYSBIOS_KNL_QUEUE_H
+#define TI_SYSBIOS_KNL_QUEUE_H
+
+#include <xdc/std.h>
+
+typedef struct Queue_Elem
+{
+    struct Queue_Elem *next;
+    struct Queue_Elem *prev;
+} Queue_Elem;
+
+typedef struct Queue_Struct
+{
+    Queue_Elem elem;
+} Queue_Struct;
+
+typedef Queue_Struct *Queue_Handle;
+
+typedef struct Queue_Params
+{
+    UInt32 dummy;
+} Queue_Params;
+
+#define Queue_handle(s)     ((Queue_Handle)(s))
+
+extern void Queue_construct(Queue_Struct *obj, const Queue_Params *params);
+extern void Queue_put(Queue_Handle queue, Queue_Elem *elem);
+extern Ptr Queue_get(Queue_Handle queue);
+extern Ptr Queue_head(Queue_Handle queue);
+extern Bool Queue_empty(Queue_Handle queue);
+
+#endif /* TI_SYSBIOS_KNL_QUEUE_H */
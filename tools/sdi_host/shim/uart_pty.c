@@ -0,0 +1,629 @@
+/******************************************************************************
+
+ @file  uart_pty.c
+
+  Host build UART driver over a tty, normally the slave side of a
+  pseudo terminal. Reads and writes run on one thread each and finish
+  through the callbacks in UART_Params, as the CC26XX driver's ISR
+  would. A read returns early once the line has been idle for 32 bit
+  periods, as with UARTCC26XX_RETURN_PARTIAL_ENABLE.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// ****************************************************************************
+// includes
+// ****************************************************************************
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal_types.h"
+#include <ti/drivers/UART.h>
+#include <ti/drivers/uart/UARTCC26XX.h>
+#include "uart_pty.h"
+
+// ****************************************************************************
+// defines
+// ****************************************************************************
+
+//! \brief Bits per byte on the line, 8N1
+#define UARTPTY_BITS_PER_BYTE   10
+
+//! \brief Bit periods of silence that end a partial read
+#define UARTPTY_IDLE_BITS       32
+
+//! \brief Shortest idle timeout, the host scheduler cannot do much better
+#define UARTPTY_IDLE_MIN_NS     100000
+
+//! \brief How often a thread waiting on the tty checks for a cancel
+#define UARTPTY_POLL_NS         100000000
+
+// ****************************************************************************
+// typedefs
+// ****************************************************************************
+
+//! \brief One UART. A transfer belongs to the request whose generation it
+//!        started under, and is dropped if a cancel or close moved that on.
+//!
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    const char      *path;
+    int             fd;
+    uint8_t         open;
+    uint8_t         started;
+    UART_Params     params;
+
+    uint8_t         *rxBuf;
+    size_t          rxSize;
+    uint8_t         rxPending;
+    uint32_t        rxGen;
+
+    const uint8_t   *txBuf;
+    size_t          txSize;
+    uint8_t         txPending;
+    uint32_t        txGen;
+    int64_t         txLineFree;
+} UARTPty_Object;
+
+//*****************************************************************************
+// globals
+//*****************************************************************************
+
+//! \brief Driver objects, SDI reads the line status from these
+UARTCC26XX_Object uartCC26XXObjects[UARTPTY_CNT];
+
+static const UARTCC26XX_HWAttrs uartPtyHWAttrs[UARTPTY_CNT];
+
+static UARTPty_Object uartPtyObjects[UARTPTY_CNT];
+
+UART_Config UART_config[UARTPTY_CNT] =
+{
+    { NULL, &uartCC26XXObjects[0], &uartPtyHWAttrs[0] },
+};
+
+static pthread_once_t uartPtyOnce = PTHREAD_ONCE_INIT;
+static volatile uint8_t uartPtyLineRate;
+
+// -----------------------------------------------------------------------------
+//! \brief      Monotonic time in ns
+//!
+//! \return     int64_t - time
+// -----------------------------------------------------------------------------
+static int64_t UARTPty_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      With line rate pacing on, wait until count more bytes would
+//!             have left on a line that is busy until *pLineFree. Received
+//!             bytes come in as fast as the other end sends them.
+//!
+//! \param[in]  pUart     - UART
+//! \param[in]  pLineFree - when the line is next free, moved on
+//! \param[in]  start     - when the bytes started to go out
+//! \param[in]  count     - number of bytes
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+static void UARTPty_pace(UARTPty_Object *pUart, int64_t *pLineFree,
+                         int64_t start, size_t count)
+{
+    struct timespec ts;
+    int64_t done;
+
+    if (!uartPtyLineRate || (pUart->params.baudRate == 0))
+    {
+        return;
+    }
+
+    done = (*pLineFree > start) ? *pLineFree : start;
+    done += (int64_t)count * UARTPTY_BITS_PER_BYTE * 1000000000 /
+            pUart->params.baudRate;
+    *pLineFree = done;
+
+    ts.tv_sec = done / 1000000000;
+    ts.tv_nsec = done % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Whether a read or write request is still the one in progress
+//!
+//! \param[in]  pUart   - UART
+//! \param[in]  pActive - rxPending or txPending
+//! \param[in]  pGen    - rxGen or txGen
+//! \param[in]  gen     - generation the transfer started under
+//!
+//! \return     uint8_t - TRUE if the transfer should go on
+// -----------------------------------------------------------------------------
+static uint8_t UARTPty_isCurrent(UARTPty_Object *pUart,
+                                 const uint8_t *pActive,
+                                 const uint32_t *pGen, uint32_t gen)
+{
+    uint8_t current;
+
+    pthread_mutex_lock(&pUart->lock);
+    current = *pActive && (*pGen == gen);
+    pthread_mutex_unlock(&pUart->lock);
+
+    return current;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Read thread. Fills each read request until it is full or the
+//!             line goes idle after at least one byte.
+//!
+//! \param[in]  arg - UART index
+//!
+//! \return     void* - does not return
+// -----------------------------------------------------------------------------
+static void *UARTPty_rxThreadFxn(void *arg)
+{
+    unsigned int index = (unsigned int)(uintptr_t)arg;
+    UARTPty_Object *pUart = &uartPtyObjects[index];
+    struct pollfd pfd;
+    struct timespec idle;
+    struct timespec pollWait;
+    struct timespec *pWait;
+    uint8_t *pBuf;
+    size_t size;
+    size_t count;
+    ssize_t n;
+    uint32_t gen;
+    int64_t idleNs;
+
+    pollWait.tv_sec = 0;
+    pollWait.tv_nsec = UARTPTY_POLL_NS;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pUart->lock);
+        while (!pUart->rxPending)
+        {
+            pthread_cond_wait(&pUart->cond, &pUart->lock);
+        }
+        pBuf = pUart->rxBuf;
+        size = pUart->rxSize;
+        gen = pUart->rxGen;
+        pfd.fd = pUart->fd;
+        idleNs = (pUart->params.baudRate != 0) ?
+                 (int64_t)UARTPTY_IDLE_BITS * 1000000000 /
+                 pUart->params.baudRate : 0;
+        pthread_mutex_unlock(&pUart->lock);
+
+        if (idleNs < UARTPTY_IDLE_MIN_NS)
+        {
+            idleNs = UARTPTY_IDLE_MIN_NS;
+        }
+        idle.tv_sec = 0;
+        idle.tv_nsec = idleNs;
+
+        count = 0;
+        while ((count < size) &&
+               UARTPty_isCurrent(pUart, &pUart->rxPending, &pUart->rxGen, gen))
+        {
+            pfd.events = POLLIN;
+            pWait = count ? &idle : &pollWait;
+
+            if (ppoll(&pfd, 1, pWait, NULL) <= 0)
+            {
+                if (count)
+                {
+                    // Line went idle
+                    break;
+                }
+                continue;
+            }
+
+            if (!(pfd.revents & POLLIN))
+            {
+                // No host on the other end yet
+                nanosleep(&pollWait, NULL);
+                continue;
+            }
+
+            n = read(pfd.fd, pBuf + count, size - count);
+            if (n > 0)
+            {
+                count += n;
+            }
+        }
+
+        pthread_mutex_lock(&pUart->lock);
+        if (!pUart->rxPending || (pUart->rxGen != gen))
+        {
+            pthread_mutex_unlock(&pUart->lock);
+            continue;
+        }
+        pUart->rxPending = FALSE;
+        pthread_mutex_unlock(&pUart->lock);
+
+        uartCC26XXObjects[index].status = 0;
+        pUart->params.readCallback(&UART_config[index], pBuf, count);
+    }
+
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+//! \brief      Write thread. Puts each write request on the tty in full.
+//!
+//! \param[in]  arg - UART index
+//!
+//! \return     void* - does not return
+// -----------------------------------------------------------------------------
+static void *UARTPty_txThreadFxn(void *arg)
+{
+    unsigned int index = (unsigned int)(uintptr_t)arg;
+    UARTPty_Object *pUart = &uartPtyObjects[index];
+    struct pollfd pfd;
+    struct timespec pollWait;
+    const uint8_t *pBuf;
+    size_t size;
+    size_t count;
+    ssize_t n;
+    uint32_t gen;
+    int64_t start;
+
+    pollWait.tv_sec = 0;
+    pollWait.tv_nsec = UARTPTY_POLL_NS;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pUart->lock);
+        while (!pUart->txPending)
+        {
+            pthread_cond_wait(&pUart->cond, &pUart->lock);
+        }
+        pBuf = pUart->txBuf;
+        size = pUart->txSize;
+        gen = pUart->txGen;
+        pfd.fd = pUart->fd;
+        pthread_mutex_unlock(&pUart->lock);
+
+        start = UARTPty_now();
+        count = 0;
+        while ((count < size) &&
+               UARTPty_isCurrent(pUart, &pUart->txPending, &pUart->txGen, gen))
+        {
+            pfd.events = POLLOUT;
+            if (ppoll(&pfd, 1, &pollWait, NULL) <= 0)
+            {
+                continue;
+            }
+
+            n = write(pfd.fd, pBuf + count, size - count);
+            if (n > 0)
+            {
+                count += n;
+            }
+            else if ((n < 0) && (errno != EAGAIN))
+            {
+                // No host on the other end, the bytes are lost on the line
+                count = size;
+            }
+        }
+
+        UARTPty_pace(pUart, &pUart->txLineFree, start, count);
+
+        pthread_mutex_lock(&pUart->lock);
+        if (!pUart->txPending || (pUart->txGen != gen))
+        {
+            pthread_mutex_unlock(&pUart->lock);
+            continue;
+        }
+        pUart->txPending = FALSE;
+        pthread_mutex_unlock(&pUart->lock);
+
+        uartCC26XXObjects[index].status = 0;
+        pUart->params.writeCallback(&UART_config[index], (void *)pBuf, count);
+    }
+
+    return NULL;
+}
+
+static void UARTPty_init(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < UARTPTY_CNT; i++)
+    {
+        pthread_mutex_init(&uartPtyObjects[i].lock, NULL);
+        pthread_cond_init(&uartPtyObjects[i].cond, NULL);
+        uartPtyObjects[i].fd = -1;
+    }
+}
+
+static UARTPty_Object *UARTPty_fromHandle(UART_Handle handle)
+{
+    return &uartPtyObjects[handle - UART_config];
+}
+
+// -----------------------------------------------------------------------------
+// Setup
+
+void UARTPty_setPath(unsigned int index, const char *path)
+{
+    pthread_once(&uartPtyOnce, UARTPty_init);
+
+    pthread_mutex_lock(&uartPtyObjects[index].lock);
+    uartPtyObjects[index].path = path;
+    pthread_mutex_unlock(&uartPtyObjects[index].lock);
+}
+
+void UARTPty_setLineRate(bool enable)
+{
+    uartPtyLineRate = enable;
+}
+
+void UARTPty_waitOpen(unsigned int index)
+{
+    UARTPty_Object *pUart = &uartPtyObjects[index];
+
+    pthread_once(&uartPtyOnce, UARTPty_init);
+
+    pthread_mutex_lock(&pUart->lock);
+    while (!pUart->open)
+    {
+        pthread_cond_wait(&pUart->cond, &pUart->lock);
+    }
+    pthread_mutex_unlock(&pUart->lock);
+}
+
+// -----------------------------------------------------------------------------
+// UART driver
+
+void UART_Params_init(UART_Params *params)
+{
+    params->readMode = UART_MODE_BLOCKING;
+    params->writeMode = UART_MODE_BLOCKING;
+    params->readTimeout = ~(uint32_t)0;
+    params->writeTimeout = ~(uint32_t)0;
+    params->readCallback = NULL;
+    params->writeCallback = NULL;
+    params->readReturnMode = UART_RETURN_NEWLINE;
+    params->readDataMode = UART_DATA_TEXT;
+    params->writeDataMode = UART_DATA_TEXT;
+    params->readEcho = UART_ECHO_ON;
+    params->baudRate = 115200;
+    params->dataLength = UART_LEN_8;
+    params->stopBits = UART_STOP_ONE;
+    params->parityType = UART_PAR_NONE;
+    params->custom = NULL;
+}
+
+// Only callback mode is supported, both ways
+UART_Handle UART_open(unsigned int index, UART_Params *params)
+{
+    UARTPty_Object *pUart;
+    struct termios tio;
+    pthread_t thread;
+    int fd;
+
+    if ((index >= UARTPTY_CNT) || (params == NULL) ||
+        (params->readMode != UART_MODE_CALLBACK) ||
+        (params->writeMode != UART_MODE_CALLBACK))
+    {
+        return NULL;
+    }
+
+    pthread_once(&uartPtyOnce, UARTPty_init);
+    pUart = &uartPtyObjects[index];
+
+    pthread_mutex_lock(&pUart->lock);
+    if (pUart->open || (pUart->path == NULL))
+    {
+        pthread_mutex_unlock(&pUart->lock);
+        return NULL;
+    }
+
+    fd = open(pUart->path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        pthread_mutex_unlock(&pUart->lock);
+        return NULL;
+    }
+
+    // Raw bytes, no echo or line editing
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    pUart->fd = fd;
+    pUart->params = *params;
+    pUart->rxPending = FALSE;
+    pUart->txPending = FALSE;
+    pUart->txLineFree = 0;
+    pUart->open = TRUE;
+
+    if (!pUart->started)
+    {
+        pthread_create(&thread, NULL, UARTPty_rxThreadFxn,
+                       (void *)(uintptr_t)index);
+        pthread_detach(thread);
+        pthread_create(&thread, NULL, UARTPty_txThreadFxn,
+                       (void *)(uintptr_t)index);
+        pthread_detach(thread);
+        pUart->started = TRUE;
+    }
+
+    pthread_cond_broadcast(&pUart->cond);
+    pthread_mutex_unlock(&pUart->lock);
+
+    return &UART_config[index];
+}
+
+// Transfers still in progress are dropped without a callback
+void UART_close(UART_Handle handle)
+{
+    UARTPty_Object *pUart;
+    int fd;
+
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    pUart = UARTPty_fromHandle(handle);
+
+    pthread_mutex_lock(&pUart->lock);
+    fd = pUart->fd;
+    pUart->fd = -1;
+    pUart->open = FALSE;
+    pUart->rxPending = FALSE;
+    pUart->rxGen++;
+    pUart->txPending = FALSE;
+    pUart->txGen++;
+    pthread_mutex_unlock(&pUart->lock);
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+int UART_control(UART_Handle handle, unsigned int cmd, void *arg)
+{
+    (void)arg;
+
+    if (handle == NULL)
+    {
+        return UART_STATUS_ERROR;
+    }
+
+    switch (cmd)
+    {
+        case UARTCC26XX_RETURN_PARTIAL_ENABLE:
+            // Reads always return on an idle line
+            return UART_STATUS_SUCCESS;
+
+        default:
+            return UART_STATUS_UNDEFINEDCMD;
+    }
+}
+
+int UART_read(UART_Handle handle, void *buffer, size_t size)
+{
+    UARTPty_Object *pUart;
+
+    if (handle == NULL)
+    {
+        return UART_ERROR;
+    }
+
+    pUart = UARTPty_fromHandle(handle);
+
+    pthread_mutex_lock(&pUart->lock);
+    if (!pUart->open || pUart->rxPending)
+    {
+        pthread_mutex_unlock(&pUart->lock);
+        return UART_ERROR;
+    }
+    pUart->rxBuf = buffer;
+    pUart->rxSize = size;
+    pUart->rxPending = TRUE;
+    pUart->rxGen++;
+    pthread_cond_broadcast(&pUart->cond);
+    pthread_mutex_unlock(&pUart->lock);
+
+    return 0;
+}
+
+// Bytes already taken off the tty for the read are dropped with it, and the
+// read callback is not called
+void UART_readCancel(UART_Handle handle)
+{
+    UARTPty_Object *pUart;
+
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    pUart = UARTPty_fromHandle(handle);
+
+    pthread_mutex_lock(&pUart->lock);
+    pUart->rxPending = FALSE;
+    pUart->rxGen++;
+    pthread_mutex_unlock(&pUart->lock);
+}
+
+int UART_write(UART_Handle handle, const void *buffer, size_t size)
+{
+    UARTPty_Object *pUart;
+
+    if (handle == NULL)
+    {
+        return UART_ERROR;
+    }
+
+    pUart = UARTPty_fromHandle(handle);
+
+    pthread_mutex_lock(&pUart->lock);
+    if (!pUart->open || pUart->txPending)
+    {
+        pthread_mutex_unlock(&pUart->lock);
+        return UART_ERROR;
+    }
+    pUart->txBuf = buffer;
+    pUart->txSize = size;
+    pUart->txPending = TRUE;
+    pUart->txGen++;
+    pthread_cond_broadcast(&pUart->cond);
+    pthread_mutex_unlock(&pUart->lock);
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+/******************************************************************************
+
+ @file  uart_pty.h
+
+  Setup of the host build UART, which runs over a pseudo terminal
+  or any other tty named before the SDI task opens it.
+
+ Group: WCS, BTS
+ Target Device: CC2650, CC2640, CC1350
+
+ ******************************************************************************
+
+ * Copyright (C) 2016 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UART_PTY_H
+#define UART_PTY_H
+
+#include <stdbool.h>
+
+//! \brief Number of UARTs the host build provides
+#define UARTPTY_CNT     1
+
+// -----------------------------------------------------------------------------
+//! \brief      Name the tty a UART index opens, eg. the slave side of a pty
+//!
+//! \param[in]  index - UART index, below UARTPTY_CNT
+//! \param[in]  path  - tty device path, must stay valid while open
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void UARTPty_setPath(unsigned int index, const char *path);
+
+// -----------------------------------------------------------------------------
+//! \brief      Hold each write's callback back until the bytes would have
+//!             left at the configured baud rate, 8N1. Reads are paced by
+//!             whatever drives the other end.
+//!
+//! \param[in]  enable - TRUE to pace writes, FALSE to run flat out
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void UARTPty_setLineRate(bool enable);
+
+// -----------------------------------------------------------------------------
+//! \brief      Wait until a UART index has been opened
+//!
+//! \param[in]  index - UART index, below UARTPTY_CNT
+//!
+//! \return     void
+// -----------------------------------------------------------------------------
+extern void UARTPty_waitOpen(unsigned int index);
+
+#endif /* UART_PTY_H */